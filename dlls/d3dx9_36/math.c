@@ -27,6 +27,12 @@
 
 #include "d3dx9_private.h"
 
+#ifdef __WINE_TARGET
+#define D3DX_SSE
+#define D3DX_SSE_FUNC __WINE_TARGET("sse")
+#include <xmmintrin.h>
+#endif
+
 WINE_DEFAULT_DEBUG_CHANNEL(d3dx);
 
 struct ID3DXMatrixStackImpl
@@ -251,6 +257,219 @@ FLOAT WINAPI D3DXMatrixDeterminant(const D3DXMATRIX *pm)
         pm->u.m[0][2] * v[2] + pm->u.m[0][3] * v[3];
 }
 
+#ifdef D3DX_SSE
+static BOOL use_sse(void)
+{
+    static int supported = -1;
+
+    if (supported == -1) supported = IsProcessorFeaturePresent(PF_XMMI_INSTRUCTIONS_AVAILABLE);
+    return supported;
+}
+
+/* The SSE versions evaluate the sums in the same order as the C versions,
+ * so they give the same results. */
+static inline __m128 D3DX_SSE_FUNC matrix_row_sse(const float *v, const __m128 *rows)
+{
+    __m128 r;
+
+    r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(v[0]), rows[0]), _mm_mul_ps(_mm_set1_ps(v[1]), rows[1]));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v[2]), rows[2]));
+    return _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v[3]), rows[3]));
+}
+
+static void D3DX_SSE_FUNC matrix_multiply_sse(D3DXMATRIX *out, const D3DXMATRIX *m1, const D3DXMATRIX *m2,
+        BOOL transpose)
+{
+    __m128 rows[4], r0, r1, r2, r3;
+    unsigned int i;
+
+    for (i = 0; i < 4; ++i)
+        rows[i] = _mm_loadu_ps(m2->u.m[i]);
+
+    r0 = matrix_row_sse(m1->u.m[0], rows);
+    r1 = matrix_row_sse(m1->u.m[1], rows);
+    r2 = matrix_row_sse(m1->u.m[2], rows);
+    r3 = matrix_row_sse(m1->u.m[3], rows);
+    if (transpose)
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    _mm_storeu_ps(out->u.m[0], r0);
+    _mm_storeu_ps(out->u.m[1], r1);
+    _mm_storeu_ps(out->u.m[2], r2);
+    _mm_storeu_ps(out->u.m[3], r3);
+}
+
+enum vec3_transform
+{
+    VEC3_TRANSFORM,
+    VEC3_TRANSFORM_COORD,
+    VEC3_TRANSFORM_NORMAL,
+};
+
+static void D3DX_SSE_FUNC vec3_transform_array_sse(void *out, UINT outstride, const D3DXVECTOR3 *in,
+        UINT instride, const D3DXMATRIX *matrix, UINT elements, enum vec3_transform type)
+{
+    __m128 rows[4], r;
+    unsigned int i;
+
+    for (i = 0; i < 4; ++i)
+        rows[i] = _mm_loadu_ps(matrix->u.m[i]);
+
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR3 *v = (const D3DXVECTOR3 *)((const char *)in + instride * i);
+        float *o = (float *)((char *)out + outstride * i);
+
+        r = _mm_add_ps(_mm_mul_ps(rows[0], _mm_set1_ps(v->x)), _mm_mul_ps(rows[1], _mm_set1_ps(v->y)));
+        r = _mm_add_ps(r, _mm_mul_ps(rows[2], _mm_set1_ps(v->z)));
+
+        switch (type)
+        {
+            case VEC3_TRANSFORM:
+                _mm_storeu_ps(o, _mm_add_ps(r, rows[3]));
+                break;
+
+            case VEC3_TRANSFORM_COORD:
+                r = _mm_add_ps(r, rows[3]);
+                r = _mm_div_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 3)));
+                /* fall through */
+            case VEC3_TRANSFORM_NORMAL:
+                _mm_storel_pi((__m64 *)o, r);
+                _mm_store_ss(o + 2, _mm_movehl_ps(r, r));
+                break;
+        }
+    }
+}
+
+static void D3DX_SSE_FUNC vec4_transform_array_sse(D3DXVECTOR4 *out, UINT outstride, const D3DXVECTOR4 *in,
+        UINT instride, const D3DXMATRIX *matrix, UINT elements)
+{
+    __m128 rows[4];
+    unsigned int i;
+
+    for (i = 0; i < 4; ++i)
+        rows[i] = _mm_loadu_ps(matrix->u.m[i]);
+
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR4 *v = (const D3DXVECTOR4 *)((const char *)in + instride * i);
+
+        _mm_storeu_ps((float *)((char *)out + outstride * i), matrix_row_sse(&v->x, rows));
+    }
+}
+
+#define D3DX_SWIZZLE(v, x, y, z, w) _mm_shuffle_ps(v, v, _MM_SHUFFLE(w, z, y, x))
+
+static inline __m128 D3DX_SSE_FUNC minor_sse(__m128 a, __m128 b, __m128 c, __m128 d)
+{
+    return _mm_sub_ps(_mm_mul_ps(a, b), _mm_mul_ps(c, d));
+}
+
+static inline __m128 D3DX_SSE_FUNC cofactor_sse(__m128 a, __m128 t0, __m128 b, __m128 t1, __m128 c, __m128 t2)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, t0), _mm_mul_ps(b, t1)), _mm_mul_ps(c, t2));
+}
+
+/* Each lane computes the same 2x2 minors and the same signed sums as the
+ * C version. Flipping the sign of a factor is exact, so the results are the
+ * same. Elements 11 and 15 don't follow the pattern of the rest of their rows
+ * and are computed separately. */
+static BOOL D3DX_SSE_FUNC matrix_inverse_sse(D3DXMATRIX *out, float *determinant, const D3DXMATRIX *m)
+{
+    const __m128 pnpn = _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f);
+    const __m128 npnp = _mm_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+    const __m128 nnpp = _mm_setr_ps(-0.0f, -0.0f, 0.0f, 0.0f);
+    const __m128 ppnn = _mm_setr_ps(0.0f, 0.0f, -0.0f, -0.0f);
+    __m128 c0, c1, c2, c3, t0, t1, t2, r;
+    float det, v[16];
+
+    c0 = _mm_loadu_ps(m->u.m[0]);
+    c1 = _mm_loadu_ps(m->u.m[1]);
+    c2 = _mm_loadu_ps(m->u.m[2]);
+    c3 = _mm_loadu_ps(m->u.m[3]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    t0 = minor_sse(D3DX_SWIZZLE(c2, 2, 2, 1, 1), D3DX_SWIZZLE(c3, 3, 3, 3, 2),
+            D3DX_SWIZZLE(c3, 2, 2, 1, 1), D3DX_SWIZZLE(c2, 3, 3, 3, 2));
+    t1 = minor_sse(D3DX_SWIZZLE(c2, 1, 0, 0, 0), D3DX_SWIZZLE(c3, 3, 3, 3, 2),
+            D3DX_SWIZZLE(c3, 1, 0, 0, 0), D3DX_SWIZZLE(c2, 3, 3, 3, 2));
+    t2 = minor_sse(D3DX_SWIZZLE(c2, 1, 0, 0, 0), D3DX_SWIZZLE(c3, 2, 2, 1, 1),
+            D3DX_SWIZZLE(c3, 1, 0, 0, 0), D3DX_SWIZZLE(c2, 2, 2, 1, 1));
+    _mm_storeu_ps(&v[0], cofactor_sse(_mm_xor_ps(D3DX_SWIZZLE(c1, 1, 0, 0, 0), pnpn), t0,
+            _mm_xor_ps(D3DX_SWIZZLE(c1, 2, 2, 1, 1), npnp), t1,
+            _mm_xor_ps(D3DX_SWIZZLE(c1, 3, 3, 3, 2), pnpn), t2));
+    _mm_storeu_ps(&v[4], cofactor_sse(_mm_xor_ps(D3DX_SWIZZLE(c0, 1, 0, 0, 0), npnp), t0,
+            _mm_xor_ps(D3DX_SWIZZLE(c0, 2, 2, 1, 1), pnpn), t1,
+            _mm_xor_ps(D3DX_SWIZZLE(c0, 3, 3, 3, 2), npnp), t2));
+
+    t0 = minor_sse(D3DX_SWIZZLE(c0, 1, 0, 0, 0), D3DX_SWIZZLE(c1, 2, 2, 1, 1),
+            D3DX_SWIZZLE(c0, 2, 2, 1, 1), D3DX_SWIZZLE(c1, 1, 0, 0, 0));
+    t1 = minor_sse(D3DX_SWIZZLE(c0, 1, 3, 3, 3), D3DX_SWIZZLE(c1, 3, 0, 0, 0),
+            D3DX_SWIZZLE(c0, 3, 0, 0, 0), D3DX_SWIZZLE(c1, 1, 3, 3, 3));
+    t2 = minor_sse(D3DX_SWIZZLE(c0, 2, 2, 1, 1), D3DX_SWIZZLE(c1, 3, 3, 3, 3),
+            D3DX_SWIZZLE(c0, 3, 3, 3, 3), D3DX_SWIZZLE(c1, 2, 2, 1, 1));
+    _mm_storeu_ps(&v[8], cofactor_sse(_mm_xor_ps(D3DX_SWIZZLE(c3, 3, 3, 3, 3), pnpn), t0,
+            _mm_xor_ps(D3DX_SWIZZLE(c3, 2, 2, 1, 1), nnpp), t1,
+            _mm_xor_ps(D3DX_SWIZZLE(c3, 1, 0, 0, 0), pnpn), t2));
+    _mm_storeu_ps(&v[12], cofactor_sse(_mm_xor_ps(D3DX_SWIZZLE(c2, 3, 3, 3, 3), npnp), t0,
+            _mm_xor_ps(D3DX_SWIZZLE(c2, 2, 2, 1, 1), ppnn), t1,
+            _mm_xor_ps(D3DX_SWIZZLE(c2, 1, 0, 0, 0), npnp), t2));
+
+    det = m->u.m[0][0] * v[0] + m->u.m[0][1] * v[4] + m->u.m[0][2] * v[8] + m->u.m[0][3] * v[12];
+    if (det == 0.0f)
+        return FALSE;
+    if (determinant)
+        *determinant = det;
+
+    v[11] = -m->u.m[0][0] * (m->u.m[1][1] * m->u.m[2][3] - m->u.m[1][3] * m->u.m[2][1]) +
+        m->u.m[1][0] * (m->u.m[0][1] * m->u.m[2][3] - m->u.m[0][3] * m->u.m[2][1]) -
+        m->u.m[2][0] * (m->u.m[0][1] * m->u.m[1][3] - m->u.m[0][3] * m->u.m[1][1]);
+    v[15] = m->u.m[0][0] * (m->u.m[1][1] * m->u.m[2][2] - m->u.m[1][2] * m->u.m[2][1]) -
+        m->u.m[1][0] * (m->u.m[0][1] * m->u.m[2][2] - m->u.m[0][2] * m->u.m[2][1]) +
+        m->u.m[2][0] * (m->u.m[0][1] * m->u.m[1][2] - m->u.m[0][2] * m->u.m[1][1]);
+
+    r = _mm_set1_ps(1.0f / det);
+    _mm_storeu_ps(out->u.m[0], _mm_mul_ps(_mm_loadu_ps(&v[0]), r));
+    _mm_storeu_ps(out->u.m[1], _mm_mul_ps(_mm_loadu_ps(&v[4]), r));
+    _mm_storeu_ps(out->u.m[2], _mm_mul_ps(_mm_loadu_ps(&v[8]), r));
+    _mm_storeu_ps(out->u.m[3], _mm_mul_ps(_mm_loadu_ps(&v[12]), r));
+    return TRUE;
+}
+
+static void D3DX_SSE_FUNC quaternion_multiply_sse(D3DXQUATERNION *out, const D3DXQUATERNION *q1,
+        const D3DXQUATERNION *q2)
+{
+    __m128 q, r;
+
+    q = _mm_loadu_ps(&q1->x);
+    r = _mm_mul_ps(_mm_set1_ps(q2->w), q);
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(q2->x),
+            _mm_xor_ps(D3DX_SWIZZLE(q, 3, 2, 1, 0), _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f))));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(q2->y),
+            _mm_xor_ps(D3DX_SWIZZLE(q, 2, 3, 0, 1), _mm_setr_ps(0.0f, 0.0f, -0.0f, -0.0f))));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(q2->z),
+            _mm_xor_ps(D3DX_SWIZZLE(q, 1, 0, 3, 2), _mm_setr_ps(-0.0f, 0.0f, 0.0f, -0.0f))));
+    _mm_storeu_ps(&out->x, r);
+}
+
+static void D3DX_SSE_FUNC quaternion_divide_sse(D3DXQUATERNION *out, const D3DXQUATERNION *q, float norm,
+        BOOL conjugate)
+{
+    __m128 r = _mm_loadu_ps(&q->x);
+
+    if (conjugate)
+        r = _mm_xor_ps(r, _mm_setr_ps(-0.0f, -0.0f, -0.0f, 0.0f));
+    _mm_storeu_ps(&out->x, _mm_div_ps(r, _mm_set1_ps(norm)));
+}
+
+static void D3DX_SSE_FUNC quaternion_blend_sse(D3DXQUATERNION *out, const D3DXQUATERNION *q1, float s,
+        const D3DXQUATERNION *q2, float t)
+{
+    _mm_storeu_ps(&out->x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(s), _mm_loadu_ps(&q1->x)),
+            _mm_mul_ps(_mm_set1_ps(t), _mm_loadu_ps(&q2->x))));
+}
+#endif
+
 D3DXMATRIX* WINAPI D3DXMatrixInverse(D3DXMATRIX *pout, FLOAT *pdeterminant, const D3DXMATRIX *pm)
 {
     FLOAT det, t[3], v[16];
@@ -258,6 +477,11 @@ D3DXMATRIX* WINAPI D3DXMatrixInverse(D3DXMATRIX *pout, FLOAT *pdeterminant, cons
 
     TRACE("pout %p, pdeterminant %p, pm %p\n", pout, pdeterminant, pm);
 
+#ifdef D3DX_SSE
+    if (use_sse())
+        return matrix_inverse_sse(pout, pdeterminant, pm) ? pout : NULL;
+#endif
+
     t[0] = pm->u.m[2][2] * pm->u.m[3][3] - pm->u.m[2][3] * pm->u.m[3][2];
     t[1] = pm->u.m[1][2] * pm->u.m[3][3] - pm->u.m[1][3] * pm->u.m[3][2];
     t[2] = pm->u.m[1][2] * pm->u.m[2][3] - pm->u.m[1][3] * pm->u.m[2][2];
@@ -397,6 +621,14 @@ D3DXMATRIX* WINAPI D3DXMatrixMultiply(D3DXMATRIX *pout, const D3DXMATRIX *pm1, c
 
     TRACE("pout %p, pm1 %p, pm2 %p\n", pout, pm1, pm2);
 
+#ifdef D3DX_SSE
+    if (use_sse())
+    {
+        matrix_multiply_sse(pout, pm1, pm2, FALSE);
+        return pout;
+    }
+#endif
+
     for (i=0; i<4; i++)
     {
         for (j=0; j<4; j++)
@@ -416,6 +648,14 @@ D3DXMATRIX* WINAPI D3DXMatrixMultiplyTranspose(D3DXMATRIX *pout, const D3DXMATRI
 
     TRACE("pout %p, pm1 %p, pm2 %p\n", pout, pm1, pm2);
 
+#ifdef D3DX_SSE
+    if (use_sse())
+    {
+        matrix_multiply_sse(pout, pm1, pm2, TRUE);
+        return pout;
+    }
+#endif
+
     for (i = 0; i < 4; i++)
         for (j = 0; j < 4; j++)
             temp.u.m[j][i] = pm1->u.m[i][0] * pm2->u.m[0][j] + pm1->u.m[i][1] * pm2->u.m[1][j] + pm1->u.m[i][2] * pm2->u.m[2][j] + pm1->u.m[i][3] * pm2->u.m[3][j];
@@ -1382,6 +1622,14 @@ D3DXQUATERNION* WINAPI D3DXQuaternionInverse(D3DXQUATERNION *pout, const D3DXQUA
 
     norm = D3DXQuaternionLengthSq(pq);
 
+#ifdef D3DX_SSE
+    if (use_sse())
+    {
+        quaternion_divide_sse(pout, pq, norm, TRUE);
+        return pout;
+    }
+#endif
+
     pout->x = -pq->x / norm;
     pout->y = -pq->y / norm;
     pout->z = -pq->z / norm;
@@ -1414,6 +1662,14 @@ D3DXQUATERNION* WINAPI D3DXQuaternionMultiply(D3DXQUATERNION *pout, const D3DXQU
 
     TRACE("pout %p, pq1 %p, pq2 %p\n", pout, pq1, pq2);
 
+#ifdef D3DX_SSE
+    if (use_sse())
+    {
+        quaternion_multiply_sse(pout, pq1, pq2);
+        return pout;
+    }
+#endif
+
     out.x = pq2->w * pq1->x + pq2->x * pq1->w + pq2->y * pq1->z - pq2->z * pq1->y;
     out.y = pq2->w * pq1->y - pq2->x * pq1->z + pq2->y * pq1->w + pq2->z * pq1->x;
     out.z = pq2->w * pq1->z + pq2->x * pq1->y - pq2->y * pq1->x + pq2->z * pq1->w;
@@ -1430,6 +1686,14 @@ D3DXQUATERNION * WINAPI D3DXQuaternionNormalize(D3DXQUATERNION *out, const D3DXQ
 
     norm = D3DXQuaternionLength(q);
 
+#ifdef D3DX_SSE
+    if (use_sse())
+    {
+        quaternion_divide_sse(out, q, norm, FALSE);
+        return out;
+    }
+#endif
+
     out->x = q->x / norm;
     out->y = q->y / norm;
     out->z = q->z / norm;
@@ -1554,6 +1818,14 @@ D3DXQUATERNION * WINAPI D3DXQuaternionSlerp(D3DXQUATERNION *out, const D3DXQUATE
         t = sinf(theta * t) / sinf(theta);
     }
 
+#ifdef D3DX_SSE
+    if (use_sse())
+    {
+        quaternion_blend_sse(out, q1, temp, q2, t);
+        return out;
+    }
+#endif
+
     out->x = temp * q1->x + t * q2->x;
     out->y = temp * q1->y + t * q2->y;
     out->z = temp * q1->z + t * q2->z;
@@ -1859,40 +2131,51 @@ D3DXVECTOR3* WINAPI D3DXVec3Normalize(D3DXVECTOR3 *pout, const D3DXVECTOR3 *pv)
     return pout;
 }
 
+static void get_world_view_projection(D3DXMATRIX *m, const D3DXMATRIX *pprojection, const D3DXMATRIX *pview, const D3DXMATRIX *pworld)
+{
+    D3DXMatrixIdentity(m);
+    if (pworld) D3DXMatrixMultiply(m, m, pworld);
+    if (pview) D3DXMatrixMultiply(m, m, pview);
+    if (pprojection) D3DXMatrixMultiply(m, m, pprojection);
+}
+
+static inline void project_to_viewport(D3DXVECTOR3 *pout, const D3DVIEWPORT9 *pviewport)
+{
+    pout->x = pviewport->X +  ( 1.0f + pout->x ) * pviewport->Width / 2.0f;
+    pout->y = pviewport->Y +  ( 1.0f - pout->y ) * pviewport->Height / 2.0f;
+    pout->z = pviewport->MinZ + pout->z * ( pviewport->MaxZ - pviewport->MinZ );
+}
+
 D3DXVECTOR3* WINAPI D3DXVec3Project(D3DXVECTOR3 *pout, const D3DXVECTOR3 *pv, const D3DVIEWPORT9 *pviewport, const D3DXMATRIX *pprojection, const D3DXMATRIX *pview, const D3DXMATRIX *pworld)
 {
     D3DXMATRIX m;
 
     TRACE("pout %p, pv %p, pviewport %p, pprojection %p, pview %p, pworld %p\n", pout, pv, pviewport, pprojection, pview, pworld);
 
-    D3DXMatrixIdentity(&m);
-    if (pworld) D3DXMatrixMultiply(&m, &m, pworld);
-    if (pview) D3DXMatrixMultiply(&m, &m, pview);
-    if (pprojection) D3DXMatrixMultiply(&m, &m, pprojection);
+    get_world_view_projection(&m, pprojection, pview, pworld);
 
     D3DXVec3TransformCoord(pout, pv, &m);
 
     if (pviewport)
-    {
-        pout->x = pviewport->X +  ( 1.0f + pout->x ) * pviewport->Width / 2.0f;
-        pout->y = pviewport->Y +  ( 1.0f - pout->y ) * pviewport->Height / 2.0f;
-        pout->z = pviewport->MinZ + pout->z * ( pviewport->MaxZ - pviewport->MinZ );
-    }
+        project_to_viewport(pout, pviewport);
     return pout;
 }
 
 D3DXVECTOR3* WINAPI D3DXVec3ProjectArray(D3DXVECTOR3* out, UINT outstride, const D3DXVECTOR3* in, UINT instride, const D3DVIEWPORT9* viewport, const D3DXMATRIX* projection, const D3DXMATRIX* view, const D3DXMATRIX* world, UINT elements)
 {
+    D3DXMATRIX m;
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, viewport %p, projection %p, view %p, world %p, elements %u\n",
         out, outstride, in, instride, viewport, projection, view, world, elements);
 
-    for (i = 0; i < elements; ++i) {
-        D3DXVec3Project(
-            (D3DXVECTOR3*)((char*)out + outstride * i),
-            (const D3DXVECTOR3*)((const char*)in + instride * i),
-            viewport, projection, view, world);
+    get_world_view_projection(&m, projection, view, world);
+    D3DXVec3TransformCoordArray(out, outstride, in, instride, &m, elements);
+
+    if (viewport)
+    {
+        for (i = 0; i < elements; ++i)
+            project_to_viewport((D3DXVECTOR3*)((char*)out + outstride * i), viewport);
     }
     return out;
 }
@@ -1917,6 +2200,14 @@ D3DXVECTOR4* WINAPI D3DXVec3TransformArray(D3DXVECTOR4* out, UINT outstride, con
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef D3DX_SSE
+    if (use_sse())
+    {
+        vec3_transform_array_sse(out, outstride, in, instride, matrix, elements, VEC3_TRANSFORM);
+        return out;
+    }
+#endif
+
     for (i = 0; i < elements; ++i) {
         D3DXVec3Transform(
             (D3DXVECTOR4*)((char*)out + outstride * i),
@@ -1950,6 +2241,14 @@ D3DXVECTOR3* WINAPI D3DXVec3TransformCoordArray(D3DXVECTOR3* out, UINT outstride
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef D3DX_SSE
+    if (use_sse())
+    {
+        vec3_transform_array_sse(out, outstride, in, instride, matrix, elements, VEC3_TRANSFORM_COORD);
+        return out;
+    }
+#endif
+
     for (i = 0; i < elements; ++i) {
         D3DXVec3TransformCoord(
             (D3DXVECTOR3*)((char*)out + outstride * i),
@@ -1978,6 +2277,14 @@ D3DXVECTOR3* WINAPI D3DXVec3TransformNormalArray(D3DXVECTOR3* out, UINT outstrid
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef D3DX_SSE
+    if (use_sse())
+    {
+        vec3_transform_array_sse(out, outstride, in, instride, matrix, elements, VEC3_TRANSFORM_NORMAL);
+        return out;
+    }
+#endif
+
     for (i = 0; i < elements; ++i) {
         D3DXVec3TransformNormal(
             (D3DXVECTOR3*)((char*)out + outstride * i),
@@ -1987,41 +2294,46 @@ D3DXVECTOR3* WINAPI D3DXVec3TransformNormalArray(D3DXVECTOR3* out, UINT outstrid
     return out;
 }
 
+static inline void unproject_from_viewport(D3DXVECTOR3 *pout, const D3DVIEWPORT9 *pviewport)
+{
+    pout->x = 2.0f * ( pout->x - pviewport->X ) / pviewport->Width - 1.0f;
+    pout->y = 1.0f - 2.0f * ( pout->y - pviewport->Y ) / pviewport->Height;
+    pout->z = ( pout->z - pviewport->MinZ) / ( pviewport->MaxZ - pviewport->MinZ );
+}
+
 D3DXVECTOR3* WINAPI D3DXVec3Unproject(D3DXVECTOR3 *pout, const D3DXVECTOR3 *pv, const D3DVIEWPORT9 *pviewport, const D3DXMATRIX *pprojection, const D3DXMATRIX *pview, const D3DXMATRIX *pworld)
 {
     D3DXMATRIX m;
 
     TRACE("pout %p, pv %p, pviewport %p, pprojection %p, pview %p, pworlds %p\n", pout, pv, pviewport, pprojection, pview, pworld);
 
-    D3DXMatrixIdentity(&m);
-    if (pworld) D3DXMatrixMultiply(&m, &m, pworld);
-    if (pview) D3DXMatrixMultiply(&m, &m, pview);
-    if (pprojection) D3DXMatrixMultiply(&m, &m, pprojection);
+    get_world_view_projection(&m, pprojection, pview, pworld);
     D3DXMatrixInverse(&m, NULL, &m);
 
     *pout = *pv;
     if (pviewport)
-    {
-        pout->x = 2.0f * ( pout->x - pviewport->X ) / pviewport->Width - 1.0f;
-        pout->y = 1.0f - 2.0f * ( pout->y - pviewport->Y ) / pviewport->Height;
-        pout->z = ( pout->z - pviewport->MinZ) / ( pviewport->MaxZ - pviewport->MinZ );
-    }
+        unproject_from_viewport(pout, pviewport);
     D3DXVec3TransformCoord(pout, pout, &m);
     return pout;
 }
 
 D3DXVECTOR3* WINAPI D3DXVec3UnprojectArray(D3DXVECTOR3* out, UINT outstride, const D3DXVECTOR3* in, UINT instride, const D3DVIEWPORT9* viewport, const D3DXMATRIX* projection, const D3DXMATRIX* view, const D3DXMATRIX* world, UINT elements)
 {
+    D3DXMATRIX m;
+    D3DXVECTOR3 v;
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, viewport %p, projection %p, view %p, world %p, elements %u\n",
         out, outstride, in, instride, viewport, projection, view, world, elements);
 
+    get_world_view_projection(&m, projection, view, world);
+    D3DXMatrixInverse(&m, NULL, &m);
+
     for (i = 0; i < elements; ++i) {
-        D3DXVec3Unproject(
-            (D3DXVECTOR3*)((char*)out + outstride * i),
-            (const D3DXVECTOR3*)((const char*)in + instride * i),
-            viewport, projection, view, world);
+        v = *(const D3DXVECTOR3*)((const char*)in + instride * i);
+        if (viewport)
+            unproject_from_viewport(&v, viewport);
+        D3DXVec3TransformCoord((D3DXVECTOR3*)((char*)out + outstride * i), &v, &m);
     }
     return out;
 }
@@ -2118,6 +2430,14 @@ D3DXVECTOR4* WINAPI D3DXVec4TransformArray(D3DXVECTOR4* out, UINT outstride, con
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef D3DX_SSE
+    if (use_sse())
+    {
+        vec4_transform_array_sse(out, outstride, in, instride, matrix, elements);
+        return out;
+    }
+#endif
+
     for (i = 0; i < elements; ++i) {
         D3DXVec4Transform(
             (D3DXVECTOR4*)((char*)out + outstride * i),
@@ -1221,6 +1221,162 @@ static int compare_vertex_keys(const void *a, const void *b)
     return left->key < right->key ? -1 : 1;
 }
 
+/* Spatial hash of the vertex positions, used to find the vertices within
+ * epsilon of a vertex without scanning all vertices with a similar key. */
+struct vertex_grid
+{
+    DWORD bucket_mask;
+    DWORD *buckets;    /* first vertex in each bucket */
+    DWORD *next;       /* next vertex in the same bucket */
+    DWORD *positions;  /* position of each vertex in the sorted vertices */
+    INT64 (*cells)[3];
+    float cell_size;   /* 0.0f to only group identical positions */
+};
+
+static void vertex_grid_get_cell(const struct vertex_grid *grid, const D3DXVECTOR3 *vertex, INT64 *cell)
+{
+    const double limit = (double)((INT64)1 << 48);
+    const float *v = &vertex->x;
+    double c;
+    unsigned int i;
+
+    for (i = 0; i < 3; ++i)
+    {
+        if (grid->cell_size == 0.0f)
+        {
+            float f = v[i] + 0.0f; /* -0.0f and 0.0f are identical */
+            DWORD bits;
+
+            memcpy(&bits, &f, sizeof(bits));
+            cell[i] = bits;
+            continue;
+        }
+
+        c = floor(v[i] / grid->cell_size);
+        if (!(c >= -limit)) c = -limit;
+        else if (c > limit) c = limit;
+        cell[i] = (INT64)c;
+    }
+}
+
+static DWORD vertex_grid_hash(const struct vertex_grid *grid, const INT64 *cell)
+{
+    UINT64 hash = (UINT64)cell[0] * 73856093 ^ (UINT64)cell[1] * 19349663 ^ (UINT64)cell[2] * 83492791;
+
+    return (DWORD)(hash ^ (hash >> 32)) & grid->bucket_mask;
+}
+
+static HRESULT init_vertex_grid(struct vertex_grid *grid, const BYTE *vertices, DWORD vertex_size,
+        const struct vertex_metadata *sorted_vertices, DWORD vertex_count, float epsilon)
+{
+    DWORD i, bucket;
+
+    grid->bucket_mask = 1;
+    while (grid->bucket_mask < vertex_count)
+        grid->bucket_mask <<= 1;
+    grid->buckets = HeapAlloc(GetProcessHeap(), 0, grid->bucket_mask * sizeof(*grid->buckets));
+    grid->next = HeapAlloc(GetProcessHeap(), 0, vertex_count * sizeof(*grid->next));
+    grid->positions = HeapAlloc(GetProcessHeap(), 0, vertex_count * sizeof(*grid->positions));
+    grid->cells = HeapAlloc(GetProcessHeap(), 0, vertex_count * sizeof(*grid->cells));
+    if (!grid->buckets || !grid->next || !grid->positions || !grid->cells)
+        return E_OUTOFMEMORY;
+    --grid->bucket_mask;
+
+    /* Vertices within epsilon of each other are at most one cell apart. The
+     * cells are made larger than strictly needed to absorb rounding. */
+    grid->cell_size = 2.0f * epsilon;
+
+    memset(grid->buckets, 0xff, (grid->bucket_mask + 1) * sizeof(*grid->buckets));
+    for (i = 0; i < vertex_count; ++i)
+    {
+        vertex_grid_get_cell(grid, (const D3DXVECTOR3 *)(vertices + i * vertex_size), grid->cells[i]);
+        bucket = vertex_grid_hash(grid, grid->cells[i]);
+        grid->next[i] = grid->buckets[bucket];
+        grid->buckets[bucket] = i;
+        grid->positions[sorted_vertices[i].vertex_index] = i;
+    }
+
+    return D3D_OK;
+}
+
+static void cleanup_vertex_grid(struct vertex_grid *grid)
+{
+    HeapFree(GetProcessHeap(), 0, grid->buckets);
+    HeapFree(GetProcessHeap(), 0, grid->next);
+    HeapFree(GetProcessHeap(), 0, grid->positions);
+    HeapFree(GetProcessHeap(), 0, grid->cells);
+}
+
+static int compare_dwords(const void *a, const void *b)
+{
+    const DWORD left = *(const DWORD *)a;
+    const DWORD right = *(const DWORD *)b;
+
+    return left < right ? -1 : left > right;
+}
+
+/* Finds the vertices after sorted position "index" that are coincident with
+ * it, in the order a linear scan of the sorted vertices would find them. */
+static HRESULT find_coincident_vertices(const struct vertex_grid *grid, const BYTE *vertices, DWORD vertex_size,
+        const struct vertex_metadata *sorted_vertices, DWORD index, float epsilon,
+        DWORD **candidates, DWORD *candidates_size, DWORD *candidate_count)
+{
+    const struct vertex_metadata *sorted_vertex_a = &sorted_vertices[index];
+    const D3DXVECTOR3 *vertex_a = (const D3DXVECTOR3 *)(vertices + sorted_vertex_a->vertex_index * vertex_size);
+    const INT64 *cell_a = grid->cells[sorted_vertex_a->vertex_index];
+    int range = grid->cell_size == 0.0f ? 0 : 1;
+    INT64 cell[3];
+    DWORD v, j;
+    int x, y, z;
+
+    *candidate_count = 0;
+    for (x = -range; x <= range; ++x)
+    {
+        for (y = -range; y <= range; ++y)
+        {
+            for (z = -range; z <= range; ++z)
+            {
+                cell[0] = cell_a[0] + x;
+                cell[1] = cell_a[1] + y;
+                cell[2] = cell_a[2] + z;
+
+                for (v = grid->buckets[vertex_grid_hash(grid, cell)]; v != ~0u; v = grid->next[v])
+                {
+                    const D3DXVECTOR3 *vertex_b = (const D3DXVECTOR3 *)(vertices + v * vertex_size);
+
+                    if (memcmp(grid->cells[v], cell, sizeof(cell)))
+                        continue;
+                    j = grid->positions[v];
+                    if (j <= index || sorted_vertices[j].key - sorted_vertex_a->key > epsilon * 3.0f)
+                        continue;
+                    if (!(fabsf(vertex_a->x - vertex_b->x) <= epsilon
+                            && fabsf(vertex_a->y - vertex_b->y) <= epsilon
+                            && fabsf(vertex_a->z - vertex_b->z) <= epsilon))
+                        continue;
+
+                    if (*candidate_count == *candidates_size)
+                    {
+                        DWORD new_size = max(16, *candidates_size * 2);
+                        DWORD *new_candidates = *candidates
+                                ? HeapReAlloc(GetProcessHeap(), 0, *candidates, new_size * sizeof(**candidates))
+                                : HeapAlloc(GetProcessHeap(), 0, new_size * sizeof(**candidates));
+
+                        if (!new_candidates)
+                            return E_OUTOFMEMORY;
+                        *candidates = new_candidates;
+                        *candidates_size = new_size;
+                    }
+                    (*candidates)[(*candidate_count)++] = j;
+                }
+            }
+        }
+    }
+
+    if (*candidate_count > 1)
+        qsort(*candidates, *candidate_count, sizeof(**candidates), compare_dwords);
+    return D3D_OK;
+}
+
 static HRESULT WINAPI d3dx9_mesh_GenerateAdjacency(ID3DXMesh *iface, float epsilon, DWORD *adjacency)
 {
     struct d3dx9_mesh *This = impl_from_ID3DXMesh(iface);
@@ -1235,6 +1391,9 @@ static HRESULT WINAPI d3dx9_mesh_GenerateAdjacency(ID3DXMesh *iface, float epsil
      * that adjacency checks can be limited to faces sharing a vertex */
     DWORD *shared_indices = NULL;
     const FLOAT epsilon_sq = epsilon * epsilon;
+    struct vertex_grid grid = {0};
+    DWORD *candidates = NULL;
+    DWORD candidates_size = 0, candidate_count = 0;
     DWORD i;
 
     TRACE("iface %p, epsilon %.8e, adjacency %p.\n", iface, epsilon, adjacency);
@@ -1278,15 +1437,22 @@ static HRESULT WINAPI d3dx9_mesh_GenerateAdjacency(ID3DXMesh *iface, float epsil
     }
     qsort(sorted_vertices, This->numvertices, sizeof(*sorted_vertices), compare_vertex_keys);
 
+    /* a negative epsilon means only identical indices are coincident */
+    if (epsilon >= 0.0f && FAILED(hr = init_vertex_grid(&grid, vertices, vertex_size,
+            sorted_vertices, This->numvertices, epsilon)))
+        goto cleanup;
+
     for (i = 0; i < This->numvertices; i++) {
         struct vertex_metadata *sorted_vertex_a = &sorted_vertices[i];
-        D3DXVECTOR3 *vertex_a = (D3DXVECTOR3*)(vertices + sorted_vertex_a->vertex_index * vertex_size);
         DWORD shared_index_a = sorted_vertex_a->first_shared_index;
 
+        if (shared_index_a != -1 && grid.buckets && FAILED(hr = find_coincident_vertices(&grid, vertices,
+                vertex_size, sorted_vertices, i, epsilon, &candidates, &candidates_size, &candidate_count)))
+            goto cleanup;
+
         while (shared_index_a != -1) {
-            DWORD j = i;
+            DWORD j = 0;
             DWORD shared_index_b = shared_indices[shared_index_a];
-            struct vertex_metadata *sorted_vertex_b = sorted_vertex_a;
 
             while (TRUE) {
                 while (shared_index_b != -1) {
@@ -1331,27 +1497,10 @@ static HRESULT WINAPI d3dx9_mesh_GenerateAdjacency(ID3DXMesh *iface, float epsil
 
                     shared_index_b = shared_indices[shared_index_b];
                 }
-                while (++j < This->numvertices) {
-                    D3DXVECTOR3 *vertex_b;
-
-                    sorted_vertex_b++;
-                    if (sorted_vertex_b->key - sorted_vertex_a->key > epsilon * 3.0f) {
-                        /* no more coincident vertices to try */
-                        j = This->numvertices;
-                        break;
-                    }
-                    /* check for coincidence */
-                    vertex_b = (D3DXVECTOR3*)(vertices + sorted_vertex_b->vertex_index * vertex_size);
-                    if (fabsf(vertex_a->x - vertex_b->x) <= epsilon &&
-                        fabsf(vertex_a->y - vertex_b->y) <= epsilon &&
-                        fabsf(vertex_a->z - vertex_b->z) <= epsilon)
-                    {
-                        break;
-                    }
-                }
-                if (j >= This->numvertices)
+                /* continue with the next coincident vertex */
+                if (j >= candidate_count)
                     break;
-                shared_index_b = sorted_vertex_b->first_shared_index;
+                shared_index_b = sorted_vertices[candidates[j++]].first_shared_index;
             }
 
             sorted_vertex_a->first_shared_index = shared_indices[sorted_vertex_a->first_shared_index];
@@ -1364,6 +1513,8 @@ cleanup:
     if (indices) iface->lpVtbl->UnlockIndexBuffer(iface);
     if (vertices) iface->lpVtbl->UnlockVertexBuffer(iface);
     HeapFree(GetProcessHeap(), 0, shared_indices);
+    cleanup_vertex_grid(&grid);
+    HeapFree(GetProcessHeap(), 0, candidates);
     return hr;
 }
 
@@ -1640,6 +1791,330 @@ static HRESULT remap_faces_for_attrsort(struct d3dx9_mesh *This, const DWORD *in
     return D3D_OK;
 }
 
+/* Vertex cache optimization, after Tom Forsyth's "Linear-Speed Vertex Cache
+ * Optimisation". Vertices are scored by their position in a simulated LRU
+ * cache and by the number of faces still using them, and the face with the
+ * highest score among those using cached vertices is emitted next. */
+#define VERTEX_CACHE_SIZE 32
+/* FIFO cache size used to measure the result, typical of real hardware */
+#define VERTEX_FIFO_SIZE  16
+
+struct vertex_cache_entry
+{
+    int cache_position;
+    float score;
+    DWORD face_count;  /* faces not emitted yet */
+    DWORD first_face;  /* first entry in the vertex face list */
+};
+
+static float get_vertex_cache_score(const struct vertex_cache_entry *vertex)
+{
+    float score = 0.0f;
+
+    if (!vertex->face_count)
+        return -1.0f;
+
+    if (vertex->cache_position >= 0)
+    {
+        /* the vertices of the last face are scored lower so that the next
+         * face doesn't just reuse the same edge */
+        if (vertex->cache_position < 3)
+            score = 0.75f;
+        else
+            score = powf(1.0f - (vertex->cache_position - 3) * (1.0f / (VERTEX_CACHE_SIZE - 3)), 1.5f);
+    }
+
+    /* favor vertices with few remaining faces to get rid of them */
+    return score + 2.0f / sqrtf(vertex->face_count);
+}
+
+/* Fills face_order with the original index of each face in drawing order. */
+static HRESULT optimize_faces_for_vertex_cache(const DWORD *indices, DWORD num_faces, DWORD num_vertices,
+        DWORD *face_order)
+{
+    DWORD cache[VERTEX_CACHE_SIZE + 3], new_cache[VERTEX_CACHE_SIZE + 3];
+    DWORD cache_count = 0, new_cache_count;
+    struct vertex_cache_entry *vertices;
+    DWORD *vertex_faces;
+    float *face_scores, best_score;
+    DWORD best_face = ~0u, next_face = 0;
+    DWORD i, j, k, v, f;
+
+    for (i = 0; i < num_faces * 3; ++i)
+    {
+        if (indices[i] >= num_vertices)
+            return D3DERR_INVALIDCALL;
+    }
+
+    vertices = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, num_vertices * sizeof(*vertices));
+    vertex_faces = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*vertex_faces));
+    face_scores = HeapAlloc(GetProcessHeap(), 0, num_faces * sizeof(*face_scores));
+    if (!vertices || !vertex_faces || !face_scores)
+    {
+        HeapFree(GetProcessHeap(), 0, vertices);
+        HeapFree(GetProcessHeap(), 0, vertex_faces);
+        HeapFree(GetProcessHeap(), 0, face_scores);
+        return E_OUTOFMEMORY;
+    }
+
+    /* build the list of faces using each vertex */
+    for (i = 0; i < num_faces * 3; ++i)
+        ++vertices[indices[i]].face_count;
+    for (i = 0, j = 0; i < num_vertices; ++i)
+    {
+        vertices[i].first_face = j;
+        j += vertices[i].face_count;
+        vertices[i].face_count = 0;
+        vertices[i].cache_position = -1;
+    }
+    for (i = 0; i < num_faces * 3; ++i)
+    {
+        v = indices[i];
+        vertex_faces[vertices[v].first_face + vertices[v].face_count++] = i / 3;
+    }
+
+    for (i = 0; i < num_vertices; ++i)
+        vertices[i].score = get_vertex_cache_score(&vertices[i]);
+    for (i = 0; i < num_faces; ++i)
+        face_scores[i] = vertices[indices[i * 3]].score + vertices[indices[i * 3 + 1]].score
+                + vertices[indices[i * 3 + 2]].score;
+
+    for (i = 0; i < num_faces; ++i)
+    {
+        if (best_face == ~0u)
+        {
+            /* none of the cached vertices has faces left, continue with the
+             * next face in the original order */
+            while (face_scores[next_face] < 0.0f)
+                ++next_face;
+            best_face = next_face;
+        }
+
+        face_order[i] = best_face;
+        face_scores[best_face] = -1.0f;
+
+        /* move the vertices of the face to the front of the cache */
+        new_cache_count = 0;
+        for (k = 0; k < 3; ++k)
+        {
+            struct vertex_cache_entry *vertex = &vertices[indices[best_face * 3 + k]];
+            DWORD *faces = &vertex_faces[vertex->first_face];
+
+            for (j = 0; j < vertex->face_count; ++j)
+            {
+                if (faces[j] == best_face)
+                {
+                    faces[j] = faces[--vertex->face_count];
+                    break;
+                }
+            }
+
+            for (j = 0; j < new_cache_count; ++j)
+            {
+                if (new_cache[j] == indices[best_face * 3 + k])
+                    break;
+            }
+            if (j == new_cache_count)
+                new_cache[new_cache_count++] = indices[best_face * 3 + k];
+        }
+        for (j = 0; j < cache_count; ++j)
+        {
+            v = cache[j];
+            if (v != indices[best_face * 3] && v != indices[best_face * 3 + 1] && v != indices[best_face * 3 + 2])
+                new_cache[new_cache_count++] = v;
+        }
+
+        for (j = 0; j < new_cache_count; ++j)
+        {
+            v = new_cache[j];
+            vertices[v].cache_position = j < VERTEX_CACHE_SIZE ? j : -1;
+            vertices[v].score = get_vertex_cache_score(&vertices[v]);
+        }
+        cache_count = min(new_cache_count, VERTEX_CACHE_SIZE);
+        memcpy(cache, new_cache, cache_count * sizeof(*cache));
+
+        /* rescore the faces touching the updated vertices, and pick the best
+         * one using a cached vertex */
+        best_face = ~0u;
+        best_score = -1.0f;
+        for (j = 0; j < new_cache_count; ++j)
+        {
+            struct vertex_cache_entry *vertex = &vertices[new_cache[j]];
+
+            for (k = 0; k < vertex->face_count; ++k)
+            {
+                f = vertex_faces[vertex->first_face + k];
+                face_scores[f] = vertices[indices[f * 3]].score + vertices[indices[f * 3 + 1]].score
+                        + vertices[indices[f * 3 + 2]].score;
+                if (vertex->cache_position >= 0 && face_scores[f] > best_score)
+                {
+                    best_face = f;
+                    best_score = face_scores[f];
+                }
+            }
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, vertices);
+    HeapFree(GetProcessHeap(), 0, vertex_faces);
+    HeapFree(GetProcessHeap(), 0, face_scores);
+    return D3D_OK;
+}
+
+/* Counts the vertex cache misses when drawing the faces in the given order
+ * with a FIFO vertex cache. */
+static DWORD count_vertex_cache_misses(const DWORD *indices, const DWORD *face_order, DWORD num_faces,
+        DWORD num_vertices, DWORD *timestamps)
+{
+    DWORD misses = 0;
+    DWORD i, k, v;
+
+    memset(timestamps, 0xff, num_vertices * sizeof(*timestamps));
+    for (i = 0; i < num_faces; ++i)
+    {
+        for (k = 0; k < 3; ++k)
+        {
+            v = indices[face_order[i] * 3 + k];
+            if (timestamps[v] != ~0u && misses - timestamps[v] <= VERTEX_FIFO_SIZE)
+                continue;
+            timestamps[v] = misses++;
+        }
+    }
+    return misses;
+}
+
+/* Fills vertex_remap (new -> old) with the vertices in the order the faces
+ * first use them, followed by -1 for unused vertices, and vertex_map with the
+ * inverse mapping. Returns the number of used vertices. */
+static DWORD remap_vertices_by_first_use(const DWORD *indices, const DWORD *face_order, DWORD num_faces,
+        DWORD num_vertices, DWORD *vertex_remap, DWORD *vertex_map)
+{
+    DWORD num_used_vertices = 0;
+    DWORD i, k, v;
+
+    memset(vertex_map, 0xff, num_vertices * sizeof(*vertex_map));
+    for (i = 0; i < num_faces; ++i)
+    {
+        for (k = 0; k < 3; ++k)
+        {
+            v = indices[(face_order ? face_order[i] : i) * 3 + k];
+            if (vertex_map[v] != ~0u)
+                continue;
+            vertex_map[v] = num_used_vertices;
+            vertex_remap[num_used_vertices++] = v;
+        }
+    }
+    for (i = num_used_vertices; i < num_vertices; ++i)
+        vertex_remap[i] = ~0u;
+
+    return num_used_vertices;
+}
+
+/* Reorders the faces of each attribute range of an attribute sorted mesh for
+ * the vertex cache. face_remap is the old -> new mapping, and is updated.
+ * The vertices of each range are renumbered first, so that the work done per
+ * range depends on the size of the range rather than of the whole mesh. */
+static HRESULT remap_faces_for_vertex_cache(struct d3dx9_mesh *This, const DWORD *indices,
+        const DWORD *sorted_attrib_buffer, DWORD *face_remap)
+{
+    DWORD *face_order, *range_indices, *range_order, *range_vertices, *vertex_map;
+    DWORD start, end, num_range_vertices, i, k, v;
+    HRESULT hr = D3D_OK;
+
+    face_order = HeapAlloc(GetProcessHeap(), 0, This->numfaces * sizeof(*face_order));
+    range_indices = HeapAlloc(GetProcessHeap(), 0, This->numfaces * 3 * sizeof(*range_indices));
+    range_order = HeapAlloc(GetProcessHeap(), 0, This->numfaces * sizeof(*range_order));
+    range_vertices = HeapAlloc(GetProcessHeap(), 0, This->numfaces * 3 * sizeof(*range_vertices));
+    vertex_map = HeapAlloc(GetProcessHeap(), 0, This->numvertices * sizeof(*vertex_map));
+    if (!face_order || !range_indices || !range_order || !range_vertices || !vertex_map)
+    {
+        hr = E_OUTOFMEMORY;
+        goto done;
+    }
+
+    for (i = 0; i < This->numfaces; ++i)
+        face_order[face_remap[i]] = i;
+    memset(vertex_map, 0xff, This->numvertices * sizeof(*vertex_map));
+
+    for (start = 0; start < This->numfaces; start = end)
+    {
+        for (end = start + 1; end < This->numfaces; ++end)
+        {
+            if (sorted_attrib_buffer[end] != sorted_attrib_buffer[start])
+                break;
+        }
+
+        num_range_vertices = 0;
+        for (i = start; i < end; ++i)
+        {
+            for (k = 0; k < 3; ++k)
+            {
+                v = indices[face_order[i] * 3 + k];
+                if (v >= This->numvertices)
+                {
+                    hr = D3DERR_INVALIDCALL;
+                    goto done;
+                }
+                if (vertex_map[v] == ~0u)
+                {
+                    vertex_map[v] = num_range_vertices;
+                    range_vertices[num_range_vertices++] = v;
+                }
+                range_indices[(i - start) * 3 + k] = vertex_map[v];
+            }
+        }
+        if (FAILED(hr = optimize_faces_for_vertex_cache(range_indices, end - start, num_range_vertices, range_order)))
+            goto done;
+        for (i = start; i < end; ++i)
+            face_remap[face_order[start + range_order[i - start]]] = i;
+        for (i = 0; i < num_range_vertices; ++i)
+            vertex_map[range_vertices[i]] = ~0u;
+    }
+
+done:
+    HeapFree(GetProcessHeap(), 0, face_order);
+    HeapFree(GetProcessHeap(), 0, range_indices);
+    HeapFree(GetProcessHeap(), 0, range_order);
+    HeapFree(GetProcessHeap(), 0, range_vertices);
+    HeapFree(GetProcessHeap(), 0, vertex_map);
+    return hr;
+}
+
+/* Creates a vertex_remap that orders the vertices by first use in the new
+ * face order and removes unused vertices. Indices are updated according to
+ * the vertex_remap. */
+static HRESULT remap_vertices_for_vertex_cache(struct d3dx9_mesh *This, DWORD *indices,
+        const DWORD *face_remap, DWORD *new_num_vertices, ID3DXBuffer **vertex_remap)
+{
+    DWORD *face_order, *vertex_map;
+    HRESULT hr;
+    DWORD i;
+
+    face_order = HeapAlloc(GetProcessHeap(), 0, This->numfaces * sizeof(*face_order));
+    vertex_map = HeapAlloc(GetProcessHeap(), 0, This->numvertices * sizeof(*vertex_map));
+    if (!face_order || !vertex_map)
+    {
+        hr = E_OUTOFMEMORY;
+        goto done;
+    }
+
+    hr = D3DXCreateBuffer(This->numvertices * sizeof(DWORD), vertex_remap);
+    if (FAILED(hr)) goto done;
+
+    for (i = 0; i < This->numfaces; ++i)
+        face_order[face_remap[i]] = i;
+    *new_num_vertices = remap_vertices_by_first_use(indices, face_order, This->numfaces, This->numvertices,
+            ID3DXBuffer_GetBufferPointer(*vertex_remap), vertex_map);
+
+    for (i = 0; i < This->numfaces * 3; ++i)
+        indices[i] = vertex_map[indices[i]];
+
+done:
+    HeapFree(GetProcessHeap(), 0, face_order);
+    HeapFree(GetProcessHeap(), 0, vertex_map);
+    return hr;
+}
+
 static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags, const DWORD *adjacency_in,
         DWORD *adjacency_out, DWORD *face_remap_out, ID3DXBuffer **vertex_remap_out)
 {
@@ -1666,14 +2141,14 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
     if ((flags & (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER)) == (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER))
         return D3DERR_INVALIDCALL;
 
-    if (flags & (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER))
+    if (flags & D3DXMESHOPT_STRIPREORDER)
     {
-        if (flags & D3DXMESHOPT_VERTEXCACHE)
-            FIXME("D3DXMESHOPT_VERTEXCACHE not implemented.\n");
-        if (flags & D3DXMESHOPT_STRIPREORDER)
-            FIXME("D3DXMESHOPT_STRIPREORDER not implemented.\n");
+        FIXME("D3DXMESHOPT_STRIPREORDER not implemented.\n");
         return E_NOTIMPL;
     }
+    /* optimizing for the vertex cache implies sorting by attribute */
+    if (flags & D3DXMESHOPT_VERTEXCACHE)
+        flags |= D3DXMESHOPT_ATTRSORT;
 
     hr = iface->lpVtbl->LockIndexBuffer(iface, 0, &indices);
     if (FAILED(hr)) goto cleanup;
@@ -1688,7 +2163,25 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
             dword_indices[i] = *word_indices++;
     }
 
-    if ((flags & (D3DXMESHOPT_COMPACT | D3DXMESHOPT_IGNOREVERTS | D3DXMESHOPT_ATTRSORT)) == D3DXMESHOPT_COMPACT)
+    if (flags & D3DXMESHOPT_VERTEXCACHE)
+    {
+        hr = iface->lpVtbl->LockAttributeBuffer(iface, 0, &attrib_buffer);
+        if (FAILED(hr)) goto cleanup;
+
+        hr = remap_faces_for_attrsort(This, dword_indices, attrib_buffer, &sorted_attrib_buffer, &face_remap);
+        if (FAILED(hr)) goto cleanup;
+
+        hr = remap_faces_for_vertex_cache(This, dword_indices, sorted_attrib_buffer, face_remap);
+        if (FAILED(hr)) goto cleanup;
+
+        if (!(flags & D3DXMESHOPT_IGNOREVERTS))
+        {
+            new_num_alloc_vertices = This->numvertices;
+            hr = remap_vertices_for_vertex_cache(This, dword_indices, face_remap, &new_num_vertices, &vertex_remap);
+            if (FAILED(hr)) goto cleanup;
+        }
+    }
+    else if ((flags & (D3DXMESHOPT_COMPACT | D3DXMESHOPT_IGNOREVERTS | D3DXMESHOPT_ATTRSORT)) == D3DXMESHOPT_COMPACT)
     {
         new_num_alloc_vertices = This->numvertices;
         hr = compact_mesh(This, dword_indices, &new_num_vertices, &vertex_remap);
@@ -1795,12 +2288,9 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
 
     if (adjacency_out) {
         if (face_remap) {
-            for (i = 0; i < This->numfaces; i++) {
-                DWORD old_pos = i * 3;
-                DWORD new_pos = face_remap[i] * 3;
-                adjacency_out[new_pos++] = face_remap[adjacency_in[old_pos++]];
-                adjacency_out[new_pos++] = face_remap[adjacency_in[old_pos++]];
-                adjacency_out[new_pos++] = face_remap[adjacency_in[old_pos++]];
+            for (i = 0; i < This->numfaces * 3; i++) {
+                DWORD adjacent = adjacency_in[i];
+                adjacency_out[face_remap[i / 3] * 3 + i % 3] = adjacent == ~0u ? ~0u : face_remap[adjacent];
             }
         } else {
             memcpy(adjacency_out, adjacency_in, This->numfaces * 3 * sizeof(*adjacency_out));
@@ -7199,57 +7689,131 @@ cleanup:
  *
  * RETURNS
  *   Success: D3D_OK.
- *   Failure: D3DERR_INVALIDCALL.
- *
- * BUGS
- *   The face re-ordering does not use the vertex cache optimally.
+ *   Failure: D3DERR_INVALIDCALL, E_OUTOFMEMORY.
  *
  */
 HRESULT WINAPI D3DXOptimizeFaces(const void *indices, UINT num_faces,
         UINT num_vertices, BOOL indices_are_32bit, DWORD *face_remap)
 {
     UINT i;
-    UINT j = num_faces - 1;
     UINT limit_16_bit = 2 << 15; /* According to MSDN */
+    DWORD *dword_indices = NULL, *face_order = NULL, *timestamps = NULL;
     HRESULT hr = D3D_OK;
 
-    FIXME("indices %p, num_faces %u, num_vertices %u, indices_are_32bit %#x, face_remap %p semi-stub. "
-            "Face order will not be optimal.\n",
+    TRACE("indices %p, num_faces %u, num_vertices %u, indices_are_32bit %#x, face_remap %p.\n",
             indices, num_faces, num_vertices, indices_are_32bit, face_remap);
 
     if (!indices_are_32bit && num_faces >= limit_16_bit)
     {
         WARN("Number of faces must be less than %d when using 16-bit indices.\n",
              limit_16_bit);
-        hr = D3DERR_INVALIDCALL;
-        goto error;
+        return D3DERR_INVALIDCALL;
     }
 
     if (!face_remap)
     {
         WARN("Face remap pointer is NULL.\n");
-        hr = D3DERR_INVALIDCALL;
-        goto error;
+        return D3DERR_INVALIDCALL;
     }
 
-    /* The faces are drawn in reverse order for simple meshes. This ordering
-     * is not optimal for complicated meshes, but will not break anything
-     * either. The ordering should be changed to take advantage of the vertex
-     * cache on the graphics card.
-     *
-     * TODO Re-order to take advantage of vertex cache.
-     */
+    /* The faces are drawn in reverse order for simple meshes, which is what
+     * native does. Use the optimized order when it is actually better. */
     for (i = 0; i < num_faces; i++)
+        face_remap[i] = num_faces - 1 - i;
+
+    if (!num_faces)
+        return D3D_OK;
+
+    dword_indices = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*dword_indices));
+    face_order = HeapAlloc(GetProcessHeap(), 0, num_faces * sizeof(*face_order));
+    timestamps = HeapAlloc(GetProcessHeap(), 0, num_vertices * sizeof(*timestamps));
+    if (!dword_indices || !face_order || !timestamps)
     {
-        face_remap[i] = j--;
+        hr = E_OUTOFMEMORY;
+        goto done;
     }
 
-    return D3D_OK;
+    if (indices_are_32bit)
+        memcpy(dword_indices, indices, num_faces * 3 * sizeof(*dword_indices));
+    else
+        for (i = 0; i < num_faces * 3; i++)
+            dword_indices[i] = ((const WORD *)indices)[i];
 
-error:
+    if (FAILED(hr = optimize_faces_for_vertex_cache(dword_indices, num_faces, num_vertices, face_order)))
+    {
+        WARN("Failed to optimize faces, hr %#x.\n", hr);
+        goto done;
+    }
+
+    if (count_vertex_cache_misses(dword_indices, face_order, num_faces, num_vertices, timestamps)
+            < count_vertex_cache_misses(dword_indices, face_remap, num_faces, num_vertices, timestamps))
+        memcpy(face_remap, face_order, num_faces * sizeof(*face_remap));
+
+done:
+    HeapFree(GetProcessHeap(), 0, dword_indices);
+    HeapFree(GetProcessHeap(), 0, face_order);
+    HeapFree(GetProcessHeap(), 0, timestamps);
     return hr;
 }
 
+/*************************************************************************
+ * D3DXOptimizeVertices    (D3DX9_36.@)
+ *
+ * Re-orders the vertices in the order they are first used by the faces, so
+ * that the vertex fetches are sequential.
+ *
+ * PARAMS
+ *   indices           [I] Pointer to an index buffer belonging to a mesh.
+ *   num_faces         [I] Number of faces in the mesh.
+ *   num_vertices      [I] Number of vertices in the mesh.
+ *   indices_are_32bit [I] Specifies whether indices are 32- or 16-bit.
+ *   vertex_remap      [O] The original vertex of each new vertex, or -1.
+ *
+ * RETURNS
+ *   Success: D3D_OK.
+ *   Failure: D3DERR_INVALIDCALL, E_OUTOFMEMORY.
+ *
+ */
+HRESULT WINAPI D3DXOptimizeVertices(const void *indices, UINT num_faces,
+        UINT num_vertices, BOOL indices_are_32bit, DWORD *vertex_remap)
+{
+    DWORD *dword_indices, *vertex_map;
+    UINT i;
+
+    TRACE("indices %p, num_faces %u, num_vertices %u, indices_are_32bit %#x, vertex_remap %p.\n",
+            indices, num_faces, num_vertices, indices_are_32bit, vertex_remap);
+
+    if (!indices || !vertex_remap)
+        return D3DERR_INVALIDCALL;
+
+    dword_indices = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*dword_indices));
+    vertex_map = HeapAlloc(GetProcessHeap(), 0, num_vertices * sizeof(*vertex_map));
+    if (!dword_indices || !vertex_map)
+    {
+        HeapFree(GetProcessHeap(), 0, dword_indices);
+        HeapFree(GetProcessHeap(), 0, vertex_map);
+        return E_OUTOFMEMORY;
+    }
+
+    for (i = 0; i < num_faces * 3; i++)
+    {
+        dword_indices[i] = indices_are_32bit ? ((const DWORD *)indices)[i] : ((const WORD *)indices)[i];
+        if (dword_indices[i] >= num_vertices)
+        {
+            WARN("Index %u out of range.\n", dword_indices[i]);
+            HeapFree(GetProcessHeap(), 0, dword_indices);
+            HeapFree(GetProcessHeap(), 0, vertex_map);
+            return D3DERR_INVALIDCALL;
+        }
+    }
+
+    remap_vertices_by_first_use(dword_indices, NULL, num_faces, num_vertices, vertex_remap, vertex_map);
+
+    HeapFree(GetProcessHeap(), 0, dword_indices);
+    HeapFree(GetProcessHeap(), 0, vertex_map);
+    return D3D_OK;
+}
+
 static D3DXVECTOR3 *vertex_element_vec3(BYTE *vertices, const D3DVERTEXELEMENT9 *declaration,
         DWORD vertex_stride, DWORD index)
 {
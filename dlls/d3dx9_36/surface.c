@@ -27,6 +27,12 @@
 #include "ole2.h"
 #include "wincodec.h"
 
+#ifdef __WINE_TARGET
+#define D3DX_SSE
+#define D3DX_SSE_FUNC __WINE_TARGET("sse")
+#include <xmmintrin.h>
+#endif
+
 WINE_DEFAULT_DEBUG_CHANNEL(d3dx);
 
 
@@ -1487,6 +1493,109 @@ static void format_from_vec4(const struct pixel_format_desc *format, const struc
     }
 }
 
+/* Conversion between formats whose common channels have the same size,
+ * which only needs to move bits around. */
+struct argb_fast_conversion
+{
+    DWORD keep_mask;   /* bits at the same position in both formats */
+    DWORD fill_mask;   /* channels missing in the source, set to their maximal value */
+    unsigned int shift_count;
+    DWORD shift_mask[4];
+    int shift[4];
+};
+
+static BOOL init_argb_fast_conversion(const struct pixel_format_desc *src_format,
+        const struct pixel_format_desc *dst_format, D3DCOLOR color_key, struct argb_fast_conversion *conv)
+{
+    unsigned int c;
+
+    if (color_key || src_format->type != FORMAT_ARGB || dst_format->type != FORMAT_ARGB
+            || src_format->to_rgba || dst_format->from_rgba
+            || src_format->bytes_per_pixel > 4 || dst_format->bytes_per_pixel > 4)
+        return FALSE;
+
+    memset(conv, 0, sizeof(*conv));
+    for (c = 0; c < 4; ++c)
+    {
+        if (!dst_format->bits[c])
+            continue;
+
+        if (!src_format->bits[c])
+        {
+            conv->fill_mask |= ((1u << dst_format->bits[c]) - 1) << dst_format->shift[c];
+            continue;
+        }
+
+        if (src_format->bits[c] != dst_format->bits[c])
+            return FALSE;
+
+        if (src_format->shift[c] == dst_format->shift[c])
+        {
+            conv->keep_mask |= ((1u << src_format->bits[c]) - 1) << src_format->shift[c];
+        }
+        else
+        {
+            conv->shift_mask[conv->shift_count] = ((1u << src_format->bits[c]) - 1) << src_format->shift[c];
+            conv->shift[conv->shift_count++] = dst_format->shift[c] - src_format->shift[c];
+        }
+    }
+
+    return TRUE;
+}
+
+static inline DWORD argb_fast_convert_pixel(const struct argb_fast_conversion *conv, DWORD pixel)
+{
+    DWORD val = (pixel & conv->keep_mask) | conv->fill_mask;
+    unsigned int i;
+
+    for (i = 0; i < conv->shift_count; ++i)
+    {
+        if (conv->shift[i] > 0)
+            val |= (pixel & conv->shift_mask[i]) << conv->shift[i];
+        else
+            val |= (pixel & conv->shift_mask[i]) >> -conv->shift[i];
+    }
+    return val;
+}
+
+static void argb_fast_convert_row(const struct argb_fast_conversion *conv, const BYTE *src, UINT src_bpp,
+        BYTE *dst, UINT dst_bpp, UINT width)
+{
+    DWORD pixel = 0, val;
+    UINT x;
+
+    /* constant sizes let the compiler turn the copies into plain loads and stores */
+    if (src_bpp == 4 && dst_bpp == 4)
+    {
+        for (x = 0; x < width; ++x, src += 4, dst += 4)
+        {
+            memcpy(&pixel, src, 4);
+            val = argb_fast_convert_pixel(conv, pixel);
+            memcpy(dst, &val, 4);
+        }
+    }
+    else if (src_bpp == 2 && dst_bpp == 2)
+    {
+        WORD word;
+
+        for (x = 0; x < width; ++x, src += 2, dst += 2)
+        {
+            memcpy(&word, src, 2);
+            word = argb_fast_convert_pixel(conv, word);
+            memcpy(dst, &word, 2);
+        }
+    }
+    else
+    {
+        for (x = 0; x < width; ++x, src += src_bpp, dst += dst_bpp)
+        {
+            memcpy(&pixel, src, src_bpp);
+            val = argb_fast_convert_pixel(conv, pixel);
+            memcpy(dst, &val, dst_bpp);
+        }
+    }
+}
+
 /************************************************************
  * copy_pixels
  *
@@ -1532,12 +1641,18 @@ void convert_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slice_pit
 {
     struct argb_conversion_info conv_info, ck_conv_info;
     const struct pixel_format_desc *ck_format = NULL;
+    struct argb_fast_conversion fast_conv;
+    BOOL fast, integer;
     DWORD channels[4];
     UINT min_width, min_height, min_depth;
     UINT x, y, z;
 
     ZeroMemory(channels, sizeof(channels));
     init_argb_conversion_info(src_format, dst_format, &conv_info);
+    fast = init_argb_fast_conversion(src_format, dst_format, color_key, &fast_conv);
+    integer = !src_format->to_rgba && !dst_format->from_rgba
+            && src_format->type == dst_format->type
+            && src_format->bytes_per_pixel <= 4 && dst_format->bytes_per_pixel <= 4;
 
     min_width = min(src_size->width, dst_size->width);
     min_height = min(src_size->height, dst_size->height);
@@ -1558,10 +1673,20 @@ void convert_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slice_pit
             const BYTE *src_ptr = src_slice_ptr + y * src_row_pitch;
             BYTE *dst_ptr = dst_slice_ptr + y * dst_row_pitch;
 
-            for (x = 0; x < min_width; x++) {
-                if (!src_format->to_rgba && !dst_format->from_rgba
-                        && src_format->type == dst_format->type
-                        && src_format->bytes_per_pixel <= 4 && dst_format->bytes_per_pixel <= 4)
+            if (fast)
+            {
+                argb_fast_convert_row(&fast_conv, src_ptr, src_format->bytes_per_pixel,
+                        dst_ptr, dst_format->bytes_per_pixel, min_width);
+                dst_ptr += min_width * dst_format->bytes_per_pixel;
+                x = min_width;
+            }
+            else
+            {
+                x = 0;
+            }
+
+            for (; x < min_width; x++) {
+                if (integer)
                 {
                     DWORD val;
 
@@ -1635,11 +1760,17 @@ void point_filter_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slic
 {
     struct argb_conversion_info conv_info, ck_conv_info;
     const struct pixel_format_desc *ck_format = NULL;
+    struct argb_fast_conversion fast_conv;
+    BOOL fast, integer;
     DWORD channels[4];
     UINT x, y, z;
 
     ZeroMemory(channels, sizeof(channels));
     init_argb_conversion_info(src_format, dst_format, &conv_info);
+    fast = init_argb_fast_conversion(src_format, dst_format, color_key, &fast_conv);
+    integer = !src_format->to_rgba && !dst_format->from_rgba
+            && src_format->type == dst_format->type
+            && src_format->bytes_per_pixel <= 4 && dst_format->bytes_per_pixel <= 4;
 
     if (color_key)
     {
@@ -1662,9 +1793,12 @@ void point_filter_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slic
             {
                 const BYTE *src_ptr = src_row_ptr + (x * src_size->width / dst_size->width) * src_format->bytes_per_pixel;
 
-                if (!src_format->to_rgba && !dst_format->from_rgba
-                        && src_format->type == dst_format->type
-                        && src_format->bytes_per_pixel <= 4 && dst_format->bytes_per_pixel <= 4)
+                if (fast)
+                {
+                    argb_fast_convert_row(&fast_conv, src_ptr, src_format->bytes_per_pixel,
+                            dst_ptr, dst_format->bytes_per_pixel, 1);
+                }
+                else if (integer)
                 {
                     DWORD val;
 
@@ -1715,6 +1849,427 @@ void point_filter_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slic
     }
 }
 
+/* Weights of the source pixels contributing to each destination pixel along
+ * one axis. The filters are separable, so they are applied to the rows, then
+ * the rows are combined. */
+struct filter_kernel
+{
+    int *first;       /* first pixel of each destination pixel, before wrapping */
+    UINT *count;      /* number of taps of each destination pixel */
+    UINT *sources;    /* max_count source pixels for each destination pixel */
+    float *weights;   /* max_count weights for each destination pixel */
+    UINT max_count;
+};
+
+static void cleanup_filter_kernel(struct filter_kernel *kernel)
+{
+    HeapFree(GetProcessHeap(), 0, kernel->first);
+    HeapFree(GetProcessHeap(), 0, kernel->count);
+    HeapFree(GetProcessHeap(), 0, kernel->sources);
+    HeapFree(GetProcessHeap(), 0, kernel->weights);
+}
+
+static float filter_kernel_weight(DWORD filter, int i, float center, float radius)
+{
+    if ((filter & 0xf) == D3DX_FILTER_BOX)
+        return min(i + 1.0f, center + radius) - max((float)i, center - radius);
+    return 1.0f - fabsf(i + 0.5f - center) / radius;
+}
+
+/* Pixels outside of the source wrap around, or are mirrored back into it if
+ * requested. */
+static UINT filter_kernel_source_pixel(int i, UINT src_length, BOOL mirror)
+{
+    int length = src_length;
+
+    if (!mirror)
+    {
+        i %= length;
+        return i < 0 ? i + length : i;
+    }
+
+    i %= 2 * length;
+    if (i < 0)
+        i += 2 * length;
+    return i < length ? i : 2 * length - 1 - i;
+}
+
+/* Returns the row cache slot of the given tap. The taps of a destination
+ * pixel are consecutive before wrapping, so they never share a slot. */
+static UINT filter_kernel_slot(const struct filter_kernel *kernel, UINT d, UINT i)
+{
+    int slot = (kernel->first[d] + (int)i) % (int)kernel->max_count;
+
+    return slot < 0 ? slot + kernel->max_count : slot;
+}
+
+static HRESULT init_filter_kernel(struct filter_kernel *kernel, UINT src_length, UINT dst_length,
+        DWORD filter, BOOL mirror)
+{
+    float scale = (float)src_length / dst_length;
+    float radius, center, sum, weight;
+    int lo, hi, i;
+    UINT d, count;
+
+    /* Linear filtering samples the two nearest source pixels, while the box
+     * and triangle filters take the whole footprint of the destination pixel
+     * into account when minifying. */
+    switch (filter & 0xf)
+    {
+        case D3DX_FILTER_BOX:
+            radius = max(scale, 1.0f) / 2.0f;
+            break;
+        case D3DX_FILTER_TRIANGLE:
+            radius = max(scale, 1.0f);
+            break;
+        default:
+            radius = 1.0f;
+            break;
+    }
+
+    kernel->max_count = (UINT)ceilf(2.0f * radius) + 2;
+    kernel->first = HeapAlloc(GetProcessHeap(), 0, dst_length * sizeof(*kernel->first));
+    kernel->count = HeapAlloc(GetProcessHeap(), 0, dst_length * sizeof(*kernel->count));
+    kernel->sources = HeapAlloc(GetProcessHeap(), 0, dst_length * kernel->max_count * sizeof(*kernel->sources));
+    kernel->weights = HeapAlloc(GetProcessHeap(), 0, dst_length * kernel->max_count * sizeof(*kernel->weights));
+    if (!kernel->first || !kernel->count || !kernel->sources || !kernel->weights)
+    {
+        cleanup_filter_kernel(kernel);
+        return E_OUTOFMEMORY;
+    }
+
+    for (d = 0; d < dst_length; ++d)
+    {
+        UINT *sources = &kernel->sources[d * kernel->max_count];
+        float *weights = &kernel->weights[d * kernel->max_count];
+
+        center = (d + 0.5f) * scale;
+        lo = (int)floorf(center - radius - 0.5f);
+        hi = (int)ceilf(center + radius - 0.5f);
+
+        /* Only keep the pixels that contribute. The same source pixel may
+         * show up more than once when the kernel is wider than the source. */
+        count = 0;
+        sum = 0.0f;
+        for (i = lo; i <= hi; ++i)
+        {
+            if ((weight = filter_kernel_weight(filter, i, center, radius)) <= 0.0f)
+                continue;
+            if (!count)
+                kernel->first[d] = i;
+            sources[count] = filter_kernel_source_pixel(i, src_length, mirror);
+            weights[count++] = weight;
+            sum += weight;
+        }
+
+        kernel->count[d] = count;
+        for (i = 0; i < count; ++i)
+            weights[i] /= sum;
+    }
+
+    return D3D_OK;
+}
+
+/* Reads a row of pixels into vec4 colors, applying the palette and the color key. */
+static void load_argb_row(const BYTE *src, const struct pixel_format_desc *format, struct vec4 *dst, UINT width,
+        const struct pixel_format_desc *ck_format, D3DCOLOR color_key, const PALETTEENTRY *palette)
+{
+    static const unsigned int component_offsets[4] = {3, 0, 1, 2};
+    struct vec4 color;
+    UINT x, c;
+
+    if (format->type == FORMAT_ARGB && !format->to_rgba && format->bytes_per_pixel <= 4)
+    {
+        float scale[4];
+        DWORD mask[4], pixel = 0;
+
+        for (c = 0; c < 4; ++c)
+        {
+            mask[c] = format->bits[c] ? ~0u >> (32 - format->bits[c]) : 0;
+            scale[c] = format->bits[c] ? 1.0f / mask[c] : 0.0f;
+        }
+
+        for (x = 0; x < width; ++x, src += format->bytes_per_pixel)
+        {
+            memcpy(&pixel, src, format->bytes_per_pixel);
+            for (c = 0; c < 4; ++c)
+            {
+                ((float *)&dst[x])[component_offsets[c]] = format->bits[c]
+                        ? ((pixel >> format->shift[c]) & mask[c]) * scale[c] : 1.0f;
+            }
+        }
+    }
+    else
+    {
+        for (x = 0; x < width; ++x, src += format->bytes_per_pixel)
+        {
+            format_to_vec4(format, src, &color);
+            if (format->to_rgba)
+                format->to_rgba(&color, &dst[x], palette);
+            else
+                dst[x] = color;
+        }
+    }
+
+    if (ck_format)
+    {
+        for (x = 0; x < width; ++x)
+        {
+            DWORD ck_pixel;
+
+            format_from_vec4(ck_format, &dst[x], (BYTE *)&ck_pixel);
+            if (ck_pixel == color_key)
+                dst[x].w = 0.0f;
+        }
+    }
+}
+
+static void store_argb_row(const struct vec4 *src, const struct pixel_format_desc *format, BYTE *dst, UINT width)
+{
+    static const unsigned int component_offsets[4] = {3, 0, 1, 2};
+    struct vec4 color;
+    UINT x, c;
+
+    if (format->type == FORMAT_ARGB && !format->from_rgba && format->bytes_per_pixel <= 4)
+    {
+        float scale[4];
+        DWORD pixel;
+
+        for (c = 0; c < 4; ++c)
+            scale[c] = format->bits[c] ? (float)(~0u >> (32 - format->bits[c])) : 0.0f;
+
+        for (x = 0; x < width; ++x, dst += format->bytes_per_pixel)
+        {
+            pixel = 0;
+            for (c = 0; c < 4; ++c)
+            {
+                if (format->bits[c])
+                    pixel |= (DWORD)(((const float *)&src[x])[component_offsets[c]] * scale[c] + 0.5f)
+                            << format->shift[c];
+            }
+            memcpy(dst, &pixel, format->bytes_per_pixel);
+        }
+    }
+    else
+    {
+        for (x = 0; x < width; ++x, dst += format->bytes_per_pixel)
+        {
+            if (format->from_rgba)
+            {
+                format->from_rgba(&src[x], &color);
+                format_from_vec4(format, &color, dst);
+            }
+            else
+            {
+                format_from_vec4(format, &src[x], dst);
+            }
+        }
+    }
+}
+
+#ifdef D3DX_SSE
+static BOOL use_sse(void)
+{
+    static int supported = -1;
+
+    if (supported == -1) supported = IsProcessorFeaturePresent(PF_XMMI_INSTRUCTIONS_AVAILABLE);
+    return supported;
+}
+
+/* The SSE versions sum in the same order as the C versions. */
+static void D3DX_SSE_FUNC filter_row_sse(const struct filter_kernel *kernel, const struct vec4 *src,
+        struct vec4 *dst, UINT width)
+{
+    UINT x, i;
+
+    for (x = 0; x < width; ++x)
+    {
+        const UINT *sources = &kernel->sources[x * kernel->max_count];
+        const float *weights = &kernel->weights[x * kernel->max_count];
+        __m128 sum = _mm_setzero_ps();
+
+        for (i = 0; i < kernel->count[x]; ++i)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[i]), _mm_loadu_ps(&src[sources[i]].x)));
+        _mm_storeu_ps(&dst[x].x, sum);
+    }
+}
+
+static void D3DX_SSE_FUNC accumulate_row_sse(float *dst, const float *src, float weight, UINT count)
+{
+    __m128 w = _mm_set1_ps(weight);
+    UINT i;
+
+    for (i = 0; i + 4 <= count; i += 4)
+        _mm_storeu_ps(&dst[i], _mm_add_ps(_mm_loadu_ps(&dst[i]), _mm_mul_ps(w, _mm_loadu_ps(&src[i]))));
+    for (; i < count; ++i)
+        dst[i] += weight * src[i];
+}
+#endif
+
+static void filter_row(const struct filter_kernel *kernel, const struct vec4 *src, struct vec4 *dst, UINT width)
+{
+    UINT x, i;
+
+#ifdef D3DX_SSE
+    if (use_sse())
+    {
+        filter_row_sse(kernel, src, dst, width);
+        return;
+    }
+#endif
+
+    for (x = 0; x < width; ++x)
+    {
+        const UINT *sources = &kernel->sources[x * kernel->max_count];
+        const float *weights = &kernel->weights[x * kernel->max_count];
+        struct vec4 sum = {0.0f, 0.0f, 0.0f, 0.0f};
+
+        for (i = 0; i < kernel->count[x]; ++i)
+        {
+            const struct vec4 *s = &src[sources[i]];
+
+            sum.x += weights[i] * s->x;
+            sum.y += weights[i] * s->y;
+            sum.z += weights[i] * s->z;
+            sum.w += weights[i] * s->w;
+        }
+        dst[x] = sum;
+    }
+}
+
+static void accumulate_row(float *dst, const float *src, float weight, UINT count)
+{
+    UINT i;
+
+#ifdef D3DX_SSE
+    if (use_sse())
+    {
+        accumulate_row_sse(dst, src, weight, count);
+        return;
+    }
+#endif
+
+    for (i = 0; i < count; ++i)
+        dst[i] += weight * src[i];
+}
+
+/************************************************************
+ * filter_argb_pixels
+ *
+ * Copies the source buffer to the destination buffer, performing
+ * any necessary format conversion, color keying and stretching
+ * using the given filter.
+ */
+HRESULT filter_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slice_pitch, const struct volume *src_size,
+        const struct pixel_format_desc *src_format, BYTE *dst, UINT dst_row_pitch, UINT dst_slice_pitch,
+        const struct volume *dst_size, const struct pixel_format_desc *dst_format, D3DCOLOR color_key,
+        const PALETTEENTRY *palette, DWORD filter)
+{
+    const struct pixel_format_desc *ck_format = NULL;
+    struct filter_kernel kernels[3];
+    struct vec4 *src_row = NULL, *rows = NULL, *dst_row = NULL;
+    UINT *row_ids = NULL;
+    UINT row_count, slot, x, y, z, i, j;
+    HRESULT hr = D3D_OK;
+
+    if ((filter & 0xf) > D3DX_FILTER_BOX)
+        FIXME("Unhandled filter %#x.\n", filter);
+
+    /* All filters give the same result without stretching. */
+    if ((filter & 0xf) <= D3DX_FILTER_POINT || (filter & 0xf) > D3DX_FILTER_BOX
+            || (src_size->width == dst_size->width && src_size->height == dst_size->height
+            && src_size->depth == dst_size->depth))
+    {
+        point_filter_argb_pixels(src, src_row_pitch, src_slice_pitch, src_size, src_format,
+                dst, dst_row_pitch, dst_slice_pitch, dst_size, dst_format, color_key, palette);
+        return D3D_OK;
+    }
+
+    memset(kernels, 0, sizeof(kernels));
+    if (FAILED(hr = init_filter_kernel(&kernels[0], src_size->width, dst_size->width,
+            filter, filter & D3DX_FILTER_MIRROR_U))
+            || FAILED(hr = init_filter_kernel(&kernels[1], src_size->height, dst_size->height,
+            filter, filter & D3DX_FILTER_MIRROR_V))
+            || FAILED(hr = init_filter_kernel(&kernels[2], src_size->depth, dst_size->depth,
+            filter, filter & D3DX_FILTER_MIRROR_W)))
+        goto done;
+
+    /* Horizontally filtered source rows are cached, indexed by their row and
+     * slice modulo the maximum number of rows contributing to a pixel. */
+    row_count = kernels[1].max_count * kernels[2].max_count;
+    src_row = HeapAlloc(GetProcessHeap(), 0, src_size->width * sizeof(*src_row));
+    rows = HeapAlloc(GetProcessHeap(), 0, row_count * dst_size->width * sizeof(*rows));
+    dst_row = HeapAlloc(GetProcessHeap(), 0, dst_size->width * sizeof(*dst_row));
+    row_ids = HeapAlloc(GetProcessHeap(), 0, row_count * sizeof(*row_ids));
+    if (!src_row || !rows || !dst_row || !row_ids)
+    {
+        hr = E_OUTOFMEMORY;
+        goto done;
+    }
+    memset(row_ids, 0xff, row_count * sizeof(*row_ids));
+
+    if (color_key)
+    {
+        /* Color keys are always represented in D3DFMT_A8R8G8B8 format. */
+        ck_format = get_format_info(D3DFMT_A8R8G8B8);
+    }
+
+    for (z = 0; z < dst_size->depth; ++z)
+    {
+        const float *z_weights = &kernels[2].weights[z * kernels[2].max_count];
+
+        for (y = 0; y < dst_size->height; ++y)
+        {
+            const float *y_weights = &kernels[1].weights[y * kernels[1].max_count];
+
+            memset(dst_row, 0, dst_size->width * sizeof(*dst_row));
+            for (i = 0; i < kernels[2].count[z]; ++i)
+            {
+                UINT src_z = kernels[2].sources[z * kernels[2].max_count + i];
+
+                for (j = 0; j < kernels[1].count[y]; ++j)
+                {
+                    UINT src_y = kernels[1].sources[y * kernels[1].max_count + j];
+                    UINT row_id = src_z * src_size->height + src_y;
+
+                    slot = filter_kernel_slot(&kernels[2], z, i) * kernels[1].max_count
+                            + filter_kernel_slot(&kernels[1], y, j);
+                    if (row_ids[slot] != row_id)
+                    {
+                        load_argb_row(src + src_z * src_slice_pitch + src_y * src_row_pitch, src_format,
+                                src_row, src_size->width, ck_format, color_key, palette);
+                        filter_row(&kernels[0], src_row, &rows[slot * dst_size->width], dst_size->width);
+                        row_ids[slot] = row_id;
+                    }
+
+                    accumulate_row((float *)dst_row, (const float *)&rows[slot * dst_size->width],
+                            z_weights[i] * y_weights[j], dst_size->width * 4);
+                }
+            }
+
+            for (x = 0; x < dst_size->width; ++x)
+            {
+                /* rounding errors might push the sums slightly out of range */
+                dst_row[x].x = min(max(dst_row[x].x, 0.0f), 1.0f);
+                dst_row[x].y = min(max(dst_row[x].y, 0.0f), 1.0f);
+                dst_row[x].z = min(max(dst_row[x].z, 0.0f), 1.0f);
+                dst_row[x].w = min(max(dst_row[x].w, 0.0f), 1.0f);
+            }
+            store_argb_row(dst_row, dst_format, dst + z * dst_slice_pitch + y * dst_row_pitch, dst_size->width);
+        }
+    }
+
+done:
+    cleanup_filter_kernel(&kernels[0]);
+    cleanup_filter_kernel(&kernels[1]);
+    cleanup_filter_kernel(&kernels[2]);
+    HeapFree(GetProcessHeap(), 0, src_row);
+    HeapFree(GetProcessHeap(), 0, rows);
+    HeapFree(GetProcessHeap(), 0, dst_row);
+    HeapFree(GetProcessHeap(), 0, row_ids);
+    return hr;
+}
+
 /************************************************************
  * D3DXLoadSurfaceFromMemory
  *
@@ -1756,6 +2311,7 @@ HRESULT WINAPI D3DXLoadSurfaceFromMemory(IDirect3DSurface9 *dst_surface,
     D3DSURFACE_DESC surfdesc;
     D3DLOCKED_RECT lockrect;
     struct volume src_size, dst_size;
+    HRESULT hr = D3D_OK;
 
     TRACE("(%p, %p, %s, %p, %#x, %u, %p, %s, %#x, 0x%08x)\n",
             dst_surface, dst_palette, wine_dbgstr_rect(dst_rect), src_memory, src_format,
@@ -1852,18 +2408,15 @@ HRESULT WINAPI D3DXLoadSurfaceFromMemory(IDirect3DSurface9 *dst_surface,
             convert_argb_pixels(src_memory, src_pitch, 0, &src_size, srcformatdesc,
                     lockrect.pBits, lockrect.Pitch, 0, &dst_size, destformatdesc, color_key, src_palette);
         }
-        else /* if ((filter & 0xf) == D3DX_FILTER_POINT) */
+        else
         {
-            if ((filter & 0xf) != D3DX_FILTER_POINT)
-                FIXME("Unhandled filter %#x.\n", filter);
-
-            /* Always apply a point filter until D3DX_FILTER_LINEAR,
-             * D3DX_FILTER_TRIANGLE and D3DX_FILTER_BOX are implemented. */
-            point_filter_argb_pixels(src_memory, src_pitch, 0, &src_size, srcformatdesc,
-                    lockrect.pBits, lockrect.Pitch, 0, &dst_size, destformatdesc, color_key, src_palette);
+            hr = filter_argb_pixels(src_memory, src_pitch, 0, &src_size, srcformatdesc,
+                    lockrect.pBits, lockrect.Pitch, 0, &dst_size, destformatdesc, color_key, src_palette, filter);
         }
 
         IDirect3DSurface9_UnlockRect(dst_surface);
+        if (FAILED(hr))
+            return hr;
     }
 
     return D3D_OK;
@@ -322,6 +322,9 @@ static void D3DXMatrixTest(void)
     D3DXMatrixInverse(&gotmat,&determinant,&mat);
     expect_mat(&expectedmat, &gotmat);
     ok(relative_error( determinant, expectedfloat ) < admitted_error, "Expected: %f, Got: %f\n", expectedfloat, determinant);
+    gotmat = mat;
+    D3DXMatrixInverse(&gotmat, NULL, &gotmat);
+    expect_mat(&expectedmat, &gotmat);
     funcpointer = D3DXMatrixInverse(&gotmat,NULL,&mat2);
     ok(funcpointer == NULL, "Expected: %p, Got: %p\n", NULL, funcpointer);
 
@@ -799,6 +802,9 @@ static void D3DXQuaternionTest(void)
     expectedquat.x = 3.0f; expectedquat.y = 61.0f; expectedquat.z = -32.0f; expectedquat.w = 85.0f;
     D3DXQuaternionMultiply(&gotquat,&q,&r);
     expect_vec4(expectedquat,gotquat);
+    gotquat = r;
+    D3DXQuaternionMultiply(&gotquat, &q, &gotquat);
+    expect_vec4(expectedquat,gotquat);
 
 /*_______________D3DXQuaternionNormalize________________________*/
     expectedquat.x = 1.0f/11.0f; expectedquat.y = 2.0f/11.0f; expectedquat.z = 4.0f/11.0f; expectedquat.w = 10.0f/11.0f;
@@ -2240,6 +2246,7 @@ static void test_D3DXVec_Array(void)
     D3DXPLANE inp_plane[ARRAY_SIZE];
     D3DXPLANE out_plane[ARRAY_SIZE + 2];
     D3DXPLANE exp_plane[ARRAY_SIZE + 2];
+    D3DXVECTOR3 packed_vec[ARRAY_SIZE];
 
     viewport.Width = 800; viewport.MinZ = 0.2f; viewport.X = 10;
     viewport.Height = 680; viewport.MaxZ = 0.9f; viewport.Y = 5;
@@ -2364,6 +2371,26 @@ static void test_D3DXVec_Array(void)
     exp_plane[5].a = 58.0f; exp_plane[5].b = 68.0f;  exp_plane[5].c = 78.0f;  exp_plane[5].d = 88.0f;
     D3DXPlaneTransformArray(out_plane + 1, sizeof(D3DXPLANE), inp_plane, sizeof(D3DXPLANE), &mat, ARRAY_SIZE);
     compare_planes(exp_plane, out_plane);
+
+    /* Tightly packed, in place */
+    for (i = 0; i < ARRAY_SIZE; ++i)
+    {
+        packed_vec[i].x = i;
+        packed_vec[i].y = ARRAY_SIZE - i;
+        packed_vec[i].z = 2.0f * i;
+    }
+    D3DXVec3TransformCoordArray(packed_vec, sizeof(*packed_vec), packed_vec, sizeof(*packed_vec), &mat, ARRAY_SIZE);
+    for (i = 0; i < ARRAY_SIZE; ++i)
+    {
+        D3DXVECTOR3 v = {i, ARRAY_SIZE - i, 2.0f * i};
+
+        D3DXVec3TransformCoord(&v, &v, &mat);
+        ok(relative_error(v.x, packed_vec[i].x) < admitted_error
+                && relative_error(v.y, packed_vec[i].y) < admitted_error
+                && relative_error(v.z, packed_vec[i].z) < admitted_error,
+                "Element %u: expected (%f, %f, %f), got (%f, %f, %f).\n", i,
+                v.x, v.y, v.z, packed_vec[i].x, packed_vec[i].y, packed_vec[i].z);
+    }
 }
 
 static void test_D3DXFloat_Array(void)
@@ -3420,6 +3447,67 @@ static void test_D3DXSHScale(void)
     }
 }
 
+static void test_perf(void)
+{
+    static const unsigned int count = 1000000;
+    D3DXVECTOR3 *vectors;
+    D3DXMATRIX m, n, identity;
+    D3DXQUATERNION q, r;
+    unsigned int i;
+    DWORD start;
+
+    if (!winetest_interactive)
+    {
+        skip("Skipping math benchmark, set WINETEST_INTERACTIVE to run it.\n");
+        return;
+    }
+
+    D3DXMatrixRotationYawPitchRoll(&m, 0.3f, 0.2f, 0.1f);
+    U(m).m[3][0] = 1.0f; U(m).m[3][1] = 2.0f; U(m).m[3][2] = 3.0f;
+
+    n = m;
+    start = GetTickCount();
+    for (i = 0; i < count; ++i)
+        D3DXMatrixMultiply(&n, &n, &m);
+    trace("D3DXMatrixMultiply: %u ms.\n", GetTickCount() - start);
+
+    start = GetTickCount();
+    for (i = 0; i < count; ++i)
+        D3DXMatrixInverse(&n, NULL, &m);
+    trace("D3DXMatrixInverse: %u ms.\n", GetTickCount() - start);
+    D3DXMatrixMultiply(&n, &n, &m);
+    D3DXMatrixIdentity(&identity);
+    expect_mat(&identity, &n);
+
+    D3DXQuaternionRotationYawPitchRoll(&q, 0.3f, 0.2f, 0.1f);
+    r = q;
+    start = GetTickCount();
+    for (i = 0; i < count; ++i)
+    {
+        D3DXQuaternionMultiply(&r, &r, &q);
+        D3DXQuaternionNormalize(&r, &r);
+    }
+    trace("D3DXQuaternionMultiply and D3DXQuaternionNormalize: %u ms.\n", GetTickCount() - start);
+
+    start = GetTickCount();
+    for (i = 0; i < count; ++i)
+        D3DXQuaternionSlerp(&r, &r, &q, 0.5f);
+    trace("D3DXQuaternionSlerp: %u ms.\n", GetTickCount() - start);
+
+    vectors = HeapAlloc(GetProcessHeap(), 0, count * sizeof(*vectors));
+    for (i = 0; i < count; ++i)
+    {
+        vectors[i].x = i;
+        vectors[i].y = i * 0.5f;
+        vectors[i].z = i * 0.25f;
+    }
+    start = GetTickCount();
+    for (i = 0; i < 10; ++i)
+        D3DXVec3TransformCoordArray(vectors, sizeof(*vectors), vectors, sizeof(*vectors), &m, count);
+    trace("D3DXVec3TransformCoordArray: %u ms.\n", GetTickCount() - start);
+    HeapFree(GetProcessHeap(), 0, vectors);
+}
+
 START_TEST(math)
 {
     D3DXColorTest();
@@ -3449,4 +3537,5 @@ START_TEST(math)
     test_D3DXSHRotate();
     test_D3DXSHRotateZ();
     test_D3DXSHScale();
+    test_perf();
 }
@@ -10404,6 +10404,42 @@ cleanup:
     free_test_context(test_context);
 }
 
+/* Fills in a grid of two triangles per cell, with the faces shuffled. */
+static void fill_shuffled_grid(DWORD grid_size, D3DXVECTOR3 *vertices, DWORD *indices)
+{
+    DWORD num_faces = grid_size * grid_size * 2;
+    DWORD i, j, k, tmp;
+
+    for (i = 0; i < (grid_size + 1) * (grid_size + 1); i++)
+    {
+        vertices[i].x = i % (grid_size + 1);
+        vertices[i].y = i / (grid_size + 1);
+        vertices[i].z = 0.0f;
+    }
+    for (i = 0; i < num_faces / 2; i++)
+    {
+        DWORD v = i / grid_size * (grid_size + 1) + i % grid_size;
+        DWORD *face = &indices[i * 6];
+
+        face[0] = v;
+        face[1] = v + 1;
+        face[2] = v + grid_size + 1;
+        face[3] = v + 1;
+        face[4] = v + grid_size + 2;
+        face[5] = v + grid_size + 1;
+    }
+    for (i = num_faces - 1; i > 0; i--)
+    {
+        j = (i * 2654435761u) % (i + 1);
+        for (k = 0; k < 3; k++)
+        {
+            tmp = indices[i * 3 + k];
+            indices[i * 3 + k] = indices[j * 3 + k];
+            indices[j * 3 + k] = tmp;
+        }
+    }
+}
+
 static void test_optimize_faces(void)
 {
     HRESULT hr;
@@ -10470,6 +10506,13 @@ static void test_optimize_faces(void)
     const UINT num_faces4 = 4;
     const UINT num_vertices4 = 6;
     const DWORD exp_face_remap4[] = {3, 2, 1, 0};
+    /* grid of 16x16 quads, with the faces in a shuffled order */
+    const UINT grid_size = 16;
+    const UINT grid_num_faces = grid_size * grid_size * 2;
+    const UINT grid_num_vertices = (grid_size + 1) * (grid_size + 1);
+    DWORD *grid_indices, *grid_face_remap, *cache_timestamps;
+    D3DXVECTOR3 *grid_vertices;
+    DWORD cache_misses = 0;
     /* Test cases are stored in the tc array */
     struct
     {
@@ -10543,6 +10586,38 @@ static void test_optimize_faces(void)
         HeapFree(GetProcessHeap(), 0, face_remap);
     }
 
+    /* A shuffled grid should be reordered to reuse the vertex cache */
+    grid_vertices = HeapAlloc(GetProcessHeap(), 0, grid_num_vertices * sizeof(*grid_vertices));
+    grid_indices = HeapAlloc(GetProcessHeap(), 0, grid_num_faces * 3 * sizeof(*grid_indices));
+    grid_face_remap = HeapAlloc(GetProcessHeap(), 0, grid_num_faces * sizeof(*grid_face_remap));
+    cache_timestamps = HeapAlloc(GetProcessHeap(), 0, grid_num_vertices * sizeof(*cache_timestamps));
+    fill_shuffled_grid(grid_size, grid_vertices, grid_indices);
+
+    hr = D3DXOptimizeFaces(grid_indices, grid_num_faces, grid_num_vertices, TRUE, grid_face_remap);
+    ok(hr == D3D_OK, "D3DXOptimizeFaces failed, hr %#x.\n", hr);
+
+    memset(cache_timestamps, 0xff, grid_num_vertices * sizeof(*cache_timestamps));
+    for (i = 0; i < grid_num_faces; i++)
+    {
+        DWORD k, v;
+
+        ok(grid_face_remap[i] < grid_num_faces, "Got unexpected face %u at %u.\n", grid_face_remap[i], i);
+        if (grid_face_remap[i] >= grid_num_faces)
+            break;
+        for (k = 0; k < 3; k++)
+        {
+            v = grid_indices[grid_face_remap[i] * 3 + k];
+            if (cache_timestamps[v] != ~0u && cache_misses - cache_timestamps[v] <= 16)
+                continue;
+            cache_timestamps[v] = cache_misses++;
+        }
+    }
+    ok(cache_misses < grid_num_faces, "Got unexpected ACMR %.3f.\n", (float)cache_misses / grid_num_faces);
+    HeapFree(GetProcessHeap(), 0, grid_vertices);
+    HeapFree(GetProcessHeap(), 0, grid_indices);
+    HeapFree(GetProcessHeap(), 0, grid_face_remap);
+    HeapFree(GetProcessHeap(), 0, cache_timestamps);
+
     /* face_remap must not be NULL */
     hr = D3DXOptimizeFaces(tc[0].indices, tc[0].num_faces,
                            tc[0].num_vertices, tc[0].indices_are_32bit,
@@ -10558,6 +10633,186 @@ static void test_optimize_faces(void)
     "faces when using 16-bit indices. Got %x\n, expected D3DERR_INVALIDCALL\n", hr);
 }
 
+/* Checks that "remap" is a permutation of 0..count-1 and fills in its inverse. */
+static BOOL check_remap_permutation(const DWORD *remap, DWORD count, DWORD *inverse)
+{
+    DWORD i;
+
+    memset(inverse, 0xff, count * sizeof(*inverse));
+    for (i = 0; i < count; i++)
+    {
+        if (remap[i] >= count || inverse[remap[i]] != ~0u)
+            return FALSE;
+        inverse[remap[i]] = i;
+    }
+
+    return TRUE;
+}
+
+static void test_optimize_vertices(void)
+{
+    static const DWORD grid_size = 4;
+    const DWORD num_vertices = (grid_size + 1) * (grid_size + 1);
+    const DWORD num_faces = grid_size * grid_size * 2;
+    D3DXVECTOR3 vertices[25];
+    DWORD indices[32 * 3], remap[25], inverse[25];
+    WORD word_indices[32 * 3];
+    DWORD i, k;
+    HRESULT hr;
+
+    fill_shuffled_grid(grid_size, vertices, indices);
+
+    hr = D3DXOptimizeVertices(indices, num_faces, num_vertices, TRUE, remap);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    ok(check_remap_permutation(remap, num_vertices, inverse), "Got invalid vertex remap.\n");
+
+    /* Every face of the remapped mesh still refers to the same positions. */
+    for (i = 0; i < num_faces * 3; i++)
+    {
+        DWORD v = inverse[indices[i]];
+
+        ok(v < num_vertices, "Got unexpected vertex %u for index %u.\n", v, i);
+        if (v >= num_vertices)
+            break;
+        ok(!memcmp(&vertices[remap[v]], &vertices[indices[i]], sizeof(*vertices)),
+                "Got unexpected position for index %u.\n", i);
+    }
+
+    for (i = 0; i < num_faces * 3; i++)
+        word_indices[i] = indices[i];
+    memset(inverse, 0, sizeof(inverse));
+    hr = D3DXOptimizeVertices(word_indices, num_faces, num_vertices, FALSE, inverse);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    for (k = 0; k < num_vertices; k++)
+        ok(inverse[k] == remap[k], "Got unexpected vertex %u at %u, expected %u.\n", inverse[k], k, remap[k]);
+
+    hr = D3DXOptimizeVertices(indices, num_faces, num_vertices, TRUE, NULL);
+    ok(hr == D3DERR_INVALIDCALL, "Got unexpected hr %#x.\n", hr);
+    hr = D3DXOptimizeVertices(NULL, num_faces, num_vertices, TRUE, remap);
+    ok(hr == D3DERR_INVALIDCALL, "Got unexpected hr %#x.\n", hr);
+}
+
+static void test_optimize_vertex_cache(void)
+{
+    static const D3DVERTEXELEMENT9 declaration[] =
+    {
+        {0, 0, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0},
+        D3DDECL_END()
+    };
+    static const DWORD grid_size = 4;
+    const DWORD num_vertices = (grid_size + 1) * (grid_size + 1);
+    const DWORD num_faces = grid_size * grid_size * 2;
+    D3DXVECTOR3 vertices[25];
+    DWORD indices[32 * 3], attributes[32], adjacency[32 * 3], adjacency_out[32 * 3];
+    DWORD face_remap[32], face_inverse[32], vertex_inverse[25];
+    struct test_context *test_context;
+    ID3DXBuffer *vertex_remap = NULL;
+    DWORD *new_indices, *new_attributes, *remap;
+    D3DXVECTOR3 *new_vertices;
+    ID3DXMesh *mesh = NULL;
+    DWORD i, k;
+    HRESULT hr;
+
+    if (!(test_context = new_test_context()))
+    {
+        skip("Couldn't create test context.\n");
+        return;
+    }
+
+    fill_shuffled_grid(grid_size, vertices, indices);
+    for (i = 0; i < num_faces; i++)
+        attributes[i] = i % 3;
+
+    hr = init_test_mesh(num_faces, num_vertices, D3DXMESH_32BIT | D3DXMESH_SYSTEMMEM, declaration,
+            test_context->device, &mesh, vertices, sizeof(*vertices), indices, attributes);
+    if (FAILED(hr))
+    {
+        skip("Couldn't initialize test mesh, hr %#x.\n", hr);
+        goto cleanup;
+    }
+
+    hr = mesh->lpVtbl->GenerateAdjacency(mesh, 0.0f, adjacency);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    hr = mesh->lpVtbl->OptimizeInplace(mesh, D3DXMESHOPT_VERTEXCACHE, NULL, NULL, NULL, NULL);
+    ok(hr == D3DERR_INVALIDCALL, "Got unexpected hr %#x.\n", hr);
+    hr = mesh->lpVtbl->OptimizeInplace(mesh, D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER,
+            adjacency, NULL, NULL, NULL);
+    ok(hr == D3DERR_INVALIDCALL, "Got unexpected hr %#x.\n", hr);
+
+    hr = mesh->lpVtbl->OptimizeInplace(mesh, D3DXMESHOPT_VERTEXCACHE, adjacency,
+            adjacency_out, face_remap, &vertex_remap);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    if (FAILED(hr))
+        goto cleanup;
+
+    ok(mesh->lpVtbl->GetNumFaces(mesh) == num_faces, "Got unexpected face count %u.\n",
+            mesh->lpVtbl->GetNumFaces(mesh));
+    ok(mesh->lpVtbl->GetNumVertices(mesh) == num_vertices, "Got unexpected vertex count %u.\n",
+            mesh->lpVtbl->GetNumVertices(mesh));
+    ok(check_remap_permutation(face_remap, num_faces, face_inverse), "Got invalid face remap.\n");
+    ok(!!vertex_remap, "Expected a vertex remap.\n");
+    if (!vertex_remap)
+        goto cleanup;
+    remap = ID3DXBuffer_GetBufferPointer(vertex_remap);
+    ok(ID3DXBuffer_GetBufferSize(vertex_remap) >= num_vertices * sizeof(DWORD),
+            "Got unexpected vertex remap size %u.\n", ID3DXBuffer_GetBufferSize(vertex_remap));
+    ok(check_remap_permutation(remap, num_vertices, vertex_inverse), "Got invalid vertex remap.\n");
+
+    hr = mesh->lpVtbl->LockIndexBuffer(mesh, D3DLOCK_READONLY, (void **)&new_indices);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = mesh->lpVtbl->LockVertexBuffer(mesh, D3DLOCK_READONLY, (void **)&new_vertices);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = mesh->lpVtbl->LockAttributeBuffer(mesh, D3DLOCK_READONLY, &new_attributes);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    for (i = 0; i < num_faces; i++)
+    {
+        DWORD old_face = face_remap[i];
+
+        if (old_face >= num_faces)
+            break;
+
+        /* The vertex cache optimization implies sorting by attribute. */
+        ok(new_attributes[i] == attributes[old_face], "Got unexpected attribute %u for face %u.\n",
+                new_attributes[i], i);
+        if (i)
+            ok(new_attributes[i] >= new_attributes[i - 1], "Faces %u and %u aren't sorted by attribute.\n",
+                    i - 1, i);
+
+        /* Each face is still the same triangle. */
+        for (k = 0; k < 3; k++)
+        {
+            DWORD v = new_indices[i * 3 + k];
+
+            ok(v < num_vertices && !memcmp(&new_vertices[v], &vertices[indices[old_face * 3 + k]],
+                    sizeof(*vertices)), "Got unexpected vertex %u for face %u.\n", v, i);
+            ok(v < num_vertices && remap[v] == indices[old_face * 3 + k],
+                    "Got unexpected remap %u for vertex %u.\n", v < num_vertices ? remap[v] : ~0u, v);
+        }
+
+        for (k = 0; k < 3; k++)
+        {
+            DWORD old_adjacent = adjacency[old_face * 3 + k];
+            DWORD exp = old_adjacent == ~0u ? ~0u : face_inverse[old_adjacent];
+
+            ok(adjacency_out[i * 3 + k] == exp, "Got unexpected adjacency %u for face %u, expected %u.\n",
+                    adjacency_out[i * 3 + k], i, exp);
+        }
+    }
+
+    mesh->lpVtbl->UnlockAttributeBuffer(mesh);
+    mesh->lpVtbl->UnlockVertexBuffer(mesh);
+    mesh->lpVtbl->UnlockIndexBuffer(mesh);
+
+cleanup:
+    if (vertex_remap)
+        ID3DXBuffer_Release(vertex_remap);
+    if (mesh)
+        mesh->lpVtbl->Release(mesh);
+    free_test_context(test_context);
+}
+
 static HRESULT clear_normals(ID3DXMesh *mesh)
 {
     HRESULT hr;
@@ -11218,5 +11473,7 @@ START_TEST(mesh)
     test_clone_mesh();
     test_valid_mesh();
     test_optimize_faces();
+    test_optimize_vertices();
+    test_optimize_vertex_cache();
     test_compute_normals();
 }
@@ -695,6 +695,15 @@ static void test_D3DXLoadSurface(IDirect3DDevice9 *device)
     const DWORD pixdata_g16r16[] = { 0x07d23fbe, 0xdc7f44a4, 0xe4d8976b, 0x9a84fe89 };
     const DWORD pixdata_a8b8g8r8[] = { 0xc3394cf0, 0x235ae892, 0x09b197fd, 0x8dc32bf6 };
     const DWORD pixdata_a2r10g10b10[] = { 0x57395aff, 0x5b7668fd, 0xb0d856b5, 0xff2c61d6 };
+    const DWORD pixdata_a8r8g8b8_4x4[] =
+    {
+        0x10203040, 0x30405060, 0xffffffff, 0xffffffff,
+        0x50607080, 0x70809000, 0xffffffff, 0xffffffff,
+        0x00000000, 0x80808080, 0x11223344, 0x11223344,
+        0x80808080, 0x00000000, 0x11223344, 0x11223344,
+    };
+    const DWORD pixdata_a8r8g8b8_3x1[] = { 0x00000000, 0x80808080, 0xffffffff };
+    const DWORD pixdata_a8r8g8b8_4x1[] = { 0x00000000, 0x00000000, 0x00000000, 0xffffffff };
 
     hr = create_file("testdummy.bmp", noimage, sizeof(noimage));  /* invalid image */
     testdummy_ok = SUCCEEDED(hr);
@@ -943,6 +952,58 @@ static void test_D3DXLoadSurface(IDirect3DDevice9 *device)
         hr = IDirect3DSurface9_UnlockRect(surf);
         ok(SUCCEEDED(hr), "Failed to unlock surface, hr %#x.\n", hr);
 
+        /* Test a box filtered downscale */
+        SetRect(&rect, 0, 0, 4, 4);
+        hr = D3DXLoadSurfaceFromMemory(surf, NULL, NULL, pixdata_a8r8g8b8_4x4,
+                D3DFMT_A8R8G8B8, 16, NULL, &rect, D3DX_FILTER_BOX, 0);
+        ok(SUCCEEDED(hr), "Failed to load surface, hr %#x.\n", hr);
+        hr = IDirect3DSurface9_LockRect(surf, &lockrect, NULL, D3DLOCK_READONLY);
+        ok(SUCCEEDED(hr), "Failed to lock surface, hr %#x.\n", hr);
+        check_pixel_4bpp(&lockrect, 0, 0, 0x40506048);
+        check_pixel_4bpp(&lockrect, 1, 0, 0xffffffff);
+        check_pixel_4bpp(&lockrect, 0, 1, 0x40404040);
+        check_pixel_4bpp(&lockrect, 1, 1, 0x11223344);
+        hr = IDirect3DSurface9_UnlockRect(surf);
+        ok(SUCCEEDED(hr), "Failed to unlock surface, hr %#x.\n", hr);
+
+        /* Test linear and triangle filtered downscales by a non-integer factor */
+        SetRect(&rect, 0, 0, 3, 1);
+        SetRect(&destrect, 0, 0, 2, 1);
+        hr = D3DXLoadSurfaceFromMemory(surf, NULL, &destrect, pixdata_a8r8g8b8_3x1,
+                D3DFMT_A8R8G8B8, 12, NULL, &rect, D3DX_FILTER_LINEAR, 0);
+        ok(SUCCEEDED(hr), "Failed to load surface, hr %#x.\n", hr);
+        hr = IDirect3DSurface9_LockRect(surf, &lockrect, NULL, D3DLOCK_READONLY);
+        ok(SUCCEEDED(hr), "Failed to lock surface, hr %#x.\n", hr);
+        check_pixel_4bpp(&lockrect, 0, 0, 0x20202020);
+        check_pixel_4bpp(&lockrect, 1, 0, 0xdfdfdfdf);
+        hr = IDirect3DSurface9_UnlockRect(surf);
+        ok(SUCCEEDED(hr), "Failed to unlock surface, hr %#x.\n", hr);
+
+        hr = D3DXLoadSurfaceFromMemory(surf, NULL, &destrect, pixdata_a8r8g8b8_3x1,
+                D3DFMT_A8R8G8B8, 12, NULL, &rect, D3DX_FILTER_TRIANGLE, 0);
+        ok(SUCCEEDED(hr), "Failed to load surface, hr %#x.\n", hr);
+        hr = IDirect3DSurface9_LockRect(surf, &lockrect, NULL, D3DLOCK_READONLY);
+        ok(SUCCEEDED(hr), "Failed to lock surface, hr %#x.\n", hr);
+        /* The pixels off the edges wrap around. */
+        check_pixel_4bpp(&lockrect, 0, 0, 0x47474747);
+        check_pixel_4bpp(&lockrect, 1, 0, 0xb8b8b8b8);
+        hr = IDirect3DSurface9_UnlockRect(surf);
+        ok(SUCCEEDED(hr), "Failed to unlock surface, hr %#x.\n", hr);
+
+        /* With D3DX_FILTER_MIRROR_U, the pixels off the edges are mirrored,
+         * so each source pixel gets the same weight. */
+        SetRect(&rect, 0, 0, 4, 1);
+        SetRect(&destrect, 0, 0, 1, 1);
+        hr = D3DXLoadSurfaceFromMemory(surf, NULL, &destrect, pixdata_a8r8g8b8_4x1,
+                D3DFMT_A8R8G8B8, 16, NULL, &rect, D3DX_FILTER_TRIANGLE | D3DX_FILTER_MIRROR_U, 0);
+        ok(SUCCEEDED(hr), "Failed to load surface, hr %#x.\n", hr);
+        hr = IDirect3DSurface9_LockRect(surf, &lockrect, NULL, D3DLOCK_READONLY);
+        ok(SUCCEEDED(hr), "Failed to lock surface, hr %#x.\n", hr);
+        check_pixel_4bpp(&lockrect, 0, 0, 0x40404040);
+        hr = IDirect3DSurface9_UnlockRect(surf);
+        ok(SUCCEEDED(hr), "Failed to unlock surface, hr %#x.\n", hr);
+        SetRect(&rect, 0, 0, 2, 2);
+
         /* Test D3DXLoadSurfaceFromMemory with indexed color image */
         palette.peRed   = bmp_1bpp[56];
         palette.peGreen = bmp_1bpp[55];
@@ -147,6 +147,16 @@ static void test_D3DXLoadVolumeFromMemory(IDirect3DDevice9 *device)
     for (i = 0; i < 4; i++) check_pixel_4bpp(&locked_box, i % 2, i / 2, 0, pixels[i + 8]);
     IDirect3DVolume9_UnlockBox(volume);
 
+    /* Box filtering averages all eight source pixels */
+    set_box(&src_box, 0, 0, 2, 2, 0, 2);
+    set_box(&dst_box, 0, 0, 1, 1, 0, 1);
+    hr = D3DXLoadVolumeFromMemory(volume, NULL, &dst_box, pixels, D3DFMT_A8R8G8B8, 8, 16, NULL, &src_box, D3DX_FILTER_BOX, 0);
+    ok(hr == D3D_OK, "D3DXLoadVolumeFromMemory returned %#x, expected %#x\n", hr, D3D_OK);
+
+    IDirect3DVolume9_LockBox(volume, &locked_box, &dst_box, D3DLOCK_READONLY);
+    check_pixel_4bpp(&locked_box, 0, 0, 0, 0xafc0beee);
+    IDirect3DVolume9_UnlockBox(volume);
+
     set_box(&src_box, 0, 0, 4, 1, 0, 4);
 
     set_box(&dst_box, -1, -1, 3, 0, 0, 4);
@@ -11275,6 +11275,141 @@ static void test_blt(void)
     DestroyWindow(window);
 }
 
+/* Blits between system memory surfaces of different formats go through the
+ * CPU format converters. Only timed in interactive mode. */
+static void test_blt_conversion_perf(void)
+{
+    DDSURFACEDESC2 surface_desc, lock_desc;
+    IDirectDrawSurface7 *src, *dst;
+    DWORD start, elapsed, color;
+    unsigned int i, j, k;
+    IDirectDraw7 *ddraw;
+    ULONG refcount;
+    HWND window;
+    HRESULT hr;
+    DWORD *row;
+
+    static const unsigned int size = 1024, count = 50;
+    static const struct
+    {
+        const char *name;
+        DDPIXELFORMAT format;
+        unsigned int bpp;
+        DWORD fill;
+        D3DCOLOR expected;
+    }
+    tests[] =
+    {
+        {
+            "R5G6B5",
+            {
+                sizeof(DDPIXELFORMAT), DDPF_RGB, 0,
+                {16}, {0xf800}, {0x07e0}, {0x001f}, {0x0000}
+            },
+            16, 0xf81ff81f, 0x00ff00ff,
+        },
+        {
+            "A8R8G8B8",
+            {
+                sizeof(DDPIXELFORMAT), DDPF_RGB | DDPF_ALPHAPIXELS, 0,
+                {32}, {0x00ff0000}, {0x0000ff00}, {0x000000ff}, {0xff000000}
+            },
+            32, 0x80123456, 0x00123456,
+        },
+        {
+            "YUY2",
+            {
+                sizeof(DDPIXELFORMAT), DDPF_FOURCC, MAKEFOURCC('Y', 'U', 'Y', '2'),
+                {0}, {0}, {0}, {0}, {0}
+            },
+            16, 0x80808080, 0x00828282,
+        },
+    };
+    static const DDPIXELFORMAT x8r8g8b8 =
+    {
+        sizeof(DDPIXELFORMAT), DDPF_RGB, 0,
+        {32}, {0x00ff0000}, {0x0000ff00}, {0x000000ff}, {0x00000000}
+    };
+
+    if (!winetest_interactive)
+    {
+        skip("Blit conversion benchmark, set WINETEST_INTERACTIVE to run it.\n");
+        return;
+    }
+
+    window = CreateWindowA("static", "ddraw_test", WS_OVERLAPPEDWINDOW,
+            0, 0, 640, 480, 0, 0, 0, 0);
+    ddraw = create_ddraw();
+    ok(!!ddraw, "Failed to create a ddraw object.\n");
+    hr = IDirectDraw7_SetCooperativeLevel(ddraw, window, DDSCL_NORMAL);
+    ok(SUCCEEDED(hr), "Failed to set cooperative level, hr %#x.\n", hr);
+
+    memset(&surface_desc, 0, sizeof(surface_desc));
+    surface_desc.dwSize = sizeof(surface_desc);
+    surface_desc.dwFlags = DDSD_CAPS | DDSD_WIDTH | DDSD_HEIGHT | DDSD_PIXELFORMAT;
+    surface_desc.ddsCaps.dwCaps = DDSCAPS_OFFSCREENPLAIN | DDSCAPS_SYSTEMMEMORY;
+    surface_desc.dwWidth = size;
+    surface_desc.dwHeight = size;
+    U4(surface_desc).ddpfPixelFormat = x8r8g8b8;
+    hr = IDirectDraw7_CreateSurface(ddraw, &surface_desc, &dst, NULL);
+    ok(SUCCEEDED(hr), "Failed to create surface, hr %#x.\n", hr);
+
+    for (i = 0; i < sizeof(tests) / sizeof(*tests); ++i)
+    {
+        U4(surface_desc).ddpfPixelFormat = tests[i].format;
+        if (FAILED(hr = IDirectDraw7_CreateSurface(ddraw, &surface_desc, &src, NULL)))
+        {
+            skip("Failed to create %s surface, hr %#x.\n", tests[i].name, hr);
+            continue;
+        }
+
+        memset(&lock_desc, 0, sizeof(lock_desc));
+        lock_desc.dwSize = sizeof(lock_desc);
+        hr = IDirectDrawSurface7_Lock(src, NULL, &lock_desc, DDLOCK_WAIT, NULL);
+        ok(SUCCEEDED(hr), "Failed to lock surface, hr %#x.\n", hr);
+        for (j = 0; j < size; ++j)
+        {
+            row = (DWORD *)((BYTE *)lock_desc.lpSurface + j * U1(lock_desc).lPitch);
+            for (k = 0; k < size * tests[i].bpp / 32; ++k)
+                row[k] = tests[i].fill;
+        }
+        hr = IDirectDrawSurface7_Unlock(src, NULL);
+        ok(SUCCEEDED(hr), "Failed to unlock surface, hr %#x.\n", hr);
+
+        if (FAILED(hr = IDirectDrawSurface7_Blt(dst, NULL, src, NULL, DDBLT_WAIT, NULL)))
+        {
+            skip("Failed to blit from %s, hr %#x.\n", tests[i].name, hr);
+            IDirectDrawSurface7_Release(src);
+            continue;
+        }
+
+        start = GetTickCount();
+        for (j = 0; j < count; ++j)
+        {
+            hr = IDirectDrawSurface7_Blt(dst, NULL, src, NULL, DDBLT_WAIT, NULL);
+            ok(SUCCEEDED(hr), "Failed to blit, hr %#x.\n", hr);
+        }
+        elapsed = GetTickCount() - start;
+        trace("Converted %u %ux%u %s surfaces in %u ms, %u MB/s.\n", count, size, size, tests[i].name,
+                elapsed, elapsed ? (count * size * size * tests[i].bpp / 8) / (elapsed * 1000) : 0);
+
+        hr = IDirectDrawSurface7_Lock(dst, NULL, &lock_desc, DDLOCK_READONLY | DDLOCK_WAIT, NULL);
+        ok(SUCCEEDED(hr), "Failed to lock surface, hr %#x.\n", hr);
+        color = ((DWORD *)((BYTE *)lock_desc.lpSurface + (size / 2) * U1(lock_desc).lPitch))[size / 2];
+        ok(compare_color(color & 0x00ffffff, tests[i].expected, 2),
+                "Got unexpected color 0x%08x for %s.\n", color, tests[i].name);
+        hr = IDirectDrawSurface7_Unlock(dst, NULL);
+        ok(SUCCEEDED(hr), "Failed to unlock surface, hr %#x.\n", hr);
+
+        IDirectDrawSurface7_Release(src);
+    }
+
+    IDirectDrawSurface7_Release(dst);
+    refcount = IDirectDraw7_Release(ddraw);
+    ok(!refcount, "DirectDraw has %u references left.\n", refcount);
+    DestroyWindow(window);
+}
+
 static void test_color_clamping(void)
 {
     static D3DMATRIX mat =
@@ -11918,6 +12053,7 @@ START_TEST(ddraw7)
     test_offscreen_overlay();
     test_overlay_rect();
     test_blt();
+    test_blt_conversion_perf();
     test_color_clamping();
     test_getdc();
     test_draw_primitive();
@@ -22,6 +22,7 @@
 
 #include <stdarg.h>
 #include <math.h>
+#include <float.h>
 
 #include "windef.h"
 #include "winbase.h"
@@ -152,7 +153,9 @@ enum layout_run_kind {
 
 struct inline_object_run {
     IDWriteInlineObject *object;
+    UINT32 position;
     UINT16 length;
+    FLOAT width;
 };
 
 struct regular_layout_run {
@@ -228,9 +231,21 @@ enum layout_recompute_mask {
     RECOMPUTE_NOMINAL_RUNS   = 1 << 0,
     RECOMPUTE_MINIMAL_WIDTH  = 1 << 1,
     RECOMPUTE_EFFECTIVE_RUNS = 1 << 2,
+    RECOMPUTE_DIRTY_RUNS     = 1 << 3, /* only runs within [dirty_start,dirty_end) are outdated */
+    RECOMPUTE_DIRTY_LINES    = 1 << 4, /* only lines ending after relayout_pos are outdated */
     RECOMPUTE_EVERYTHING     = 0xffff
 };
 
+/* Line breaking state saved at the end of every line, used to restart breaking from a given line. */
+struct layout_line_state {
+    UINT32 cluster;         /* index of the cluster that terminated this line */
+    UINT32 textpos;         /* text position following that cluster */
+    FLOAT width;            /* line width, including trailing whitespace */
+    FLOAT trimmed_width;    /* line width without trailing whitespace */
+    FLOAT fit_width;        /* widest breaking opportunity that fit in layout width */
+    FLOAT break_width;      /* width that didn't fit and caused wrapping, FLT_MAX for mandatory breaks */
+};
+
 struct dwrite_textlayout {
     IDWriteTextLayout3 IDWriteTextLayout3_iface;
     IDWriteTextFormat1 IDWriteTextFormat1_iface;
@@ -256,6 +271,9 @@ struct dwrite_textlayout {
     struct list underlines;
     struct list strikethrough;
     USHORT recompute;
+    UINT32 dirty_start;
+    UINT32 dirty_end;
+    UINT32 relayout_pos;
 
     DWRITE_LINE_BREAKPOINT *nominal_breakpoints;
     DWRITE_LINE_BREAKPOINT *actual_breakpoints;
@@ -266,6 +284,7 @@ struct dwrite_textlayout {
     FLOAT  minwidth;
 
     DWRITE_LINE_METRICS *lines;
+    struct layout_line_state *line_states;
     UINT32 line_alloc;
 
     DWRITE_TEXT_METRICS1 metrics;
@@ -476,23 +495,38 @@ static struct layout_run *alloc_layout_run(enum layout_run_kind kind)
     return ret;
 }
 
+static void free_layout_run(struct layout_run *run)
+{
+    if (run->kind == LAYOUT_RUN_REGULAR) {
+        if (run->u.regular.run.fontFace)
+            IDWriteFontFace_Release(run->u.regular.run.fontFace);
+        heap_free(run->u.regular.glyphs);
+        heap_free(run->u.regular.clustermap);
+        heap_free(run->u.regular.advances);
+        heap_free(run->u.regular.offsets);
+    }
+    heap_free(run);
+}
+
 static void free_layout_runs(struct dwrite_textlayout *layout)
 {
     struct layout_run *cur, *cur2;
     LIST_FOR_EACH_ENTRY_SAFE(cur, cur2, &layout->runs, struct layout_run, entry) {
         list_remove(&cur->entry);
-        if (cur->kind == LAYOUT_RUN_REGULAR) {
-            if (cur->u.regular.run.fontFace)
-                IDWriteFontFace_Release(cur->u.regular.run.fontFace);
-            heap_free(cur->u.regular.glyphs);
-            heap_free(cur->u.regular.clustermap);
-            heap_free(cur->u.regular.advances);
-            heap_free(cur->u.regular.offsets);
-        }
-        heap_free(cur);
+        free_layout_run(cur);
     }
 }
 
+static inline UINT32 get_layout_run_position(const struct layout_run *run)
+{
+    return run->kind == LAYOUT_RUN_INLINE ? run->u.object.position : run->u.regular.descr.textPosition;
+}
+
+static inline UINT32 get_layout_run_length(const struct layout_run *run)
+{
+    return run->kind == LAYOUT_RUN_INLINE ? run->u.object.length : run->u.regular.descr.stringLength;
+}
+
 static void free_layout_eruns(struct dwrite_textlayout *layout)
 {
     struct layout_effective_inline *in, *in2;
@@ -714,50 +748,163 @@ static void layout_get_font_height(FLOAT emsize, DWRITE_FONT_METRICS *fontmetric
     *height = SCALE_FONT_METRIC(fontmetrics->ascent + fontmetrics->descent + fontmetrics->lineGap, emsize, fontmetrics);
 }
 
-static HRESULT layout_compute_runs(struct dwrite_textlayout *layout)
+/* Marks lines that end after 'pos' as outdated, line breaking will restart from first such line. */
+static void layout_invalidate_lines(struct dwrite_textlayout *layout, UINT32 pos)
+{
+    if (!(layout->recompute & RECOMPUTE_DIRTY_LINES) || pos < layout->relayout_pos)
+        layout->relayout_pos = pos;
+    layout->recompute |= RECOMPUTE_DIRTY_LINES;
+}
+
+/* Marks given text range as changed. If 'reshape' is set, nominal runs for this range are
+   itemized and shaped again on next update, otherwise only line breaking is affected. */
+static void layout_invalidate_range(struct dwrite_textlayout *layout, const DWRITE_TEXT_RANGE *range, BOOL reshape)
+{
+    UINT32 start = range->startPosition, end;
+
+    end = start + min(range->length, ~0u - start);
+
+    if (reshape) {
+        if (!(layout->recompute & RECOMPUTE_DIRTY_RUNS)) {
+            layout->dirty_start = start;
+            layout->dirty_end = end;
+        }
+        else {
+            layout->dirty_start = min(layout->dirty_start, start);
+            layout->dirty_end = max(layout->dirty_end, end);
+        }
+        layout->recompute |= RECOMPUTE_DIRTY_RUNS | RECOMPUTE_MINIMAL_WIDTH;
+    }
+
+    /* breaking conditions for position preceding changed range could change too */
+    layout_invalidate_lines(layout, start ? start - 1 : 0);
+}
+
+/* Extends [start,end) so it's aligned with both layout range boundaries and existing runs boundaries. */
+static void layout_extend_dirty_range(struct dwrite_textlayout *layout, UINT32 *start, UINT32 *end)
 {
-    IDWriteFontFallback *fallback;
-    IDWriteTextAnalyzer *analyzer;
     struct layout_range *range;
     struct layout_run *r;
-    UINT32 cluster = 0;
-    HRESULT hr;
+    BOOL extended;
 
-    free_layout_eruns(layout);
-    free_layout_runs(layout);
+    if (*start >= *end)
+        return;
 
-    /* Cluster data arrays are allocated once, assuming one text position per cluster. */
-    if (!layout->clustermetrics && layout->len) {
-        layout->clustermetrics = heap_alloc(layout->len*sizeof(*layout->clustermetrics));
-        layout->clusters = heap_alloc(layout->len*sizeof(*layout->clusters));
-        if (!layout->clustermetrics || !layout->clusters) {
-            heap_free(layout->clustermetrics);
-            heap_free(layout->clusters);
-            return E_OUTOFMEMORY;
+    do {
+        UINT32 range_end;
+
+        extended = FALSE;
+
+        range = get_layout_range_by_pos(layout, *start);
+        if (range->h.range.startPosition < *start) {
+            *start = range->h.range.startPosition;
+            extended = TRUE;
         }
+
+        range = get_layout_range_by_pos(layout, *end - 1);
+        range_end = range->h.range.startPosition + get_clipped_range_length(layout, range);
+        if (range_end > *end) {
+            *end = range_end;
+            extended = TRUE;
+        }
+
+        LIST_FOR_EACH_ENTRY(r, &layout->runs, struct layout_run, entry) {
+            UINT32 run_start = get_layout_run_position(r), run_end = run_start + get_layout_run_length(r);
+
+            if (run_start < *start && *start < run_end) {
+                *start = run_start;
+                extended = TRUE;
+            }
+            if (run_start < *end && *end < run_end) {
+                *end = run_end;
+                extended = TRUE;
+            }
+        }
+    } while (extended);
+}
+
+/* Runs preceding [start,end) are moved to 'head' list, runs following it - to 'tail' list,
+   everything else is released. */
+static void layout_detach_runs(struct dwrite_textlayout *layout, UINT32 start, UINT32 end, struct list *head,
+    struct list *tail)
+{
+    struct layout_run *cur, *cur2;
+
+    LIST_FOR_EACH_ENTRY_SAFE(cur, cur2, &layout->runs, struct layout_run, entry) {
+        UINT32 position = get_layout_run_position(cur);
+
+        list_remove(&cur->entry);
+        if (position + get_layout_run_length(cur) <= start)
+            list_add_tail(head, &cur->entry);
+        else if (position >= end)
+            list_add_tail(tail, &cur->entry);
+        else
+            free_layout_run(cur);
     }
-    layout->cluster_count = 0;
+}
+
+/* There's always one cluster per inline object. */
+static void layout_set_inline_cluster_metrics(struct dwrite_textlayout *layout, const struct layout_run *r, UINT32 *cluster)
+{
+    DWRITE_CLUSTER_METRICS *metrics = &layout->clustermetrics[*cluster];
+    struct layout_cluster *c = &layout->clusters[*cluster];
+
+    metrics->width = r->u.object.width;
+    metrics->length = r->u.object.length;
+    metrics->canWrapLineAfter = 0;
+    metrics->isWhitespace = 0;
+    metrics->isNewline = 0;
+    metrics->isSoftHyphen = 0;
+    metrics->isRightToLeft = 0;
+    metrics->padding = 0;
+    c->run = r;
+    c->position = 0; /* there's always one cluster per inline object, so 0 is valid value */
+    *cluster += 1;
+
+    /* FIXME: use resolved breakpoints in this case too */
+}
+
+/* Itemizes and shapes text in [start,end), which is expected to start and end at range boundaries.
+   New runs are added to layout run list. */
+static HRESULT layout_shape_runs(struct dwrite_textlayout *layout, UINT32 start, UINT32 end)
+{
+    IDWriteFontFallback *fallback;
+    IDWriteTextAnalyzer *analyzer;
+    struct layout_range *range;
+    struct layout_run *r;
+    HRESULT hr;
 
     hr = get_textanalyzer(&analyzer);
     if (FAILED(hr))
         return hr;
 
+    /* inline objects override actual text in a range */
     LIST_FOR_EACH_ENTRY(range, &layout->ranges, struct layout_range, h.entry) {
-        /* we don't care about ranges that don't contain any text */
         if (range->h.range.startPosition >= layout->len)
             break;
 
-        /* inline objects override actual text in a range */
         if (range->object) {
             hr = layout_update_breakpoints_range(layout, range);
             if (FAILED(hr))
                 return hr;
+        }
+    }
+
+    LIST_FOR_EACH_ENTRY(range, &layout->ranges, struct layout_range, h.entry) {
+        /* we don't care about ranges that don't contain any text */
+        if (range->h.range.startPosition >= end)
+            break;
 
+        if (range->h.range.startPosition < start)
+            continue;
+
+        if (range->object) {
             r = alloc_layout_run(LAYOUT_RUN_INLINE);
             if (!r)
                 return E_OUTOFMEMORY;
 
             r->u.object.object = range->object;
+            r->u.object.position = range->h.range.startPosition;
             r->u.object.length = get_clipped_range_length(layout, range);
             list_add_tail(&layout->runs, &r->entry);
             continue;
@@ -862,34 +1009,17 @@ static HRESULT layout_compute_runs(struct dwrite_textlayout *layout)
 
         /* we need to do very little in case of inline objects */
         if (r->kind == LAYOUT_RUN_INLINE) {
-            DWRITE_CLUSTER_METRICS *metrics = &layout->clustermetrics[cluster];
-            struct layout_cluster *c = &layout->clusters[cluster];
             DWRITE_INLINE_OBJECT_METRICS inlinemetrics;
 
-            metrics->width = 0.0f;
-            metrics->length = r->u.object.length;
-            metrics->canWrapLineAfter = 0;
-            metrics->isWhitespace = 0;
-            metrics->isNewline = 0;
-            metrics->isSoftHyphen = 0;
-            metrics->isRightToLeft = 0;
-            metrics->padding = 0;
-            c->run = r;
-            c->position = 0; /* there's always one cluster per inline object, so 0 is valid value */
-            cluster++;
-
             /* it's not fatal if GetMetrics() fails, all returned metrics are ignored */
             hr = IDWriteInlineObject_GetMetrics(r->u.object.object, &inlinemetrics);
             if (FAILED(hr)) {
                 memset(&inlinemetrics, 0, sizeof(inlinemetrics));
                 hr = S_OK;
             }
-            metrics->width = inlinemetrics.width;
+            r->u.object.width = inlinemetrics.width;
             r->baseline = inlinemetrics.baseline;
             r->height = inlinemetrics.height;
-
-            /* FIXME: use resolved breakpoints in this case too */
-
             continue;
         }
 
@@ -975,8 +1105,6 @@ static HRESULT layout_compute_runs(struct dwrite_textlayout *layout)
         /* baseline derived from font metrics */
         layout_get_font_metrics(layout, run->run.fontFace, run->run.fontEmSize, &fontmetrics);
         layout_get_font_height(run->run.fontEmSize, &fontmetrics, &r->baseline, &r->height);
-
-        layout_set_cluster_metrics(layout, r, &cluster);
         continue;
 
     memerr:
@@ -993,13 +1121,73 @@ static HRESULT layout_compute_runs(struct dwrite_textlayout *layout)
         break;
     }
 
+    IDWriteTextAnalyzer_Release(analyzer);
+    return hr;
+}
+
+/* Itemizes and shapes text. When full update is not requested, only runs covering changed ranges
+   are rebuilt, remaining runs are kept as is. Cluster metrics are always rebuilt for the whole text,
+   because breaking conditions from inline objects could affect neighbouring runs. */
+static HRESULT layout_compute_runs(struct dwrite_textlayout *layout)
+{
+    struct list head, tail;
+    struct layout_run *r;
+    UINT32 cluster = 0, start, end;
+    HRESULT hr;
+
+    /* Cluster data arrays are allocated once, assuming one text position per cluster. */
+    if (!layout->clustermetrics && layout->len) {
+        layout->clustermetrics = heap_alloc(layout->len*sizeof(*layout->clustermetrics));
+        layout->clusters = heap_alloc(layout->len*sizeof(*layout->clusters));
+        if (!layout->clustermetrics || !layout->clusters) {
+            heap_free(layout->clustermetrics);
+            heap_free(layout->clusters);
+            layout->clustermetrics = NULL;
+            layout->clusters = NULL;
+            return E_OUTOFMEMORY;
+        }
+    }
+    layout->cluster_count = 0;
+
+    list_init(&head);
+    list_init(&tail);
+
+    if (layout->recompute & RECOMPUTE_NOMINAL_RUNS) {
+        free_layout_eruns(layout);
+        free_layout_runs(layout);
+        start = 0;
+        end = layout->len;
+    }
+    else {
+        start = min(layout->dirty_start, layout->len);
+        end = min(layout->dirty_end, layout->len);
+        layout_extend_dirty_range(layout, &start, &end);
+        layout_detach_runs(layout, start, end, &head, &tail);
+
+        /* effective runs referencing released runs are removed when line breaking restarts */
+        layout_invalidate_lines(layout, start ? start - 1 : 0);
+        TRACE("updating runs in [%u,%u)\n", start, end);
+    }
+
+    hr = layout_shape_runs(layout, start, end);
+
+    list_move_head(&layout->runs, &head);
+    list_move_tail(&layout->runs, &tail);
+
     if (hr == S_OK) {
+        LIST_FOR_EACH_ENTRY(r, &layout->runs, struct layout_run, entry) {
+            if (r->kind == LAYOUT_RUN_INLINE)
+                layout_set_inline_cluster_metrics(layout, r, &cluster);
+            /* runs that failed to shape don't produce any clusters */
+            else if (r->u.regular.descr.clusterMap)
+                layout_set_cluster_metrics(layout, r, &cluster);
+        }
+
         layout->cluster_count = cluster;
         if (cluster)
             layout->clustermetrics[cluster-1].canWrapLineAfter = 1;
     }
 
-    IDWriteTextAnalyzer_Release(analyzer);
     return hr;
 }
 
@@ -1007,7 +1195,7 @@ static HRESULT layout_compute(struct dwrite_textlayout *layout)
 {
     HRESULT hr;
 
-    if (!(layout->recompute & RECOMPUTE_NOMINAL_RUNS))
+    if (!(layout->recompute & (RECOMPUTE_NOMINAL_RUNS | RECOMPUTE_DIRTY_RUNS)))
         return S_OK;
 
     /* nominal breakpoints are evaluated only once, because string never changes */
@@ -1046,7 +1234,7 @@ static HRESULT layout_compute(struct dwrite_textlayout *layout)
         }
     }
 
-    layout->recompute &= ~RECOMPUTE_NOMINAL_RUNS;
+    layout->recompute &= ~(RECOMPUTE_NOMINAL_RUNS | RECOMPUTE_DIRTY_RUNS);
     return hr;
 }
 
@@ -1252,24 +1440,40 @@ static HRESULT layout_add_effective_run(struct dwrite_textlayout *layout, const
     return S_OK;
 }
 
-static HRESULT layout_set_line_metrics(struct dwrite_textlayout *layout, DWRITE_LINE_METRICS *metrics, UINT32 *line)
+static HRESULT layout_set_line_metrics(struct dwrite_textlayout *layout, DWRITE_LINE_METRICS *metrics,
+    const struct layout_line_state *state, UINT32 *line)
 {
     if (!layout->line_alloc) {
-        layout->line_alloc = 5;
-        layout->lines = heap_alloc(layout->line_alloc*sizeof(*layout->lines));
-        if (!layout->lines)
+        layout->lines = heap_alloc(5*sizeof(*layout->lines));
+        layout->line_states = heap_alloc(5*sizeof(*layout->line_states));
+        if (!layout->lines || !layout->line_states) {
+            heap_free(layout->lines);
+            heap_free(layout->line_states);
+            layout->lines = NULL;
+            layout->line_states = NULL;
             return E_OUTOFMEMORY;
+        }
+        layout->line_alloc = 5;
     }
 
     if (layout->metrics.lineCount == layout->line_alloc) {
-        DWRITE_LINE_METRICS *l = heap_realloc(layout->lines, layout->line_alloc*2*sizeof(*layout->lines));
+        struct layout_line_state *states;
+        DWRITE_LINE_METRICS *l;
+
+        l = heap_realloc(layout->lines, layout->line_alloc*2*sizeof(*layout->lines));
         if (!l)
             return E_OUTOFMEMORY;
         layout->lines = l;
+
+        states = heap_realloc(layout->line_states, layout->line_alloc*2*sizeof(*layout->line_states));
+        if (!states)
+            return E_OUTOFMEMORY;
+        layout->line_states = states;
         layout->line_alloc *= 2;
     }
 
     layout->lines[*line] = *metrics;
+    layout->line_states[*line] = *state;
     layout->metrics.lineCount += 1;
     *line += 1;
     return S_OK;
@@ -1640,6 +1844,7 @@ static HRESULT layout_add_underline(struct dwrite_textlayout *layout, struct lay
 /* Adds zero width line, metrics are derived from font at specified text position. */
 static HRESULT layout_set_dummy_line_metrics(struct dwrite_textlayout *layout, UINT32 pos, UINT32 *line)
 {
+    struct layout_line_state state;
     DWRITE_FONT_METRICS fontmetrics;
     DWRITE_LINE_METRICS metrics;
     struct layout_range *range;
@@ -1669,7 +1874,79 @@ static HRESULT layout_set_dummy_line_metrics(struct dwrite_textlayout *layout, U
     metrics.trailingWhitespaceLength = 0;
     metrics.newlineLength = 0;
     metrics.isTrimmed = FALSE;
-    return layout_set_line_metrics(layout, &metrics, line);
+
+    state.cluster = layout->cluster_count;
+    state.textpos = layout->len;
+    state.width = state.trimmed_width = state.fit_width = 0.0f;
+    state.break_width = FLT_MAX;
+    return layout_set_line_metrics(layout, &metrics, &state, line);
+}
+
+/* Removes lines starting from 'line' together with their effective runs. Underlines are always removed,
+   because consecutive underlined runs could span multiple lines. */
+static void layout_truncate_lines(struct dwrite_textlayout *layout, UINT32 line)
+{
+    struct layout_effective_inline *in, *in2;
+    struct layout_effective_run *cur, *cur2;
+    struct layout_strikethrough *s, *s2;
+    struct layout_underline *u, *u2;
+    UINT32 i;
+
+    LIST_FOR_EACH_ENTRY_SAFE(u, u2, &layout->underlines, struct layout_underline, entry) {
+        list_remove(&u->entry);
+        heap_free(u);
+    }
+
+    LIST_FOR_EACH_ENTRY_SAFE_REV(s, s2, &layout->strikethrough, struct layout_strikethrough, entry) {
+        if (s->run->line < line)
+            break;
+        list_remove(&s->entry);
+        heap_free(s);
+    }
+
+    LIST_FOR_EACH_ENTRY_SAFE_REV(cur, cur2, &layout->eruns, struct layout_effective_run, entry) {
+        if (cur->line < line)
+            break;
+        list_remove(&cur->entry);
+        heap_free(cur->clustermap);
+        heap_free(cur);
+    }
+
+    LIST_FOR_EACH_ENTRY_SAFE_REV(in, in2, &layout->inlineobjects, struct layout_effective_inline, entry) {
+        if (in->line < line)
+            break;
+        list_remove(&in->entry);
+        heap_free(in);
+    }
+
+    /* update metrics from remaining lines */
+    layout->metrics.lineCount = line;
+    layout->metrics.width = 0.0f;
+    layout->metrics.widthIncludingTrailingWhitespace = 0.0f;
+    for (i = 0; i < line; i++) {
+        const struct layout_line_state *state = &layout->line_states[i];
+
+        if (state->width > layout->metrics.widthIncludingTrailingWhitespace)
+            layout->metrics.widthIncludingTrailingWhitespace = state->width;
+        if (state->trimmed_width > layout->metrics.width)
+            layout->metrics.width = state->trimmed_width;
+        layout->lines[i].isTrimmed = state->width > layout->metrics.layoutWidth;
+    }
+}
+
+/* Returns index of the first line that has to be built again, previous lines are not affected
+   by changes made after last update. */
+static UINT32 layout_get_relayout_line(struct dwrite_textlayout *layout)
+{
+    UINT32 line = 0;
+
+    if (layout->recompute & RECOMPUTE_EFFECTIVE_RUNS)
+        return 0;
+
+    while (line < layout->metrics.lineCount && layout->line_states[line].textpos <= layout->relayout_pos)
+        line++;
+
+    return line < layout->metrics.lineCount ? line : 0;
 }
 
 static HRESULT layout_compute_effective_runs(struct dwrite_textlayout *layout)
@@ -1678,30 +1955,50 @@ static HRESULT layout_compute_effective_runs(struct dwrite_textlayout *layout)
     struct layout_final_splitting_params prev_params, params;
     struct layout_effective_run *erun, *first_underlined;
     struct layout_effective_inline *inrun;
+    struct layout_line_state state;
     const struct layout_run *run;
     DWRITE_LINE_METRICS metrics;
     FLOAT width, origin_x, origin_y;
     UINT32 i, start, line, textpos;
     HRESULT hr;
 
-    if (!(layout->recompute & RECOMPUTE_EFFECTIVE_RUNS))
+    if (!(layout->recompute & (RECOMPUTE_EFFECTIVE_RUNS | RECOMPUTE_DIRTY_LINES)))
         return S_OK;
 
     hr = layout_compute(layout);
     if (FAILED(hr))
         return hr;
 
-    layout->metrics.lineCount = 0;
+    line = layout_get_relayout_line(layout);
+    TRACE("breaking lines starting from line %u\n", line);
+    layout_truncate_lines(layout, line);
+
     origin_x = is_rtl ? layout->metrics.layoutWidth : 0.0f;
-    line = 0;
     memset(&metrics, 0, sizeof(metrics));
-
-    layout_splitting_params_from_pos(layout, 0, &params);
+    state.fit_width = 0.0f;
+    state.break_width = FLT_MAX;
+
+    if (line) {
+        /* restore state as it was right after previous line was added */
+        const struct layout_line_state *prev = &layout->line_states[line - 1];
+
+        start = prev->cluster;
+        textpos = prev->textpos;
+        width = layout->clustermetrics[start].width;
+        run = layout->clusters[start].run;
+        layout_splitting_params_from_pos(layout, textpos - layout->clustermetrics[start].length, &params);
+        i = start + 1;
+    }
+    else {
+        layout_splitting_params_from_pos(layout, 0, &params);
+        if (layout->cluster_count)
+            run = layout->clusters[0].run;
+        i = start = textpos = 0;
+        width = 0.0f;
+    }
     prev_params = params;
 
-    if (layout->cluster_count)
-        run = layout->clusters[0].run;
-    for (i = 0, start = 0, textpos = 0, width = 0.0f; i < layout->cluster_count; i++) {
+    for (; i < layout->cluster_count; i++) {
         BOOL overflow;
 
         layout_splitting_params_from_pos(layout, textpos, &params);
@@ -1721,6 +2018,14 @@ static HRESULT layout_compute_effective_runs(struct dwrite_textlayout *layout)
         overflow = layout->clustermetrics[i].canWrapLineAfter &&
             (width + layout->clustermetrics[i].width > layout->metrics.layoutWidth) &&
             (layout->format.wrapping != DWRITE_WORD_WRAPPING_NO_WRAP);
+
+        /* keep track of widths that affected breaking decisions for this line */
+        if (layout->clustermetrics[i].canWrapLineAfter) {
+            if (overflow)
+                state.break_width = width + layout->clustermetrics[i].width;
+            else if (width + layout->clustermetrics[i].width > state.fit_width)
+                state.fit_width = width + layout->clustermetrics[i].width;
+        }
         /* check if we got new */
         if (overflow ||
             layout->clustermetrics[i].isNewline || /* always wrap on new line */
@@ -1803,12 +2108,19 @@ static HRESULT layout_compute_effective_runs(struct dwrite_textlayout *layout)
                 layout->metrics.width = width - trailingspacewidth;
 
             metrics.isTrimmed = width > layout->metrics.layoutWidth;
-            hr = layout_set_line_metrics(layout, &metrics, &line);
+
+            state.cluster = i;
+            state.textpos = textpos + layout->clustermetrics[i].length;
+            state.width = width;
+            state.trimmed_width = width - trailingspacewidth;
+            hr = layout_set_line_metrics(layout, &metrics, &state, &line);
             if (FAILED(hr))
                 return hr;
 
             width = layout->clustermetrics[i].width;
             memset(&metrics, 0, sizeof(metrics));
+            state.fit_width = 0.0f;
+            state.break_width = FLT_MAX;
             origin_x = is_rtl ? layout->metrics.layoutWidth : 0.0f;
             start = i;
         }
@@ -1870,9 +2182,8 @@ static HRESULT layout_compute_effective_runs(struct dwrite_textlayout *layout)
         layout->metrics.height += layout->lines[line].height;
     }
 
-    /* initial alignment is always leading */
-    if (layout->format.textalignment != DWRITE_TEXT_ALIGNMENT_LEADING)
-        layout_apply_text_alignment(layout);
+    /* kept runs could have alignment adjustments for previous layout width */
+    layout_apply_text_alignment(layout);
 
     /* initial paragraph alignment is always near */
     if (layout->format.paralign != DWRITE_PARAGRAPH_ALIGNMENT_NEAR)
@@ -1880,7 +2191,7 @@ static HRESULT layout_compute_effective_runs(struct dwrite_textlayout *layout)
 
     layout->metrics.heightIncludingTrailingWhitespace = layout->metrics.height; /* FIXME: not true for vertical text */
 
-    layout->recompute &= ~RECOMPUTE_EFFECTIVE_RUNS;
+    layout->recompute &= ~(RECOMPUTE_EFFECTIVE_RUNS | RECOMPUTE_DIRTY_LINES);
     return hr;
 }
 
@@ -2335,6 +2646,22 @@ static inline HRESULT return_range(const struct layout_range_header *h, DWRITE_T
     return S_OK;
 }
 
+static void layout_invalidate_range_attr(struct dwrite_textlayout *layout, enum layout_range_attr_kind attr,
+    const DWRITE_TEXT_RANGE *range)
+{
+    switch (attr)
+    {
+    /* decorations and effects only split effective runs */
+    case LAYOUT_RANGE_ATTR_UNDERLINE:
+    case LAYOUT_RANGE_ATTR_STRIKETHROUGH:
+    case LAYOUT_RANGE_ATTR_EFFECT:
+        layout_invalidate_range(layout, range, FALSE);
+        break;
+    default:
+        layout_invalidate_range(layout, range, TRUE);
+    }
+}
+
 /* Sets attribute value for given range, does all needed splitting/merging of existing ranges. */
 static HRESULT set_layout_range_attr(struct dwrite_textlayout *layout, enum layout_range_attr_kind attr, struct layout_range_attr_value *value)
 {
@@ -2439,7 +2766,7 @@ static HRESULT set_layout_range_attr(struct dwrite_textlayout *layout, enum layo
         list_add_after(&outer->entry, &cur->entry);
         list_add_after(&cur->entry, &right->entry);
 
-        layout->recompute = RECOMPUTE_EVERYTHING;
+        layout_invalidate_range_attr(layout, attr, &value->range);
         return S_OK;
     }
 
@@ -2479,7 +2806,7 @@ done:
     if (changed) {
         struct list *next, *i;
 
-        layout->recompute = RECOMPUTE_EVERYTHING;
+        layout_invalidate_range_attr(layout, attr, &value->range);
         i = list_head(ranges);
         while ((next = list_next(ranges, i))) {
             struct layout_range_header *next_range = LIST_ENTRY(next, struct layout_range_header, entry);
@@ -2610,6 +2937,7 @@ static ULONG WINAPI dwritetextlayout_Release(IDWriteTextLayout3 *iface)
         heap_free(This->clustermetrics);
         heap_free(This->clusters);
         heap_free(This->lines);
+        heap_free(This->line_states);
         heap_free(This->str);
         heap_free(This);
     }
@@ -2775,29 +3103,78 @@ static HRESULT WINAPI dwritetextlayout_GetLocaleName(IDWriteTextLayout3 *iface,
     return IDWriteTextFormat1_GetLocaleName(&This->IDWriteTextFormat1_iface, name, size);
 }
 
+/* Returns number of leading lines that are broken the same way with given layout width. */
+static UINT32 layout_get_unaffected_line_count(const struct dwrite_textlayout *layout, FLOAT width)
+{
+    UINT32 line;
+
+    if (layout->format.wrapping == DWRITE_WORD_WRAPPING_NO_WRAP)
+        return layout->metrics.lineCount;
+
+    for (line = 0; line < layout->metrics.lineCount; line++) {
+        const struct layout_line_state *state = &layout->line_states[line];
+
+        if (state->fit_width > width || state->break_width <= width)
+            break;
+    }
+
+    return line;
+}
+
 static HRESULT WINAPI dwritetextlayout_SetMaxWidth(IDWriteTextLayout3 *iface, FLOAT maxWidth)
 {
     struct dwrite_textlayout *This = impl_from_IDWriteTextLayout3(iface);
+    UINT32 line;
 
     TRACE("(%p)->(%.2f)\n", This, maxWidth);
 
     if (maxWidth < 0.0f)
         return E_INVALIDARG;
 
+    if (This->metrics.layoutWidth == maxWidth)
+        return S_OK;
+
     This->metrics.layoutWidth = maxWidth;
+
+    if (This->recompute & RECOMPUTE_EFFECTIVE_RUNS)
+        return S_OK;
+
+    /* run origins are set relative to layout width for right-to-left direction */
+    if (This->format.readingdir == DWRITE_READING_DIRECTION_RIGHT_TO_LEFT) {
+        This->recompute |= RECOMPUTE_EFFECTIVE_RUNS;
+        return S_OK;
+    }
+
+    line = layout_get_unaffected_line_count(This, maxWidth);
+    if (line < This->metrics.lineCount)
+        layout_invalidate_lines(This, line ? This->line_states[line - 1].textpos : 0);
+    else if (!(This->recompute & RECOMPUTE_DIRTY_LINES)) {
+        /* lines are broken the same way, only trimming flags and alignment change */
+        for (line = 0; line < This->metrics.lineCount; line++)
+            This->lines[line].isTrimmed = This->line_states[line].width > maxWidth;
+        layout_apply_text_alignment(This);
+    }
+
     return S_OK;
 }
 
 static HRESULT WINAPI dwritetextlayout_SetMaxHeight(IDWriteTextLayout3 *iface, FLOAT maxHeight)
 {
     struct dwrite_textlayout *This = impl_from_IDWriteTextLayout3(iface);
+    BOOL changed;
 
     TRACE("(%p)->(%.2f)\n", This, maxHeight);
 
     if (maxHeight < 0.0f)
         return E_INVALIDARG;
 
+    changed = This->metrics.layoutHeight != maxHeight;
     This->metrics.layoutHeight = maxHeight;
+
+    /* if layout is not ready there's nothing to align */
+    if (changed && !(This->recompute & (RECOMPUTE_EFFECTIVE_RUNS | RECOMPUTE_DIRTY_LINES)))
+        layout_apply_par_alignment(This);
+
     return S_OK;
 }
 
@@ -3382,6 +3759,8 @@ static HRESULT WINAPI dwritetextlayout_DetermineMinWidth(IDWriteTextLayout3 *ifa
     if (FAILED(hr))
         return hr;
 
+    This->minwidth = 0.0f;
+
     /* Find widest word without emergency breaking between clusters, trailing whitespaces
        preceding breaking point do not contribute to word width. */
     for (start = 0; start < This->cluster_count;) {
@@ -3735,7 +4114,7 @@ static HRESULT WINAPI dwritetextformat_layout_SetTextAlignment(IDWriteTextFormat
         return hr;
 
     /* if layout is not ready there's nothing to align */
-    if (changed && !(This->recompute & RECOMPUTE_EFFECTIVE_RUNS))
+    if (changed && !(This->recompute & (RECOMPUTE_EFFECTIVE_RUNS | RECOMPUTE_DIRTY_LINES)))
         layout_apply_text_alignment(This);
 
     return S_OK;
@@ -3754,7 +4133,7 @@ static HRESULT WINAPI dwritetextformat_layout_SetParagraphAlignment(IDWriteTextF
         return hr;
 
     /* if layout is not ready there's nothing to align */
-    if (changed && !(This->recompute & RECOMPUTE_EFFECTIVE_RUNS))
+    if (changed && !(This->recompute & (RECOMPUTE_EFFECTIVE_RUNS | RECOMPUTE_DIRTY_LINES)))
         layout_apply_par_alignment(This);
 
     return S_OK;
@@ -4455,12 +4834,15 @@ static HRESULT init_textlayout(const struct textlayout_desc *desc, struct dwrite
     layout->ref = 1;
     layout->len = desc->length;
     layout->recompute = RECOMPUTE_EVERYTHING;
+    layout->dirty_start = layout->dirty_end = 0;
+    layout->relayout_pos = 0;
     layout->nominal_breakpoints = NULL;
     layout->actual_breakpoints = NULL;
     layout->cluster_count = 0;
     layout->clustermetrics = NULL;
     layout->clusters = NULL;
     layout->lines = NULL;
+    layout->line_states = NULL;
     layout->line_alloc = 0;
     layout->minwidth = 0.0f;
     list_init(&layout->eruns);
@@ -4916,6 +4916,163 @@ static void test_InvalidateLayout(void)
     IDWriteFactory_Release(factory);
 }
 
+enum layout_update_kind {
+    UPDATE_MAXWIDTH,
+    UPDATE_MAXHEIGHT,
+    UPDATE_WEIGHT,
+    UPDATE_FONTSIZE,
+    UPDATE_UNDERLINE
+};
+
+struct layout_update_test {
+    enum layout_update_kind kind;
+    DWRITE_TEXT_RANGE range;
+    FLOAT value;
+};
+
+static void apply_layout_update(IDWriteTextLayout *layout, const struct layout_update_test *test)
+{
+    HRESULT hr = E_FAIL;
+
+    switch (test->kind)
+    {
+    case UPDATE_MAXWIDTH:
+        hr = IDWriteTextLayout_SetMaxWidth(layout, test->value);
+        break;
+    case UPDATE_MAXHEIGHT:
+        hr = IDWriteTextLayout_SetMaxHeight(layout, test->value);
+        break;
+    case UPDATE_WEIGHT:
+        hr = IDWriteTextLayout_SetFontWeight(layout, (DWRITE_FONT_WEIGHT)test->value, test->range);
+        break;
+    case UPDATE_FONTSIZE:
+        hr = IDWriteTextLayout_SetFontSize(layout, test->value, test->range);
+        break;
+    case UPDATE_UNDERLINE:
+        hr = IDWriteTextLayout_SetUnderline(layout, test->value != 0.0f, test->range);
+        break;
+    }
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+}
+
+static void test_layout_update(void)
+{
+    static const WCHAR textW[] = {'T','h','e',' ','q','u','i','c','k',' ','b','r','o','w','n',' ','f','o','x',' ',
+        'j','u','m','p','s',' ','o','v','e','r',' ','t','h','e',' ','l','a','z','y',' ','d','o','g','.',' '};
+    static const struct layout_update_test tests[] = {
+        { UPDATE_MAXWIDTH,  { 0, 0 }, 250.0f },
+        { UPDATE_MAXHEIGHT, { 0, 0 }, 5000.0f },
+        { UPDATE_WEIGHT,    { 4000, 100 }, DWRITE_FONT_WEIGHT_BOLD },
+        { UPDATE_MAXWIDTH,  { 0, 0 }, 600.0f },
+        { UPDATE_FONTSIZE,  { 8000, 20 }, 24.0f },
+        { UPDATE_UNDERLINE, { 1000, 2000 }, 1.0f },
+        { UPDATE_MAXWIDTH,  { 0, 0 }, 249.5f },
+        { UPDATE_WEIGHT,    { 4050, 10 }, DWRITE_FONT_WEIGHT_NORMAL },
+        { UPDATE_FONTSIZE,  { 0, 5 }, 20.0f },
+        { UPDATE_UNDERLINE, { 1500, 100 }, 0.0f },
+        { UPDATE_MAXHEIGHT, { 0, 0 }, 50.0f },
+        { UPDATE_MAXWIDTH,  { 0, 0 }, 5000.0f },
+        { UPDATE_MAXWIDTH,  { 0, 0 }, 100.0f },
+    };
+    DWRITE_LINE_METRICS *lines, *lines2;
+    DWRITE_TEXT_METRICS metrics, metrics2;
+    IDWriteTextLayout *layout, *layout2;
+    IDWriteTextFormat *format;
+    IDWriteFactory *factory;
+    UINT32 len, count, count2, i, j;
+    WCHAR *str;
+    HRESULT hr;
+
+    factory = create_factory();
+
+    hr = IDWriteFactory_CreateTextFormat(factory, tahomaW, NULL, DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL,
+        DWRITE_FONT_STRETCH_NORMAL, 12.0f, enusW, &format);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    /* centered, so that changing max height moves the text */
+    hr = IDWriteTextFormat_SetParagraphAlignment(format, DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    /* large text with paragraphs, updated layout should match layout created from scratch */
+    len = 200 * sizeof(textW)/sizeof(WCHAR);
+    str = HeapAlloc(GetProcessHeap(), 0, len * sizeof(WCHAR));
+    for (i = 0; i < len; i++)
+        str[i] = i % 1000 == 999 ? '\n' : textW[i % (sizeof(textW)/sizeof(WCHAR))];
+
+    hr = IDWriteFactory_CreateTextLayout(factory, str, len, format, 400.0f, 100.0f, &layout);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    hr = IDWriteTextLayout_GetMetrics(layout, &metrics);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    for (i = 0; i < sizeof(tests)/sizeof(tests[0]); i++) {
+        apply_layout_update(layout, &tests[i]);
+
+        hr = IDWriteFactory_CreateTextLayout(factory, str, len, format, 400.0f, 100.0f, &layout2);
+        ok(hr == S_OK, "got 0x%08x\n", hr);
+        for (j = 0; j <= i; j++)
+            apply_layout_update(layout2, &tests[j]);
+
+        hr = IDWriteTextLayout_GetMetrics(layout, &metrics);
+        ok(hr == S_OK, "%u: got 0x%08x\n", i, hr);
+        hr = IDWriteTextLayout_GetMetrics(layout2, &metrics2);
+        ok(hr == S_OK, "%u: got 0x%08x\n", i, hr);
+
+        ok(metrics.left == metrics2.left, "%u: got left %f, expected %f\n", i, metrics.left, metrics2.left);
+        ok(metrics.top == metrics2.top, "%u: got top %f, expected %f\n", i, metrics.top, metrics2.top);
+        ok(metrics.width == metrics2.width, "%u: got width %f, expected %f\n", i, metrics.width, metrics2.width);
+        ok(metrics.widthIncludingTrailingWhitespace == metrics2.widthIncludingTrailingWhitespace,
+            "%u: got width %f, expected %f\n", i, metrics.widthIncludingTrailingWhitespace,
+            metrics2.widthIncludingTrailingWhitespace);
+        ok(metrics.height == metrics2.height, "%u: got height %f, expected %f\n", i, metrics.height, metrics2.height);
+        ok(metrics.layoutWidth == metrics2.layoutWidth, "%u: got layout width %f, expected %f\n", i,
+            metrics.layoutWidth, metrics2.layoutWidth);
+        ok(metrics.layoutHeight == metrics2.layoutHeight, "%u: got layout height %f, expected %f\n", i,
+            metrics.layoutHeight, metrics2.layoutHeight);
+        ok(metrics.lineCount == metrics2.lineCount, "%u: got line count %u, expected %u\n", i, metrics.lineCount,
+            metrics2.lineCount);
+
+        count = count2 = 0;
+        hr = IDWriteTextLayout_GetLineMetrics(layout, NULL, 0, &count);
+        ok(hr == E_NOT_SUFFICIENT_BUFFER, "%u: got 0x%08x\n", i, hr);
+        hr = IDWriteTextLayout_GetLineMetrics(layout2, NULL, 0, &count2);
+        ok(hr == E_NOT_SUFFICIENT_BUFFER, "%u: got 0x%08x\n", i, hr);
+        ok(count == count2, "%u: got %u, expected %u\n", i, count, count2);
+
+        lines = HeapAlloc(GetProcessHeap(), 0, count * sizeof(*lines));
+        lines2 = HeapAlloc(GetProcessHeap(), 0, count2 * sizeof(*lines2));
+        hr = IDWriteTextLayout_GetLineMetrics(layout, lines, count, &count);
+        ok(hr == S_OK, "%u: got 0x%08x\n", i, hr);
+        hr = IDWriteTextLayout_GetLineMetrics(layout2, lines2, count2, &count2);
+        ok(hr == S_OK, "%u: got 0x%08x\n", i, hr);
+
+        for (j = 0; j < min(count, count2); j++) {
+            ok(lines[j].length == lines2[j].length, "%u: line %u: got length %u, expected %u\n", i, j,
+                lines[j].length, lines2[j].length);
+            ok(lines[j].trailingWhitespaceLength == lines2[j].trailingWhitespaceLength,
+                "%u: line %u: got trailing length %u, expected %u\n", i, j, lines[j].trailingWhitespaceLength,
+                lines2[j].trailingWhitespaceLength);
+            ok(lines[j].newlineLength == lines2[j].newlineLength, "%u: line %u: got newline length %u, expected %u\n",
+                i, j, lines[j].newlineLength, lines2[j].newlineLength);
+            ok(lines[j].height == lines2[j].height, "%u: line %u: got height %f, expected %f\n", i, j,
+                lines[j].height, lines2[j].height);
+            ok(lines[j].baseline == lines2[j].baseline, "%u: line %u: got baseline %f, expected %f\n", i, j,
+                lines[j].baseline, lines2[j].baseline);
+            ok(lines[j].isTrimmed == lines2[j].isTrimmed, "%u: line %u: got trimmed %d, expected %d\n", i, j,
+                lines[j].isTrimmed, lines2[j].isTrimmed);
+        }
+
+        HeapFree(GetProcessHeap(), 0, lines);
+        HeapFree(GetProcessHeap(), 0, lines2);
+        IDWriteTextLayout_Release(layout2);
+    }
+
+    IDWriteTextLayout_Release(layout);
+    HeapFree(GetProcessHeap(), 0, str);
+    IDWriteTextFormat_Release(format);
+    IDWriteFactory_Release(factory);
+}
+
 START_TEST(layout)
 {
     IDWriteFactory *factory;
@@ -4964,6 +5121,7 @@ START_TEST(layout)
     test_SetOpticalAlignment();
     test_SetUnderline();
     test_InvalidateLayout();
+    test_layout_update();
 
     IDWriteFactory_Release(factory);
 }
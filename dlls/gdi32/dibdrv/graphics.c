@@ -29,8 +29,11 @@ WINE_DEFAULT_DEBUG_CHANNEL(dib);
 
 struct cached_glyph
 {
-    GLYPHMETRICS metrics;
-    BYTE         bits[1];
+    struct cached_glyph *next;      /* next evicted glyph of the font */
+    LONG                 last_use;  /* glyph_cache_clock when the glyph was last drawn */
+    LONG                 size;      /* allocation size */
+    GLYPHMETRICS         metrics;
+    BYTE                 bits[1];
 };
 
 enum glyph_type
@@ -43,10 +46,21 @@ enum glyph_type
 #define GLYPH_CACHE_PAGE_SIZE  0x100
 #define GLYPH_CACHE_PAGES      (0x10000 / GLYPH_CACHE_PAGE_SIZE)
 
+/* unused fonts are released once more than 5 of them are cached; once the
+ * glyphs of all cached fonts exceed this many bytes, the least recently
+ * drawn ones are evicted until a quarter of the space is free */
+#define FONT_CACHE_MAX_UNUSED  5
+#define GLYPH_CACHE_MAX_SIZE   (4 * 1024 * 1024)
+#define FONT_CACHE_HASH_SIZE   64
+
 struct cached_font
 {
-    struct list           entry;
+    struct list           entry;       /* entry in the most-recently used list */
+    struct list           hash_entry;  /* entry in the hash table bucket */
     LONG                  ref;
+    LONG                  renderers;   /* number of threads drawing glyphs of the font */
+    LONG                  glyph_size;  /* total size of the cached glyphs */
+    struct cached_glyph  *evicted;     /* evicted glyphs, freed once there are no renderers */
     DWORD                 hash;
     LOGFONTW              lf;
     XFORM                 xform;
@@ -55,6 +69,9 @@ struct cached_font
 };
 
 static struct list font_cache = LIST_INIT( font_cache );
+static struct list font_cache_hash_table[FONT_CACHE_HASH_SIZE];
+static LONG glyph_cache_size;   /* total size of the glyphs of all cached fonts */
+static LONG glyph_cache_clock;  /* incremented for every string drawn */
 
 static CRITICAL_SECTION font_cache_cs;
 static CRITICAL_SECTION_DEBUG critsect_debug =
@@ -549,10 +566,45 @@ static int font_cache_cmp( const struct cached_font *p1, const struct cached_fon
     return ret;
 }
 
+/* the font cache lock must be held */
+static void free_evicted_glyphs( struct cached_font *font )
+{
+    struct cached_glyph *glyph;
+
+    if (font->renderers) return;
+    while ((glyph = font->evicted))
+    {
+        font->evicted = glyph->next;
+        HeapFree( GetProcessHeap(), 0, glyph );
+    }
+}
+
+static void free_cached_font( struct cached_font *font )
+{
+    UINT i, j, k;
+
+    for (i = 0; i < GLYPH_NBTYPES; i++)
+    {
+        for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+        {
+            if (!font->glyphs[i][j]) continue;
+            for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
+                HeapFree( GetProcessHeap(), 0, font->glyphs[i][j][k] );
+            HeapFree( GetProcessHeap(), 0, font->glyphs[i][j] );
+        }
+    }
+    free_evicted_glyphs( font );
+    InterlockedExchangeAdd( &glyph_cache_size, -font->glyph_size );
+    list_remove( &font->entry );
+    list_remove( &font->hash_entry );
+    HeapFree( GetProcessHeap(), 0, font );
+}
+
 static struct cached_font *add_cached_font( HDC hdc, HFONT hfont, UINT aa_flags )
 {
-    struct cached_font font, *ptr, *last_unused = NULL;
-    UINT i = 0, j, k;
+    struct cached_font font, *ptr, *next;
+    struct list *bucket;
+    UINT i, unused = 0;
 
     GetObjectW( hfont, sizeof(font.lf), &font.lf );
     GetTransform( hdc, 0x204, &font.xform );
@@ -568,7 +620,13 @@ static struct cached_font *add_cached_font( HDC hdc, HFONT hfont, UINT aa_flags
     font.hash = font_cache_hash( &font );
 
     EnterCriticalSection( &font_cache_cs );
-    LIST_FOR_EACH_ENTRY( ptr, &font_cache, struct cached_font, entry )
+    if (!font_cache_hash_table[0].next)  /* first use */
+    {
+        for (i = 0; i < FONT_CACHE_HASH_SIZE; i++) list_init( &font_cache_hash_table[i] );
+    }
+    bucket = &font_cache_hash_table[font.hash % FONT_CACHE_HASH_SIZE];
+
+    LIST_FOR_EACH_ENTRY( ptr, bucket, struct cached_font, hash_entry )
     {
         if (!font_cache_cmp( &font, ptr ))
         {
@@ -576,29 +634,19 @@ static struct cached_font *add_cached_font( HDC hdc, HFONT hfont, UINT aa_flags
             list_remove( &ptr->entry );
             goto done;
         }
-        if (!ptr->ref)
-        {
-            i++;
-            last_unused = ptr;
-        }
     }
 
-    if (i > 5)  /* keep at least 5 of the most-recently used fonts around */
+    /* references are only acquired under the lock, so unused fonts can be freed safely */
+    LIST_FOR_EACH_ENTRY_SAFE( ptr, next, &font_cache, struct cached_font, entry )
     {
-        ptr = last_unused;
-        for (i = 0; i < GLYPH_NBTYPES; i++)
+        if (!ptr->ref && ++unused > FONT_CACHE_MAX_UNUSED)
         {
-            for (j = 0; j < GLYPH_CACHE_PAGES; j++)
-            {
-                if (!ptr->glyphs[i][j]) continue;
-                for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
-                    HeapFree( GetProcessHeap(), 0, ptr->glyphs[i][j][k] );
-                HeapFree( GetProcessHeap(), 0, ptr->glyphs[i][j] );
-            }
+            TRACE( "freeing %p, %u bytes of glyphs\n", ptr, ptr->glyph_size );
+            free_cached_font( ptr );
         }
-        list_remove( &ptr->entry );
     }
-    else if (!(ptr = HeapAlloc( GetProcessHeap(), 0, sizeof(*ptr) )))
+
+    if (!(ptr = HeapAlloc( GetProcessHeap(), 0, sizeof(*ptr) )))
     {
         LeaveCriticalSection( &font_cache_cs );
         return NULL;
@@ -606,7 +654,11 @@ static struct cached_font *add_cached_font( HDC hdc, HFONT hfont, UINT aa_flags
 
     *ptr = font;
     ptr->ref = 1;
+    ptr->renderers = 0;
+    ptr->glyph_size = 0;
+    ptr->evicted = NULL;
     memset( ptr->glyphs, 0, sizeof(ptr->glyphs) );
+    list_add_head( bucket, &ptr->hash_entry );
 done:
     list_add_head( &font_cache, &ptr->entry );
     LeaveCriticalSection( &font_cache_cs );
@@ -619,6 +671,77 @@ void release_cached_font( struct cached_font *font )
     if (font) InterlockedDecrement( &font->ref );
 }
 
+struct glyph_slot
+{
+    struct cached_font   *font;
+    struct cached_glyph **slot;
+    struct cached_glyph  *glyph;
+    LONG                  last_use;  /* copied, other threads may update it */
+};
+
+static int glyph_slot_cmp( const void *p1, const void *p2 )
+{
+    const struct glyph_slot *s1 = p1, *s2 = p2;
+
+    return s1->last_use - s2->last_use;
+}
+
+/* Evicts the least recently drawn glyphs of all cached fonts. Other threads
+ * may still be drawing them, since glyphs are looked up without holding the
+ * lock, so they are only freed once the font has no renderers.
+ * The font cache lock must be held. */
+static void shrink_glyph_cache(void)
+{
+    struct glyph_slot *slots;
+    struct cached_font *font;
+    struct cached_glyph *glyph;
+    UINT i, j, k, count = 0;
+
+    LIST_FOR_EACH_ENTRY( font, &font_cache, struct cached_font, entry )
+        for (i = 0; i < GLYPH_NBTYPES; i++)
+            for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+                if (font->glyphs[i][j])
+                    for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
+                        if (font->glyphs[i][j][k]) count++;
+
+    if (!count || !(slots = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*slots) ))) return;
+
+    count = 0;
+    LIST_FOR_EACH_ENTRY( font, &font_cache, struct cached_font, entry )
+        for (i = 0; i < GLYPH_NBTYPES; i++)
+            for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+                if (font->glyphs[i][j])
+                    for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
+                    {
+                        if (!(glyph = font->glyphs[i][j][k])) continue;
+                        slots[count].font  = font;
+                        slots[count].slot  = &font->glyphs[i][j][k];
+                        slots[count].glyph = glyph;
+                        slots[count].last_use = glyph->last_use;
+                        count++;
+                    }
+
+    qsort( slots, count, sizeof(*slots), glyph_slot_cmp );
+
+    for (i = 0; i < count && glyph_cache_size > GLYPH_CACHE_MAX_SIZE / 4 * 3; i++)
+    {
+        glyph = slots[i].glyph;
+        font = slots[i].font;
+        /* clearing the slot before checking for renderers means that new
+         * renderers can't find the glyph anymore */
+        InterlockedExchangePointer( (void **)slots[i].slot, NULL );
+        InterlockedExchangeAdd( &font->glyph_size, -glyph->size );
+        InterlockedExchangeAdd( &glyph_cache_size, -glyph->size );
+        glyph->next = font->evicted;
+        font->evicted = glyph;
+    }
+    TRACE( "evicted %u glyphs, %u bytes left\n", i, glyph_cache_size );
+
+    LIST_FOR_EACH_ENTRY( font, &font_cache, struct cached_font, entry )
+        free_evicted_glyphs( font );
+    HeapFree( GetProcessHeap(), 0, slots );
+}
+
 static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT index, UINT flags,
                                               struct cached_glyph *glyph )
 {
@@ -641,9 +764,20 @@ static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT ind
             HeapFree( GetProcessHeap(), 0, ptr );
     }
     ret = InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page][entry], glyph, NULL );
-    if (!ret) ret = glyph;
-    else HeapFree( GetProcessHeap(), 0, glyph );
-    return ret;
+    if (ret)
+    {
+        HeapFree( GetProcessHeap(), 0, glyph );
+        return ret;
+    }
+
+    InterlockedExchangeAdd( &font->glyph_size, glyph->size );
+    if (InterlockedExchangeAdd( &glyph_cache_size, glyph->size ) + glyph->size > GLYPH_CACHE_MAX_SIZE)
+    {
+        EnterCriticalSection( &font_cache_cs );
+        if (glyph_cache_size > GLYPH_CACHE_MAX_SIZE) shrink_glyph_cache();
+        LeaveCriticalSection( &font_cache_cs );
+    }
+    return glyph;
 }
 
 static struct cached_glyph *get_cached_glyph( struct cached_font *font, UINT index, UINT flags )
@@ -800,6 +934,8 @@ static struct cached_glyph *cache_glyph_bitmap( HDC hdc, struct cached_font *fon
 
 done:
     glyph->metrics = metrics;
+    glyph->size = FIELD_OFFSET( struct cached_glyph, bits[size] );
+    glyph->last_use = glyph_cache_clock;
     return add_cached_glyph( font, index, flags, glyph );
 }
 
@@ -812,6 +948,7 @@ static void render_string( HDC hdc, dib_info *dib, struct cached_font *font, INT
     dib_info glyph_dib;
     DWORD text_color;
     struct intensity_range ranges[17];
+    LONG clock = InterlockedIncrement( &glyph_cache_clock );
 
     glyph_dib.bit_count    = get_glyph_depth( font->aa_flags );
     glyph_dib.rect.left    = 0;
@@ -824,11 +961,16 @@ static void render_string( HDC hdc, dib_info *dib, struct cached_font *font, INT
     if (glyph_dib.bit_count == 8)
         get_aa_ranges( dib->funcs->pixel_to_colorref( dib, text_color ), ranges );
 
+    /* keeps glyphs evicted by other threads from being freed while we draw them */
+    InterlockedIncrement( &font->renderers );
+
     for (i = 0; i < count; i++)
     {
         if (!(glyph = get_cached_glyph( font, str[i], flags )) &&
             !(glyph = cache_glyph_bitmap( hdc, font, str[i], flags ))) continue;
 
+        glyph->last_use = clock;
+
         glyph_dib.width       = glyph->metrics.gmBlackBoxX;
         glyph_dib.height      = glyph->metrics.gmBlackBoxY;
         glyph_dib.rect.right  = glyph->metrics.gmBlackBoxX;
@@ -854,6 +996,13 @@ static void render_string( HDC hdc, dib_info *dib, struct cached_font *font, INT
             y += glyph->metrics.gmCellIncY;
         }
     }
+
+    if (!InterlockedDecrement( &font->renderers ) && font->evicted)
+    {
+        EnterCriticalSection( &font_cache_cs );
+        free_evicted_glyphs( font );
+        LeaveCriticalSection( &font_cache_cs );
+    }
 }
 
 BOOL render_aa_text_bitmapinfo( HDC hdc, BITMAPINFO *info, struct gdi_image_bits *bits,
@@ -18,6 +18,9 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
  */
 
+#include "config.h"
+#include "wine/port.h"
+
 #include <assert.h>
 
 #include "gdi_private.h"
@@ -25,8 +28,24 @@
 
 #include "wine/debug.h"
 
+#ifdef __WINE_TARGET
+#define DIBDRV_SSE2
+#define SSE2_FUNC __WINE_TARGET("sse2")
+#include <emmintrin.h>
+#endif
+
 WINE_DEFAULT_DEBUG_CHANNEL(dib);
 
+#ifdef DIBDRV_SSE2
+static BOOL use_sse2(void)
+{
+    static int supported = -1;
+
+    if (supported == -1) supported = IsProcessorFeaturePresent( PF_XMMI64_INSTRUCTIONS_AVAILABLE );
+    return supported;
+}
+#endif
+
 /* Bayer matrices for dithering */
 
 static const BYTE bayer_4x4[4][4] =
@@ -1801,6 +1820,80 @@ static inline BOOL bit_fields_match(const dib_info *d1, const dib_info *d2)
            d1->blue_mask  == d2->blue_mask;
 }
 
+#ifdef DIBDRV_SSE2
+/* Move 8-bit channels between the given shifts and the 8888 positions, like
+ * get_field() and put_field() do for 8-bit fields. The alpha channel is
+ * zeroed. */
+static inline __m128i SSE2_FUNC channels_to_8888_sse2( __m128i val, __m128i r_shift,
+                                                       __m128i g_shift, __m128i b_shift )
+{
+    const __m128i mask = _mm_set1_epi32( 0xff );
+    __m128i r = _mm_and_si128( _mm_srl_epi32( val, r_shift ), mask );
+    __m128i g = _mm_and_si128( _mm_srl_epi32( val, g_shift ), mask );
+    __m128i b = _mm_and_si128( _mm_srl_epi32( val, b_shift ), mask );
+
+    return _mm_or_si128( _mm_or_si128( _mm_slli_epi32( r, 16 ), _mm_slli_epi32( g, 8 ) ), b );
+}
+
+static inline __m128i SSE2_FUNC channels_from_8888_sse2( __m128i val, __m128i r_shift,
+                                                         __m128i g_shift, __m128i b_shift )
+{
+    const __m128i mask = _mm_set1_epi32( 0xff );
+    __m128i r = _mm_and_si128( _mm_srli_epi32( val, 16 ), mask );
+    __m128i g = _mm_and_si128( _mm_srli_epi32( val, 8 ), mask );
+    __m128i b = _mm_and_si128( val, mask );
+
+    return _mm_or_si128( _mm_or_si128( _mm_sll_epi32( r, r_shift ), _mm_sll_epi32( g, g_shift ) ),
+                         _mm_sll_epi32( b, b_shift ) );
+}
+
+/* Converts between 32-bpp formats with 8-bit channels. dst and src may be the
+ * same row. */
+static int SSE2_FUNC convert_32_row_sse2( DWORD *dst, const DWORD *src, int width,
+                                          const dib_info *dst_dib, int src_r, int src_g, int src_b )
+{
+    const __m128i src_r_shift = _mm_cvtsi32_si128( src_r );
+    const __m128i src_g_shift = _mm_cvtsi32_si128( src_g );
+    const __m128i src_b_shift = _mm_cvtsi32_si128( src_b );
+    const __m128i dst_r_shift = _mm_cvtsi32_si128( dst_dib->red_shift );
+    const __m128i dst_g_shift = _mm_cvtsi32_si128( dst_dib->green_shift );
+    const __m128i dst_b_shift = _mm_cvtsi32_si128( dst_dib->blue_shift );
+    __m128i val;
+    int x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        val = _mm_loadu_si128( (const __m128i *)(src + x) );
+        val = channels_to_8888_sse2( val, src_r_shift, src_g_shift, src_b_shift );
+        val = channels_from_8888_sse2( val, dst_r_shift, dst_g_shift, dst_b_shift );
+        _mm_storeu_si128( (__m128i *)(dst + x), val );
+    }
+    return x;
+}
+
+static int SSE2_FUNC convert_555_to_8888_row_sse2( DWORD *dst, const WORD *src, int width )
+{
+    const __m128i mask = _mm_set1_epi16( 0x1f );
+    __m128i val, r, g, b;
+    int x;
+
+    for (x = 0; x + 8 <= width; x += 8)
+    {
+        val = _mm_loadu_si128( (const __m128i *)(src + x) );
+        r = _mm_and_si128( _mm_srli_epi16( val, 10 ), mask );
+        g = _mm_and_si128( _mm_srli_epi16( val, 5 ), mask );
+        b = _mm_and_si128( val, mask );
+        r = _mm_or_si128( _mm_slli_epi16( r, 3 ), _mm_srli_epi16( r, 2 ) );
+        g = _mm_or_si128( _mm_slli_epi16( g, 3 ), _mm_srli_epi16( g, 2 ) );
+        b = _mm_or_si128( _mm_slli_epi16( b, 3 ), _mm_srli_epi16( b, 2 ) );
+        b = _mm_or_si128( _mm_slli_epi16( g, 8 ), b );
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_unpacklo_epi16( b, r ) );
+        _mm_storeu_si128( (__m128i *)(dst + x + 4), _mm_unpackhi_epi16( b, r ) );
+    }
+    return x;
+}
+#endif
+
 static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_rect, BOOL dither)
 {
     DWORD *dst_start = get_pixel_ptr_32(dst, 0, 0), *dst_pixel, src_val;
@@ -1898,7 +1991,17 @@ static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_
             {
                 dst_pixel = dst_start;
                 src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
+                x = src_rect->left;
+#ifdef DIBDRV_SSE2
+                if (use_sse2())
+                {
+                    int done = convert_555_to_8888_row_sse2( dst_pixel, src_pixel, src_rect->right - x );
+                    dst_pixel += done;
+                    src_pixel += done;
+                    x += done;
+                }
+#endif
+                for(; x < src_rect->right; x++)
                 {
                     src_val = *src_pixel++;
                     *dst_pixel++ = ((src_val << 9) & 0xf80000) | ((src_val << 4) & 0x070000) |
@@ -2057,7 +2160,17 @@ static void convert_to_32(dib_info *dst, const dib_info *src, const RECT *src_re
             {
                 dst_pixel = dst_start;
                 src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
+                x = src_rect->left;
+#ifdef DIBDRV_SSE2
+                if (use_sse2() && dst->red_len == 8 && dst->green_len == 8 && dst->blue_len == 8)
+                {
+                    int done = convert_32_row_sse2( dst_pixel, src_pixel, src_rect->right - x, dst, 16, 8, 0 );
+                    dst_pixel += done;
+                    src_pixel += done;
+                    x += done;
+                }
+#endif
+                for(; x < src_rect->right; x++)
                 {
                     src_val = *src_pixel++;
                     *dst_pixel++ = put_field(src_val >> 16, dst->red_shift,   dst->red_len)   |
@@ -2091,7 +2204,18 @@ static void convert_to_32(dib_info *dst, const dib_info *src, const RECT *src_re
             {
                 dst_pixel = dst_start;
                 src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
+                x = src_rect->left;
+#ifdef DIBDRV_SSE2
+                if (use_sse2())
+                {
+                    int done = convert_32_row_sse2( dst_pixel, src_pixel, src_rect->right - x, dst,
+                                                    src->red_shift, src->green_shift, src->blue_shift );
+                    dst_pixel += done;
+                    src_pixel += done;
+                    x += done;
+                }
+#endif
+                for(; x < src_rect->right; x++)
                 {
                     src_val = *src_pixel++;
                     *dst_pixel++ = (((src_val >> src->red_shift)   & 0xff) << dst->red_shift)   |
@@ -2159,7 +2283,18 @@ static void convert_to_32(dib_info *dst, const dib_info *src, const RECT *src_re
             {
                 dst_pixel = dst_start;
                 src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
+                x = src_rect->left;
+#ifdef DIBDRV_SSE2
+                if (use_sse2() && dst->red_len == 8 && dst->green_len == 8 && dst->blue_len == 8)
+                {
+                    int done = convert_555_to_8888_row_sse2( dst_pixel, src_pixel, src_rect->right - x );
+                    convert_32_row_sse2( dst_pixel, dst_pixel, done, dst, 16, 8, 0 );
+                    dst_pixel += done;
+                    src_pixel += done;
+                    x += done;
+                }
+#endif
+                for(; x < src_rect->right; x++)
                 {
                     src_val = *src_pixel++;
                     *dst_pixel++ = put_field(((src_val >> 7) & 0xf8) | ((src_val >> 12) & 0x07), dst->red_shift,   dst->red_len) |
@@ -4182,32 +4317,162 @@ static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BL
             blend_color( dst_r, src >> 16, blend.SourceConstantAlpha ) << 16);
 }
 
+#ifdef DIBDRV_SSE2
+/* The SSE2 versions produce the same results as the functions above.
+ * (x + 127) / 255 is computed as (y + (y >> 8)) >> 8 with y = x + 128,
+ * which is exact for x <= 255 * 255. */
+static inline __m128i SSE2_FUNC div255_sse2( __m128i x )
+{
+    x = _mm_add_epi16( x, _mm_set1_epi16( 128 ) );
+    return _mm_srli_epi16( _mm_add_epi16( x, _mm_srli_epi16( x, 8 ) ), 8 );
+}
+
+/* Channels can exceed 255 with bad premultiplied data, in which case
+ * blend_argb() ORs the carry into the next channel, so do the same here. */
+static inline __m128i SSE2_FUNC pack_argb_sse2( __m128i lo, __m128i hi )
+{
+    const __m128i mask = _mm_set1_epi16( 0xff );
+
+    lo = _mm_and_si128( _mm_or_si128( lo, _mm_slli_epi64( lo, 8 ) ), mask );
+    hi = _mm_and_si128( _mm_or_si128( hi, _mm_slli_epi64( hi, 8 ) ), mask );
+    return _mm_packus_epi16( lo, hi );
+}
+
+/* Blends four pixels like blend_argb() and blend_argb_alpha(). */
+static inline __m128i SSE2_FUNC blend_argb_sse2( __m128i s, __m128i d, DWORD alpha )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16( 255 );
+    __m128i src_lo, src_hi, dst_lo, dst_hi, a;
+
+    src_lo = _mm_unpacklo_epi8( s, zero );
+    src_hi = _mm_unpackhi_epi8( s, zero );
+    dst_lo = _mm_unpacklo_epi8( d, zero );
+    dst_hi = _mm_unpackhi_epi8( d, zero );
+
+    if (alpha != 255)
+    {
+        const __m128i const_alpha = _mm_set1_epi16( alpha );
+
+        src_lo = div255_sse2( _mm_mullo_epi16( src_lo, const_alpha ) );
+        src_hi = div255_sse2( _mm_mullo_epi16( src_hi, const_alpha ) );
+    }
+
+    a = _mm_sub_epi16( max, _mm_shufflehi_epi16( _mm_shufflelo_epi16( src_lo, 0xff ), 0xff ) );
+    dst_lo = _mm_add_epi16( src_lo, div255_sse2( _mm_mullo_epi16( dst_lo, a ) ) );
+    a = _mm_sub_epi16( max, _mm_shufflehi_epi16( _mm_shufflelo_epi16( src_hi, 0xff ), 0xff ) );
+    dst_hi = _mm_add_epi16( src_hi, div255_sse2( _mm_mullo_epi16( dst_hi, a ) ) );
+
+    return pack_argb_sse2( dst_lo, dst_hi );
+}
+
+/* Blends four pixels like blend_color() on each channel. */
+static inline __m128i SSE2_FUNC blend_constant_alpha_sse2( __m128i s, __m128i d, DWORD alpha )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i src_alpha = _mm_set1_epi16( alpha );
+    const __m128i dst_alpha = _mm_set1_epi16( 255 - alpha );
+    __m128i lo, hi;
+
+    lo = _mm_add_epi16( _mm_mullo_epi16( _mm_unpacklo_epi8( s, zero ), src_alpha ),
+                        _mm_mullo_epi16( _mm_unpacklo_epi8( d, zero ), dst_alpha ) );
+    hi = _mm_add_epi16( _mm_mullo_epi16( _mm_unpackhi_epi8( s, zero ), src_alpha ),
+                        _mm_mullo_epi16( _mm_unpackhi_epi8( d, zero ), dst_alpha ) );
+    return _mm_packus_epi16( div255_sse2( lo ), div255_sse2( hi ) );
+}
+
+static int SSE2_FUNC blend_argb_row_sse2( DWORD *dst, const DWORD *src, int width, DWORD alpha )
+{
+    __m128i s, d;
+    int x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        _mm_storeu_si128( (__m128i *)(dst + x), blend_argb_sse2( s, d, alpha ) );
+    }
+    return x;
+}
+
+static int SSE2_FUNC blend_constant_alpha_row_sse2( DWORD *dst, const DWORD *src, int width,
+                                                    DWORD alpha, DWORD src_or )
+{
+    const __m128i or_mask = _mm_set1_epi32( src_or );
+    __m128i s, d;
+    int x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        s = _mm_or_si128( _mm_loadu_si128( (const __m128i *)(src + x) ), or_mask );
+        d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        _mm_storeu_si128( (__m128i *)(dst + x), blend_constant_alpha_sse2( s, d, alpha ) );
+    }
+    return x;
+}
+
+/* Same as blend_rgb() for destinations with 8-bit channels. The destination
+ * is blended in 8888 layout; like in blend_rect_32(), carries out of the red
+ * channel are dropped. */
+static int SSE2_FUNC blend_rgb_row_sse2( DWORD *dst, const DWORD *src, int width,
+                                         const dib_info *dib, BLENDFUNCTION blend )
+{
+    const __m128i r_shift = _mm_cvtsi32_si128( dib->red_shift );
+    const __m128i g_shift = _mm_cvtsi32_si128( dib->green_shift );
+    const __m128i b_shift = _mm_cvtsi32_si128( dib->blue_shift );
+    __m128i s, d;
+    int x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        d = channels_to_8888_sse2( _mm_loadu_si128( (const __m128i *)(dst + x) ), r_shift, g_shift, b_shift );
+        if (blend.AlphaFormat & AC_SRC_ALPHA)
+            d = blend_argb_sse2( s, d, blend.SourceConstantAlpha );
+        else
+            d = blend_constant_alpha_sse2( s, d, blend.SourceConstantAlpha );
+        _mm_storeu_si128( (__m128i *)(dst + x), channels_from_8888_sse2( d, r_shift, g_shift, b_shift ) );
+    }
+    return x;
+}
+#endif
+
 static void blend_rect_8888(const dib_info *dst, const RECT *rc,
                             const dib_info *src, const POINT *origin, BLENDFUNCTION blend)
 {
     DWORD *src_ptr = get_pixel_ptr_32( src, origin->x, origin->y );
     DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
-    int x, y;
+    int x, y, width = rc->right - rc->left;
 
-    if (blend.AlphaFormat & AC_SRC_ALPHA)
+    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
     {
-	if (blend.SourceConstantAlpha == 255)
-	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
-		    dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
+        x = 0;
+#ifdef DIBDRV_SSE2
+        if (use_sse2())
+        {
+            if (blend.AlphaFormat & AC_SRC_ALPHA)
+                x = blend_argb_row_sse2( dst_ptr, src_ptr, width, blend.SourceConstantAlpha );
+            else
+                x = blend_constant_alpha_row_sse2( dst_ptr, src_ptr, width, blend.SourceConstantAlpha,
+                                                   src->compression == BI_RGB ? 0 : 0xff000000 );
+        }
+#endif
+        if (blend.AlphaFormat & AC_SRC_ALPHA)
+        {
+            if (blend.SourceConstantAlpha == 255)
+                for (; x < width; x++)
+                    dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
+            else
+                for (; x < width; x++)
+                    dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+        }
+        else if (src->compression == BI_RGB)
+            for (; x < width; x++)
+                dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
         else
-	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
-		    dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
-    }
-    else if (src->compression == BI_RGB)
-	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-	    for (x = 0; x < rc->right - rc->left; x++)
-		dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
-    else
-	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-	    for (x = 0; x < rc->right - rc->left; x++)
-		dst_ptr[x] = blend_argb_no_src_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+            for (; x < width; x++)
+                dst_ptr[x] = blend_argb_no_src_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+    }
 }
 
 static void blend_rect_32(const dib_info *dst, const RECT *rc,
@@ -4221,7 +4486,12 @@ static void blend_rect_32(const dib_info *dst, const RECT *rc,
     {
         for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
         {
-            for (x = 0; x < rc->right - rc->left; x++)
+            x = 0;
+#ifdef DIBDRV_SSE2
+            if (use_sse2())
+                x = blend_rgb_row_sse2( dst_ptr, src_ptr, rc->right - rc->left, dst, blend );
+#endif
+            for (; x < rc->right - rc->left; x++)
             {
                 DWORD val = blend_rgb( dst_ptr[x] >> dst->red_shift,
                                        dst_ptr[x] >> dst->green_shift,
@@ -562,6 +562,44 @@ static const WCHAR face_internal_leading_value[] = {'I','n','t','e','r','n','a',
 static const WCHAR face_font_sig_value[] = {'F','o','n','t',' ','S','i','g','n','a','t','u','r','e',0};
 static const WCHAR face_file_name_value[] = {'F','i','l','e',' ','N','a','m','e','\0'};
 static const WCHAR face_full_name_value[] = {'F','u','l','l',' ','N','a','m','e','\0'};
+static const WCHAR font_catalog_value[] = {'C','a','t','a','l','o','g',0};
+
+/* The font catalog is a packed copy of the registry font cache, stored as a
+ * single binary value of the cache key.  It starts with FONT_CATALOG_VERSION
+ * and is followed by a sequence of records, each starting with a DWORD type:
+ *
+ * FONT_CATALOG_FAMILY: family name, English name (empty if none)
+ * FONT_CATALOG_FACE:   style name, file name, full name (empty if none),
+ *                      struct font_catalog_face; belongs to the last family
+ *
+ * Strings are null-terminated WCHAR arrays.
+ */
+#define FONT_CATALOG_VERSION 1
+#define FONT_CATALOG_FAMILY  1
+#define FONT_CATALOG_FACE    2
+
+struct font_catalog_face
+{
+    DWORD         index;
+    DWORD         ntm_flags;
+    DWORD         version;
+    DWORD         flags;
+    FONTSIGNATURE fs;
+    DWORD         scalable;
+    DWORD         height;
+    DWORD         width;
+    DWORD         size;
+    DWORD         x_ppem;
+    DWORD         y_ppem;
+    DWORD         internal_leading;
+};
+
+struct font_catalog
+{
+    BYTE  *data;
+    DWORD  size;
+    DWORD  alloc;
+};
 
 
 struct font_mapping
@@ -1608,7 +1646,97 @@ static inline LONG reg_save_dword(HKEY hkey, const WCHAR *value, DWORD data)
     return RegSetValueExW(hkey, value, 0, REG_DWORD, (BYTE*)&data, sizeof(DWORD));
 }
 
-static void load_face(HKEY hkey_face, WCHAR *face_name, Family *family, void *buffer, DWORD buffer_size)
+static void catalog_append( struct font_catalog *catalog, const void *data, DWORD size )
+{
+    if (!catalog || !catalog->data) return;
+
+    if (catalog->alloc - catalog->size < size)
+    {
+        DWORD new_alloc = max( catalog->alloc * 2, catalog->size + size );
+        BYTE *new_data = HeapReAlloc( GetProcessHeap(), 0, catalog->data, new_alloc );
+
+        if (!new_data)
+        {
+            HeapFree( GetProcessHeap(), 0, catalog->data );
+            catalog->data = NULL;
+            return;
+        }
+        catalog->data = new_data;
+        catalog->alloc = new_alloc;
+    }
+    memcpy( catalog->data + catalog->size, data, size );
+    catalog->size += size;
+}
+
+static void catalog_append_dword( struct font_catalog *catalog, DWORD data )
+{
+    catalog_append( catalog, &data, sizeof(data) );
+}
+
+static void catalog_append_string( struct font_catalog *catalog, const WCHAR *str )
+{
+    static const WCHAR emptyW[] = {0};
+
+    if (!str) str = emptyW;
+    catalog_append( catalog, str, (strlenW( str ) + 1) * sizeof(WCHAR) );
+}
+
+static Face *create_cached_face( Family *family, const WCHAR *style_name, const WCHAR *file,
+                                 const WCHAR *full_name, const struct font_catalog_face *info )
+{
+    Face *face = HeapAlloc( GetProcessHeap(), 0, sizeof(*face) );
+
+    face->cached_enum_data = NULL;
+    face->family = NULL;
+    face->dev = 0;
+    face->ino = 0;
+    face->font_data_ptr = NULL;
+    face->font_data_size = 0;
+
+    face->refcount = 1;
+    face->file = strdupW( file );
+    face->StyleName = strdupW( style_name );
+    face->FullName = full_name ? strdupW( full_name ) : NULL;
+
+    face->face_index = info->index;
+    face->ntmFlags = info->ntm_flags;
+    face->font_version = info->version;
+    face->flags = info->flags;
+    face->fs = info->fs;
+
+    if (info->scalable)
+    {
+        face->scalable = TRUE;
+        memset(&face->size, 0, sizeof(face->size));
+    }
+    else
+    {
+        face->scalable = FALSE;
+        face->size.height = info->height;
+        face->size.width = info->width;
+        face->size.size = info->size;
+        face->size.x_ppem = info->x_ppem;
+        face->size.y_ppem = info->y_ppem;
+        face->size.internal_leading = info->internal_leading;
+
+        TRACE("Adding bitmap size h %d w %d size %ld x_ppem %ld y_ppem %ld\n",
+              face->size.height, face->size.width, face->size.size >> 6,
+              face->size.x_ppem >> 6, face->size.y_ppem >> 6);
+    }
+
+    TRACE("fsCsb = %08x %08x/%08x %08x %08x %08x\n",
+          face->fs.fsCsb[0], face->fs.fsCsb[1],
+          face->fs.fsUsb[0], face->fs.fsUsb[1],
+          face->fs.fsUsb[2], face->fs.fsUsb[3]);
+
+    if (insert_face_in_family_list(face, family))
+        TRACE("Added font %s %s\n", debugstr_w(family->FamilyName), debugstr_w(face->StyleName));
+
+    return face;
+}
+
+static void load_face(HKEY hkey_face, WCHAR *face_name, Family *family, void *buffer, DWORD buffer_size,
+                      struct font_catalog *catalog)
 {
     DWORD needed, strike_index = 0;
     HKEY hkey_strike;
@@ -1618,57 +1746,43 @@ static void load_face(HKEY hkey_face, WCHAR *face_name, Family *family, void *bu
     needed = buffer_size;
     if (RegQueryValueExW(hkey_face, face_file_name_value, NULL, NULL, buffer, &needed) == ERROR_SUCCESS)
     {
-        Face *face;
-        face = HeapAlloc(GetProcessHeap(), 0, sizeof(*face));
-        face->cached_enum_data = NULL;
-        face->family = NULL;
-
-        face->refcount = 1;
-        face->file = strdupW( buffer );
-        face->StyleName = strdupW(face_name);
+        struct font_catalog_face info;
+        WCHAR *file = strdupW( buffer ), *full_name = NULL;
 
         needed = buffer_size;
         if(RegQueryValueExW(hkey_face, face_full_name_value, NULL, NULL, buffer, &needed) == ERROR_SUCCESS)
-            face->FullName = strdupW( buffer );
-        else
-            face->FullName = NULL;
+            full_name = strdupW( buffer );
 
-        reg_load_ftlong(hkey_face, face_index_value, &face->face_index);
-        reg_load_dword(hkey_face, face_ntmflags_value, &face->ntmFlags);
-        reg_load_ftlong(hkey_face, face_version_value, &face->font_version);
-        reg_load_dword(hkey_face, face_flags_value, &face->flags);
+        memset(&info, 0, sizeof(info));
+        reg_load_dword(hkey_face, face_index_value, &info.index);
+        reg_load_dword(hkey_face, face_ntmflags_value, &info.ntm_flags);
+        reg_load_dword(hkey_face, face_version_value, &info.version);
+        reg_load_dword(hkey_face, face_flags_value, &info.flags);
 
-        needed = sizeof(face->fs);
-        RegQueryValueExW(hkey_face, face_font_sig_value, NULL, NULL, (BYTE*)&face->fs, &needed);
+        needed = sizeof(info.fs);
+        RegQueryValueExW(hkey_face, face_font_sig_value, NULL, NULL, (BYTE*)&info.fs, &needed);
 
-        if(reg_load_ftshort(hkey_face, face_height_value, &face->size.height) != ERROR_SUCCESS)
-        {
-            face->scalable = TRUE;
-            memset(&face->size, 0, sizeof(face->size));
-        }
+        if(reg_load_dword(hkey_face, face_height_value, &info.height) != ERROR_SUCCESS)
+            info.scalable = TRUE;
         else
         {
-            face->scalable = FALSE;
-            reg_load_ftshort(hkey_face, face_width_value, &face->size.width);
-            reg_load_ftlong(hkey_face, face_size_value, &face->size.size);
-            reg_load_ftlong(hkey_face, face_x_ppem_value, &face->size.x_ppem);
-            reg_load_ftlong(hkey_face, face_y_ppem_value, &face->size.y_ppem);
-            reg_load_ftshort(hkey_face, face_internal_leading_value, &face->size.internal_leading);
-
-            TRACE("Adding bitmap size h %d w %d size %ld x_ppem %ld y_ppem %ld\n",
-                  face->size.height, face->size.width, face->size.size >> 6,
-                  face->size.x_ppem >> 6, face->size.y_ppem >> 6);
+            reg_load_dword(hkey_face, face_width_value, &info.width);
+            reg_load_dword(hkey_face, face_size_value, &info.size);
+            reg_load_dword(hkey_face, face_x_ppem_value, &info.x_ppem);
+            reg_load_dword(hkey_face, face_y_ppem_value, &info.y_ppem);
+            reg_load_dword(hkey_face, face_internal_leading_value, &info.internal_leading);
         }
 
-        TRACE("fsCsb = %08x %08x/%08x %08x %08x %08x\n",
-              face->fs.fsCsb[0], face->fs.fsCsb[1],
-              face->fs.fsUsb[0], face->fs.fsUsb[1],
-              face->fs.fsUsb[2], face->fs.fsUsb[3]);
+        release_face( create_cached_face( family, face_name, file, full_name, &info ));
 
-        if (insert_face_in_family_list(face, family))
-            TRACE("Added font %s %s\n", debugstr_w(family->FamilyName), debugstr_w(face->StyleName));
+        catalog_append_dword( catalog, FONT_CATALOG_FACE );
+        catalog_append_string( catalog, face_name );
+        catalog_append_string( catalog, file );
+        catalog_append_string( catalog, full_name );
+        catalog_append( catalog, &info, sizeof(info) );
 
-        release_face( face );
+        HeapFree( GetProcessHeap(), 0, file );
+        HeapFree( GetProcessHeap(), 0, full_name );
     }
 
     /* load bitmap strikes */
@@ -1678,7 +1792,7 @@ static void load_face(HKEY hkey_face, WCHAR *face_name, Family *family, void *bu
     {
         if (!RegOpenKeyExW(hkey_face, buffer, 0, KEY_ALL_ACCESS, &hkey_strike))
         {
-            load_face(hkey_strike, face_name, family, buffer, buffer_size);
+            load_face(hkey_strike, face_name, family, buffer, buffer_size, catalog);
             RegCloseKey(hkey_strike);
         }
         needed = buffer_size;
@@ -1717,12 +1831,28 @@ static void reorder_vertical_fonts(void)
     list_move_tail( &font_list, &vertical_families );
 }
 
+static void add_english_family_subst( const WCHAR *family_name, const WCHAR *english_family )
+{
+    FontSubst *subst = HeapAlloc(GetProcessHeap(), 0, sizeof(*subst));
+    subst->from.name = strdupW(english_family);
+    subst->from.charset = -1;
+    subst->to.name = strdupW(family_name);
+    subst->to.charset = -1;
+    add_font_subst(&font_subst_list, subst, 0);
+}
+
 static void load_font_list_from_cache(HKEY hkey_font_cache)
 {
     DWORD size, family_index = 0;
     Family *family;
     HKEY hkey_family;
     WCHAR buffer[4096];
+    struct font_catalog catalog;
+
+    catalog.alloc = 0x10000;
+    catalog.data = HeapAlloc( GetProcessHeap(), 0, catalog.alloc );
+    catalog.size = 0;
+    catalog_append_dword( &catalog, FONT_CATALOG_VERSION );
 
     size = sizeof(buffer);
     while (!RegEnumKeyExW(hkey_font_cache, family_index++, buffer, &size, NULL, NULL, NULL, NULL))
@@ -1740,14 +1870,11 @@ static void load_font_list_from_cache(HKEY hkey_font_cache)
         family = create_family(family_name, english_family);
 
         if(english_family)
-        {
-            FontSubst *subst = HeapAlloc(GetProcessHeap(), 0, sizeof(*subst));
-            subst->from.name = strdupW(english_family);
-            subst->from.charset = -1;
-            subst->to.name = strdupW(family_name);
-            subst->to.charset = -1;
-            add_font_subst(&font_subst_list, subst, 0);
-        }
+            add_english_family_subst( family_name, english_family );
+
+        catalog_append_dword( &catalog, FONT_CATALOG_FAMILY );
+        catalog_append_string( &catalog, family_name );
+        catalog_append_string( &catalog, english_family );
 
         size = sizeof(buffer);
         while (!RegEnumKeyExW(hkey_family, face_index++, buffer, &size, NULL, NULL, NULL, NULL))
@@ -1757,7 +1884,7 @@ static void load_font_list_from_cache(HKEY hkey_font_cache)
 
             if (!RegOpenKeyExW(hkey_family, face_name, 0, KEY_ALL_ACCESS, &hkey_face))
             {
-                load_face(hkey_face, face_name, family, buffer, sizeof(buffer));
+                load_face(hkey_face, face_name, family, buffer, sizeof(buffer), &catalog);
                 RegCloseKey(hkey_face);
             }
             HeapFree( GetProcessHeap(), 0, face_name );
@@ -1769,6 +1896,104 @@ static void load_font_list_from_cache(HKEY hkey_font_cache)
     }
 
     reorder_vertical_fonts();
+
+    /* save the catalog so that the next process can skip walking the keys */
+    if (catalog.data)
+    {
+        TRACE("saving font catalog, %u bytes\n", catalog.size);
+        RegSetValueExW(hkey_font_cache, font_catalog_value, 0, REG_BINARY, catalog.data, catalog.size);
+        HeapFree( GetProcessHeap(), 0, catalog.data );
+    }
+}
+
+static const WCHAR *catalog_read_string( const BYTE **ptr, const BYTE *end )
+{
+    const WCHAR *str = (const WCHAR *)*ptr, *p;
+
+    for (p = str; (const BYTE *)(p + 1) <= end; p++)
+    {
+        if (*p) continue;
+        *ptr = (const BYTE *)(p + 1);
+        return str;
+    }
+    return NULL;
+}
+
+/* Walk the catalog, either to validate it, or to load it once validated. */
+static BOOL parse_font_catalog( const BYTE *ptr, const BYTE *end, BOOL load )
+{
+    const WCHAR *family_name, *english_family, *style_name, *file, *full_name;
+    struct font_catalog_face info;
+    Family *family = NULL;
+    BOOL have_family = FALSE;
+    DWORD type;
+
+    if (end - ptr < sizeof(type)) return FALSE;
+    memcpy( &type, ptr, sizeof(type) );
+    ptr += sizeof(type);
+    if (type != FONT_CATALOG_VERSION) return FALSE;
+
+    while (ptr < end)
+    {
+        if (end - ptr < sizeof(type)) return FALSE;
+        memcpy( &type, ptr, sizeof(type) );
+        ptr += sizeof(type);
+
+        switch (type)
+        {
+        case FONT_CATALOG_FAMILY:
+            if (!(family_name = catalog_read_string( &ptr, end ))) return FALSE;
+            if (!(english_family = catalog_read_string( &ptr, end ))) return FALSE;
+            have_family = TRUE;
+            if (!load) break;
+            if (family) release_family( family );
+            family = create_family( strdupW( family_name ), *english_family ? strdupW( english_family ) : NULL );
+            if (family->EnglishName) add_english_family_subst( family->FamilyName, family->EnglishName );
+            break;
+
+        case FONT_CATALOG_FACE:
+            if (!have_family) return FALSE;
+            if (!(style_name = catalog_read_string( &ptr, end ))) return FALSE;
+            if (!(file = catalog_read_string( &ptr, end ))) return FALSE;
+            if (!(full_name = catalog_read_string( &ptr, end ))) return FALSE;
+            if (end - ptr < sizeof(info)) return FALSE;
+            memcpy( &info, ptr, sizeof(info) );
+            ptr += sizeof(info);
+            if (load) release_face( create_cached_face( family, style_name, file,
+                                                        *full_name ? full_name : NULL, &info ));
+            break;
+
+        default:
+            return FALSE;
+        }
+    }
+    if (load && family) release_family( family );
+    return TRUE;
+}
+
+static BOOL load_font_list_from_catalog(HKEY hkey_font_cache)
+{
+    DWORD type, size = 0;
+    BYTE *data;
+    BOOL ret = FALSE;
+
+    if (RegQueryValueExW(hkey_font_cache, font_catalog_value, NULL, &type, NULL, &size) ||
+        type != REG_BINARY)
+        return FALSE;
+    if (!(data = HeapAlloc( GetProcessHeap(), 0, size ))) return FALSE;
+
+    if (!RegQueryValueExW(hkey_font_cache, font_catalog_value, NULL, NULL, data, &size))
+    {
+        if (parse_font_catalog( data, data + size, FALSE ))
+        {
+            TRACE("loading font catalog, %u bytes\n", size);
+            ret = parse_font_catalog( data, data + size, TRUE );
+            reorder_vertical_fonts();
+        }
+        else WARN("invalid font catalog\n");
+    }
+    HeapFree( GetProcessHeap(), 0, data );
+    return ret;
 }
 
 static LONG create_font_cache_key(HKEY *hkey, DWORD *disposition)
@@ -1796,6 +2021,7 @@ static void add_face_to_cache(Face *face)
     HKEY hkey_family, hkey_face;
     WCHAR *face_key_name;
 
+    RegDeleteValueW(hkey_font_cache, font_catalog_value);
     RegCreateKeyExW(hkey_font_cache, face->family->FamilyName, 0,
                     NULL, REG_OPTION_VOLATILE, KEY_ALL_ACCESS, NULL, &hkey_family, NULL);
     if(face->family->EnglishName)
@@ -1845,6 +2071,7 @@ static void remove_face_from_cache( Face *face )
 {
     HKEY hkey_family;
 
+    RegDeleteValueW( hkey_font_cache, font_catalog_value );
     RegOpenKeyExW( hkey_font_cache, face->family->FamilyName, 0, KEY_ALL_ACCESS, &hkey_family );
 
     if (face->scalable)
@@ -4367,7 +4594,7 @@ BOOL WineEngInit(void)
 
     if(disposition == REG_CREATED_NEW_KEY)
         init_font_list();
-    else
+    else if (!load_font_list_from_catalog(hkey_font_cache))
         load_font_list_from_cache(hkey_font_cache);
 
     reorder_font_list();
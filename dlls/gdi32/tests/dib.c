@@ -3327,6 +3327,154 @@ static void test_simple_graphics(void)
     DeleteDC(mem_dc);
 }
 
+#define PERF_WIDTH  1920
+#define PERF_HEIGHT 1080
+
+static void perf_op(HDC dst_dc, HDC src_dc, HDC src_555_dc, int op, int x, int width)
+{
+    BLENDFUNCTION blend = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+
+    switch (op)
+    {
+    case 1:
+        blend.SourceConstantAlpha = 128;
+        break;
+    case 2:
+        blend.SourceConstantAlpha = 128;
+        blend.AlphaFormat = 0;
+        break;
+    case 3:
+        BitBlt(dst_dc, x, 0, width, PERF_HEIGHT, src_dc, x, 0, SRCCOPY);
+        return;
+    case 4:
+        BitBlt(dst_dc, x, 0, width, PERF_HEIGHT, src_555_dc, x, 0, SRCCOPY);
+        return;
+    }
+    pGdiAlphaBlend(dst_dc, x, 0, width, PERF_HEIGHT, src_dc, x, 0, width, PERF_HEIGHT, blend);
+}
+
+/* Times the 32-bpp blending and conversion paths on a large DIB.  The results
+ * are compared against blits three pixels wide, which are too narrow for the
+ * SIMD paths.  Only run in interactive mode. */
+static void test_perf(void)
+{
+    static const char *op_names[] =
+    {
+        "AlphaBlend", "AlphaBlend constant alpha", "AlphaBlend no source alpha", "BitBlt 8888", "BitBlt 555"
+    };
+    static const DWORD dst_fields[][3] = {{0xff0000, 0x00ff00, 0x0000ff}, {0x0000ff, 0x00ff00, 0xff0000}};
+    static const char *dst_names[] = {"a8r8g8b8", "a8b8g8r8"};
+    char bmibuf[sizeof(BITMAPINFO) + 2 * sizeof(RGBQUAD)];
+    BITMAPINFO *bmi = (BITMAPINFO *)bmibuf;
+    DWORD *bit_fields = (DWORD *)(bmibuf + sizeof(BITMAPINFOHEADER));
+    HBITMAP src_dib, src_555_dib, dst_dib[2], init_dib;
+    HBITMAP orig_src, orig_src_555, orig_dst[2];
+    HDC src_dc, src_555_dc, dst_dc[2];
+    DWORD *src_bits, *dst_bits[2], *init_bits, seed = 1, start, elapsed;
+    WORD *src_555_bits;
+    char *hash[2];
+    int i, j, op, x, a;
+
+    if (!winetest_interactive)
+    {
+        skip("DIB engine benchmark, set WINETEST_INTERACTIVE to run it\n");
+        return;
+    }
+    if (!pGdiAlphaBlend)
+    {
+        win_skip("GdiAlphaBlend isn't supported\n");
+        return;
+    }
+
+    memset(bmi, 0, sizeof(bmibuf));
+    bmi->bmiHeader.biSize = sizeof(bmi->bmiHeader);
+    bmi->bmiHeader.biWidth = PERF_WIDTH;
+    bmi->bmiHeader.biHeight = -PERF_HEIGHT;
+    bmi->bmiHeader.biPlanes = 1;
+    bmi->bmiHeader.biBitCount = 32;
+    bmi->bmiHeader.biCompression = BI_RGB;
+
+    src_dib = CreateDIBSection(0, bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0);
+    ok(src_dib != NULL, "ret NULL\n");
+    init_dib = CreateDIBSection(0, bmi, DIB_RGB_COLORS, (void **)&init_bits, NULL, 0);
+    ok(init_dib != NULL, "ret NULL\n");
+    for (i = 0; i < PERF_WIDTH * PERF_HEIGHT; i++)
+    {
+        /* Premultiplied source data. */
+        seed = seed * 1103515245 + 12345;
+        a = seed >> 24;
+        src_bits[i] = (a << 24) | ((((seed >> 16) & 0xff) * a / 255) << 16)
+                | ((((seed >> 8) & 0xff) * a / 255) << 8) | ((seed & 0xff) * a / 255);
+        seed = seed * 1103515245 + 12345;
+        init_bits[i] = seed;
+    }
+
+    bmi->bmiHeader.biBitCount = 16;
+    src_555_dib = CreateDIBSection(0, bmi, DIB_RGB_COLORS, (void **)&src_555_bits, NULL, 0);
+    ok(src_555_dib != NULL, "ret NULL\n");
+    for (i = 0; i < PERF_WIDTH * PERF_HEIGHT; i++)
+        src_555_bits[i] = src_bits[i] >> 9;
+
+    src_dc = CreateCompatibleDC(NULL);
+    src_555_dc = CreateCompatibleDC(NULL);
+    orig_src = SelectObject(src_dc, src_dib);
+    orig_src_555 = SelectObject(src_555_dc, src_555_dib);
+
+    bmi->bmiHeader.biBitCount = 32;
+    bmi->bmiHeader.biCompression = BI_BITFIELDS;
+    for (i = 0; i < sizeof(dst_names) / sizeof(dst_names[0]); i++)
+    {
+        memcpy(bit_fields, dst_fields[i], sizeof(dst_fields[i]));
+        for (j = 0; j < 2; j++)
+        {
+            dst_dib[j] = CreateDIBSection(0, bmi, DIB_RGB_COLORS, (void **)&dst_bits[j], NULL, 0);
+            ok(dst_dib[j] != NULL, "ret NULL\n");
+            dst_dc[j] = CreateCompatibleDC(NULL);
+            orig_dst[j] = SelectObject(dst_dc[j], dst_dib[j]);
+        }
+
+        for (op = 0; op < sizeof(op_names) / sizeof(op_names[0]); op++)
+        {
+            start = GetTickCount();
+            for (j = 0; j < 20; j++)
+                perf_op(dst_dc[0], src_dc, src_555_dc, op, 0, PERF_WIDTH);
+            GdiFlush();
+            elapsed = GetTickCount() - start;
+            trace("%s: %s %dx%d 20 times in %u ms\n", dst_names[i], op_names[op], PERF_WIDTH, PERF_HEIGHT, elapsed);
+
+            for (j = 0; j < 2; j++)
+                memcpy(dst_bits[j], init_bits, PERF_WIDTH * PERF_HEIGHT * 4);
+            perf_op(dst_dc[0], src_dc, src_555_dc, op, 0, PERF_WIDTH);
+            for (x = 0; x < PERF_WIDTH; x += 3)
+                perf_op(dst_dc[1], src_dc, src_555_dc, op, x, 3);
+            GdiFlush();
+
+            for (j = 0; j < 2; j++)
+                hash[j] = hash_dib(bmi, dst_bits[j]);
+            if (hash[0] && hash[1])
+                ok(!strcmp(hash[0], hash[1]), "%s: %s results differ, got %s and %s\n",
+                   dst_names[i], op_names[op], hash[0], hash[1]);
+            for (j = 0; j < 2; j++)
+                HeapFree(GetProcessHeap(), 0, hash[j]);
+        }
+
+        for (j = 0; j < 2; j++)
+        {
+            SelectObject(dst_dc[j], orig_dst[j]);
+            DeleteDC(dst_dc[j]);
+            DeleteObject(dst_dib[j]);
+        }
+    }
+
+    SelectObject(src_dc, orig_src);
+    SelectObject(src_555_dc, orig_src_555);
+    DeleteDC(src_dc);
+    DeleteDC(src_555_dc);
+    DeleteObject(src_dib);
+    DeleteObject(src_555_dib);
+    DeleteObject(init_dib);
+}
+
 START_TEST(dib)
 {
     HMODULE mod = GetModuleHandleA("gdi32.dll");
@@ -3337,6 +3485,7 @@ START_TEST(dib)
     CryptAcquireContextW(&crypt_prov, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT);
 
     test_simple_graphics();
+    test_perf();
 
     CryptReleaseContext(crypt_prov, 0);
 }
@@ -16,6 +16,9 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
  */
 
+#include "config.h"
+#include "wine/port.h"
+
 #include <stdarg.h>
 #include <math.h>
 #include <limits.h>
@@ -40,6 +43,12 @@
 #include "wine/debug.h"
 #include "wine/list.h"
 
+#ifdef __WINE_TARGET
+#define GDIPLUS_SSE2
+#define SSE2_FUNC __WINE_TARGET("sse2")
+#include <emmintrin.h>
+#endif
+
 WINE_DEFAULT_DEBUG_CHANNEL(gdiplus);
 
 /* looks-right constants */
@@ -354,30 +363,242 @@ static GpStatus get_clip_hrgn(GpGraphics *graphics, HRGN *hrgn)
     return GdipGetRegionHRgn(graphics->clip, NULL, hrgn);
 }
 
-/* Draw ARGB data to the given graphics object */
-static GpStatus alpha_blend_bmp_pixels(GpGraphics *graphics, INT dst_x, INT dst_y,
-    const BYTE *src, INT src_width, INT src_height, INT src_stride, const PixelFormat fmt)
+/* Minimum number of pixels, and of rows per band, before software rendering
+ * is split into bands processed in parallel. */
+#define BAND_MIN_PIXELS (256 * 256)
+#define BAND_MIN_ROWS 16
+#define MAX_BANDS 16
+
+typedef void (*band_func)(void *param, INT band);
+
+struct band_job
 {
-    GpBitmap *dst_bitmap = (GpBitmap*)graphics->image;
-    INT x, y;
+    band_func func;
+    void *param;
+    INT band_count;
+    LONG next_band;
+};
 
-    for (y=0; y<src_height; y++)
+static void process_bands(struct band_job *job)
+{
+    INT band;
+
+    while ((band = InterlockedIncrement(&job->next_band) - 1) < job->band_count)
+        job->func(job->param, band);
+}
+
+static void CALLBACK band_work_callback(PTP_CALLBACK_INSTANCE instance, void *context, PTP_WORK work)
+{
+    process_bands(context);
+}
+
+/* Number of bands to split a width x height area into. */
+static INT get_band_count(INT width, INT height)
+{
+    static LONG cpu_count;
+    INT count;
+
+    if (!cpu_count)
     {
-        for (x=0; x<src_width; x++)
+        SYSTEM_INFO info;
+
+        GetSystemInfo(&info);
+        cpu_count = info.dwNumberOfProcessors;
+    }
+
+    if ((LONGLONG)width * height < BAND_MIN_PIXELS)
+        return 1;
+
+    count = min(cpu_count, MAX_BANDS);
+    count = min(count, height / BAND_MIN_ROWS);
+
+    return max(count, 1);
+}
+
+/* Calls func for every band, sharing the bands between the calling thread
+ * and the thread pool. Bands must not touch the same pixels. */
+static void run_bands(band_func func, void *param, INT band_count)
+{
+    struct band_job job;
+    PTP_WORK work = NULL;
+    INT i;
+
+    job.func = func;
+    job.param = param;
+    job.band_count = band_count;
+    job.next_band = 0;
+
+    if (band_count > 1 && (work = CreateThreadpoolWork(band_work_callback, &job, NULL)))
+    {
+        for (i=1; i<band_count; i++)
+            SubmitThreadpoolWork(work);
+    }
+
+    process_bands(&job);
+
+    if (work)
+    {
+        WaitForThreadpoolWorkCallbacks(work, FALSE);
+        CloseThreadpoolWork(work);
+    }
+}
+
+/* Whether alpha_blend_bmp_span accesses the bits of this format directly,
+ * which also makes it safe to blend separate rows in parallel. */
+static BOOL is_direct_blend_format(PixelFormat format)
+{
+    return format == PixelFormat32bppARGB ||
+           format == PixelFormat32bppRGB ||
+           format == PixelFormat32bppPARGB;
+}
+
+#ifdef GDIPLUS_SSE2
+static BOOL use_sse2(void)
+{
+    static int supported = -1;
+
+    if (supported == -1) supported = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+    return supported;
+}
+
+/* Blends four pixels at a time the same way as color_over. The divisions are
+ * done in single precision; the quotients are at most 255 and at least 1/255
+ * away from the next integer unless exact, so truncating them gives the same
+ * results as the integer divisions. Returns the number of pixels blended. */
+static INT SSE2_FUNC alpha_blend_argb_span_sse2(DWORD *dst_row, const ARGB *src, INT count, BOOL rgb)
+{
+    const __m128i mask = _mm_set1_epi32(0xff), zero = _mm_setzero_si128();
+    const __m128 f255 = _mm_set1_ps(255.0f);
+    __m128i dst, bg, fg, fa, bga, use_fg, use_bg, result;
+    __m128 fa_f, bga_f, a_f, bc, fc;
+    INT x, shift;
+
+    for (x = 0; x + 4 <= count; x += 4)
+    {
+        dst = _mm_loadu_si128((const __m128i *)(dst_row + x));
+        fg = _mm_loadu_si128((const __m128i *)(src + x));
+        bg = rgb ? _mm_or_si128(dst, _mm_set1_epi32(0xff000000)) : dst;
+
+        fa = _mm_srli_epi32(fg, 24);
+        fa_f = _mm_cvtepi32_ps(fa);
+        bga = _mm_cvttps_epi32(_mm_div_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(bg, 24)),
+                _mm_sub_ps(f255, fa_f)), f255));
+        bga_f = _mm_cvtepi32_ps(bga);
+        a_f = _mm_add_ps(bga_f, fa_f);
+
+        result = _mm_slli_epi32(_mm_cvttps_epi32(a_f), 24);
+        for (shift = 0; shift < 24; shift += 8)
+        {
+            bc = _mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(bg, _mm_cvtsi32_si128(shift)), mask));
+            fc = _mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(fg, _mm_cvtsi32_si128(shift)), mask));
+            bc = _mm_div_ps(_mm_add_ps(_mm_mul_ps(bc, bga_f), _mm_mul_ps(fc, fa_f)), a_f);
+            result = _mm_or_si128(result, _mm_sll_epi32(_mm_cvttps_epi32(bc), _mm_cvtsi32_si128(shift)));
+        }
+
+        use_fg = _mm_or_si128(_mm_cmpeq_epi32(fa, mask), _mm_cmpeq_epi32(bga, zero));
+        result = _mm_or_si128(_mm_and_si128(use_fg, fg), _mm_andnot_si128(use_fg, result));
+        if (rgb)
+            result = _mm_and_si128(result, _mm_set1_epi32(0xffffff));
+        /* fully transparent pixels leave the destination alone */
+        use_bg = _mm_cmpeq_epi32(fa, zero);
+        result = _mm_or_si128(_mm_and_si128(use_bg, dst), _mm_andnot_si128(use_bg, result));
+
+        _mm_storeu_si128((__m128i *)(dst_row + x), result);
+    }
+
+    return x;
+}
+#endif
+
+/* Draw a row of ARGB data to the given bitmap */
+static void alpha_blend_bmp_span(GpBitmap *dst_bitmap, INT dst_x, INT dst_y,
+    const ARGB *src, INT count, PixelFormat fmt)
+{
+    DWORD *dst_row;
+    INT x = 0;
+
+    if (!is_direct_blend_format(dst_bitmap->format))
+    {
+        for (x=0; x<count; x++)
         {
-            ARGB dst_color, src_color;
-            src_color = ((ARGB*)(src + src_stride * y))[x];
+            ARGB dst_color, src_color = src[x];
 
             if (!(src_color & 0xff000000))
                 continue;
 
-            GdipBitmapGetPixel(dst_bitmap, x+dst_x, y+dst_y, &dst_color);
+            GdipBitmapGetPixel(dst_bitmap, x+dst_x, dst_y, &dst_color);
             if (fmt & PixelFormatPAlpha)
-                GdipBitmapSetPixel(dst_bitmap, x+dst_x, y+dst_y, color_over_fgpremult(dst_color, src_color));
+                GdipBitmapSetPixel(dst_bitmap, x+dst_x, dst_y, color_over_fgpremult(dst_color, src_color));
+            else
+                GdipBitmapSetPixel(dst_bitmap, x+dst_x, dst_y, color_over(dst_color, src_color));
+        }
+        return;
+    }
+
+    /* Same as going through GdipBitmapGetPixel and GdipBitmapSetPixel. */
+    dst_row = (DWORD*)(dst_bitmap->bits + dst_bitmap->stride * dst_y) + dst_x;
+
+#ifdef GDIPLUS_SSE2
+    if (!(fmt & PixelFormatPAlpha) && dst_bitmap->format != PixelFormat32bppPARGB && use_sse2())
+        x = alpha_blend_argb_span_sse2(dst_row, src, count, dst_bitmap->format == PixelFormat32bppRGB);
+#endif
+
+    for (; x<count; x++)
+    {
+        ARGB dst_color, src_color = src[x];
+        BYTE a, r, g, b;
+
+        if (!(src_color & 0xff000000))
+            continue;
+
+        dst_color = dst_row[x];
+
+        if (dst_bitmap->format == PixelFormat32bppRGB)
+            dst_color |= 0xff000000;
+        else if (dst_bitmap->format == PixelFormat32bppPARGB)
+        {
+            a = dst_color >> 24;
+            if (a == 0)
+                dst_color = 0;
             else
-                GdipBitmapSetPixel(dst_bitmap, x+dst_x, y+dst_y, color_over(dst_color, src_color));
+            {
+                r = ((dst_color >> 16) & 0xff) * 255 / a;
+                g = ((dst_color >> 8) & 0xff) * 255 / a;
+                b = (dst_color & 0xff) * 255 / a;
+                dst_color = (a << 24) | (r << 16) | (g << 8) | b;
+            }
+        }
+
+        if (fmt & PixelFormatPAlpha)
+            dst_color = color_over_fgpremult(dst_color, src_color);
+        else
+            dst_color = color_over(dst_color, src_color);
+
+        if (dst_bitmap->format == PixelFormat32bppRGB)
+            dst_color &= 0xffffff;
+        else if (dst_bitmap->format == PixelFormat32bppPARGB)
+        {
+            a = dst_color >> 24;
+            r = ((dst_color >> 16) & 0xff) * a / 255;
+            g = ((dst_color >> 8) & 0xff) * a / 255;
+            b = (dst_color & 0xff) * a / 255;
+            dst_color = (a << 24) | (r << 16) | (g << 8) | b;
         }
+
+        dst_row[x] = dst_color;
     }
+}
+
+/* Draw ARGB data to the given graphics object */
+static GpStatus alpha_blend_bmp_pixels(GpGraphics *graphics, INT dst_x, INT dst_y,
+    const BYTE *src, INT src_width, INT src_height, INT src_stride, const PixelFormat fmt)
+{
+    GpBitmap *dst_bitmap = (GpBitmap*)graphics->image;
+    INT y;
+
+    for (y=0; y<src_height; y++)
+        alpha_blend_bmp_span(dst_bitmap, dst_x, dst_y + y,
+            (const ARGB*)(src + src_stride * y), src_width, fmt);
 
     return Ok;
 }
@@ -423,6 +644,51 @@ static GpStatus alpha_blend_hdc_pixels(GpGraphics *graphics, INT dst_x, INT dst_
     return Ok;
 }
 
+/* Get the parts of the given device area, optionally limited to hregion,
+ * that are not clipped, as region data. */
+static GpStatus get_visible_region_data(GpGraphics *graphics, INT x, INT y,
+    INT width, INT height, HRGN hregion, RGNDATA **rgndata)
+{
+    GpStatus stat;
+    int size;
+    HRGN hrgn, visible_rgn;
+
+    hrgn = CreateRectRgn(x, y, x + width, y + height);
+    if (!hrgn)
+        return OutOfMemory;
+
+    stat = get_clip_hrgn(graphics, &visible_rgn);
+    if (stat != Ok)
+    {
+        DeleteObject(hrgn);
+        return stat;
+    }
+
+    if (visible_rgn)
+    {
+        CombineRgn(hrgn, hrgn, visible_rgn, RGN_AND);
+        DeleteObject(visible_rgn);
+    }
+
+    if (hregion)
+        CombineRgn(hrgn, hrgn, hregion, RGN_AND);
+
+    size = GetRegionData(hrgn, 0, NULL);
+
+    *rgndata = heap_alloc_zero(size);
+    if (!*rgndata)
+    {
+        DeleteObject(hrgn);
+        return OutOfMemory;
+    }
+
+    GetRegionData(hrgn, size, *rgndata);
+
+    DeleteObject(hrgn);
+
+    return Ok;
+}
+
 static GpStatus alpha_blend_pixels_hrgn(GpGraphics *graphics, INT dst_x, INT dst_y,
     const BYTE *src, INT src_width, INT src_height, INT src_stride, HRGN hregion, PixelFormat fmt)
 {
@@ -431,41 +697,13 @@ static GpStatus alpha_blend_pixels_hrgn(GpGraphics *graphics, INT dst_x, INT dst
     if (graphics->image && graphics->image->type == ImageTypeBitmap)
     {
         DWORD i;
-        int size;
         RGNDATA *rgndata;
         RECT *rects;
-        HRGN hrgn, visible_rgn;
 
-        hrgn = CreateRectRgn(dst_x, dst_y, dst_x + src_width, dst_y + src_height);
-        if (!hrgn)
-            return OutOfMemory;
-
-        stat = get_clip_hrgn(graphics, &visible_rgn);
+        stat = get_visible_region_data(graphics, dst_x, dst_y, src_width, src_height,
+            hregion, &rgndata);
         if (stat != Ok)
-        {
-            DeleteObject(hrgn);
             return stat;
-        }
-
-        if (visible_rgn)
-        {
-            CombineRgn(hrgn, hrgn, visible_rgn, RGN_AND);
-            DeleteObject(visible_rgn);
-        }
-
-        if (hregion)
-            CombineRgn(hrgn, hrgn, hregion, RGN_AND);
-
-        size = GetRegionData(hrgn, 0, NULL);
-
-        rgndata = heap_alloc_zero(size);
-        if (!rgndata)
-        {
-            DeleteObject(hrgn);
-            return OutOfMemory;
-        }
-
-        GetRegionData(hrgn, size, rgndata);
 
         rects = (RECT*)rgndata->Buffer;
 
@@ -479,8 +717,6 @@ static GpStatus alpha_blend_pixels_hrgn(GpGraphics *graphics, INT dst_x, INT dst
 
         heap_free(rgndata);
 
-        DeleteObject(hrgn);
-
         return stat;
     }
     else if (graphics->image && graphics->image->type == ImageTypeMetafile)
@@ -523,12 +759,10 @@ static GpStatus alpha_blend_pixels(GpGraphics *graphics, INT dst_x, INT dst_y,
     return alpha_blend_pixels_hrgn(graphics, dst_x, dst_y, src, src_width, src_height, src_stride, NULL, fmt);
 }
 
-static ARGB blend_colors(ARGB start, ARGB end, REAL position)
+/* Blends two colors, pos ranging from 0 (start) to 0xff (end). */
+static ARGB blend_colors_pos(ARGB start, ARGB end, INT pos)
 {
     INT start_a, end_a, final_a;
-    INT pos;
-
-    pos = gdip_round(position * 0xff);
 
     start_a = ((start >> 24) & 0xff) * (pos ^ 0xff);
     end_a = ((end >> 24) & 0xff) * pos;
@@ -543,10 +777,13 @@ static ARGB blend_colors(ARGB start, ARGB end, REAL position)
         (((start & 0xff) * start_a + ((end & 0xff) * end_a)) / final_a);
 }
 
-static ARGB blend_line_gradient(GpLineGradient* brush, REAL position)
+static ARGB blend_colors(ARGB start, ARGB end, REAL position)
 {
-    REAL blendfac;
+    return blend_colors_pos(start, end, gdip_round(position * 0xff));
+}
 
+static inline REAL wrap_line_gradient_position(const GpLineGradient *brush, REAL position)
+{
     /* clamp to between 0.0 and 1.0, using the wrap mode */
     if (brush->wrap == WrapModeTile)
     {
@@ -560,6 +797,15 @@ static ARGB blend_line_gradient(GpLineGradient* brush, REAL position)
         if (position > 1.0f) position = 2.0f - position;
     }
 
+    return position;
+}
+
+static ARGB blend_line_gradient(GpLineGradient* brush, REAL position)
+{
+    REAL blendfac;
+
+    position = wrap_line_gradient_position(brush, position);
+
     if (brush->blendcount == 1)
         blendfac = position;
     else
@@ -1087,44 +1333,60 @@ static BOOL brush_can_fill_pixels(GpBrush *brush)
     }
 }
 
-static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
-    DWORD *argb_pixels, GpRect *fill_area, UINT cdwStride)
+struct path_gradient_edge
+{
+    GpPointF start_point, end_point;
+    ARGB start_color, end_color;
+    REAL dx, dy, center_distance;
+    INT min_y, max_y;
+};
+
+/* Precomputed state for generating rows of brush pixels over a device area. */
+typedef struct brush_fill_context
+{
+    GpBrush *brush;
+    GpRect fill_area;
+    InterpolationMode interpolation;
+    PixelOffsetMode offset_mode;
+
+    /* Linear gradients and textures: brush space position of the fill area
+     * origin, and the brush space steps of one device pixel in x and y. */
+    GpPointF origin;
+    REAL x_dx, x_dy, y_dx, y_dy;
+
+    const char *hatch_data;
+
+    /* Two color linear gradients: the color for each rounded position. */
+    BOOL use_gradient_colors;
+    ARGB gradient_colors[256];
+
+    GpRect src_area;
+
+    struct path_gradient_edge *edges;
+    INT edge_count;
+    GpPointF center_point;
+} brush_fill_context;
+
+static GpStatus init_brush_fill_context(brush_fill_context *context, GpGraphics *graphics,
+    GpBrush *brush, const GpRect *fill_area)
 {
+    memset(context, 0, sizeof(*context));
+    context->brush = brush;
+    context->fill_area = *fill_area;
+    context->interpolation = graphics->interpolation;
+    context->offset_mode = graphics->pixeloffset;
+
     switch (brush->bt)
     {
     case BrushTypeSolidColor:
-    {
-        int x, y;
-        GpSolidFill *fill = (GpSolidFill*)brush;
-        for (x=0; x<fill_area->Width; x++)
-            for (y=0; y<fill_area->Height; y++)
-                argb_pixels[x + y*cdwStride] = fill->color;
         return Ok;
-    }
     case BrushTypeHatchFill:
     {
-        int x, y;
         GpHatch *fill = (GpHatch*)brush;
-        const char *hatch_data;
 
-        if (get_hatch_data(fill->hatchstyle, &hatch_data) != Ok)
+        if (get_hatch_data(fill->hatchstyle, &context->hatch_data) != Ok)
             return NotImplemented;
 
-        for (x=0; x<fill_area->Width; x++)
-            for (y=0; y<fill_area->Height; y++)
-            {
-                int hx, hy;
-
-                /* FIXME: Account for the rendering origin */
-                hx = (x + fill_area->X) % 8;
-                hy = (y + fill_area->Y) % 8;
-
-                if ((hatch_data[7-hy] & (0x80 >> hx)) != 0)
-                    argb_pixels[x + y*cdwStride] = fill->forecol;
-                else
-                    argb_pixels[x + y*cdwStride] = fill->backcol;
-            }
-
         return Ok;
     }
     case BrushTypeLinearGradient:
@@ -1134,7 +1396,7 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
         GpStatus stat;
         static const GpRectF box_1 = { 0.0, 0.0, 1.0, 1.0 };
         GpMatrix *world_to_gradient; /* FIXME: Store this in the brush? */
-        int x, y;
+        int i;
 
         draw_points[0].X = fill_area->X;
         draw_points[0].Y = fill_area->Y;
@@ -1171,17 +1433,17 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
 
         if (stat == Ok)
         {
-            REAL x_delta = draw_points[1].X - draw_points[0].X;
-            REAL y_delta = draw_points[2].X - draw_points[0].X;
+            context->origin = draw_points[0];
+            context->x_dx = draw_points[1].X - draw_points[0].X;
+            context->y_dx = draw_points[2].X - draw_points[0].X;
 
-            for (y=0; y<fill_area->Height; y++)
+            /* Without blend factors or preset colors, the color only depends
+             * on the position rounded to 1/255. */
+            if (fill->blendcount == 1 && fill->pblendcount == 0)
             {
-                for (x=0; x<fill_area->Width; x++)
-                {
-                    REAL pos = draw_points[0].X + x * x_delta + y * y_delta;
-
-                    argb_pixels[x + y*cdwStride] = blend_line_gradient(fill, pos);
-                }
+                for (i=0; i<256; i++)
+                    context->gradient_colors[i] = blend_colors_pos(fill->startcolor, fill->endcolor, i);
+                context->use_gradient_colors = TRUE;
             }
         }
 
@@ -1192,10 +1454,8 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
         GpTexture *fill = (GpTexture*)brush;
         GpPointF draw_points[3];
         GpStatus stat;
-        int x, y;
         GpBitmap *bitmap;
         int src_stride;
-        GpRect src_area;
 
         if (fill->image->type != ImageTypeBitmap)
         {
@@ -1206,9 +1466,9 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
         bitmap = (GpBitmap*)fill->image;
         src_stride = sizeof(ARGB) * bitmap->width;
 
-        src_area.X = src_area.Y = 0;
-        src_area.Width = bitmap->width;
-        src_area.Height = bitmap->height;
+        context->src_area.X = context->src_area.Y = 0;
+        context->src_area.Width = bitmap->width;
+        context->src_area.Height = bitmap->height;
 
         draw_points[0].X = fill_area->X;
         draw_points[0].Y = fill_area->Y;
@@ -1246,7 +1506,7 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
                 lockeddata.PixelFormat = PixelFormat32bppARGB;
                 lockeddata.Scan0 = fill->bitmap_bits;
 
-                stat = GdipBitmapLockBits(bitmap, &src_area, ImageLockModeRead|ImageLockModeUserInputBuf,
+                stat = GdipBitmapLockBits(bitmap, &context->src_area, ImageLockModeRead|ImageLockModeUserInputBuf,
                     PixelFormat32bppARGB, &lockeddata);
             }
 
@@ -1267,25 +1527,11 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
 
         if (stat == Ok)
         {
-            REAL x_dx = draw_points[1].X - draw_points[0].X;
-            REAL x_dy = draw_points[1].Y - draw_points[0].Y;
-            REAL y_dx = draw_points[2].X - draw_points[0].X;
-            REAL y_dy = draw_points[2].Y - draw_points[0].Y;
-
-            for (y=0; y<fill_area->Height; y++)
-            {
-                for (x=0; x<fill_area->Width; x++)
-                {
-                    GpPointF point;
-                    point.X = draw_points[0].X + x * x_dx + y * y_dx;
-                    point.Y = draw_points[0].Y + y * x_dy + y * y_dy;
-
-                    argb_pixels[x + y*cdwStride] = resample_bitmap_pixel(
-                        &src_area, fill->bitmap_bits, bitmap->width, bitmap->height,
-                        &point, fill->imageattributes, graphics->interpolation,
-                        graphics->pixeloffset);
-                }
-            }
+            context->origin = draw_points[0];
+            context->x_dx = draw_points[1].X - draw_points[0].X;
+            context->x_dy = draw_points[1].Y - draw_points[0].Y;
+            context->y_dx = draw_points[2].X - draw_points[0].X;
+            context->y_dy = draw_points[2].Y - draw_points[0].Y;
         }
 
         return stat;
@@ -1299,10 +1545,7 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
         int i, figure_start=0;
         GpPointF start_point, end_point, center_point;
         BYTE type;
-        REAL min_yf, max_yf, line1_xf, line2_xf;
-        INT min_y, max_y, min_x, max_x;
-        INT x, y;
-        ARGB outer_color;
+        REAL min_yf, max_yf;
         static BOOL transform_fixme_once;
 
         if (fill->focus.X != 0.0 || fill->focus.Y != 0.0)
@@ -1365,19 +1608,24 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
                 stat = GdipFlattenPath(flat_path, NULL, 0.5);
         }
 
+        if (stat == Ok && flat_path->pathdata.Count)
+        {
+            context->edges = heap_alloc(flat_path->pathdata.Count * sizeof(*context->edges));
+            if (!context->edges)
+                stat = OutOfMemory;
+        }
+
         if (stat != Ok)
         {
             GdipDeletePath(flat_path);
             return stat;
         }
 
+        context->center_point = center_point;
+
         for (i=0; i<flat_path->pathdata.Count; i++)
         {
-            int start_center_line=0, end_center_line=0;
-            BOOL seen_start = FALSE, seen_end = FALSE, seen_center = FALSE;
-            REAL center_distance;
-            ARGB start_color, end_color;
-            REAL dy, dx;
+            struct path_gradient_edge *edge = &context->edges[context->edge_count];
 
             type = flat_path->pathdata.Types[i];
 
@@ -1386,128 +1634,256 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
 
             start_point = flat_path->pathdata.Points[i];
 
-            start_color = fill->surroundcolors[min(i, fill->surroundcolorcount-1)];
+            edge->start_color = fill->surroundcolors[min(i, fill->surroundcolorcount-1)];
 
             if ((type&PathPointTypeCloseSubpath) == PathPointTypeCloseSubpath || i+1 >= flat_path->pathdata.Count)
             {
                 end_point = flat_path->pathdata.Points[figure_start];
-                end_color = fill->surroundcolors[min(figure_start, fill->surroundcolorcount-1)];
+                edge->end_color = fill->surroundcolors[min(figure_start, fill->surroundcolorcount-1)];
             }
             else if ((flat_path->pathdata.Types[i+1] & PathPointTypePathTypeMask) == PathPointTypeLine)
             {
                 end_point = flat_path->pathdata.Points[i+1];
-                end_color = fill->surroundcolors[min(i+1, fill->surroundcolorcount-1)];
+                edge->end_color = fill->surroundcolors[min(i+1, fill->surroundcolorcount-1)];
             }
             else
                 continue;
 
-            outer_color = start_color;
+            edge->start_point = start_point;
+            edge->end_point = end_point;
 
             min_yf = center_point.Y;
             if (min_yf > start_point.Y) min_yf = start_point.Y;
             if (min_yf > end_point.Y) min_yf = end_point.Y;
 
             if (min_yf < fill_area->Y)
-                min_y = fill_area->Y;
+                edge->min_y = fill_area->Y;
             else
-                min_y = (INT)ceil(min_yf);
+                edge->min_y = (INT)ceil(min_yf);
 
             max_yf = center_point.Y;
             if (max_yf < start_point.Y) max_yf = start_point.Y;
             if (max_yf < end_point.Y) max_yf = end_point.Y;
 
             if (max_yf > fill_area->Y + fill_area->Height)
-                max_y = fill_area->Y + fill_area->Height;
+                edge->max_y = fill_area->Y + fill_area->Height;
             else
-                max_y = (INT)ceil(max_yf);
+                edge->max_y = (INT)ceil(max_yf);
 
-            dy = end_point.Y - start_point.Y;
-            dx = end_point.X - start_point.X;
+            edge->dy = end_point.Y - start_point.Y;
+            edge->dx = end_point.X - start_point.X;
 
             /* This is proportional to the distance from start-end line to center point. */
-            center_distance = dy * (start_point.X - center_point.X) +
-                dx * (center_point.Y - start_point.Y);
+            edge->center_distance = edge->dy * (start_point.X - center_point.X) +
+                edge->dx * (center_point.Y - start_point.Y);
+
+            context->edge_count++;
+        }
+
+        GdipDeletePath(flat_path);
+        return Ok;
+    }
+    default:
+        return NotImplemented;
+    }
+}
+
+static void free_brush_fill_context(brush_fill_context *context)
+{
+    heap_free(context->edges);
+}
+
+static void path_gradient_fill_span(const brush_fill_context *context,
+    DWORD *argb_pixels, INT x, INT y, INT count)
+{
+    GpPathGradient *fill = (GpPathGradient*)context->brush;
+    const GpPointF *center_point = &context->center_point;
+    REAL yf = (REAL)y;
+    INT i, min_x, max_x;
 
-            for (y=min_y; y<max_y; y++)
+    memset(argb_pixels, 0, count * sizeof(*argb_pixels));
+
+    /* Each edge fills the triangle between it and the center point; later
+     * edges take precedence where they overlap. */
+    for (i=0; i<context->edge_count; i++)
+    {
+        const struct path_gradient_edge *edge = &context->edges[i];
+        const GpPointF *start_point = &edge->start_point, *end_point = &edge->end_point;
+        BOOL start_center_line, end_center_line;
+        REAL line1_xf, line2_xf;
+        ARGB outer_color = edge->start_color;
+        INT px;
+
+        if (y < edge->min_y || y >= edge->max_y)
+            continue;
+
+        start_center_line = (yf >= start_point->Y) ^ (yf >= center_point->Y);
+        end_center_line = (yf >= end_point->Y) ^ (yf >= center_point->Y);
+
+        if (start_center_line)
+            line1_xf = intersect_line_scanline(start_point, center_point, yf);
+        else
+            line1_xf = intersect_line_scanline(start_point, end_point, yf);
+
+        if (end_center_line)
+            line2_xf = intersect_line_scanline(end_point, center_point, yf);
+        else
+            line2_xf = intersect_line_scanline(start_point, end_point, yf);
+
+        if (line1_xf < line2_xf)
+        {
+            min_x = (INT)ceil(line1_xf);
+            max_x = (INT)ceil(line2_xf);
+        }
+        else
+        {
+            min_x = (INT)ceil(line2_xf);
+            max_x = (INT)ceil(line1_xf);
+        }
+
+        if (min_x < context->fill_area.X)
+            min_x = context->fill_area.X;
+        if (max_x > context->fill_area.X + context->fill_area.Width)
+            max_x = context->fill_area.X + context->fill_area.Width;
+        if (min_x < x)
+            min_x = x;
+        if (max_x > x + count)
+            max_x = x + count;
+
+        for (px=min_x; px<max_x; px++)
+        {
+            REAL xf = (REAL)px;
+            REAL distance;
+
+            if (edge->start_color != edge->end_color)
             {
-                REAL yf = (REAL)y;
+                REAL blend_amount, pdy, pdx;
+                pdy = yf - center_point->Y;
+                pdx = xf - center_point->X;
+                blend_amount = ( (center_point->Y - start_point->Y) * pdx + (start_point->X - center_point->X) * pdy ) / ( edge->dy * pdx - edge->dx * pdy );
+                outer_color = blend_colors(edge->start_color, edge->end_color, blend_amount);
+            }
 
-                if (!seen_start && yf >= start_point.Y)
-                {
-                    seen_start = TRUE;
-                    start_center_line ^= 1;
-                }
-                if (!seen_end && yf >= end_point.Y)
-                {
-                    seen_end = TRUE;
-                    end_center_line ^= 1;
-                }
-                if (!seen_center && yf >= center_point.Y)
-                {
-                    seen_center = TRUE;
-                    start_center_line ^= 1;
-                    end_center_line ^= 1;
-                }
+            distance = (end_point->Y - start_point->Y) * (start_point->X - xf) +
+                (end_point->X - start_point->X) * (yf - start_point->Y);
 
-                if (start_center_line)
-                    line1_xf = intersect_line_scanline(&start_point, &center_point, yf);
-                else
-                    line1_xf = intersect_line_scanline(&start_point, &end_point, yf);
+            distance = distance / edge->center_distance;
 
-                if (end_center_line)
-                    line2_xf = intersect_line_scanline(&end_point, &center_point, yf);
-                else
-                    line2_xf = intersect_line_scanline(&start_point, &end_point, yf);
+            argb_pixels[px - x] = blend_colors(outer_color, fill->centercolor, distance);
+        }
+    }
+}
 
-                if (line1_xf < line2_xf)
-                {
-                    min_x = (INT)ceil(line1_xf);
-                    max_x = (INT)ceil(line2_xf);
-                }
-                else
-                {
-                    min_x = (INT)ceil(line2_xf);
-                    max_x = (INT)ceil(line1_xf);
-                }
+/* Generates count pixels of the brush starting at device position x, y,
+ * which must lie within the context's fill area. */
+static void brush_fill_span(const brush_fill_context *context, DWORD *argb_pixels,
+    INT x, INT y, INT count)
+{
+    INT rx = x - context->fill_area.X, ry = y - context->fill_area.Y;
+    INT i;
 
-                if (min_x < fill_area->X)
-                    min_x = fill_area->X;
-                if (max_x > fill_area->X + fill_area->Width)
-                    max_x = fill_area->X + fill_area->Width;
+    switch (context->brush->bt)
+    {
+    case BrushTypeSolidColor:
+    {
+        ARGB color = ((GpSolidFill*)context->brush)->color;
 
-                for (x=min_x; x<max_x; x++)
-                {
-                    REAL xf = (REAL)x;
-                    REAL distance;
+        for (i=0; i<count; i++)
+            argb_pixels[i] = color;
+        break;
+    }
+    case BrushTypeHatchFill:
+    {
+        GpHatch *fill = (GpHatch*)context->brush;
+        BYTE hatch_row;
+        int hx, hy;
 
-                    if (start_color != end_color)
-                    {
-                        REAL blend_amount, pdy, pdx;
-                        pdy = yf - center_point.Y;
-                        pdx = xf - center_point.X;
-                        blend_amount = ( (center_point.Y - start_point.Y) * pdx + (start_point.X - center_point.X) * pdy ) / ( dy * pdx - dx * pdy );
-                        outer_color = blend_colors(start_color, end_color, blend_amount);
-                    }
+        /* FIXME: Account for the rendering origin */
+        hy = (ry + context->fill_area.Y) % 8;
+        hatch_row = context->hatch_data[7-hy];
 
-                    distance = (end_point.Y - start_point.Y) * (start_point.X - xf) +
-                        (end_point.X - start_point.X) * (yf - start_point.Y);
+        for (i=0; i<count; i++)
+        {
+            hx = (rx + i + context->fill_area.X) % 8;
 
-                    distance = distance / center_distance;
+            if ((hatch_row & (0x80 >> hx)) != 0)
+                argb_pixels[i] = fill->forecol;
+            else
+                argb_pixels[i] = fill->backcol;
+        }
+        break;
+    }
+    case BrushTypeLinearGradient:
+    {
+        GpLineGradient *fill = (GpLineGradient*)context->brush;
 
-                    argb_pixels[(x-fill_area->X) + (y-fill_area->Y)*cdwStride] =
-                        blend_colors(outer_color, fill->centercolor, distance);
-                }
+        for (i=0; i<count; i++)
+        {
+            REAL pos = context->origin.X + (rx + i) * context->x_dx + ry * context->y_dx;
+
+            if (context->use_gradient_colors)
+            {
+                INT index;
+
+                pos = wrap_line_gradient_position(fill, pos);
+                index = gdip_round(pos * 0xff);
+                if (index >= 0 && index <= 0xff)
+                    argb_pixels[i] = context->gradient_colors[index];
+                else
+                    argb_pixels[i] = blend_colors(fill->startcolor, fill->endcolor, pos);
             }
+            else
+                argb_pixels[i] = blend_line_gradient(fill, pos);
         }
+        break;
+    }
+    case BrushTypeTextureFill:
+    {
+        GpTexture *fill = (GpTexture*)context->brush;
+        GpBitmap *bitmap = (GpBitmap*)fill->image;
 
-        GdipDeletePath(flat_path);
-        return stat;
+        for (i=0; i<count; i++)
+        {
+            GpPointF point;
+            point.X = context->origin.X + (rx + i) * context->x_dx + ry * context->y_dx;
+            point.Y = context->origin.Y + (rx + i) * context->x_dy + ry * context->y_dy;
+
+            argb_pixels[i] = resample_bitmap_pixel(
+                &context->src_area, fill->bitmap_bits, bitmap->width, bitmap->height,
+                &point, fill->imageattributes, context->interpolation,
+                context->offset_mode);
+        }
+        break;
     }
+    case BrushTypePathGradient:
+        path_gradient_fill_span(context, argb_pixels, x, y, count);
+        break;
     default:
-        return NotImplemented;
+        break;
     }
 }
 
+static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
+    DWORD *argb_pixels, GpRect *fill_area, UINT cdwStride)
+{
+    brush_fill_context context;
+    GpStatus stat;
+    int y;
+
+    stat = init_brush_fill_context(&context, graphics, brush, fill_area);
+
+    if (stat == Ok)
+    {
+        for (y=0; y<fill_area->Height; y++)
+            brush_fill_span(&context, argb_pixels + y*cdwStride,
+                fill_area->X, fill_area->Y + y, fill_area->Width);
+    }
+
+    free_brush_fill_context(&context);
+
+    return stat;
+}
+
 /* Draws the linecap the specified color and size on the hdc.  The linecap is in
  * direction of the line from x1, y1 to x2, y2 and is anchored on x2, y2. Probably
  * should not be called on an hdc that has a path you care about. */
@@ -2835,6 +3211,53 @@ static BOOL CALLBACK play_metafile_proc(EmfPlusRecordType record_type, unsigned
     return TRUE;
 }
 
+struct resample_params
+{
+    GpPointF origin;
+    REAL x_dx, x_dy, y_dx, y_dy;
+    const RECT *dst_area;
+    BYTE *dst_data;
+    INT dst_stride;
+    GpRectF src_rect;
+    const GpRect *src_area;
+    BYTE *src_data;
+    GpBitmap *bitmap;
+    const GpImageAttributes *attributes;
+    InterpolationMode interpolation;
+    PixelOffsetMode offset_mode;
+    INT band_height;
+};
+
+static void resample_band(void *param, INT band)
+{
+    const struct resample_params *params = param;
+    const GpRectF *src_rect = &params->src_rect;
+    INT top = params->dst_area->top + band * params->band_height;
+    INT bottom = min(top + params->band_height, params->dst_area->bottom);
+    INT x, y;
+
+    for (y=top; y<bottom; y++)
+    {
+        ARGB *dst_color = (ARGB*)(params->dst_data + params->dst_stride * (y - params->dst_area->top));
+
+        for (x=params->dst_area->left; x<params->dst_area->right; x++, dst_color++)
+        {
+            GpPointF src_pointf;
+
+            src_pointf.X = params->origin.X + x * params->x_dx + y * params->y_dx;
+            src_pointf.Y = params->origin.Y + x * params->x_dy + y * params->y_dy;
+
+            if (src_pointf.X >= src_rect->X && src_pointf.X < src_rect->X + src_rect->Width &&
+                src_pointf.Y >= src_rect->Y && src_pointf.Y < src_rect->Y + src_rect->Height)
+                *dst_color = resample_bitmap_pixel(params->src_area, params->src_data,
+                    params->bitmap->width, params->bitmap->height, &src_pointf,
+                    params->attributes, params->interpolation, params->offset_mode);
+            else
+                *dst_color = 0;
+        }
+    }
+}
+
 GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image,
      GDIPCONST GpPointF *points, INT count, REAL srcx, REAL srcy, REAL srcwidth,
      REAL srcheight, GpUnit srcUnit, GDIPCONST GpImageAttributes* imageAttributes,
@@ -2940,7 +3363,8 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
             RECT dst_area;
             GpRectF graphics_bounds;
             GpRect src_area;
-            int i, x, y, src_stride, dst_stride;
+            int i, src_stride, dst_stride, band_count;
+            struct resample_params params;
             GpMatrix dst_to_src;
             REAL m11, m12, m21, m22, mdx, mdy;
             LPBYTE src_data, dst_data, dst_dyn_data=NULL;
@@ -3054,25 +3478,29 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
                 y_dx = dst_to_src_points[2].X - dst_to_src_points[0].X;
                 y_dy = dst_to_src_points[2].Y - dst_to_src_points[0].Y;
 
-                for (x=dst_area.left; x<dst_area.right; x++)
-                {
-                    for (y=dst_area.top; y<dst_area.bottom; y++)
-                    {
-                        GpPointF src_pointf;
-                        ARGB *dst_color;
-
-                        src_pointf.X = dst_to_src_points[0].X + x * x_dx + y * y_dx;
-                        src_pointf.Y = dst_to_src_points[0].Y + x * x_dy + y * y_dy;
-
-                        dst_color = (ARGB*)(dst_data + dst_stride * (y - dst_area.top) + sizeof(ARGB) * (x - dst_area.left));
-
-                        if (src_pointf.X >= srcx && src_pointf.X < srcx + srcwidth && src_pointf.Y >= srcy && src_pointf.Y < srcy+srcheight)
-                            *dst_color = resample_bitmap_pixel(&src_area, src_data, bitmap->width, bitmap->height, &src_pointf,
-                                                               imageAttributes, interpolation, offset_mode);
-                        else
-                            *dst_color = 0;
-                    }
-                }
+                params.origin = dst_to_src_points[0];
+                params.x_dx = x_dx;
+                params.x_dy = x_dy;
+                params.y_dx = y_dx;
+                params.y_dy = y_dy;
+                params.dst_area = &dst_area;
+                params.dst_data = dst_data;
+                params.dst_stride = dst_stride;
+                params.src_rect.X = srcx;
+                params.src_rect.Y = srcy;
+                params.src_rect.Width = srcwidth;
+                params.src_rect.Height = srcheight;
+                params.src_area = &src_area;
+                params.src_data = src_data;
+                params.bitmap = bitmap;
+                params.attributes = imageAttributes;
+                params.interpolation = interpolation;
+                params.offset_mode = offset_mode;
+
+                band_count = get_band_count(dst_area.right - dst_area.left, dst_area.bottom - dst_area.top);
+                params.band_height = (dst_area.bottom - dst_area.top + band_count - 1) / band_count;
+
+                run_bands(resample_band, &params, band_count);
             }
             else
             {
@@ -3970,6 +4398,106 @@ static GpStatus GDI32_GdipFillRegion(GpGraphics* graphics, GpBrush* brush,
     return Ok;
 }
 
+struct fill_region_params
+{
+    const brush_fill_context *context;
+    GpBitmap *bitmap;
+    const RECT *rects;
+    DWORD rect_count;
+    INT top, band_height;
+    DWORD *spans;
+    INT span_width;
+};
+
+static void fill_region_band(void *param, INT band)
+{
+    const struct fill_region_params *params = param;
+    INT band_top = params->top + band * params->band_height;
+    INT band_bottom = band_top + params->band_height;
+    DWORD *span = params->spans + band * params->span_width;
+    DWORD i, lo = 0, hi = params->rect_count;
+    INT y;
+
+    /* Region rectangles are sorted by their top edge, and rectangles in the
+     * same row share their bottom edge, so the bottom edges are sorted too.
+     * Start at the first rectangle reaching into the band. */
+    while (lo < hi)
+    {
+        i = (lo + hi) / 2;
+        if (params->rects[i].bottom <= band_top)
+            lo = i + 1;
+        else
+            hi = i;
+    }
+
+    for (i=lo; i<params->rect_count; i++)
+    {
+        const RECT *rect = &params->rects[i];
+        INT width = rect->right - rect->left;
+
+        if (rect->top >= band_bottom)
+            break;
+
+        for (y=max(rect->top, band_top); y<min(rect->bottom, band_bottom); y++)
+        {
+            brush_fill_span(params->context, span, rect->left, y, width);
+            alpha_blend_bmp_span(params->bitmap, rect->left, y, span, width,
+                PixelFormat32bppARGB);
+        }
+    }
+}
+
+/* Fill the visible part of hregion on a bitmap, generating brush pixels
+ * only for the spans that are drawn. */
+static GpStatus fill_region_bitmap(GpGraphics *graphics, GpBrush *brush,
+    HRGN hregion, GpRect *bound_rect)
+{
+    struct fill_region_params params;
+    brush_fill_context context;
+    RGNDATA *rgndata;
+    INT band_count;
+    GpStatus stat;
+
+    stat = get_visible_region_data(graphics, bound_rect->X, bound_rect->Y,
+        bound_rect->Width, bound_rect->Height, hregion, &rgndata);
+    if (stat != Ok)
+        return stat;
+
+    stat = init_brush_fill_context(&context, graphics, brush, bound_rect);
+
+    if (stat == Ok && rgndata->rdh.nCount)
+    {
+        params.context = &context;
+        params.bitmap = (GpBitmap*)graphics->image;
+        params.rects = (RECT*)rgndata->Buffer;
+        params.rect_count = rgndata->rdh.nCount;
+        params.top = rgndata->rdh.rcBound.top;
+        params.span_width = rgndata->rdh.rcBound.right - rgndata->rdh.rcBound.left;
+
+        params.band_height = rgndata->rdh.rcBound.bottom - rgndata->rdh.rcBound.top;
+        band_count = 1;
+        if (is_direct_blend_format(params.bitmap->format))
+        {
+            band_count = get_band_count(params.span_width, params.band_height);
+            params.band_height = (params.band_height + band_count - 1) / band_count;
+        }
+
+        params.spans = heap_alloc(sizeof(DWORD) * params.span_width * band_count);
+        if (params.spans)
+        {
+            run_bands(fill_region_band, &params, band_count);
+            heap_free(params.spans);
+        }
+        else
+            stat = OutOfMemory;
+    }
+
+    free_brush_fill_context(&context);
+    heap_free(rgndata);
+
+    return stat;
+}
+
 static GpStatus SOFTWARE_GdipFillRegion(GpGraphics *graphics, GpBrush *brush,
     GpRegion* region)
 {
@@ -4020,6 +4548,13 @@ static GpStatus SOFTWARE_GdipFillRegion(GpGraphics *graphics, GpBrush *brush,
         gp_bound_rect.Width = bound_rect.right - bound_rect.left;
         gp_bound_rect.Height = bound_rect.bottom - bound_rect.top;
 
+        if (graphics->image && graphics->image->type == ImageTypeBitmap)
+        {
+            stat = fill_region_bitmap(graphics, brush, hregion, &gp_bound_rect);
+            DeleteObject(hregion);
+            return stat;
+        }
+
         pixel_data = heap_alloc_zero(sizeof(*pixel_data) * gp_bound_rect.Width * gp_bound_rect.Height);
         if (!pixel_data)
             stat = OutOfMemory;
@@ -5786,6 +5786,207 @@ static void test_GdipFillRectangles(void)
     ReleaseDC(hwnd, hdc);
 }
 
+static void test_fill_large_bitmap(void)
+{
+    static const GpPoint start = {0, 0}, end = {512, 0};
+    static const GpPoint square[4] = {{0, 0}, {512, 0}, {512, 512}, {0, 512}};
+    static const struct
+    {
+        REAL matrix[4];
+        REAL inverse[4];
+    } transforms[] =
+    {
+        /* rotated by 90 degrees */
+        {{0.0, 1.0, -1.0, 0.0}, {0.0, -1.0, 1.0, 0.0}},
+        /* sheared, x steps down the texture */
+        {{1.0, 1.0, 0.0, 1.0}, {1.0, -1.0, 0.0, 1.0}},
+    };
+    ARGB surround = 0xff000000;
+    GpStatus status;
+    GpGraphics *graphics;
+    GpBitmap *bitmap, *texture_bitmap;
+    GpBrush *brush;
+    GpMatrix *matrix;
+    GpRect rect = {0, 0, 512, 512};
+    BitmapData data;
+    ARGB color, mirrored, transposed;
+    DWORD *row, *first_row;
+    int x, y, count;
+    unsigned int i;
+
+    /* Large enough for the fill to be split into bands. */
+    status = GdipCreateBitmapFromScan0(512, 512, 0, PixelFormat32bppPARGB, NULL, &bitmap);
+    expect(Ok, status);
+    status = GdipGetImageGraphicsContext((GpImage*)bitmap, &graphics);
+    expect(Ok, status);
+
+    status = GdipCreateSolidFill(0x80ff0000, (GpSolidFill**)&brush);
+    expect(Ok, status);
+    status = GdipFillRectangleI(graphics, brush, 0, 0, 512, 512);
+    expect(Ok, status);
+    GdipDeleteBrush(brush);
+
+    status = GdipBitmapGetPixel(bitmap, 0, 0, &color);
+    expect(Ok, status);
+    ok(color == 0x80ff0000, "got %08x\n", color);
+    status = GdipBitmapGetPixel(bitmap, 300, 256, &color);
+    expect(Ok, status);
+    ok(color == 0x80ff0000, "got %08x\n", color);
+    status = GdipBitmapGetPixel(bitmap, 511, 511, &color);
+    expect(Ok, status);
+    ok(color == 0x80ff0000, "got %08x\n", color);
+
+    GdipDeleteGraphics(graphics);
+    GdipDisposeImage((GpImage*)bitmap);
+
+    status = GdipCreateBitmapFromScan0(512, 512, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    expect(Ok, status);
+    status = GdipGetImageGraphicsContext((GpImage*)bitmap, &graphics);
+    expect(Ok, status);
+
+    status = GdipCreateLineBrushI(&start, &end, 0xff000000, 0xffffffff, WrapModeTile,
+        (GpLineGradient**)&brush);
+    expect(Ok, status);
+    status = GdipFillRectangleI(graphics, brush, 0, 0, 512, 512);
+    expect(Ok, status);
+    GdipDeleteBrush(brush);
+
+    status = GdipBitmapLockBits(bitmap, &rect, ImageLockModeRead, PixelFormat32bppARGB, &data);
+    expect(Ok, status);
+
+    /* A horizontal gradient is the same on every row, and gets lighter to the right. */
+    first_row = data.Scan0;
+    ok((first_row[0] & 0xff) < 0x10, "got %08x\n", first_row[0]);
+    ok((first_row[511] & 0xff) > 0xf0, "got %08x\n", first_row[511]);
+    for (x = 1; x < 512; x++)
+        if ((first_row[x] & 0xff) < (first_row[x - 1] & 0xff)) break;
+    ok(x == 512, "gradient decreases at %d\n", x);
+
+    for (y = 1; y < 512; y++)
+    {
+        row = (DWORD*)((BYTE*)data.Scan0 + data.Stride * y);
+        if (memcmp(row, first_row, 512 * sizeof(DWORD))) break;
+    }
+    ok(y == 512, "row %d differs\n", y);
+
+    status = GdipBitmapUnlockBits(bitmap, &data);
+    expect(Ok, status);
+
+    GdipDeleteGraphics(graphics);
+    GdipDisposeImage((GpImage*)bitmap);
+
+    /* Texture brushes that aren't axis aligned step through the texture in
+     * both directions along a row and down a column. */
+    status = GdipCreateBitmapFromScan0(16, 16, 0, PixelFormat32bppARGB, NULL, &texture_bitmap);
+    expect(Ok, status);
+    for (y = 0; y < 16; y++)
+        for (x = 0; x < 16; x++)
+        {
+            status = GdipBitmapSetPixel(texture_bitmap, x, y, (x < 8) != (y < 8) ? 0xffffffff : 0xff000000);
+            expect(Ok, status);
+        }
+
+    for (i = 0; i < sizeof(transforms) / sizeof(transforms[0]); i++)
+    {
+        const REAL *m = transforms[i].matrix, *inv = transforms[i].inverse;
+        int mismatches = 0;
+
+        status = GdipCreateBitmapFromScan0(512, 512, 0, PixelFormat32bppARGB, NULL, &bitmap);
+        expect(Ok, status);
+        status = GdipGetImageGraphicsContext((GpImage*)bitmap, &graphics);
+        expect(Ok, status);
+
+        status = GdipCreateTexture((GpImage*)texture_bitmap, WrapModeTile, (GpTexture**)&brush);
+        expect(Ok, status);
+        status = GdipCreateMatrix2(m[0], m[1], m[2], m[3], 0.0, 0.0, &matrix);
+        expect(Ok, status);
+        status = GdipSetTextureTransform((GpTexture*)brush, matrix);
+        expect(Ok, status);
+        GdipDeleteMatrix(matrix);
+        status = GdipFillRectangleI(graphics, brush, 0, 0, 512, 512);
+        expect(Ok, status);
+        GdipDeleteBrush(brush);
+
+        status = GdipBitmapLockBits(bitmap, &rect, ImageLockModeRead, PixelFormat32bppARGB, &data);
+        expect(Ok, status);
+
+        for (y = 0; y < 512; y += 7)
+        {
+            row = (DWORD*)((BYTE*)data.Scan0 + data.Stride * y);
+            for (x = 0; x < 512; x += 7)
+            {
+                REAL tx = inv[0] * x + inv[2] * y, ty = inv[1] * x + inv[3] * y;
+                REAL cell_x, cell_y;
+                DWORD expected;
+
+                /* position within the 16x16 tile, away from the cell edges */
+                tx -= 16.0 * floor(tx / 16.0);
+                ty -= 16.0 * floor(ty / 16.0);
+                cell_x = tx - 8.0 * floor(tx / 8.0);
+                cell_y = ty - 8.0 * floor(ty / 8.0);
+                if (cell_x < 2.0 || cell_x > 6.0 || cell_y < 2.0 || cell_y > 6.0) continue;
+
+                expected = (tx < 8.0) != (ty < 8.0) ? 0xffffffff : 0xff000000;
+                if (row[x] != expected && !mismatches++)
+                    ok(0, "%u: got %08x at (%d,%d), expected %08x\n", i, row[x], x, y, expected);
+            }
+        }
+        ok(!mismatches, "%u: %d pixels differ\n", i, mismatches);
+
+        status = GdipBitmapUnlockBits(bitmap, &data);
+        expect(Ok, status);
+
+        GdipDeleteGraphics(graphics);
+        GdipDisposeImage((GpImage*)bitmap);
+    }
+
+    GdipDisposeImage((GpImage*)texture_bitmap);
+
+    /* A path gradient over the whole bitmap is symmetric across rows and
+     * columns, whichever band a pixel was generated in. */
+    status = GdipCreateBitmapFromScan0(512, 512, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    expect(Ok, status);
+    status = GdipGetImageGraphicsContext((GpImage*)bitmap, &graphics);
+    expect(Ok, status);
+
+    status = GdipCreatePathGradientI(square, 4, WrapModeClamp, (GpPathGradient**)&brush);
+    expect(Ok, status);
+    status = GdipSetPathGradientCenterColor((GpPathGradient*)brush, 0xffffffff);
+    expect(Ok, status);
+    count = 1;
+    status = GdipSetPathGradientSurroundColorsWithCount((GpPathGradient*)brush, &surround, &count);
+    expect(Ok, status);
+    status = GdipFillRectangleI(graphics, brush, 0, 0, 512, 512);
+    expect(Ok, status);
+    GdipDeleteBrush(brush);
+
+    status = GdipBitmapGetPixel(bitmap, 256, 256, &color);
+    expect(Ok, status);
+    ok((color & 0xff) > 0xf0, "got %08x\n", color);
+    status = GdipBitmapGetPixel(bitmap, 1, 256, &color);
+    expect(Ok, status);
+    ok((color & 0xff) < 0x10, "got %08x\n", color);
+
+    for (y = 1; y < 512; y += 5)
+    {
+        for (x = 1; x < 512; x += 5)
+        {
+            GdipBitmapGetPixel(bitmap, x, y, &color);
+            GdipBitmapGetPixel(bitmap, 512 - x, y, &mirrored);
+            GdipBitmapGetPixel(bitmap, y, x, &transposed);
+            if (abs((int)(color & 0xff) - (int)(mirrored & 0xff)) > 2 ||
+                abs((int)(color & 0xff) - (int)(transposed & 0xff)) > 2)
+                break;
+        }
+        if (x < 512) break;
+    }
+    ok(y >= 512, "got %08x at (%d,%d), %08x mirrored, %08x transposed\n",
+       color, x, y, mirrored, transposed);
+
+    GdipDeleteGraphics(graphics);
+    GdipDisposeImage((GpImage*)bitmap);
+}
+
 static void test_GdipGetVisibleClipBounds_memoryDC(void)
 {
     HDC hdc,dc;
@@ -5913,6 +6114,7 @@ START_TEST(graphics)
     test_alpha_hdc();
     test_bitmapfromgraphics();
     test_GdipFillRectangles();
+    test_fill_large_bitmap();
     test_GdipGetVisibleClipBounds_memoryDC();
 
     GdiplusShutdown(gdiplusToken);
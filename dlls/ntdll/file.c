@@ -227,6 +227,8 @@ static NTSTATUS FILE_CreateFile( PHANDLE handle, ACCESS_MASK access, POBJECT_ATT
         OBJECT_ATTRIBUTES unix_attr = *attr;
         data_size_t len;
         struct object_attributes *objattr;
+        sigset_t sigset;
+        BOOL want_fd;
 
         unix_attr.ObjectName = &empty_string;  /* we send the unix name instead */
         if ((io->u.Status = alloc_object_attributes( &unix_attr, &objattr, &len )))
@@ -235,6 +237,10 @@ static NTSTATUS FILE_CreateFile( PHANDLE handle, ACCESS_MASK access, POBJECT_ATT
             return io->u.Status;
         }
 
+        /* if the file is opened for i/o, have its unix fd sent along with the handle */
+        want_fd = (access & (FILE_READ_DATA | FILE_WRITE_DATA | FILE_APPEND_DATA |
+                             GENERIC_READ | GENERIC_WRITE | GENERIC_ALL)) != 0;
+        if (want_fd) server_enter_fd_cache_section( &sigset );
         SERVER_START_REQ( create_file )
         {
             req->access     = access;
@@ -242,12 +248,16 @@ static NTSTATUS FILE_CreateFile( PHANDLE handle, ACCESS_MASK access, POBJECT_ATT
             req->create     = disposition;
             req->options    = options;
             req->attrs      = attributes;
+            req->want_fd    = want_fd;
             wine_server_add_data( req, objattr, len );
             wine_server_add_data( req, unix_name.Buffer, unix_name.Length );
             io->u.Status = wine_server_call( req );
             *handle = wine_server_ptr_handle( reply->handle );
+            if (!io->u.Status && reply->type != FD_TYPE_INVALID)
+                server_cache_handle_fd( *handle, reply->type, reply->access, reply->options );
         }
         SERVER_END_REQ;
+        if (want_fd) server_leave_fd_cache_section( &sigset );
         RtlFreeHeap( GetProcessHeap(), 0, objattr );
         RtlFreeAnsiString( &unix_name );
     }
@@ -94,6 +94,11 @@ extern unsigned int server_select( const select_op_t *select_op, data_size_t siz
                                    UINT flags, const LARGE_INTEGER *timeout ) DECLSPEC_HIDDEN;
 extern unsigned int server_queue_process_apc( HANDLE process, const apc_call_t *call, apc_result_t *result ) DECLSPEC_HIDDEN;
 extern int server_remove_fd_from_cache( HANDLE handle ) DECLSPEC_HIDDEN;
+extern void server_enter_fd_cache_section( sigset_t *sigset ) DECLSPEC_HIDDEN;
+extern void server_leave_fd_cache_section( sigset_t *sigset ) DECLSPEC_HIDDEN;
+extern void server_prefetch_handle_fds(void) DECLSPEC_HIDDEN;
+extern void server_cache_handle_fd( HANDLE handle, enum server_fd_type type,
+                                    unsigned int access, unsigned int options ) DECLSPEC_HIDDEN;
 extern int server_get_unix_fd( HANDLE handle, unsigned int access, int *unix_fd,
                                int *needs_close, enum server_fd_type *type, unsigned int *options ) DECLSPEC_HIDDEN;
 extern int server_pipe( int fd[2] ) DECLSPEC_HIDDEN;
@@ -914,6 +914,80 @@ int server_remove_fd_from_cache( HANDLE handle )
 }
 
 
+/***********************************************************************
+ *           server_enter_fd_cache_section
+ *
+ * Must be held around requests that send a unix fd along with their reply.
+ */
+void server_enter_fd_cache_section( sigset_t *sigset )
+{
+    server_enter_uninterrupted_section( &fd_cache_section, sigset );
+}
+
+
+/***********************************************************************
+ *           server_leave_fd_cache_section
+ */
+void server_leave_fd_cache_section( sigset_t *sigset )
+{
+    server_leave_uninterrupted_section( &fd_cache_section, sigset );
+}
+
+
+/***********************************************************************
+ *           server_cache_handle_fd
+ *
+ * Receive the unix fd that the server sent along with a new handle and store it in the cache.
+ * Caller must hold fd_cache_section.
+ */
+void server_cache_handle_fd( HANDLE handle, enum server_fd_type type,
+                             unsigned int access, unsigned int options )
+{
+    obj_handle_t fd_handle;
+    int fd;
+
+    if ((fd = receive_fd( &fd_handle )) == -1) return;
+    assert( wine_server_ptr_handle(fd_handle) == handle );
+    if (!add_fd_to_cache( handle, fd, type, access, options )) close( fd );
+}
+
+
+/***********************************************************************
+ *           server_prefetch_handle_fds
+ *
+ * Fill the fd cache with the fds of the handles inherited at process start, so that
+ * the first I/O on each of them doesn't need a separate get_handle_fd round trip.
+ */
+void server_prefetch_handle_fds(void)
+{
+    struct handle_fd_info infos[64];
+    obj_handle_t fd_handle;
+    sigset_t sigset;
+    unsigned int i, count = 0;
+    int fd;
+
+    server_enter_uninterrupted_section( &fd_cache_section, &sigset );
+    SERVER_START_REQ( get_handle_fds )
+    {
+        wine_server_set_reply( req, infos, sizeof(infos) );
+        if (!wine_server_call( req )) count = wine_server_reply_size( reply ) / sizeof(infos[0]);
+    }
+    SERVER_END_REQ;
+
+    for (i = 0; i < count; i++)
+    {
+        HANDLE handle = wine_server_ptr_handle( infos[i].handle );
+
+        if ((fd = receive_fd( &fd_handle )) == -1) break;
+        assert( fd_handle == infos[i].handle );
+        if (get_cached_fd( handle, NULL, NULL, NULL ) != -1 ||
+            !add_fd_to_cache( handle, fd, infos[i].type, infos[i].access, infos[i].options ))
+            close( fd );
+    }
+    server_leave_uninterrupted_section( &fd_cache_section, &sigset );
+}
+
+
 /***********************************************************************
  *           server_get_unix_fd
  *
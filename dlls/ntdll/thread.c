@@ -328,6 +328,7 @@ HANDLE thread_init(void)
     if (info_size)
     {
         init_user_process_params( info_size, &exe_file );
+        server_prefetch_handle_fds();
     }
     else
     {
@@ -8488,6 +8488,53 @@ todo_wine
     DestroyWindow(parent);
 }
 
+/* Moves overlapping sibling windows around, which makes the server clip and
+ * expose regions with many rectangles.  Only timed in interactive mode. */
+static void test_overlapped_children_perf(void)
+{
+    HWND parent, children[64];
+    HRGN rgn;
+    DWORD start, elapsed;
+    int i, j, count = sizeof(children) / sizeof(children[0]);
+
+    if (!winetest_interactive)
+    {
+        skip("overlapped children benchmark, set WINETEST_INTERACTIVE to run it\n");
+        return;
+    }
+
+    parent = CreateWindowExA(0, "MainWindowClass", NULL, WS_VISIBLE | WS_CLIPCHILDREN,
+                             0, 0, 400, 400, NULL, NULL, GetModuleHandleA(0), 0);
+    ok(parent != NULL, "CreateWindowEx failed\n");
+    for (i = 0; i < count; i++)
+    {
+        children[i] = CreateWindowExA(0, "MainWindowClass", NULL,
+                                      WS_VISIBLE | WS_CHILD | WS_CLIPSIBLINGS,
+                                      (i % 8) * 40, (i / 8) * 40, 70, 70,
+                                      parent, NULL, GetModuleHandleA(0), 0);
+        ok(children[i] != NULL, "CreateWindowEx failed\n");
+    }
+    flush_events( TRUE );
+
+    start = GetTickCount();
+    for (j = 0; j < 100; j++)
+    {
+        for (i = 0; i < count; i++)
+            SetWindowPos(children[i], 0, ((i + j) % 8) * 40 + j % 13, ((i / 8 + j) % 8) * 40 + j % 7,
+                         0, 0, SWP_NOZORDER | SWP_NOACTIVATE | SWP_NOSIZE);
+        RedrawWindow(parent, NULL, NULL, RDW_INVALIDATE | RDW_ALLCHILDREN | RDW_UPDATENOW);
+    }
+    elapsed = GetTickCount() - start;
+    trace("moved %d overlapping children 100 times in %u ms\n", count, elapsed);
+
+    rgn = CreateRectRgn(0, 0, 0, 0);
+    ok(GetUpdateRgn(parent, rgn, FALSE) == NULLREGION, "parent still has an update region\n");
+    for (i = 0; i < count; i++)
+        ok(GetUpdateRgn(children[i], rgn, FALSE) == NULLREGION, "child %d still has an update region\n", i);
+    DeleteObject(rgn);
+    DestroyWindow(parent);
+}
+
 static void test_window_without_child_style(void)
 {
     HWND hwnd;
@@ -9274,6 +9321,7 @@ START_TEST(win)
     test_winregion();
     test_map_points();
     test_update_region();
+    test_overlapped_children_perf();
     test_window_without_child_style();
     test_smresult();
     test_GetMessagePos();
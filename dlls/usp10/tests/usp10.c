@@ -1824,6 +1824,83 @@ static void test_ScriptPlace(HDC hdc)
     ScriptFreeCache(&sc);
 }
 
+static void test_ScriptShapePlace_repeated(HDC hdc)
+{
+    static const WCHAR test1[] = {'r','e','p','e','a','t',0};
+    static const WCHAR test2[] = {'r','e','p','e','a','t','e','d',0};
+    /* U+2072 is unassigned, so no font has a glyph for it */
+    static const WCHAR test3[] = {'r','e',0x2072,'e','a','t',0};
+    WORD glyphs[8], glyphs2[8], logclust[8], logclust2[8];
+    SCRIPT_VISATTR attrs[8], attrs2[8];
+    int nb, nb2, widths[8], widths2[8], nitems, i;
+    GOFFSET offset[8], offset2[8];
+    SCRIPT_CACHE sc = NULL;
+    SCRIPT_ITEM items[2];
+    ABC abc, abc2;
+    HRESULT hr;
+
+    hr = ScriptItemize(test1, 6, 2, NULL, NULL, items, NULL);
+    ok(hr == S_OK, "ScriptItemize should return S_OK not %08x\n", hr);
+
+    /* same run shaped and placed again gives same results */
+    hr = ScriptShape(hdc, &sc, test1, 6, 8, &items[0].a, glyphs, logclust, attrs, &nb);
+    ok(hr == S_OK, "ScriptShape should return S_OK not %08x\n", hr);
+    hr = ScriptPlace(hdc, &sc, glyphs, nb, attrs, &items[0].a, widths, offset, &abc);
+    ok(hr == S_OK, "ScriptPlace should return S_OK not %08x\n", hr);
+
+    hr = ScriptShape(hdc, &sc, test2, 8, 8, &items[0].a, glyphs2, logclust2, attrs2, &nb2);
+    ok(hr == S_OK, "ScriptShape should return S_OK not %08x\n", hr);
+
+    memset(glyphs2, 0, sizeof(glyphs2));
+    memset(logclust2, 0, sizeof(logclust2));
+    memset(attrs2, 0, sizeof(attrs2));
+    hr = ScriptShape(NULL, &sc, test1, 6, 8, &items[0].a, glyphs2, logclust2, attrs2, &nb2);
+    ok(hr == S_OK, "ScriptShape should return S_OK not %08x\n", hr);
+    ok(nb == nb2, "got %d glyphs, expected %d\n", nb2, nb);
+    ok(!memcmp(glyphs, glyphs2, nb * sizeof(*glyphs)), "got different glyphs\n");
+    ok(!memcmp(logclust, logclust2, 6 * sizeof(*logclust)), "got different clusters\n");
+    ok(!memcmp(attrs, attrs2, nb * sizeof(*attrs)), "got different attributes\n");
+
+    memset(widths2, 0, sizeof(widths2));
+    memset(offset2, 0, sizeof(offset2));
+    memset(&abc2, 0, sizeof(abc2));
+    hr = ScriptPlace(NULL, &sc, glyphs2, nb2, attrs2, &items[0].a, widths2, offset2, &abc2);
+    ok(hr == S_OK, "ScriptPlace should return S_OK not %08x\n", hr);
+    ok(!memcmp(widths, widths2, nb * sizeof(*widths)), "got different widths\n");
+    ok(!memcmp(offset, offset2, nb * sizeof(*offset)), "got different offsets\n");
+    ok(abc.abcA == abc2.abcA && abc.abcB == abc2.abcB && abc.abcC == abc2.abcC, "got different ABC width\n");
+
+    /* glyph attributes are taken into account */
+    if (widths[0] != 0)
+    {
+        attrs2[0].fZeroWidth = 1;
+        hr = ScriptPlace(hdc, &sc, glyphs2, nb2, attrs2, &items[0].a, widths2, offset2, NULL);
+        ok(hr == S_OK, "ScriptPlace should return S_OK not %08x\n", hr);
+        ok(widths2[0] == 0, "got width %d\n", widths2[0]);
+        for (i = 1; i < nb2; i++)
+            ok(widths2[i] == widths[i], "%d: got width %d, expected %d\n", i, widths2[i], widths[i]);
+    }
+
+    /* a run with a missing glyph still needs a DC to be shaped again */
+    hr = ScriptItemize(test3, 6, 2, NULL, NULL, items, &nitems);
+    ok(hr == S_OK, "ScriptItemize should return S_OK not %08x\n", hr);
+    ok(nitems == 1, "got %d items\n", nitems);
+
+    hr = ScriptShape(hdc, &sc, test3, 6, 8, &items[0].a, glyphs, logclust, attrs, &nb);
+    ok(hr == S_OK, "ScriptShape should return S_OK not %08x\n", hr);
+    if (hr != S_OK || glyphs[logclust[2]] != 0)
+    {
+        skip("U+2072 doesn't map to glyph 0\n");
+        ScriptFreeCache(&sc);
+        return;
+    }
+
+    hr = ScriptShape(NULL, &sc, test3, 6, 8, &items[0].a, glyphs2, logclust2, attrs2, &nb2);
+    ok(hr == E_PENDING, "ScriptShape should return E_PENDING not %08x\n", hr);
+
+    ScriptFreeCache(&sc);
+}
+
 static void test_ScriptItemIzeShapePlace(HDC hdc, unsigned short pwOutGlyphs[256])
 {
     HRESULT         hr;
@@ -3653,6 +3730,7 @@ START_TEST(usp10)
     test_ScriptShape(hdc);
     test_ScriptShapeOpenType(hdc);
     test_ScriptPlace(hdc);
+    test_ScriptShapePlace_repeated(hdc);
 
     test_ScriptGetFontProperties(hdc);
     test_ScriptTextOut(hdc);
@@ -833,6 +833,204 @@ static inline BOOL set_cache_glyph_widths(SCRIPT_CACHE *psc, WORD glyph, ABC *ab
     return TRUE;
 }
 
+/* Shaping and placement results are cached for short runs, usually single words, that
+   applications like rich edit controls process again and again. Cache key holds everything
+   that affects results for a font the script cache was created for. Placement keys hold
+   glyphs followed by their full SCRIPT_GLYPHPROP, which is two WORDs per glyph. */
+#define RESULT_CACHE_MAX_LENGTH 64
+#define RESULT_CACHE_MAX_SIZE   (256 * 1024)
+
+enum result_kind
+{
+    RESULT_SHAPE,
+    RESULT_PLACE
+};
+
+typedef struct {
+    DWORD kind;
+    SCRIPT_ANALYSIS sa;
+    OPENTYPE_TAG script;
+    OPENTYPE_TAG lang;
+    INT count;
+    WORD values[3 * RESULT_CACHE_MAX_LENGTH];
+} ResultCacheKey;
+
+typedef struct {
+    struct list entry;
+    struct list lru;
+    DWORD hash;
+    DWORD key_size;
+    SIZE_T size;
+    ResultCacheKey *key;
+    BYTE *data;
+} ResultCacheEntry;
+
+static void init_result_cache(ResultCache *cache)
+{
+    unsigned int i;
+
+    for (i = 0; i < RESULT_CACHE_BUCKETS; i++)
+        list_init(&cache->buckets[i]);
+    list_init(&cache->lru);
+}
+
+static void remove_result_cache_entry(ResultCache *cache, ResultCacheEntry *entry)
+{
+    list_remove(&entry->entry);
+    list_remove(&entry->lru);
+    cache->size -= entry->size;
+    heap_free(entry);
+}
+
+static void free_result_cache(ResultCache *cache)
+{
+    ResultCacheEntry *entry, *entry2;
+
+    TRACE("%u hits, %u misses, %u bytes\n", cache->hits, cache->misses, (DWORD)cache->size);
+
+    LIST_FOR_EACH_ENTRY_SAFE(entry, entry2, &cache->lru, ResultCacheEntry, lru)
+        remove_result_cache_entry(cache, entry);
+}
+
+/* Sets up key header, returns key size for given number of values. */
+static DWORD init_result_key(ResultCacheKey *key, DWORD kind, const SCRIPT_ANALYSIS *psa,
+                             OPENTYPE_TAG script, OPENTYPE_TAG lang, INT count, INT values)
+{
+    memset(key, 0, FIELD_OFFSET(ResultCacheKey, values));
+    key->kind = kind;
+    key->sa = *psa;
+    key->script = script;
+    key->lang = lang;
+    key->count = count;
+    return FIELD_OFFSET(ResultCacheKey, values[values]);
+}
+
+static DWORD hash_result_key(const ResultCacheKey *key, DWORD size)
+{
+    const BYTE *ptr = (const BYTE *)key;
+    DWORD hash = 2166136261u;
+
+    while (size--)
+        hash = (hash ^ *ptr++) * 16777619;
+    return hash;
+}
+
+static ResultCacheEntry *find_result(ResultCache *cache, const ResultCacheKey *key, DWORD key_size, DWORD hash)
+{
+    ResultCacheEntry *entry;
+
+    LIST_FOR_EACH_ENTRY(entry, &cache->buckets[hash % RESULT_CACHE_BUCKETS], ResultCacheEntry, entry)
+    {
+        if (entry->hash == hash && entry->key_size == key_size && !memcmp(entry->key, key, key_size))
+        {
+            list_remove(&entry->lru);
+            list_add_head(&cache->lru, &entry->lru);
+            cache->hits++;
+            return entry;
+        }
+    }
+
+    cache->misses++;
+    return NULL;
+}
+
+/* Returns data buffer for a new entry, least recently used entries are evicted to keep cache size bounded. */
+static BYTE *add_result(ResultCache *cache, const ResultCacheKey *key, DWORD key_size, DWORD hash, SIZE_T data_size)
+{
+    SIZE_T key_offset = (sizeof(ResultCacheEntry) + 7) & ~7;
+    SIZE_T data_offset = (key_offset + key_size + 7) & ~7;
+    SIZE_T size = data_offset + data_size;
+    ResultCacheEntry *entry;
+
+    if (size > RESULT_CACHE_MAX_SIZE) return NULL;
+
+    while (cache->size + size > RESULT_CACHE_MAX_SIZE)
+        remove_result_cache_entry(cache, LIST_ENTRY(list_tail(&cache->lru), ResultCacheEntry, lru));
+
+    if (!(entry = heap_alloc(size))) return NULL;
+
+    entry->hash = hash;
+    entry->key_size = key_size;
+    entry->size = size;
+    entry->key = (ResultCacheKey *)((BYTE *)entry + key_offset);
+    entry->data = (BYTE *)entry + data_offset;
+    memcpy(entry->key, key, key_size);
+
+    list_add_head(&cache->buckets[hash % RESULT_CACHE_BUCKETS], &entry->entry);
+    list_add_head(&cache->lru, &entry->lru);
+    cache->size += size;
+    return entry->data;
+}
+
+/* Shaping results are stored as glyph count, glyph properties, character properties,
+   glyphs and logical clusters. */
+static inline SIZE_T get_shape_result_size(int chars, int glyphs)
+{
+    return sizeof(INT) + glyphs * (sizeof(SCRIPT_GLYPHPROP) + sizeof(WORD)) +
+           chars * (sizeof(SCRIPT_CHARPROP) + sizeof(WORD));
+}
+
+static inline int get_shape_result_glyph_count(const ResultCacheEntry *entry)
+{
+    return *(const INT *)entry->data;
+}
+
+static void get_shape_result(const ResultCacheEntry *entry, int chars, WORD *logclust, SCRIPT_CHARPROP *charprops,
+                             WORD *glyphs, SCRIPT_GLYPHPROP *glyphprops, int *glyph_count)
+{
+    const BYTE *ptr = entry->data;
+
+    *glyph_count = *(const INT *)ptr;
+    ptr += sizeof(INT);
+    memcpy(glyphprops, ptr, *glyph_count * sizeof(*glyphprops));
+    ptr += *glyph_count * sizeof(*glyphprops);
+    memcpy(charprops, ptr, chars * sizeof(*charprops));
+    ptr += chars * sizeof(*charprops);
+    memcpy(glyphs, ptr, *glyph_count * sizeof(*glyphs));
+    ptr += *glyph_count * sizeof(*glyphs);
+    memcpy(logclust, ptr, chars * sizeof(*logclust));
+}
+
+static void set_shape_result(BYTE *ptr, int chars, const WORD *logclust, const SCRIPT_CHARPROP *charprops,
+                             const WORD *glyphs, const SCRIPT_GLYPHPROP *glyphprops, int glyph_count)
+{
+    *(INT *)ptr = glyph_count;
+    ptr += sizeof(INT);
+    memcpy(ptr, glyphprops, glyph_count * sizeof(*glyphprops));
+    ptr += glyph_count * sizeof(*glyphprops);
+    memcpy(ptr, charprops, chars * sizeof(*charprops));
+    ptr += chars * sizeof(*charprops);
+    memcpy(ptr, glyphs, glyph_count * sizeof(*glyphs));
+    ptr += glyph_count * sizeof(*glyphs);
+    memcpy(ptr, logclust, chars * sizeof(*logclust));
+}
+
+/* Placement results are stored as combined ABC width, advances and offsets. */
+static inline SIZE_T get_place_result_size(int glyphs)
+{
+    return sizeof(ABC) + glyphs * (sizeof(int) + sizeof(GOFFSET));
+}
+
+static void get_place_result(const ResultCacheEntry *entry, int glyphs, int *advances, GOFFSET *offsets, ABC *abc)
+{
+    const BYTE *ptr = entry->data;
+
+    if (abc) memcpy(abc, ptr, sizeof(*abc));
+    ptr += sizeof(*abc);
+    memcpy(advances, ptr, glyphs * sizeof(*advances));
+    ptr += glyphs * sizeof(*advances);
+    memcpy(offsets, ptr, glyphs * sizeof(*offsets));
+}
+
+static void set_place_result(BYTE *ptr, int glyphs, const int *advances, const GOFFSET *offsets, const ABC *abc)
+{
+    memcpy(ptr, abc, sizeof(*abc));
+    ptr += sizeof(*abc);
+    memcpy(ptr, advances, glyphs * sizeof(*advances));
+    ptr += glyphs * sizeof(*advances);
+    memcpy(ptr, offsets, glyphs * sizeof(*offsets));
+}
+
 static HRESULT init_script_cache(const HDC hdc, SCRIPT_CACHE *psc)
 {
     ScriptCache *sc;
@@ -843,6 +1041,7 @@ static HRESULT init_script_cache(const HDC hdc, SCRIPT_CACHE *psc)
     if (!hdc) return E_PENDING;
 
     if (!(sc = heap_alloc_zero(sizeof(ScriptCache)))) return E_OUTOFMEMORY;
+    init_result_cache(&sc->results);
     if (!GetTextMetricsW(hdc, &sc->tm))
     {
         heap_free(sc);
@@ -1048,6 +1247,7 @@ HRESULT WINAPI ScriptFreeCache(SCRIPT_CACHE *psc)
         }
         heap_free(((ScriptCache *)*psc)->scripts);
         heap_free(((ScriptCache *)*psc)->otm);
+        free_result_cache(&((ScriptCache *)*psc)->results);
         heap_free(*psc);
         *psc = NULL;
     }
@@ -3051,6 +3251,9 @@ HRESULT WINAPI ScriptShapeOpenType( HDC hdc, SCRIPT_CACHE *psc,
                                     SCRIPT_CHARPROP *pCharProps, WORD *pwOutGlyphs,
                                     SCRIPT_GLYPHPROP *pOutGlyphProps, int *pcGlyphs)
 {
+    ResultCacheEntry *result = NULL;
+    ResultCacheKey key;
+    DWORD key_size = 0, hash = 0;
     HRESULT hr;
     int i;
     unsigned int g;
@@ -3082,6 +3285,22 @@ HRESULT WINAPI ScriptShapeOpenType( HDC hdc, SCRIPT_CACHE *psc,
     ((ScriptCache *)*psc)->userScript = tagScript;
     ((ScriptCache *)*psc)->userLang = tagLangSys;
 
+    /* ranges are not supported, so features can't be set per range and are fully defined by tags */
+    if (psa && !psa->fNoGlyphIndex && ((ScriptCache *)*psc)->sfnt && !cRanges &&
+        cChars > 0 && cChars <= RESULT_CACHE_MAX_LENGTH)
+    {
+        key_size = init_result_key(&key, RESULT_SHAPE, psa, tagScript, tagLangSys, cChars, cChars);
+        memcpy(key.values, pwcChars, cChars * sizeof(WCHAR));
+        hash = hash_result_key(&key, key_size);
+
+        result = find_result(&((ScriptCache *)*psc)->results, &key, key_size, hash);
+        if (result && get_shape_result_glyph_count(result) <= cMaxGlyphs)
+        {
+            get_shape_result(result, cChars, pwLogClust, pCharProps, pwOutGlyphs, pOutGlyphProps, pcGlyphs);
+            return S_OK;
+        }
+    }
+
     /* Initialize a SCRIPT_VISATTR and LogClust for each char in this run */
     for (i = 0; i < cChars; i++)
     {
@@ -3166,6 +3385,18 @@ HRESULT WINAPI ScriptShapeOpenType( HDC hdc, SCRIPT_CACHE *psc,
         SHAPE_ApplyDefaultOpentypeFeatures(hdc, (ScriptCache *)*psc, psa, pwOutGlyphs, pcGlyphs, cMaxGlyphs, cChars, pwLogClust);
         SHAPE_CharGlyphProp(hdc, (ScriptCache *)*psc, psa, pwcChars, cChars, pwOutGlyphs, *pcGlyphs, pwLogClust, pCharProps, pOutGlyphProps);
         heap_free(rChars);
+
+        /* Runs with missing glyphs are not cached, shaping them without a DC has to fail
+           with E_PENDING as they do on Windows. */
+        for (i = 0; key_size && !result && i < *pcGlyphs; i++)
+            if (!pwOutGlyphs[i]) key_size = 0;
+
+        if (key_size && !result)
+        {
+            BYTE *data = add_result(&((ScriptCache *)*psc)->results, &key, key_size, hash,
+                                    get_shape_result_size(cChars, *pcGlyphs));
+            if (data) set_shape_result(data, cChars, pwLogClust, pCharProps, pwOutGlyphs, pOutGlyphProps, *pcGlyphs);
+        }
     }
     else
     {
@@ -3302,6 +3533,10 @@ HRESULT WINAPI ScriptPlaceOpenType( HDC hdc, SCRIPT_CACHE *psc, SCRIPT_ANALYSIS
                                     GOFFSET *pGoffset, ABC *pABC
 )
 {
+    ResultCacheEntry *result = NULL;
+    ResultCacheKey key;
+    DWORD key_size = 0, hash = 0;
+    ABC total;
     HRESULT hr;
     int i;
     static int once = 0;
@@ -3323,7 +3558,24 @@ HRESULT WINAPI ScriptPlaceOpenType( HDC hdc, SCRIPT_CACHE *psc, SCRIPT_ANALYSIS
     ((ScriptCache *)*psc)->userScript = tagScript;
     ((ScriptCache *)*psc)->userLang = tagLangSys;
 
+    if (psa && piAdvance && ((ScriptCache *)*psc)->sfnt && !cRanges &&
+        cGlyphs > 0 && cGlyphs <= RESULT_CACHE_MAX_LENGTH)
+    {
+        key_size = init_result_key(&key, RESULT_PLACE, psa, tagScript, tagLangSys, cGlyphs,
+                                   cGlyphs + cGlyphs * sizeof(SCRIPT_GLYPHPROP) / sizeof(WORD));
+        memcpy(key.values, pwGlyphs, cGlyphs * sizeof(WORD));
+        memcpy(&key.values[cGlyphs], pGlyphProps, cGlyphs * sizeof(SCRIPT_GLYPHPROP));
+        hash = hash_result_key(&key, key_size);
+
+        if ((result = find_result(&((ScriptCache *)*psc)->results, &key, key_size, hash)))
+        {
+            get_place_result(result, cGlyphs, piAdvance, pGoffset, pABC);
+            return S_OK;
+        }
+    }
+
     if (pABC) memset(pABC, 0, sizeof(ABC));
+    memset(&total, 0, sizeof(total));
     for (i = 0; i < cGlyphs; i++)
     {
         ABC abc;
@@ -3347,12 +3599,9 @@ HRESULT WINAPI ScriptPlaceOpenType( HDC hdc, SCRIPT_CACHE *psc, SCRIPT_ANALYSIS
             }
             set_cache_glyph_widths(psc, pwGlyphs[i], &abc);
         }
-        if (pABC)
-        {
-            pABC->abcA += abc.abcA;
-            pABC->abcB += abc.abcB;
-            pABC->abcC += abc.abcC;
-        }
+        total.abcA += abc.abcA;
+        total.abcB += abc.abcB;
+        total.abcC += abc.abcC;
         /* FIXME: set to more reasonable values */
         pGoffset[i].du = pGoffset[i].dv = 0;
         if (piAdvance) piAdvance[i] = abc.abcA + abc.abcB + abc.abcC;
@@ -3360,7 +3609,17 @@ HRESULT WINAPI ScriptPlaceOpenType( HDC hdc, SCRIPT_CACHE *psc, SCRIPT_ANALYSIS
 
     SHAPE_ApplyOpenTypePositions(hdc, (ScriptCache *)*psc, psa, pwGlyphs, cGlyphs, piAdvance, pGoffset);
 
-    if (pABC) TRACE("Total for run: abcA=%d, abcB=%d, abcC=%d\n", pABC->abcA, pABC->abcB, pABC->abcC);
+    if (key_size)
+    {
+        BYTE *data = add_result(&((ScriptCache *)*psc)->results, &key, key_size, hash, get_place_result_size(cGlyphs));
+        if (data) set_place_result(data, cGlyphs, piAdvance, pGoffset, &total);
+    }
+
+    if (pABC)
+    {
+        *pABC = total;
+        TRACE("Total for run: abcA=%d, abcB=%d, abcC=%d\n", pABC->abcA, pABC->abcB, pABC->abcC);
+    }
     return S_OK;
 }
 
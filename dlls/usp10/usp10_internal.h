@@ -18,6 +18,9 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
  *
  */
+
+#include "wine/list.h"
+
 #define MS_MAKE_TAG( _x1, _x2, _x3, _x4 ) \
           ( ( (ULONG)_x4 << 24 ) |     \
             ( (ULONG)_x3 << 16 ) |     \
@@ -163,6 +166,16 @@ typedef struct {
     WORD *glyphs[GLYPH_MAX / GLYPH_BLOCK_SIZE];
 } CacheGlyphPage;
 
+#define RESULT_CACHE_BUCKETS 256
+
+typedef struct {
+    struct list buckets[RESULT_CACHE_BUCKETS];
+    struct list lru;
+    SIZE_T size;
+    ULONG hits;
+    ULONG misses;
+} ResultCache;
+
 typedef struct {
     LOGFONTW lf;
     TEXTMETRICW tm;
@@ -182,6 +195,8 @@ typedef struct {
 
     OPENTYPE_TAG userScript;
     OPENTYPE_TAG userLang;
+
+    ResultCache results;
 } ScriptCache;
 
 typedef struct _scriptData
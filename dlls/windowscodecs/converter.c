@@ -17,6 +17,7 @@
  */
 
 #include "config.h"
+#include "wine/port.h"
 
 #include <stdarg.h>
 
@@ -30,6 +31,20 @@
 
 #include "wine/debug.h"
 
+#ifdef __WINE_TARGET
+#define WINCODECS_SSE2
+#define SSE2_FUNC __WINE_TARGET("sse2")
+#include <emmintrin.h>
+#endif
+
+#if defined(WINCODECS_SSE2) && defined(__GNUC__) \
+        && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define WINCODECS_SSSE3
+#define SSSE3_FUNC __WINE_TARGET("ssse3")
+#include <tmmintrin.h>
+#include <cpuid.h>
+#endif
+
 WINE_DEFAULT_DEBUG_CHANNEL(wincodecs);
 
 struct FormatConverter;
@@ -66,11 +81,20 @@ struct pixelformatinfo {
     copyfunc copy_function;
 };
 
+typedef void (*convert_row_func)(const BYTE *src, BYTE *dst, UINT width);
+
+struct direct_conversion {
+    enum pixelformat src_format, dst_format;
+    UINT src_bpp, dst_bpp;
+    convert_row_func convert_row;
+};
+
 typedef struct FormatConverter {
     IWICFormatConverter IWICFormatConverter_iface;
     LONG ref;
     IWICBitmapSource *source;
     const struct pixelformatinfo *dst_format, *src_format;
+    const struct direct_conversion *direct_conversion;
     WICBitmapDitherType dither;
     double alpha_threshold;
     WICBitmapPaletteType palette_type;
@@ -82,6 +106,32 @@ static inline FormatConverter *impl_from_IWICFormatConverter(IWICFormatConverter
     return CONTAINING_RECORD(iface, FormatConverter, IWICFormatConverter_iface);
 }
 
+#ifdef WINCODECS_SSE2
+static BOOL use_sse2(void)
+{
+    static int supported = -1;
+
+    if (supported == -1) supported = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+    return supported;
+}
+#endif
+
+#ifdef WINCODECS_SSSE3
+static BOOL use_ssse3(void)
+{
+    static int supported = -1;
+
+    if (supported == -1)
+    {
+        unsigned int eax, ebx, ecx, edx;
+
+        /* there is no PF_ flag for SSSE3 */
+        supported = use_sse2() && __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSSE3);
+    }
+    return supported;
+}
+#endif
+
 static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
@@ -993,6 +1043,350 @@ static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRec
     }
 }
 
+/* Direct conversions between the common 8 bits per channel formats. These
+ * avoid the 32bppBGRA intermediate and work a row at a time, with SIMD
+ * versions handling as many pixels as they can and the C loops doing the
+ * rest. When both formats have the same size the rows are converted in place. */
+
+#ifdef WINCODECS_SSE2
+static SSE2_FUNC UINT set_alpha_row_sse2(const BYTE *src, BYTE *dst, UINT width)
+{
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+    UINT x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i *)(src + 4 * x));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x), _mm_or_si128(pixels, alpha));
+    }
+    return x;
+}
+
+static inline SSE2_FUNC __m128i premultiply_pixels_sse2(__m128i pixels)
+{
+    const __m128i color_mask = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+    const __m128i alpha_one = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+    __m128i alpha;
+
+    /* the alpha channel is multiplied by 255, which leaves it unchanged */
+    alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, 0xff), 0xff);
+    alpha = _mm_or_si128(_mm_and_si128(alpha, color_mask), alpha_one);
+    pixels = _mm_mullo_epi16(pixels, alpha);
+
+    /* (x + 1 + (x >> 8)) >> 8 == x / 255 for 0 <= x <= 255 * 255 */
+    pixels = _mm_add_epi16(pixels, _mm_add_epi16(_mm_srli_epi16(pixels, 8), _mm_set1_epi16(1)));
+    return _mm_srli_epi16(pixels, 8);
+}
+
+static SSE2_FUNC UINT premultiply_row_sse2(const BYTE *src, BYTE *dst, UINT width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    UINT x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i *)(src + 4 * x));
+        __m128i lo = premultiply_pixels_sse2(_mm_unpacklo_epi8(pixels, zero));
+        __m128i hi = premultiply_pixels_sse2(_mm_unpackhi_epi8(pixels, zero));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x), _mm_packus_epi16(lo, hi));
+    }
+    return x;
+}
+
+static SSE2_FUNC UINT gray_to_bgra_row_sse2(const BYTE *src, BYTE *dst, UINT width)
+{
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+    UINT x;
+
+    for (x = 0; x + 16 <= width; x += 16)
+    {
+        __m128i gray = _mm_loadu_si128((const __m128i *)(src + x));
+        __m128i lo = _mm_unpacklo_epi8(gray, gray);
+        __m128i hi = _mm_unpackhi_epi8(gray, gray);
+        _mm_storeu_si128((__m128i *)(dst + 4 * x), _mm_or_si128(_mm_unpacklo_epi16(lo, lo), alpha));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x + 16), _mm_or_si128(_mm_unpackhi_epi16(lo, lo), alpha));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x + 32), _mm_or_si128(_mm_unpacklo_epi16(hi, hi), alpha));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x + 48), _mm_or_si128(_mm_unpackhi_epi16(hi, hi), alpha));
+    }
+    return x;
+}
+#endif
+
+#ifdef WINCODECS_SSSE3
+static SSSE3_FUNC UINT expand_24bpp_row_ssse3(const BYTE *src, BYTE *dst, UINT width, BOOL swap)
+{
+    const __m128i shuffle = swap ? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+                                 : _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+    UINT x;
+
+    for (x = 0; x + 16 <= width; x += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + 3 * x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 3 * x + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + 3 * x + 32));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x),
+                         _mm_or_si128(_mm_shuffle_epi8(a, shuffle), alpha));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x + 16),
+                         _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), shuffle), alpha));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x + 32),
+                         _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), shuffle), alpha));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x + 48),
+                         _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(c, 4), shuffle), alpha));
+    }
+    return x;
+}
+
+static SSSE3_FUNC UINT pack_32bpp_row_ssse3(const BYTE *src, BYTE *dst, UINT width, BOOL swap)
+{
+    const __m128i shuffle = swap ? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+                                 : _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    UINT x;
+
+    for (x = 0; x + 16 <= width; x += 16)
+    {
+        __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 4 * x)), shuffle);
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 4 * x + 16)), shuffle);
+        __m128i c = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 4 * x + 32)), shuffle);
+        __m128i d = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 4 * x + 48)), shuffle);
+        _mm_storeu_si128((__m128i *)(dst + 3 * x),
+                         _mm_or_si128(a, _mm_slli_si128(b, 12)));
+        _mm_storeu_si128((__m128i *)(dst + 3 * x + 16),
+                         _mm_or_si128(_mm_srli_si128(b, 4), _mm_slli_si128(c, 8)));
+        _mm_storeu_si128((__m128i *)(dst + 3 * x + 32),
+                         _mm_or_si128(_mm_srli_si128(c, 8), _mm_slli_si128(d, 4)));
+    }
+    return x;
+}
+
+static SSSE3_FUNC UINT swap_24bpp_row_ssse3(const BYTE *src, BYTE *dst, UINT width)
+{
+    /* 16 pixels are three vectors, and some pixels straddle two of them */
+    const __m128i a0 = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, -1);
+    const __m128i b0 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1);
+    const __m128i a1 = _mm_setr_epi8(-1, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i b1 = _mm_setr_epi8(0, -1, 4, 3, 2, 7, 6, 5, 10, 9, 8, 13, 12, 11, -1, 15);
+    const __m128i c1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, -1);
+    const __m128i b2 = _mm_setr_epi8(14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i c2 = _mm_setr_epi8(-1, 3, 2, 1, 6, 5, 4, 9, 8, 7, 12, 11, 10, 15, 14, 13);
+    UINT x;
+
+    for (x = 0; x + 16 <= width; x += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + 3 * x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 3 * x + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + 3 * x + 32));
+        _mm_storeu_si128((__m128i *)(dst + 3 * x),
+                         _mm_or_si128(_mm_shuffle_epi8(a, a0), _mm_shuffle_epi8(b, b0)));
+        _mm_storeu_si128((__m128i *)(dst + 3 * x + 16),
+                         _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, a1), _mm_shuffle_epi8(b, b1)),
+                                      _mm_shuffle_epi8(c, c1)));
+        _mm_storeu_si128((__m128i *)(dst + 3 * x + 32),
+                         _mm_or_si128(_mm_shuffle_epi8(b, b2), _mm_shuffle_epi8(c, c2)));
+    }
+    return x;
+}
+#endif
+
+static void convert_row_8bppGray_to_32bppBGRA(const BYTE *src, BYTE *dst, UINT width)
+{
+    DWORD *dstpixel = (DWORD *)dst;
+    UINT x = 0;
+
+#ifdef WINCODECS_SSE2
+    if (use_sse2()) x = gray_to_bgra_row_sse2(src, dst, width);
+#endif
+    for (; x < width; x++)
+        dstpixel[x] = 0xff000000 | (src[x] << 16) | (src[x] << 8) | src[x];
+}
+
+static void convert_row_24bppBGR_to_32bppBGRA(const BYTE *src, BYTE *dst, UINT width)
+{
+    DWORD *dstpixel = (DWORD *)dst;
+    UINT x = 0;
+
+#ifdef WINCODECS_SSSE3
+    if (use_ssse3()) x = expand_24bpp_row_ssse3(src, dst, width, FALSE);
+#endif
+    for (src += 3 * x; x < width; x++, src += 3)
+        dstpixel[x] = 0xff000000 | (src[2] << 16) | (src[1] << 8) | src[0];
+}
+
+static void convert_row_24bppRGB_to_32bppBGRA(const BYTE *src, BYTE *dst, UINT width)
+{
+    DWORD *dstpixel = (DWORD *)dst;
+    UINT x = 0;
+
+#ifdef WINCODECS_SSSE3
+    if (use_ssse3()) x = expand_24bpp_row_ssse3(src, dst, width, TRUE);
+#endif
+    for (src += 3 * x; x < width; x++, src += 3)
+        dstpixel[x] = 0xff000000 | (src[0] << 16) | (src[1] << 8) | src[2];
+}
+
+static void convert_row_swap_24bpp(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x = 0;
+
+#ifdef WINCODECS_SSSE3
+    if (use_ssse3()) x = swap_24bpp_row_ssse3(src, dst, width);
+#endif
+    for (src += 3 * x, dst += 3 * x; x < width; x++, src += 3, dst += 3)
+    {
+        BYTE temp = src[0];
+        dst[1] = src[1];
+        dst[0] = src[2];
+        dst[2] = temp;
+    }
+}
+
+static void convert_row_32bppBGR_to_32bppBGRA(const BYTE *src, BYTE *dst, UINT width)
+{
+    const DWORD *srcpixel = (const DWORD *)src;
+    DWORD *dstpixel = (DWORD *)dst;
+    UINT x = 0;
+
+#ifdef WINCODECS_SSE2
+    if (use_sse2()) x = set_alpha_row_sse2(src, dst, width);
+#endif
+    for (; x < width; x++)
+        dstpixel[x] = srcpixel[x] | 0xff000000;
+}
+
+static void convert_row_32bppBGRA_to_32bppPBGRA(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x = 0;
+
+#ifdef WINCODECS_SSE2
+    if (use_sse2()) x = premultiply_row_sse2(src, dst, width);
+#endif
+    for (src += 4 * x, dst += 4 * x; x < width; x++, src += 4, dst += 4)
+    {
+        BYTE alpha = src[3];
+        dst[0] = src[0] * alpha / 255;
+        dst[1] = src[1] * alpha / 255;
+        dst[2] = src[2] * alpha / 255;
+        dst[3] = alpha;
+    }
+}
+
+static void convert_row_32bppBGRA_to_24bppBGR(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x = 0;
+
+#ifdef WINCODECS_SSSE3
+    if (use_ssse3()) x = pack_32bpp_row_ssse3(src, dst, width, FALSE);
+#endif
+    for (src += 4 * x, dst += 3 * x; x < width; x++, src += 4, dst += 3)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+    }
+}
+
+static void convert_row_32bppBGRA_to_24bppRGB(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x = 0;
+
+#ifdef WINCODECS_SSSE3
+    if (use_ssse3()) x = pack_32bpp_row_ssse3(src, dst, width, TRUE);
+#endif
+    for (src += 4 * x, dst += 3 * x; x < width; x++, src += 4, dst += 3)
+    {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+    }
+}
+
+static const struct direct_conversion direct_conversions[] = {
+    {format_8bppGray,   format_32bppBGR,   8,  32, convert_row_8bppGray_to_32bppBGRA},
+    {format_8bppGray,   format_32bppBGRA,  8,  32, convert_row_8bppGray_to_32bppBGRA},
+    {format_8bppGray,   format_32bppPBGRA, 8,  32, convert_row_8bppGray_to_32bppBGRA},
+    {format_24bppBGR,   format_24bppRGB,   24, 24, convert_row_swap_24bpp},
+    {format_24bppBGR,   format_32bppBGR,   24, 32, convert_row_24bppBGR_to_32bppBGRA},
+    {format_24bppBGR,   format_32bppBGRA,  24, 32, convert_row_24bppBGR_to_32bppBGRA},
+    {format_24bppBGR,   format_32bppPBGRA, 24, 32, convert_row_24bppBGR_to_32bppBGRA},
+    {format_24bppRGB,   format_24bppBGR,   24, 24, convert_row_swap_24bpp},
+    {format_24bppRGB,   format_32bppBGR,   24, 32, convert_row_24bppRGB_to_32bppBGRA},
+    {format_24bppRGB,   format_32bppBGRA,  24, 32, convert_row_24bppRGB_to_32bppBGRA},
+    {format_24bppRGB,   format_32bppPBGRA, 24, 32, convert_row_24bppRGB_to_32bppBGRA},
+    {format_32bppBGR,   format_24bppBGR,   32, 24, convert_row_32bppBGRA_to_24bppBGR},
+    {format_32bppBGR,   format_24bppRGB,   32, 24, convert_row_32bppBGRA_to_24bppRGB},
+    {format_32bppBGR,   format_32bppBGRA,  32, 32, convert_row_32bppBGR_to_32bppBGRA},
+    {format_32bppBGR,   format_32bppPBGRA, 32, 32, convert_row_32bppBGR_to_32bppBGRA},
+    {format_32bppBGRA,  format_24bppBGR,   32, 24, convert_row_32bppBGRA_to_24bppBGR},
+    {format_32bppBGRA,  format_24bppRGB,   32, 24, convert_row_32bppBGRA_to_24bppRGB},
+    {format_32bppBGRA,  format_32bppPBGRA, 32, 32, convert_row_32bppBGRA_to_32bppPBGRA},
+    {format_32bppPBGRA, format_24bppBGR,   32, 24, convert_row_32bppBGRA_to_24bppBGR},
+    {format_32bppPBGRA, format_24bppRGB,   32, 24, convert_row_32bppBGRA_to_24bppRGB},
+};
+
+static const struct direct_conversion *get_direct_conversion(enum pixelformat src_format,
+    enum pixelformat dst_format)
+{
+    UINT i;
+
+    for (i = 0; i < sizeof(direct_conversions) / sizeof(direct_conversions[0]); i++)
+        if (direct_conversions[i].src_format == src_format &&
+            direct_conversions[i].dst_format == dst_format)
+            return &direct_conversions[i];
+
+    return NULL;
+}
+
+static HRESULT copypixels_direct(struct FormatConverter *This, const WICRect *prc,
+    UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
+{
+    const struct direct_conversion *conversion = This->direct_conversion;
+    UINT srcstride, dststride;
+    INT y, i, band_height;
+    BYTE *srcdata;
+    WICRect rc;
+    HRESULT hr;
+
+    dststride = conversion->dst_bpp / 8 * prc->Width;
+    if (cbStride < dststride || cbStride * (prc->Height - 1) + dststride > cbBufferSize)
+        return E_INVALIDARG;
+
+    if (conversion->src_bpp == conversion->dst_bpp)
+    {
+        hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
+        if (FAILED(hr)) return hr;
+
+        for (y = 0; y < prc->Height; y++)
+            conversion->convert_row(pbBuffer + cbStride * y, pbBuffer + cbStride * y, prc->Width);
+        return S_OK;
+    }
+
+    /* fetch the source a band of rows at a time, so it is still in the cache
+     * when it gets converted */
+    srcstride = conversion->src_bpp / 8 * prc->Width;
+    band_height = min(prc->Height, max(1, 65536 / srcstride));
+
+    srcdata = HeapAlloc(GetProcessHeap(), 0, srcstride * band_height);
+    if (!srcdata) return E_OUTOFMEMORY;
+
+    rc = *prc;
+    hr = S_OK;
+    for (y = 0; y < prc->Height; y += rc.Height)
+    {
+        rc.Y = prc->Y + y;
+        rc.Height = min(band_height, prc->Height - y);
+
+        hr = IWICBitmapSource_CopyPixels(This->source, &rc, srcstride, srcstride * rc.Height, srcdata);
+        if (FAILED(hr)) break;
+
+        for (i = 0; i < rc.Height; i++)
+            conversion->convert_row(srcdata + srcstride * i, pbBuffer + cbStride * (y + i), prc->Width);
+    }
+
+    HeapFree(GetProcessHeap(), 0, srcdata);
+
+    return hr;
+}
+
 static const struct pixelformatinfo supported_formats[] = {
     {format_1bppIndexed, &GUID_WICPixelFormat1bppIndexed, NULL},
     {format_2bppIndexed, &GUID_WICPixelFormat2bppIndexed, NULL},
@@ -1149,6 +1543,9 @@ static HRESULT WINAPI FormatConverter_CopyPixels(IWICFormatConverter *iface,
             prc = &rc;
         }
 
+        if (This->direct_conversion && prc->Width > 0 && prc->Height > 0)
+            return copypixels_direct(This, prc, cbStride, cbBufferSize, pbBuffer);
+
         return This->dst_format->copy_function(This, prc, cbStride, cbBufferSize,
             pbBuffer, This->src_format->format);
     }
@@ -1203,6 +1600,7 @@ static HRESULT WINAPI FormatConverter_Initialize(IWICFormatConverter *iface,
         IWICBitmapSource_AddRef(pISource);
         This->src_format = srcinfo;
         This->dst_format = dstinfo;
+        This->direct_conversion = get_direct_conversion(srcinfo->format, dstinfo->format);
         This->dither = dither;
         This->alpha_threshold = alphaThresholdPercent;
         This->palette_type = paletteTranslate;
@@ -1285,6 +1683,7 @@ HRESULT FormatConverter_CreateInstance(REFIID iid, void** ppv)
     This->IWICFormatConverter_iface.lpVtbl = &FormatConverter_Vtbl;
     This->ref = 1;
     This->source = NULL;
+    This->direct_conversion = NULL;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": FormatConverter.lock");
 
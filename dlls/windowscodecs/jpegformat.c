@@ -61,6 +61,7 @@ WINE_DECLARE_DEBUG_CHANNEL(jpeg);
 static void *libjpeg_handle;
 
 #define MAKE_FUNCPTR(f) static typeof(f) * p##f
+MAKE_FUNCPTR(jpeg_abort_decompress);
 MAKE_FUNCPTR(jpeg_CreateCompress);
 MAKE_FUNCPTR(jpeg_CreateDecompress);
 MAKE_FUNCPTR(jpeg_destroy_compress);
@@ -86,6 +87,7 @@ static void *load_libjpeg(void)
         return NULL; \
     }
 
+        LOAD_FUNCPTR(jpeg_abort_decompress);
         LOAD_FUNCPTR(jpeg_CreateCompress);
         LOAD_FUNCPTR(jpeg_CreateDecompress);
         LOAD_FUNCPTR(jpeg_destroy_compress);
@@ -148,7 +150,8 @@ typedef struct {
     struct jpeg_error_mgr jerr;
     struct jpeg_source_mgr source_mgr;
     BYTE source_buffer[1024];
-    BYTE *image_data;
+    BYTE *rows; /* ring of the last rows_max decoded scanlines */
+    UINT rows_max;
     CRITICAL_SECTION lock;
 } JpegDecoder;
 
@@ -218,7 +221,7 @@ static ULONG WINAPI JpegDecoder_Release(IWICBitmapDecoder *iface)
         DeleteCriticalSection(&This->lock);
         if (This->cinfo_initialized) pjpeg_destroy_decompress(&This->cinfo);
         if (This->stream) IStream_Release(This->stream);
-        HeapFree(GetProcessHeap(), 0, This->image_data);
+        HeapFree(GetProcessHeap(), 0, This->rows);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -586,16 +589,48 @@ static HRESULT WINAPI JpegDecoder_Frame_CopyPalette(IWICBitmapFrameDecode *iface
     return E_NOTIMPL;
 }
 
+static HRESULT restart_decompress(JpegDecoder *This)
+{
+    J_COLOR_SPACE out_color_space = This->cinfo.out_color_space;
+    LARGE_INTEGER seek;
+
+    TRACE("(%p)\n", This);
+
+    pjpeg_abort_decompress(&This->cinfo);
+
+    seek.QuadPart = 0;
+    IStream_Seek(This->stream, seek, STREAM_SEEK_SET, NULL);
+    This->source_mgr.bytes_in_buffer = 0;
+
+    if (pjpeg_read_header(&This->cinfo, TRUE) != JPEG_HEADER_OK)
+    {
+        ERR("jpeg_read_header failed\n");
+        return E_FAIL;
+    }
+
+    This->cinfo.out_color_space = out_color_space;
+
+    if (!pjpeg_start_decompress(&This->cinfo))
+    {
+        ERR("jpeg_start_decompress failed\n");
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
 static HRESULT WINAPI JpegDecoder_Frame_CopyPixels(IWICBitmapFrameDecode *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
     JpegDecoder *This = impl_from_IWICBitmapFrameDecode(iface);
     UINT bpp;
     UINT stride;
-    UINT data_size;
-    UINT max_row_needed;
+    UINT bytesperrow;
+    UINT first_cached;
+    INT y;
     jmp_buf jmpbuf;
-    WICRect rect;
+    WICRect rect, row_rect;
+    HRESULT hr;
     TRACE("(%p,%p,%u,%u,%p)\n", iface, prc, cbStride, cbBufferSize, pbBuffer);
 
     if (!prc)
@@ -617,18 +652,22 @@ static HRESULT WINAPI JpegDecoder_Frame_CopyPixels(IWICBitmapFrameDecode *iface,
     else if (This->cinfo.out_color_space == JCS_CMYK) bpp = 32;
     else bpp = 24;
 
-    stride = bpp * This->cinfo.output_width;
-    data_size = stride * This->cinfo.output_height;
+    stride = bpp / 8 * This->cinfo.output_width;
+    bytesperrow = bpp / 8 * prc->Width;
+
+    if (cbStride < bytesperrow)
+        return E_INVALIDARG;
 
-    max_row_needed = prc->Y + prc->Height;
-    if (max_row_needed > This->cinfo.output_height) return E_INVALIDARG;
+    if ((cbStride * (prc->Height-1)) + bytesperrow > cbBufferSize)
+        return E_INVALIDARG;
 
     EnterCriticalSection(&This->lock);
 
-    if (!This->image_data)
+    if (!This->rows)
     {
-        This->image_data = HeapAlloc(GetProcessHeap(), 0, data_size);
-        if (!This->image_data)
+        This->rows_max = max(1, min(This->cinfo.output_height, DECODER_ROW_CACHE_SIZE / stride));
+        This->rows = HeapAlloc(GetProcessHeap(), 0, stride * This->rows_max);
+        if (!This->rows)
         {
             LeaveCriticalSection(&This->lock);
             return E_OUTOFMEMORY;
@@ -643,46 +682,67 @@ static HRESULT WINAPI JpegDecoder_Frame_CopyPixels(IWICBitmapFrameDecode *iface,
         return E_FAIL;
     }
 
-    while (max_row_needed > This->cinfo.output_scanline)
+    /* rows that dropped out of the cache can only be reached by decoding again */
+    first_cached = This->cinfo.output_scanline - min(This->cinfo.output_scanline, This->rows_max);
+    if (prc->Y < first_cached)
     {
-        UINT first_scanline = This->cinfo.output_scanline;
-        UINT max_rows;
-        JSAMPROW out_rows[4];
-        UINT i;
-        JDIMENSION ret;
-
-        max_rows = min(This->cinfo.output_height-first_scanline, 4);
-        for (i=0; i<max_rows; i++)
-            out_rows[i] = This->image_data + stride * (first_scanline+i);
-
-        ret = pjpeg_read_scanlines(&This->cinfo, out_rows, max_rows);
-
-        if (ret == 0)
+        hr = restart_decompress(This);
+        if (FAILED(hr))
         {
-            ERR("read_scanlines failed\n");
             LeaveCriticalSection(&This->lock);
-            return E_FAIL;
+            return hr;
         }
+    }
+
+    row_rect.X = prc->X;
+    row_rect.Y = 0;
+    row_rect.Width = prc->Width;
+    row_rect.Height = 1;
 
-        if (bpp == 24)
+    for (y = prc->Y; y < prc->Y + prc->Height; y++)
+    {
+        while (y >= This->cinfo.output_scanline)
         {
-            /* libjpeg gives us RGB data and we want BGR, so byteswap the data */
-            reverse_bgr8(3, This->image_data + stride * first_scanline,
-                This->cinfo.output_width, This->cinfo.output_scanline - first_scanline,
-                stride);
+            UINT first_scanline = This->cinfo.output_scanline;
+            UINT max_rows;
+            JSAMPROW out_rows[4];
+            UINT i, j;
+            JDIMENSION ret;
+
+            max_rows = min(This->cinfo.output_height-first_scanline, min(This->rows_max, 4));
+            for (i=0; i<max_rows; i++)
+                out_rows[i] = This->rows + stride * ((first_scanline+i) % This->rows_max);
+
+            ret = pjpeg_read_scanlines(&This->cinfo, out_rows, max_rows);
+
+            if (ret == 0)
+            {
+                ERR("read_scanlines failed\n");
+                LeaveCriticalSection(&This->lock);
+                return E_FAIL;
+            }
+
+            for (i=0; i<ret; i++)
+            {
+                if (bpp == 24)
+                    /* libjpeg gives us RGB data and we want BGR, so byteswap the data */
+                    reverse_bgr8(3, out_rows[i], This->cinfo.output_width, 1, stride);
+
+                if (This->cinfo.out_color_space == JCS_CMYK && This->cinfo.saw_Adobe_marker)
+                    /* Adobe JPEG's have inverted CMYK data. */
+                    for (j=0; j<stride; j++)
+                        out_rows[i][j] ^= 0xff;
+            }
         }
 
-        if (This->cinfo.out_color_space == JCS_CMYK && This->cinfo.saw_Adobe_marker)
-            /* Adobe JPEG's have inverted CMYK data. */
-            for (i=0; i<data_size; i++)
-                This->image_data[i] ^= 0xff;
+        copy_pixels(bpp, This->rows + stride * (y % This->rows_max),
+            This->cinfo.output_width, 1, stride, &row_rect,
+            cbStride, bytesperrow, pbBuffer + cbStride * (y - prc->Y));
     }
 
     LeaveCriticalSection(&This->lock);
 
-    return copy_pixels(bpp, This->image_data,
-        This->cinfo.output_width, This->cinfo.output_height, stride,
-        prc, cbStride, cbBufferSize, pbBuffer);
+    return S_OK;
 }
 
 static HRESULT WINAPI JpegDecoder_Frame_GetMetadataQueryReader(IWICBitmapFrameDecode *iface,
@@ -818,7 +878,7 @@ HRESULT JpegDecoder_CreateInstance(REFIID iid, void** ppv)
     This->initialized = FALSE;
     This->cinfo_initialized = FALSE;
     This->stream = NULL;
-    This->image_data = NULL;
+    This->rows = NULL;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": JpegDecoder.lock");
 
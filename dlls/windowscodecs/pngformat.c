@@ -338,6 +338,7 @@ MAKE_FUNCPTR(png_set_write_fn);
 MAKE_FUNCPTR(png_read_end);
 MAKE_FUNCPTR(png_read_image);
 MAKE_FUNCPTR(png_read_info);
+MAKE_FUNCPTR(png_read_row);
 MAKE_FUNCPTR(png_write_end);
 MAKE_FUNCPTR(png_write_info);
 MAKE_FUNCPTR(png_write_rows);
@@ -403,6 +404,7 @@ static void *load_libpng(void)
         LOAD_FUNCPTR(png_read_end);
         LOAD_FUNCPTR(png_read_image);
         LOAD_FUNCPTR(png_read_info);
+        LOAD_FUNCPTR(png_read_row);
         LOAD_FUNCPTR(png_write_end);
         LOAD_FUNCPTR(png_write_info);
         LOAD_FUNCPTR(png_write_rows);
@@ -453,7 +455,12 @@ typedef struct {
     int width, height;
     UINT stride;
     const WICPixelFormatGUID *format;
-    BYTE *image_bits;
+    BOOL interlaced;
+    BYTE *image_bits; /* whole image, only used for interlaced images */
+    BYTE *rows; /* ring of the last rows_max decoded rows */
+    UINT rows_max;
+    UINT next_row;
+    ULARGE_INTEGER read_pos;
     CRITICAL_SECTION lock; /* must be held when png structures are accessed or initialized is set */
     ULONG metadata_count;
     metadata_block_info* metadata_blocks;
@@ -525,6 +532,7 @@ static ULONG WINAPI PngDecoder_Release(IWICBitmapDecoder *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         HeapFree(GetProcessHeap(), 0, This->image_bits);
+        HeapFree(GetProcessHeap(), 0, This->rows);
         for (i=0; i<This->metadata_count; i++)
         {
             if (This->metadata_blocks[i].reader)
@@ -568,45 +576,29 @@ static void user_read_data(png_structp png_ptr, png_bytep data, png_size_t lengt
     }
 }
 
-static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *pIStream,
-    WICDecodeOptions cacheOptions)
+/* Creates the libpng reader, reads the header and sets up the transformations
+ * for the chosen pixel format. The stream is left at the start of the image data. */
+static HRESULT start_png_read(PngDecoder *This, IStream *stream)
 {
-    PngDecoder *This = impl_from_IWICBitmapDecoder(iface);
     LARGE_INTEGER seek;
-    HRESULT hr=S_OK;
-    png_bytep *row_pointers=NULL;
-    UINT image_size;
-    UINT i;
+    HRESULT hr;
     int color_type, bit_depth;
     png_bytep trans;
     int num_trans;
     png_uint_32 transparency;
     png_color_16p trans_values;
     jmp_buf jmpbuf;
-    BYTE chunk_type[4];
-    ULONG chunk_size;
-    ULARGE_INTEGER chunk_start;
-    ULONG metadata_blocks_size = 0;
-
-    TRACE("(%p,%p,%x)\n", iface, pIStream, cacheOptions);
-
-    EnterCriticalSection(&This->lock);
 
     /* initialize libpng */
     This->png_ptr = ppng_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    if (!This->png_ptr)
-    {
-        hr = E_FAIL;
-        goto end;
-    }
+    if (!This->png_ptr) return E_FAIL;
 
     This->info_ptr = ppng_create_info_struct(This->png_ptr);
     if (!This->info_ptr)
     {
         ppng_destroy_read_struct(&This->png_ptr, NULL, NULL);
         This->png_ptr = NULL;
-        hr = E_FAIL;
-        goto end;
+        return E_FAIL;
     }
 
     This->end_info = ppng_create_info_struct(This->png_ptr);
@@ -614,29 +606,26 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
     {
         ppng_destroy_read_struct(&This->png_ptr, &This->info_ptr, NULL);
         This->png_ptr = NULL;
-        hr = E_FAIL;
-        goto end;
+        return E_FAIL;
     }
 
     /* set up setjmp/longjmp error handling */
     if (setjmp(jmpbuf))
     {
         ppng_destroy_read_struct(&This->png_ptr, &This->info_ptr, &This->end_info);
-        HeapFree(GetProcessHeap(), 0, row_pointers);
         This->png_ptr = NULL;
-        hr = E_FAIL;
-        goto end;
+        return E_FAIL;
     }
     ppng_set_error_fn(This->png_ptr, jmpbuf, user_error_fn, user_warning_fn);
     ppng_set_crc_action(This->png_ptr, PNG_CRC_QUIET_USE, PNG_CRC_QUIET_USE);
 
     /* seek to the start of the stream */
     seek.QuadPart = 0;
-    hr = IStream_Seek(pIStream, seek, STREAM_SEEK_SET, NULL);
-    if (FAILED(hr)) goto end;
+    hr = IStream_Seek(stream, seek, STREAM_SEEK_SET, NULL);
+    if (FAILED(hr)) return hr;
 
     /* set up custom i/o handling */
-    ppng_set_read_fn(This->png_ptr, pIStream, user_read_data);
+    ppng_set_read_fn(This->png_ptr, stream, user_read_data);
 
     /* read the header */
     ppng_read_info(This->png_ptr, This->info_ptr);
@@ -681,8 +670,7 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         case 16: This->format = &GUID_WICPixelFormat16bppGray; break;
         default:
             ERR("invalid grayscale bit depth: %i\n", bit_depth);
-            hr = E_FAIL;
-            goto end;
+            return E_FAIL;
         }
         break;
     case PNG_COLOR_TYPE_GRAY_ALPHA:
@@ -700,8 +688,7 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         case 16: This->format = &GUID_WICPixelFormat64bppRGBA; break;
         default:
             ERR("invalid RGBA bit depth: %i\n", bit_depth);
-            hr = E_FAIL;
-            goto end;
+            return E_FAIL;
         }
         break;
     case PNG_COLOR_TYPE_PALETTE:
@@ -714,8 +701,7 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         case 8: This->format = &GUID_WICPixelFormat8bppIndexed; break;
         default:
             ERR("invalid indexed color bit depth: %i\n", bit_depth);
-            hr = E_FAIL;
-            goto end;
+            return E_FAIL;
         }
         break;
     case PNG_COLOR_TYPE_RGB:
@@ -729,45 +715,45 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         case 16: This->format = &GUID_WICPixelFormat48bppRGB; break;
         default:
             ERR("invalid RGB color bit depth: %i\n", bit_depth);
-            hr = E_FAIL;
-            goto end;
+            return E_FAIL;
         }
         break;
     default:
         ERR("invalid color type %i\n", color_type);
-        hr = E_FAIL;
-        goto end;
+        return E_FAIL;
     }
 
-    /* read the image data */
     This->width = ppng_get_image_width(This->png_ptr, This->info_ptr);
     This->height = ppng_get_image_height(This->png_ptr, This->info_ptr);
     This->stride = (This->width * This->bpp + 7) / 8;
-    image_size = This->stride * This->height;
+    This->interlaced = ppng_set_interlace_handling(This->png_ptr) > 1;
+    This->next_row = 0;
 
-    This->image_bits = HeapAlloc(GetProcessHeap(), 0, image_size);
-    if (!This->image_bits)
-    {
-        hr = E_OUTOFMEMORY;
-        goto end;
-    }
+    return S_OK;
+}
 
-    row_pointers = HeapAlloc(GetProcessHeap(), 0, sizeof(png_bytep)*This->height);
-    if (!row_pointers)
-    {
-        hr = E_OUTOFMEMORY;
-        goto end;
-    }
+static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *pIStream,
+    WICDecodeOptions cacheOptions)
+{
+    PngDecoder *This = impl_from_IWICBitmapDecoder(iface);
+    LARGE_INTEGER seek;
+    HRESULT hr=S_OK;
+    BYTE chunk_type[4];
+    ULONG chunk_size;
+    ULARGE_INTEGER chunk_start;
+    ULONG metadata_blocks_size = 0;
 
-    for (i=0; i<This->height; i++)
-        row_pointers[i] = This->image_bits + i * This->stride;
+    TRACE("(%p,%p,%x)\n", iface, pIStream, cacheOptions);
 
-    ppng_read_image(This->png_ptr, row_pointers);
+    EnterCriticalSection(&This->lock);
 
-    HeapFree(GetProcessHeap(), 0, row_pointers);
-    row_pointers = NULL;
+    hr = start_png_read(This, pIStream);
+    if (FAILED(hr)) goto end;
 
-    ppng_read_end(This->png_ptr, This->end_info);
+    /* the image data is decoded on demand, the metadata chunks are found first */
+    seek.QuadPart = 0;
+    hr = IStream_Seek(pIStream, seek, STREAM_SEEK_CUR, &This->read_pos);
+    if (FAILED(hr)) goto end;
 
     /* Find the metadata chunks in the file. */
     seek.QuadPart = 8;
@@ -1082,15 +1068,221 @@ end:
     return hr;
 }
 
+/* Replaces the libpng reader after an error left it in an unknown state,
+ * decoding starts again from the first row. If that fails, the old reader is
+ * kept for the header information, and the next decode tries again. */
+static HRESULT restart_png_read(PngDecoder *This)
+{
+    png_structp png_ptr = This->png_ptr;
+    png_infop info_ptr = This->info_ptr, end_info = This->end_info;
+    LARGE_INTEGER seek;
+    HRESULT hr;
+
+    This->png_ptr = NULL;
+    This->info_ptr = NULL;
+    This->end_info = NULL;
+
+    hr = start_png_read(This, This->stream);
+    if (SUCCEEDED(hr))
+    {
+        seek.QuadPart = 0;
+        hr = IStream_Seek(This->stream, seek, STREAM_SEEK_CUR, &This->read_pos);
+    }
+
+    if (FAILED(hr))
+    {
+        if (This->png_ptr)
+            ppng_destroy_read_struct(&This->png_ptr, &This->info_ptr, &This->end_info);
+        This->png_ptr = png_ptr;
+        This->info_ptr = info_ptr;
+        This->end_info = end_info;
+        This->next_row = ~0u;
+        return hr;
+    }
+
+    if (png_ptr)
+        ppng_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
+    return S_OK;
+}
+
+static HRESULT read_png_image(PngDecoder *This)
+{
+    png_bytep *row_pointers;
+    jmp_buf jmpbuf;
+    UINT i;
+
+    This->image_bits = HeapAlloc(GetProcessHeap(), 0, This->stride * This->height);
+    row_pointers = HeapAlloc(GetProcessHeap(), 0, sizeof(png_bytep)*This->height);
+    if (!This->image_bits || !row_pointers)
+    {
+        HeapFree(GetProcessHeap(), 0, This->image_bits);
+        HeapFree(GetProcessHeap(), 0, row_pointers);
+        This->image_bits = NULL;
+        return E_OUTOFMEMORY;
+    }
+
+    for (i=0; i<This->height; i++)
+        row_pointers[i] = This->image_bits + i * This->stride;
+
+    if (setjmp(jmpbuf))
+    {
+        HeapFree(GetProcessHeap(), 0, This->image_bits);
+        HeapFree(GetProcessHeap(), 0, row_pointers);
+        This->image_bits = NULL;
+        return E_FAIL;
+    }
+    ppng_set_error_fn(This->png_ptr, jmpbuf, user_error_fn, user_warning_fn);
+
+    ppng_read_image(This->png_ptr, row_pointers);
+
+    HeapFree(GetProcessHeap(), 0, row_pointers);
+
+    return S_OK;
+}
+
 static HRESULT WINAPI PngDecoder_Frame_CopyPixels(IWICBitmapFrameDecode *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
     PngDecoder *This = impl_from_IWICBitmapFrameDecode(iface);
+    WICRect rect, row_rect;
+    UINT bytesperrow;
+    UINT first_cached;
+    LARGE_INTEGER seek;
+    jmp_buf jmpbuf;
+    HRESULT hr;
+    INT y;
     TRACE("(%p,%p,%u,%u,%p)\n", iface, prc, cbStride, cbBufferSize, pbBuffer);
 
-    return copy_pixels(This->bpp, This->image_bits,
-        This->width, This->height, This->stride,
-        prc, cbStride, cbBufferSize, pbBuffer);
+    if (!prc)
+    {
+        rect.X = 0;
+        rect.Y = 0;
+        rect.Width = This->width;
+        rect.Height = This->height;
+        prc = &rect;
+    }
+    else
+    {
+        if (prc->X < 0 || prc->Y < 0 || prc->X+prc->Width > This->width ||
+            prc->Y+prc->Height > This->height)
+            return E_INVALIDARG;
+    }
+
+    bytesperrow = (This->bpp * prc->Width + 7) / 8;
+
+    if (cbStride < bytesperrow)
+        return E_INVALIDARG;
+
+    if ((cbStride * (prc->Height-1)) + bytesperrow > cbBufferSize)
+        return E_INVALIDARG;
+
+    EnterCriticalSection(&This->lock);
+
+    if (!This->png_ptr)
+    {
+        LeaveCriticalSection(&This->lock);
+        return E_FAIL;
+    }
+
+    /* an earlier restart failed, the reader is still broken */
+    if (This->next_row == ~0u && FAILED(hr = restart_png_read(This)))
+    {
+        LeaveCriticalSection(&This->lock);
+        return hr;
+    }
+
+    if (setjmp(jmpbuf))
+    {
+        /* the next call decodes again instead of reading on from a broken state */
+        restart_png_read(This);
+        LeaveCriticalSection(&This->lock);
+        return E_FAIL;
+    }
+    ppng_set_error_fn(This->png_ptr, jmpbuf, user_error_fn, user_warning_fn);
+
+    if (This->interlaced)
+    {
+        /* every pass touches the whole image, so keep all of it */
+        if (!This->image_bits)
+        {
+            seek.QuadPart = This->read_pos.QuadPart;
+            hr = IStream_Seek(This->stream, seek, STREAM_SEEK_SET, NULL);
+            if (SUCCEEDED(hr))
+                hr = read_png_image(This);
+            if (FAILED(hr))
+            {
+                restart_png_read(This);
+                LeaveCriticalSection(&This->lock);
+                return hr;
+            }
+        }
+
+        LeaveCriticalSection(&This->lock);
+
+        return copy_pixels(This->bpp, This->image_bits,
+            This->width, This->height, This->stride,
+            prc, cbStride, cbBufferSize, pbBuffer);
+    }
+
+    if (!This->rows)
+    {
+        This->rows_max = max(1, min(This->height, DECODER_ROW_CACHE_SIZE / This->stride));
+        This->rows = HeapAlloc(GetProcessHeap(), 0, This->stride * This->rows_max);
+        if (!This->rows)
+        {
+            LeaveCriticalSection(&This->lock);
+            return E_OUTOFMEMORY;
+        }
+    }
+
+    /* rows that dropped out of the cache can only be reached by decoding again */
+    first_cached = This->next_row - min(This->next_row, This->rows_max);
+    if (prc->Y < first_cached)
+    {
+        hr = restart_png_read(This);
+        if (FAILED(hr))
+        {
+            LeaveCriticalSection(&This->lock);
+            return hr;
+        }
+        ppng_set_error_fn(This->png_ptr, jmpbuf, user_error_fn, user_warning_fn);
+    }
+    else
+    {
+        /* the metadata readers share the stream */
+        seek.QuadPart = This->read_pos.QuadPart;
+        hr = IStream_Seek(This->stream, seek, STREAM_SEEK_SET, NULL);
+        if (FAILED(hr))
+        {
+            LeaveCriticalSection(&This->lock);
+            return hr;
+        }
+    }
+
+    row_rect.X = prc->X;
+    row_rect.Y = 0;
+    row_rect.Width = prc->Width;
+    row_rect.Height = 1;
+
+    for (y = prc->Y; y < prc->Y + prc->Height; y++)
+    {
+        while (y >= This->next_row)
+        {
+            ppng_read_row(This->png_ptr, This->rows + This->stride * (This->next_row % This->rows_max), NULL);
+            This->next_row++;
+        }
+
+        copy_pixels(This->bpp, This->rows + This->stride * (y % This->rows_max),
+            This->width, 1, This->stride, &row_rect,
+            cbStride, bytesperrow, pbBuffer + cbStride * (y - prc->Y));
+    }
+
+    seek.QuadPart = 0;
+    IStream_Seek(This->stream, seek, STREAM_SEEK_CUR, &This->read_pos);
+
+    LeaveCriticalSection(&This->lock);
+
+    return S_OK;
 }
 
 static HRESULT WINAPI PngDecoder_Frame_GetMetadataQueryReader(IWICBitmapFrameDecode *iface,
@@ -1304,6 +1496,7 @@ HRESULT PngDecoder_CreateInstance(REFIID iid, void** ppv)
     This->stream = NULL;
     This->initialized = FALSE;
     This->image_bits = NULL;
+    This->rows = NULL;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": PngDecoder.lock");
     This->metadata_count = 0;
@@ -17,8 +17,10 @@
  */
 
 #include "config.h"
+#include "wine/port.h"
 
 #include <stdarg.h>
+#include <math.h>
 
 #define COBJMACROS
 
@@ -30,8 +32,23 @@
 
 #include "wine/debug.h"
 
+#ifdef __WINE_TARGET
+#define WINCODECS_SSE2
+#define SSE2_FUNC __WINE_TARGET("sse2")
+#include <emmintrin.h>
+#endif
+
 WINE_DEFAULT_DEBUG_CHANNEL(wincodecs);
 
+/* Weights of the source pixels contributing to each destination pixel along
+ * one axis. */
+typedef struct ScalerKernel {
+    UINT *first;    /* first source pixel of each destination pixel */
+    UINT *count;    /* number of source pixels of each destination pixel */
+    float *weights; /* max_count weights for each destination pixel */
+    UINT max_count;
+} ScalerKernel;
+
 typedef struct BitmapScaler {
     IWICBitmapScaler IWICBitmapScaler_iface;
     LONG ref;
@@ -40,8 +57,20 @@ typedef struct BitmapScaler {
     UINT src_width, src_height;
     WICBitmapInterpolationMode mode;
     UINT bpp;
-    void (*fn_get_required_source_rect)(struct BitmapScaler*,UINT,UINT,WICRect*);
-    void (*fn_copy_scanline)(struct BitmapScaler*,UINT,UINT,UINT,BYTE**,UINT,UINT,BYTE*);
+    UINT channels, channel_bytes;
+    HRESULT (*fn_copy_rows)(struct BitmapScaler*,const WICRect*,UINT,BYTE*);
+    ScalerKernel kernel_x, kernel_y;
+    /* Source rows are kept between calls so that copying the destination
+     * one row at a time reads each of them only once. For the filtering
+     * modes they are filtered horizontally and kept in a ring indexed by
+     * source row modulo row_count. */
+    BYTE *src_rows;
+    float *rows;
+    float *dst_row; /* vertically filtered destination row */
+    UINT *row_ids;
+    UINT row_count;
+    UINT cache_x, cache_width; /* destination columns of the cached rows */
+    UINT cache_next_y;
     CRITICAL_SECTION lock; /* must be held when initialized */
 } BitmapScaler;
 
@@ -96,6 +125,16 @@ static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         if (This->source) IWICBitmapSource_Release(This->source);
+        HeapFree(GetProcessHeap(), 0, This->kernel_x.first);
+        HeapFree(GetProcessHeap(), 0, This->kernel_x.count);
+        HeapFree(GetProcessHeap(), 0, This->kernel_x.weights);
+        HeapFree(GetProcessHeap(), 0, This->kernel_y.first);
+        HeapFree(GetProcessHeap(), 0, This->kernel_y.count);
+        HeapFree(GetProcessHeap(), 0, This->kernel_y.weights);
+        HeapFree(GetProcessHeap(), 0, This->src_rows);
+        HeapFree(GetProcessHeap(), 0, This->rows);
+        HeapFree(GetProcessHeap(), 0, This->dst_row);
+        HeapFree(GetProcessHeap(), 0, This->row_ids);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -165,29 +204,402 @@ static HRESULT WINAPI BitmapScaler_CopyPalette(IWICBitmapScaler *iface,
     return IWICBitmapSource_CopyPalette(This->source, pIPalette);
 }
 
-static void NearestNeighbor_GetRequiredSourceRect(BitmapScaler *This,
-    UINT x, UINT y, WICRect *src_rect)
+/* Makes sure the row cache can hold row_count rows for the given destination
+ * rectangle, plus one destination row. Its contents are only kept when the
+ * rectangle continues the one of the previous call. */
+static HRESULT prepare_row_cache(BitmapScaler *This, const WICRect *dst_rect, UINT row_count,
+    UINT src_row_size, UINT row_size)
+{
+    UINT i;
+
+    if (This->row_ids && dst_rect->X == This->cache_x && dst_rect->Width == This->cache_width)
+    {
+        if (dst_rect->Y != This->cache_next_y)
+        {
+            for (i = 0; i < This->row_count; i++)
+                This->row_ids[i] = ~0u;
+        }
+        This->cache_next_y = dst_rect->Y + dst_rect->Height;
+        return S_OK;
+    }
+
+    HeapFree(GetProcessHeap(), 0, This->src_rows);
+    HeapFree(GetProcessHeap(), 0, This->rows);
+    HeapFree(GetProcessHeap(), 0, This->dst_row);
+    HeapFree(GetProcessHeap(), 0, This->row_ids);
+    This->src_rows = HeapAlloc(GetProcessHeap(), 0, row_count * src_row_size);
+    This->rows = HeapAlloc(GetProcessHeap(), 0, row_count * row_size);
+    This->dst_row = HeapAlloc(GetProcessHeap(), 0, row_size);
+    This->row_ids = HeapAlloc(GetProcessHeap(), 0, row_count * sizeof(*This->row_ids));
+    if (!This->src_rows || !This->rows || !This->dst_row || !This->row_ids)
+    {
+        HeapFree(GetProcessHeap(), 0, This->src_rows);
+        HeapFree(GetProcessHeap(), 0, This->rows);
+        HeapFree(GetProcessHeap(), 0, This->dst_row);
+        HeapFree(GetProcessHeap(), 0, This->row_ids);
+        This->src_rows = NULL;
+        This->rows = NULL;
+        This->dst_row = NULL;
+        This->row_ids = NULL;
+        return E_OUTOFMEMORY;
+    }
+
+    for (i = 0; i < row_count; i++)
+        This->row_ids[i] = ~0u;
+    This->row_count = row_count;
+    This->cache_x = dst_rect->X;
+    This->cache_width = dst_rect->Width;
+    This->cache_next_y = dst_rect->Y + dst_rect->Height;
+    return S_OK;
+}
+
+static HRESULT NearestNeighbor_CopyRows(BitmapScaler *This, const WICRect *dst_rect,
+    UINT stride, BYTE *buffer)
+{
+    UINT bytesperpixel = This->bpp/8;
+    UINT src_x, src_width, src_bytesperrow;
+    WICRect src_rect;
+    HRESULT hr;
+    UINT x, y;
+
+    src_x = dst_rect->X * This->src_width / This->width;
+    src_width = (dst_rect->X + dst_rect->Width - 1) * This->src_width / This->width - src_x + 1;
+    src_bytesperrow = src_width * bytesperpixel;
+
+    /* only the last source row is kept, which is enough when upscaling */
+    hr = prepare_row_cache(This, dst_rect, 1, src_bytesperrow, 0);
+    if (FAILED(hr)) return hr;
+
+    for (y = 0; y < dst_rect->Height; y++)
+    {
+        UINT src_y = (dst_rect->Y + y) * This->src_height / This->height;
+        BYTE *dst = buffer + stride * y;
+
+        if (This->row_ids[0] != src_y)
+        {
+            src_rect.X = src_x;
+            src_rect.Y = src_y;
+            src_rect.Width = src_width;
+            src_rect.Height = 1;
+
+            This->row_ids[0] = ~0u;
+            hr = IWICBitmapSource_CopyPixels(This->source, &src_rect, src_bytesperrow,
+                src_bytesperrow, This->src_rows);
+            if (FAILED(hr)) return hr;
+            This->row_ids[0] = src_y;
+        }
+
+        for (x = 0; x < dst_rect->Width; x++)
+        {
+            UINT sx = (dst_rect->X + x) * This->src_width / This->width - src_x;
+            memcpy(dst + bytesperpixel * x, This->src_rows + bytesperpixel * sx, bytesperpixel);
+        }
+    }
+
+    return S_OK;
+}
+
+static float cubic_weight(float x)
+{
+    /* Catmull-Rom spline */
+    x = fabsf(x);
+    if (x < 1.0f)
+        return (1.5f * x - 2.5f) * x * x + 1.0f;
+    if (x < 2.0f)
+        return ((-0.5f * x + 2.5f) * x - 4.0f) * x + 2.0f;
+    return 0.0f;
+}
+
+static HRESULT init_scaler_kernel(ScalerKernel *kernel, UINT src_length, UINT dst_length,
+    WICBitmapInterpolationMode mode)
+{
+    float scale = (float)src_length / dst_length;
+    float radius, center, sum, weight;
+    UINT d, first, last;
+    int lo, hi, i;
+
+    switch (mode)
+    {
+    case WICBitmapInterpolationModeFant:
+        /* average of the source area covered by the destination pixel */
+        radius = max(scale, 1.0f) / 2.0f;
+        break;
+    case WICBitmapInterpolationModeCubic:
+        radius = 2.0f;
+        break;
+    default:
+        radius = 1.0f;
+        break;
+    }
+
+    HeapFree(GetProcessHeap(), 0, kernel->first);
+    HeapFree(GetProcessHeap(), 0, kernel->count);
+    HeapFree(GetProcessHeap(), 0, kernel->weights);
+
+    kernel->max_count = (UINT)ceilf(2.0f * radius) + 2;
+    kernel->first = HeapAlloc(GetProcessHeap(), 0, dst_length * sizeof(*kernel->first));
+    kernel->count = HeapAlloc(GetProcessHeap(), 0, dst_length * sizeof(*kernel->count));
+    kernel->weights = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY,
+        dst_length * kernel->max_count * sizeof(*kernel->weights));
+    if (!kernel->first || !kernel->count || !kernel->weights)
+        return E_OUTOFMEMORY;
+
+    for (d = 0; d < dst_length; d++)
+    {
+        float *weights = &kernel->weights[d * kernel->max_count];
+
+        center = (d + 0.5f) * scale;
+        lo = (int)floorf(center - radius - 0.5f);
+        hi = (int)ceilf(center + radius - 0.5f);
+        first = min(max(lo, 0), src_length - 1);
+        last = min(max(hi, 0), src_length - 1);
+
+        /* pixels outside of the source are clamped to the edge */
+        sum = 0.0f;
+        for (i = lo; i <= hi; i++)
+        {
+            if (mode == WICBitmapInterpolationModeFant)
+                weight = min(i + 1.0f, center + radius) - max((float)i, center - radius);
+            else if (mode == WICBitmapInterpolationModeCubic)
+                weight = cubic_weight(i + 0.5f - center);
+            else
+                weight = 1.0f - fabsf(i + 0.5f - center);
+            if (weight == 0.0f || (mode != WICBitmapInterpolationModeCubic && weight < 0.0f))
+                continue;
+
+            weights[min(max(i, 0), src_length - 1) - first] += weight;
+            sum += weight;
+        }
+
+        /* drop the pixels that don't contribute */
+        while (first < last && weights[0] == 0.0f)
+        {
+            memmove(weights, weights + 1, (last - first) * sizeof(*weights));
+            weights[last - first] = 0.0f;
+            first++;
+        }
+        while (last > first && weights[last - first] == 0.0f)
+            last--;
+
+        kernel->first[d] = first;
+        kernel->count[d] = last - first + 1;
+        for (i = 0; i < kernel->count[d]; i++)
+            weights[i] /= sum;
+    }
+
+    return S_OK;
+}
+
+#ifdef WINCODECS_SSE2
+static BOOL use_sse2(void)
+{
+    static int supported = -1;
+
+    if (supported == -1) supported = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+    return supported;
+}
+
+/* The SSE2 versions handle four channel pixels, and sum in the same order as
+ * the C versions. */
+static void SSE2_FUNC filter_row_sse2(const ScalerKernel *kernel, const BYTE *src, UINT src_x,
+    UINT channel_bytes, float *dst, UINT dst_x, UINT dst_width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i pixel;
+    __m128 sum;
+    UINT x, i;
+
+    for (x = dst_x; x < dst_x + dst_width; x++, dst += 4)
+    {
+        const float *weights = &kernel->weights[x * kernel->max_count];
+        const BYTE *s = src + (kernel->first[x] - src_x) * 4 * channel_bytes;
+
+        sum = _mm_setzero_ps();
+        for (i = 0; i < kernel->count[x]; i++, s += 4 * channel_bytes)
+        {
+            if (channel_bytes == 1)
+            {
+                DWORD value;
+
+                memcpy(&value, s, sizeof(value));
+                pixel = _mm_unpacklo_epi8(_mm_cvtsi32_si128(value), zero);
+                pixel = _mm_unpacklo_epi16(pixel, zero);
+            }
+            else
+            {
+                pixel = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)s), zero);
+            }
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[i]), _mm_cvtepi32_ps(pixel)));
+        }
+        _mm_storeu_ps(dst, sum);
+    }
+}
+
+static void SSE2_FUNC accumulate_row_sse2(float *dst, const float *src, float weight, UINT count)
+{
+    __m128 w = _mm_set1_ps(weight);
+    UINT i;
+
+    for (i = 0; i + 4 <= count; i += 4)
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(w, _mm_loadu_ps(src + i))));
+    for (; i < count; i++)
+        dst[i] += weight * src[i];
+}
+#endif
+
+/* Filters a source row horizontally, for the destination columns dst_x to
+ * dst_x + dst_width - 1. src starts at source column src_x. */
+static void filter_row(const BitmapScaler *This, const BYTE *src, UINT src_x,
+    float *dst, UINT dst_x, UINT dst_width)
 {
-    src_rect->X = x * This->src_width / This->width;
-    src_rect->Y = y * This->src_height / This->height;
-    src_rect->Width = src_rect->Height = 1;
+    const ScalerKernel *kernel = &This->kernel_x;
+    UINT channels = This->channels;
+    float sum[4];
+    UINT x, i, c;
+
+#ifdef WINCODECS_SSE2
+    if (channels == 4 && use_sse2())
+    {
+        filter_row_sse2(kernel, src, src_x, This->channel_bytes, dst, dst_x, dst_width);
+        return;
+    }
+#endif
+
+    for (x = 0; x < dst_width; x++)
+    {
+        const float *weights = &kernel->weights[(dst_x + x) * kernel->max_count];
+        UINT first = kernel->first[dst_x + x] - src_x;
+
+        for (c = 0; c < channels; c++)
+            sum[c] = 0.0f;
+
+        if (This->channel_bytes == 1)
+        {
+            const BYTE *s = src + first * channels;
+
+            for (i = 0; i < kernel->count[dst_x + x]; i++, s += channels)
+                for (c = 0; c < channels; c++)
+                    sum[c] += weights[i] * s[c];
+        }
+        else
+        {
+            const WORD *s = (const WORD *)src + first * channels;
+
+            for (i = 0; i < kernel->count[dst_x + x]; i++, s += channels)
+                for (c = 0; c < channels; c++)
+                    sum[c] += weights[i] * s[c];
+        }
+
+        for (c = 0; c < channels; c++)
+            *dst++ = sum[c];
+    }
+}
+
+static void accumulate_row(float *dst, const float *src, float weight, UINT count)
+{
+    UINT i;
+
+#ifdef WINCODECS_SSE2
+    if (use_sse2())
+    {
+        accumulate_row_sse2(dst, src, weight, count);
+        return;
+    }
+#endif
+
+    for (i = 0; i < count; i++)
+        dst[i] += weight * src[i];
 }
 
-static void NearestNeighbor_CopyScanline(BitmapScaler *This,
-    UINT dst_x, UINT dst_y, UINT dst_width,
-    BYTE **src_data, UINT src_data_x, UINT src_data_y, BYTE *pbBuffer)
+static void store_row(const BitmapScaler *This, const float *src, BYTE *dst, UINT count)
 {
+    float max_value = This->channel_bytes == 1 ? 255.0f : 65535.0f;
+    float v;
     UINT i;
+
+    for (i = 0; i < count; i++)
+    {
+        /* the cubic filter can overshoot */
+        v = min(max(src[i] + 0.5f, 0.0f), max_value);
+        if (This->channel_bytes == 1)
+            dst[i] = (BYTE)v;
+        else
+            ((WORD *)dst)[i] = (WORD)v;
+    }
+}
+
+static HRESULT Filter_CopyRows(BitmapScaler *This, const WICRect *dst_rect,
+    UINT stride, BYTE *buffer)
+{
+    const ScalerKernel *kernel_y = &This->kernel_y;
     UINT bytesperpixel = This->bpp/8;
-    UINT src_x, src_y;
+    UINT src_width;
+    UINT src_x, src_end, src_bytesperrow, row_size;
+    float *dst_row;
+    WICRect src_rect;
+    HRESULT hr = S_OK;
+    UINT x, y, i;
+
+    /* pixels with zero weight are skipped, so the source ranges of successive
+     * pixels aren't necessarily increasing */
+    src_x = This->src_width;
+    src_end = 0;
+    for (x = dst_rect->X; x < dst_rect->X + dst_rect->Width; x++)
+    {
+        src_x = min(src_x, This->kernel_x.first[x]);
+        src_end = max(src_end, This->kernel_x.first[x] + This->kernel_x.count[x]);
+    }
+    src_width = src_end - src_x;
+    src_bytesperrow = src_width * bytesperpixel;
+    row_size = dst_rect->Width * This->channels;
 
-    src_y = dst_y * This->src_height / This->height - src_data_y;
+    hr = prepare_row_cache(This, dst_rect, kernel_y->max_count, src_bytesperrow, row_size * sizeof(float));
+    if (FAILED(hr)) return hr;
+    dst_row = This->dst_row;
 
-    for (i=0; i<dst_width; i++)
+    for (y = 0; y < dst_rect->Height; y++)
     {
-        src_x = (dst_x + i) * This->src_width / This->width - src_data_x;
-        memcpy(pbBuffer + bytesperpixel * i, src_data[src_y] + bytesperpixel * src_x, bytesperpixel);
+        UINT first = kernel_y->first[dst_rect->Y + y], count = kernel_y->count[dst_rect->Y + y];
+        const float *weights = &kernel_y->weights[(dst_rect->Y + y) * kernel_y->max_count];
+
+        /* The rows needed by successive destination rows move forward, so
+         * the missing ones are at the end and are read in one go. */
+        for (i = 0; i < count; i++)
+            if (This->row_ids[(first + i) % This->row_count] != first + i) break;
+
+        if (i < count)
+        {
+            UINT missing = count - i, j;
+
+            src_rect.X = src_x;
+            src_rect.Y = first + i;
+            src_rect.Width = src_width;
+            src_rect.Height = missing;
+
+            for (j = 0; j < missing; j++)
+                This->row_ids[(first + i + j) % This->row_count] = ~0u;
+            hr = IWICBitmapSource_CopyPixels(This->source, &src_rect, src_bytesperrow,
+                src_bytesperrow * missing, This->src_rows);
+            if (FAILED(hr)) break;
+
+            for (j = 0; j < missing; j++)
+            {
+                UINT slot = (first + i + j) % This->row_count;
+
+                filter_row(This, This->src_rows + src_bytesperrow * j, src_x,
+                    This->rows + slot * row_size, dst_rect->X, dst_rect->Width);
+                This->row_ids[slot] = first + i + j;
+            }
+        }
+
+        memset(dst_row, 0, row_size * sizeof(*dst_row));
+        for (i = 0; i < count; i++)
+            accumulate_row(dst_row, This->rows + ((first + i) % This->row_count) * row_size,
+                weights[i], row_size);
+        store_row(This, dst_row, buffer + stride * y, row_size);
     }
+
+    return hr;
 }
 
 static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
@@ -196,13 +608,7 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     BitmapScaler *This = impl_from_IWICBitmapScaler(iface);
     HRESULT hr;
     WICRect dest_rect;
-    WICRect src_rect_ul, src_rect_br, src_rect;
-    BYTE **src_rows;
-    BYTE *src_bits;
     ULONG bytesperrow;
-    ULONG src_bytesperrow;
-    ULONG buffer_size;
-    UINT y;
 
     TRACE("(%p,%p,%u,%u,%p)\n", iface, prc, cbStride, cbBufferSize, pbBuffer);
 
@@ -244,59 +650,62 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
         goto end;
     }
 
-    /* MSDN recommends calling CopyPixels once for each scanline from top to
-     * bottom, and claims codecs optimize for this. Ideally, when called in this
-     * way, we should avoid requesting a scanline from the source more than
-     * once, by saving the data that will be useful for the next scanline after
-     * the call returns. The GetRequiredSourceRect/CopyScanline functions are
-     * designed to make it possible to do this in a generic way, but for now we
-     * just grab all the data we need in each call. */
-
-    This->fn_get_required_source_rect(This, dest_rect.X, dest_rect.Y, &src_rect_ul);
-    This->fn_get_required_source_rect(This, dest_rect.X+dest_rect.Width-1,
-        dest_rect.Y+dest_rect.Height-1, &src_rect_br);
+    if (!dest_rect.Width || !dest_rect.Height)
+    {
+        hr = S_OK;
+        goto end;
+    }
 
-    src_rect.X = src_rect_ul.X;
-    src_rect.Y = src_rect_ul.Y;
-    src_rect.Width = src_rect_br.Width + src_rect_br.X - src_rect_ul.X;
-    src_rect.Height = src_rect_br.Height + src_rect_br.Y - src_rect_ul.Y;
+    /* MSDN recommends calling CopyPixels once for each scanline from top to
+     * bottom, and claims codecs optimize for this. The source rows are read
+     * as the destination rows need them and kept for the next call, so the
+     * memory used doesn't depend on the size of the source. */
+    hr = This->fn_copy_rows(This, &dest_rect, cbStride, pbBuffer);
 
-    src_bytesperrow = (src_rect.Width * This->bpp + 7)/8;
-    buffer_size = src_bytesperrow * src_rect.Height;
+end:
+    LeaveCriticalSection(&This->lock);
 
-    src_rows = HeapAlloc(GetProcessHeap(), 0, sizeof(BYTE*) * src_rect.Height);
-    src_bits = HeapAlloc(GetProcessHeap(), 0, buffer_size);
+    return hr;
+}
 
-    if (!src_rows || !src_bits)
+/* The filtering modes work on formats made of 8 or 16-bit channels. */
+static BOOL get_scaler_channels(const WICPixelFormatGUID *format, UINT *channels, UINT *channel_bytes)
+{
+    static const struct
     {
-        HeapFree(GetProcessHeap(), 0, src_rows);
-        HeapFree(GetProcessHeap(), 0, src_bits);
-        hr = E_OUTOFMEMORY;
-        goto end;
+        const WICPixelFormatGUID *format;
+        UINT channels, channel_bytes;
     }
+    formats[] =
+    {
+        {&GUID_WICPixelFormat8bppGray, 1, 1},
+        {&GUID_WICPixelFormat16bppGray, 1, 2},
+        {&GUID_WICPixelFormat24bppBGR, 3, 1},
+        {&GUID_WICPixelFormat24bppRGB, 3, 1},
+        {&GUID_WICPixelFormat32bppBGR, 4, 1},
+        {&GUID_WICPixelFormat32bppBGRA, 4, 1},
+        {&GUID_WICPixelFormat32bppPBGRA, 4, 1},
+        {&GUID_WICPixelFormat32bppRGB, 4, 1},
+        {&GUID_WICPixelFormat32bppRGBA, 4, 1},
+        {&GUID_WICPixelFormat32bppPRGBA, 4, 1},
+        {&GUID_WICPixelFormat32bppCMYK, 4, 1},
+        {&GUID_WICPixelFormat48bppRGB, 3, 2},
+        {&GUID_WICPixelFormat64bppRGBA, 4, 2},
+        {&GUID_WICPixelFormat64bppPRGBA, 4, 2},
+    };
+    UINT i;
 
-    for (y=0; y<src_rect.Height; y++)
-        src_rows[y] = src_bits + y * src_bytesperrow;
-
-    hr = IWICBitmapSource_CopyPixels(This->source, &src_rect, src_bytesperrow,
-        buffer_size, src_bits);
-
-    if (SUCCEEDED(hr))
+    for (i = 0; i < sizeof(formats)/sizeof(formats[0]); i++)
     {
-        for (y=0; y < dest_rect.Height; y++)
+        if (IsEqualGUID(formats[i].format, format))
         {
-            This->fn_copy_scanline(This, dest_rect.X, dest_rect.Y+y, dest_rect.Width,
-                src_rows, src_rect.X, src_rect.Y, pbBuffer + cbStride * y);
+            *channels = formats[i].channels;
+            *channel_bytes = formats[i].channel_bytes;
+            return TRUE;
         }
     }
 
-    HeapFree(GetProcessHeap(), 0, src_rows);
-    HeapFree(GetProcessHeap(), 0, src_bits);
-
-end:
-    LeaveCriticalSection(&This->lock);
-
-    return hr;
+    return FALSE;
 }
 
 static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
@@ -337,8 +746,24 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
         {
         default:
             FIXME("unsupported mode %i\n", mode);
-            /* fall-through */
+            mode = WICBitmapInterpolationModeNearestNeighbor;
+            break;
         case WICBitmapInterpolationModeNearestNeighbor:
+            break;
+        case WICBitmapInterpolationModeLinear:
+        case WICBitmapInterpolationModeCubic:
+        case WICBitmapInterpolationModeFant:
+            if (!get_scaler_channels(&src_pixelformat, &This->channels, &This->channel_bytes))
+            {
+                FIXME("filtering not supported for format %s, using nearest neighbor\n",
+                    debugstr_guid(&src_pixelformat));
+                mode = WICBitmapInterpolationModeNearestNeighbor;
+            }
+            break;
+        }
+
+        if (mode == WICBitmapInterpolationModeNearestNeighbor)
+        {
             if ((This->bpp % 8) == 0)
             {
                 IWICBitmapSource_AddRef(pISource);
@@ -350,9 +775,23 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
                     pISource, &This->source);
                 This->bpp = 32;
             }
-            This->fn_get_required_source_rect = NearestNeighbor_GetRequiredSourceRect;
-            This->fn_copy_scanline = NearestNeighbor_CopyScanline;
-            break;
+            This->fn_copy_rows = NearestNeighbor_CopyRows;
+        }
+        else if (!This->width || !This->height || !This->src_width || !This->src_height)
+        {
+            hr = E_INVALIDARG;
+        }
+        else
+        {
+            hr = init_scaler_kernel(&This->kernel_x, This->src_width, This->width, mode);
+            if (SUCCEEDED(hr))
+                hr = init_scaler_kernel(&This->kernel_y, This->src_height, This->height, mode);
+            if (SUCCEEDED(hr))
+            {
+                IWICBitmapSource_AddRef(pISource);
+                This->source = pISource;
+                This->fn_copy_rows = Filter_CopyRows;
+            }
         }
     }
 
@@ -390,6 +829,17 @@ HRESULT BitmapScaler_Create(IWICBitmapScaler **scaler)
     This->src_height = 0;
     This->mode = 0;
     This->bpp = 0;
+    This->channels = 0;
+    This->channel_bytes = 0;
+    memset(&This->kernel_x, 0, sizeof(This->kernel_x));
+    memset(&This->kernel_y, 0, sizeof(This->kernel_y));
+    This->src_rows = NULL;
+    This->rows = NULL;
+    This->dst_row = NULL;
+    This->row_ids = NULL;
+    This->row_count = 0;
+    This->cache_x = This->cache_width = 0;
+    This->cache_next_y = 0;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": BitmapScaler.lock");
 
@@ -972,6 +972,109 @@ static void test_clipper(void)
     IWICBitmapClipper_Release(clipper);
 }
 
+static void test_scaler(void)
+{
+    static const DWORD data[16] =
+    {
+        0xff000000, 0xff000000, 0x80402010, 0x80402010,
+        0xff000000, 0xff000000, 0x80402010, 0x80402010,
+        0x00ffffff, 0xfcffffff, 0x20406080, 0x60402000,
+        0xfcffffff, 0x00ffffff, 0x40404040, 0x40404040,
+    };
+    /* Fant averages the source pixels covered by each destination pixel */
+    static const DWORD expected[4] = {0xff000000, 0x80402010, 0x7effffff, 0x40404040};
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    DWORD buffer[4];
+    UINT width, height, i;
+    WICRect rect;
+    HRESULT hr;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 4, 4, &GUID_WICPixelFormat32bppBGRA,
+        16, sizeof(data), (BYTE *)data, &bitmap);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 2, 2, WICBitmapInterpolationModeFant);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    width = height = 0;
+    hr = IWICBitmapScaler_GetSize(scaler, &width, &height);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    ok(width == 2 && height == 2, "got %ux%u\n", width, height);
+
+    memset(buffer, 0xcc, sizeof(buffer));
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 8, sizeof(buffer), (BYTE *)buffer);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    for (i = 0; i < 4; i++)
+    {
+        ok(buffer[i] == expected[i], "%u: got 0x%08x, expected 0x%08x\n", i, buffer[i], expected[i]);
+    }
+
+    /* one row at a time */
+    memset(buffer, 0xcc, sizeof(buffer));
+    rect.X = 0;
+    rect.Width = 2;
+    rect.Height = 1;
+    for (i = 0; i < 2; i++)
+    {
+        rect.Y = i;
+        hr = IWICBitmapScaler_CopyPixels(scaler, &rect, 8, 8, (BYTE *)(buffer + i * 2));
+        ok(hr == S_OK, "got 0x%08x\n", hr);
+    }
+    for (i = 0; i < 4; i++)
+    {
+        ok(buffer[i] == expected[i], "%u: got 0x%08x, expected 0x%08x\n", i, buffer[i], expected[i]);
+    }
+
+    IWICBitmapScaler_Release(scaler);
+    IWICBitmap_Release(bitmap);
+}
+
+static void test_scaler_gray(WICBitmapInterpolationMode mode, const BYTE *expected)
+{
+    static const BYTE data[4] = {0x00, 0x40, 0xc0, 0xff};
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    BYTE buffer[8];
+    UINT i;
+    HRESULT hr;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 4, 1, &GUID_WICPixelFormat8bppGray,
+        4, sizeof(data), (BYTE *)data, &bitmap);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 8, 1, mode);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    memset(buffer, 0xcc, sizeof(buffer));
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 8, sizeof(buffer), buffer);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    for (i = 0; i < 8; i++)
+    {
+        ok(buffer[i] == expected[i], "mode %u, %u: got 0x%02x, expected 0x%02x\n",
+            mode, i, buffer[i], expected[i]);
+    }
+
+    IWICBitmapScaler_Release(scaler);
+    IWICBitmap_Release(bitmap);
+}
+
+static void test_scaler_modes(void)
+{
+    static const BYTE expected_linear[8] = {0x00, 0x10, 0x30, 0x60, 0xa0, 0xd0, 0xef, 0xff};
+    /* the cubic filter overshoots at the edges, which is clamped */
+    static const BYTE expected_cubic[8] = {0x00, 0x0a, 0x2a, 0x5d, 0xa3, 0xd6, 0xf5, 0xff};
+
+    test_scaler_gray(WICBitmapInterpolationModeLinear, expected_linear);
+    test_scaler_gray(WICBitmapInterpolationModeCubic, expected_cubic);
+}
+
 START_TEST(bitmap)
 {
     HRESULT hr;
@@ -988,6 +1091,8 @@ START_TEST(bitmap)
     test_CreateBitmapFromHICON();
     test_CreateBitmapFromHBITMAP();
     test_clipper();
+    test_scaler();
+    test_scaler_modes();
 
     IWICImagingFactory_Release(factory);
 
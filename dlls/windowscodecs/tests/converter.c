@@ -317,6 +317,106 @@ static void test_conversion(const struct bitmap_data *src, const struct bitmap_d
     DeleteTestBitmap(src_obj);
 }
 
+static void test_wide_conversion(void)
+{
+    /* wide enough to use the vectorized conversions, with a few pixels left over */
+    static const UINT width = 37, height = 3;
+    BYTE gray[37 * 3], bgr[37 * 3 * 3], rgb[37 * 3 * 3], bgra[37 * 3 * 4], gray_bgra[37 * 3 * 4];
+    struct bitmap_data testdata_gray = {&GUID_WICPixelFormat8bppGray, 8, gray, width, height, 96.0, 96.0};
+    struct bitmap_data testdata_bgr = {&GUID_WICPixelFormat24bppBGR, 24, bgr, width, height, 96.0, 96.0};
+    struct bitmap_data testdata_rgb = {&GUID_WICPixelFormat24bppRGB, 24, rgb, width, height, 96.0, 96.0};
+    struct bitmap_data testdata_bgra = {&GUID_WICPixelFormat32bppBGRA, 32, bgra, width, height, 96.0, 96.0};
+    struct bitmap_data testdata_gray_bgra = {&GUID_WICPixelFormat32bppBGRA, 32, gray_bgra, width, height, 96.0, 96.0};
+    UINT i;
+
+    for (i = 0; i < width * height; i++)
+    {
+        gray[i] = i * 7;
+        bgr[3 * i] = rgb[3 * i + 2] = bgra[4 * i] = i * 3;
+        bgr[3 * i + 1] = rgb[3 * i + 1] = bgra[4 * i + 1] = i * 5 + 1;
+        bgr[3 * i + 2] = rgb[3 * i] = bgra[4 * i + 2] = 255 - i;
+        bgra[4 * i + 3] = 255;
+        gray_bgra[4 * i] = gray_bgra[4 * i + 1] = gray_bgra[4 * i + 2] = gray[i];
+        gray_bgra[4 * i + 3] = 255;
+    }
+
+    test_conversion(&testdata_gray, &testdata_gray_bgra, "wide 8bppGray -> 32bppBGRA", FALSE);
+    test_conversion(&testdata_bgr, &testdata_bgra, "wide 24bppBGR -> 32bppBGRA", FALSE);
+    test_conversion(&testdata_rgb, &testdata_bgra, "wide 24bppRGB -> 32bppBGRA", FALSE);
+    test_conversion(&testdata_bgr, &testdata_rgb, "wide 24bppBGR -> 24bppRGB", FALSE);
+    test_conversion(&testdata_bgra, &testdata_bgr, "wide 32bppBGRA -> 24bppBGR", FALSE);
+    test_conversion(&testdata_bgra, &testdata_rgb, "wide 32bppBGRA -> 24bppRGB", FALSE);
+}
+
+static void test_conversion_perf(void)
+{
+    static const struct
+    {
+        const WICPixelFormatGUID *src_format, *dst_format;
+        UINT src_bpp, dst_bpp;
+        const char *name;
+    }
+    tests[] =
+    {
+        {&GUID_WICPixelFormat8bppGray, &GUID_WICPixelFormat32bppBGRA, 8, 32, "8bppGray -> 32bppBGRA"},
+        {&GUID_WICPixelFormat24bppBGR, &GUID_WICPixelFormat32bppBGRA, 24, 32, "24bppBGR -> 32bppBGRA"},
+        {&GUID_WICPixelFormat24bppRGB, &GUID_WICPixelFormat32bppBGRA, 24, 32, "24bppRGB -> 32bppBGRA"},
+        {&GUID_WICPixelFormat24bppBGR, &GUID_WICPixelFormat24bppRGB, 24, 24, "24bppBGR -> 24bppRGB"},
+        {&GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat24bppBGR, 32, 24, "32bppBGRA -> 24bppBGR"},
+        {&GUID_WICPixelFormat32bppBGR, &GUID_WICPixelFormat32bppBGRA, 32, 32, "32bppBGR -> 32bppBGRA"},
+        {&GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat32bppPBGRA, 32, 32, "32bppBGRA -> 32bppPBGRA"},
+    };
+    static const UINT width = 1920, height = 1080, iterations = 20;
+    struct bitmap_data data = {NULL, 0, NULL, width, height, 96.0, 96.0};
+    IWICBitmapSource *dst_bitmap;
+    BitmapTestSrc *src_obj;
+    BYTE *src_bits, *dst_bits;
+    UINT i, j, stride;
+    DWORD start, time;
+    HRESULT hr;
+
+    if (!winetest_interactive)
+    {
+        skip("Skipping conversion benchmark, set WINETEST_INTERACTIVE to run it.\n");
+        return;
+    }
+
+    src_bits = HeapAlloc(GetProcessHeap(), 0, width * height * 4);
+    dst_bits = HeapAlloc(GetProcessHeap(), 0, width * height * 4);
+    for (i = 0; i < width * height * 4; i++)
+        src_bits[i] = i * 7 + (i >> 11);
+    data.bits = src_bits;
+
+    for (i = 0; i < sizeof(tests)/sizeof(tests[0]); i++)
+    {
+        data.format = tests[i].src_format;
+        data.bpp = tests[i].src_bpp;
+        CreateTestBitmap(&data, &src_obj);
+
+        hr = WICConvertBitmapSource(tests[i].dst_format, &src_obj->IWICBitmapSource_iface, &dst_bitmap);
+        ok(hr == S_OK, "%s: WICConvertBitmapSource failed, hr %#x.\n", tests[i].name, hr);
+        if (hr == S_OK)
+        {
+            stride = width * tests[i].dst_bpp / 8;
+            start = GetTickCount();
+            for (j = 0; j < iterations; j++)
+            {
+                hr = IWICBitmapSource_CopyPixels(dst_bitmap, NULL, stride, stride * height, dst_bits);
+                ok(hr == S_OK, "%s: CopyPixels failed, hr %#x.\n", tests[i].name, hr);
+            }
+            time = max(GetTickCount() - start, 1);
+            trace("%s: %u ms per frame, %u MPixel/s.\n", tests[i].name, time / iterations,
+                    (UINT)((ULONGLONG)width * height * iterations / 1000 / time));
+            IWICBitmapSource_Release(dst_bitmap);
+        }
+
+        DeleteTestBitmap(src_obj);
+    }
+
+    HeapFree(GetProcessHeap(), 0, src_bits);
+    HeapFree(GetProcessHeap(), 0, dst_bits);
+}
+
 static void test_invalid_conversion(void)
 {
     BitmapTestSrc *src_obj;
@@ -734,6 +834,9 @@ START_TEST(converter)
     test_conversion(&testdata_32bppBGR, &testdata_24bppRGB, "32bppBGR -> 24bppRGB", FALSE);
     test_conversion(&testdata_24bppRGB, &testdata_32bppBGR, "24bppRGB -> 32bppBGR", FALSE);
 
+    test_wide_conversion();
+    test_conversion_perf();
+
     test_invalid_conversion();
     test_default_converter();
 
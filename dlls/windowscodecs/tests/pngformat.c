@@ -579,6 +579,296 @@ static void test_png_palette(void)
     IWICBitmapDecoder_Release(decoder);
 }
 
+static const WCHAR wszInterlaceOption[] = {'I','n','t','e','r','l','a','c','e','O','p','t','i','o','n',0};
+
+/* encodes an 8bpp grayscale image band rows at a time, buffer holds one band */
+static HRESULT encode_gray_png(IStream *stream, UINT width, UINT height, UINT band,
+                               BOOL interlace, BYTE (*pixel)(UINT, UINT), BYTE *buffer)
+{
+    IWICBitmapEncoder *encoder;
+    IWICBitmapFrameEncode *frame_encode;
+    IPropertyBag2 *options;
+    WICPixelFormatGUID format;
+    PROPBAG2 option;
+    VARIANT var;
+    UINT x, y;
+    HRESULT hr;
+
+    hr = IWICImagingFactory_CreateEncoder(factory, &GUID_ContainerFormatPng, NULL, &encoder);
+    ok(hr == S_OK, "CreateEncoder error %#x\n", hr);
+    if (FAILED(hr)) return hr;
+    hr = IWICBitmapEncoder_Initialize(encoder, stream, WICBitmapEncoderNoCache);
+    ok(hr == S_OK, "Initialize error %#x\n", hr);
+    hr = IWICBitmapEncoder_CreateNewFrame(encoder, &frame_encode, &options);
+    ok(hr == S_OK, "CreateNewFrame error %#x\n", hr);
+
+    memset(&option, 0, sizeof(option));
+    option.pstrName = (LPOLESTR)wszInterlaceOption;
+    V_VT(&var) = VT_BOOL;
+    V_BOOL(&var) = interlace ? VARIANT_TRUE : VARIANT_FALSE;
+    hr = IPropertyBag2_Write(options, 1, &option, &var);
+    ok(hr == S_OK, "Write error %#x\n", hr);
+
+    hr = IWICBitmapFrameEncode_Initialize(frame_encode, options);
+    ok(hr == S_OK, "Initialize error %#x\n", hr);
+    IPropertyBag2_Release(options);
+    hr = IWICBitmapFrameEncode_SetSize(frame_encode, width, height);
+    ok(hr == S_OK, "SetSize error %#x\n", hr);
+    format = GUID_WICPixelFormat8bppGray;
+    hr = IWICBitmapFrameEncode_SetPixelFormat(frame_encode, &format);
+    ok(hr == S_OK, "SetPixelFormat error %#x\n", hr);
+    ok(IsEqualGUID(&format, &GUID_WICPixelFormat8bppGray), "got wrong format %s\n", wine_dbgstr_guid(&format));
+
+    for (y = 0; y < height; y += band)
+    {
+        UINT i;
+
+        for (i = 0; i < band; i++)
+            for (x = 0; x < width; x++)
+                buffer[width * i + x] = pixel(x, y + i);
+
+        hr = IWICBitmapFrameEncode_WritePixels(frame_encode, band, width, width * band, buffer);
+        ok(hr == S_OK, "WritePixels error %#x\n", hr);
+    }
+
+    hr = IWICBitmapFrameEncode_Commit(frame_encode);
+    ok(hr == S_OK, "Commit error %#x\n", hr);
+    hr = IWICBitmapEncoder_Commit(encoder);
+    ok(hr == S_OK, "Commit error %#x\n", hr);
+    IWICBitmapFrameEncode_Release(frame_encode);
+    IWICBitmapEncoder_Release(encoder);
+
+    return hr;
+}
+
+static BOOL check_gray_rect(IWICBitmapFrameDecode *frame, const WICRect *rc, BYTE *buffer,
+                            BYTE (*pixel)(UINT, UINT))
+{
+    HRESULT hr;
+    INT x, y;
+
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, rc, rc->Width, rc->Width * rc->Height, buffer);
+    ok(hr == S_OK, "CopyPixels(%d,%d,%d,%d) error %#x\n", rc->X, rc->Y, rc->Width, rc->Height, hr);
+    if (hr != S_OK) return FALSE;
+
+    for (y = 0; y < rc->Height; y++)
+        for (x = 0; x < rc->Width; x++)
+            if (buffer[rc->Width * y + x] != pixel(rc->X + x, rc->Y + y))
+            {
+                ok(0, "got %#x at (%d,%d)\n", buffer[rc->Width * y + x], rc->X + x, rc->Y + y);
+                return FALSE;
+            }
+
+    return TRUE;
+}
+
+/* private memory committed by the process, the decoders allocate their
+ * image buffers from the process heap */
+static SIZE_T get_committed_memory(void)
+{
+    MEMORY_BASIC_INFORMATION info;
+    const char *addr = NULL;
+    SIZE_T size = 0;
+
+    while (VirtualQuery(addr, &info, sizeof(info)))
+    {
+        if (info.State == MEM_COMMIT && info.Type == MEM_PRIVATE)
+            size += info.RegionSize;
+        if ((const char *)info.BaseAddress + info.RegionSize <= addr) break;
+        addr = (const char *)info.BaseAddress + info.RegionSize;
+    }
+
+    return size;
+}
+
+static BYTE large_image_pixel(UINT x, UINT y)
+{
+    return x + 3 * y;
+}
+
+static void test_png_large_image(void)
+{
+    /* 32MB decoded, much more than a decoder needs to keep around to serve
+     * small rectangles or a single pass over the image */
+    static const UINT width = 4096, height = 8192, band = 64;
+    IWICBitmapDecoder *decoder;
+    IWICBitmapFrameDecode *frame;
+    SIZE_T committed, held;
+    LARGE_INTEGER pos;
+    IStream *stream;
+    WICRect rc;
+    BYTE *buffer;
+    HRESULT hr;
+
+    buffer = HeapAlloc(GetProcessHeap(), 0, width * band);
+
+    hr = CreateStreamOnHGlobal(NULL, TRUE, &stream);
+    ok(hr == S_OK, "CreateStreamOnHGlobal error %#x\n", hr);
+
+    hr = encode_gray_png(stream, width, height, band, FALSE, large_image_pixel, buffer);
+    if (FAILED(hr))
+    {
+        IStream_Release(stream);
+        HeapFree(GetProcessHeap(), 0, buffer);
+        return;
+    }
+
+    pos.QuadPart = 0;
+    IStream_Seek(stream, pos, STREAM_SEEK_SET, NULL);
+
+    committed = get_committed_memory();
+
+    hr = IWICImagingFactory_CreateDecoderFromStream(factory, stream, NULL, 0, &decoder);
+    ok(hr == S_OK, "CreateDecoderFromStream error %#x\n", hr);
+    IStream_Release(stream);
+    if (FAILED(hr))
+    {
+        HeapFree(GetProcessHeap(), 0, buffer);
+        return;
+    }
+
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK, "GetFrame error %#x\n", hr);
+
+    /* small rectangles, going back up the image */
+    rc.X = width - 17;
+    rc.Y = height - 3;
+    rc.Width = 17;
+    rc.Height = 3;
+    check_gray_rect(frame, &rc, buffer, large_image_pixel);
+
+    rc.X = 1001;
+    rc.Y = height / 2;
+    rc.Width = 100;
+    rc.Height = 100;
+    check_gray_rect(frame, &rc, buffer, large_image_pixel);
+
+    rc.X = 0;
+    rc.Y = 0;
+    rc.Width = width;
+    rc.Height = 1;
+    check_gray_rect(frame, &rc, buffer, large_image_pixel);
+
+    /* one pass over the whole image */
+    rc.X = 0;
+    rc.Width = width;
+    rc.Height = band;
+    for (rc.Y = 0; rc.Y < height; rc.Y += band)
+        if (!check_gray_rect(frame, &rc, buffer, large_image_pixel)) break;
+
+    /* the frame is still alive, so anything it cached is still committed */
+    held = get_committed_memory();
+    held = held > committed ? held - committed : 0;
+    ok(held < width * height / 2, "decoder holds %u bytes\n", (UINT)held);
+
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+    HeapFree(GetProcessHeap(), 0, buffer);
+}
+
+static BYTE noise_pixel(UINT x, UINT y)
+{
+    UINT h = x * 0x9e3779b1 ^ y * 0x85ebca6b;
+
+    h ^= h >> 15;
+    h *= 0x2c1b3c6d;
+    h ^= h >> 12;
+    return h;
+}
+
+static void test_png_corrupt_image(BOOL interlace)
+{
+    /* noise doesn't compress, so the image data is split over several IDAT chunks */
+    static const UINT width = 256, height = 128;
+    IWICBitmapDecoder *decoder;
+    IWICBitmapFrameDecode *frame;
+    LARGE_INTEGER pos;
+    ULARGE_INTEGER end;
+    IStream *stream;
+    HGLOBAL hglobal;
+    WICRect rc;
+    BYTE *buffer, *data, *last_idat = NULL;
+    UINT size, offset, idat_count = 0;
+    HRESULT hr;
+
+    buffer = HeapAlloc(GetProcessHeap(), 0, width * height);
+
+    hr = CreateStreamOnHGlobal(NULL, TRUE, &stream);
+    ok(hr == S_OK, "CreateStreamOnHGlobal error %#x\n", hr);
+
+    hr = encode_gray_png(stream, width, height, height, interlace, noise_pixel, buffer);
+    if (FAILED(hr))
+    {
+        IStream_Release(stream);
+        HeapFree(GetProcessHeap(), 0, buffer);
+        return;
+    }
+
+    /* turn the last IDAT chunk into an unknown ancillary chunk, so that the
+     * image data ends early while the chunk structure is still intact */
+    hr = GetHGlobalFromStream(stream, &hglobal);
+    ok(hr == S_OK, "GetHGlobalFromStream error %#x\n", hr);
+    data = GlobalLock(hglobal);
+    pos.QuadPart = 0;
+    IStream_Seek(stream, pos, STREAM_SEEK_CUR, &end);
+    for (offset = 8; offset + 8 <= end.QuadPart; offset += size + 12)
+    {
+        size = (data[offset] << 24) | (data[offset + 1] << 16) | (data[offset + 2] << 8) | data[offset + 3];
+        if (!memcmp(data + offset + 4, "IDAT", 4))
+        {
+            last_idat = data + offset + 4;
+            idat_count++;
+        }
+    }
+    ok(idat_count > 1, "got %u IDAT chunks\n", idat_count);
+    if (last_idat) last_idat[0] = 'i';
+    GlobalUnlock(hglobal);
+
+    pos.QuadPart = 0;
+    IStream_Seek(stream, pos, STREAM_SEEK_SET, NULL);
+
+    /* Wine only decodes the image data in CopyPixels, native may already
+     * decode it here and fail */
+    hr = IWICImagingFactory_CreateDecoderFromStream(factory, stream, NULL, 0, &decoder);
+    ok(hr == S_OK || broken(FAILED(hr)), "CreateDecoderFromStream error %#x\n", hr);
+    IStream_Release(stream);
+    if (FAILED(hr))
+    {
+        HeapFree(GetProcessHeap(), 0, buffer);
+        return;
+    }
+
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK, "GetFrame error %#x\n", hr);
+
+    rc.X = 0;
+    rc.Y = 0;
+    rc.Width = width;
+    rc.Height = 16;
+    if (!interlace)
+        check_gray_rect(frame, &rc, buffer, noise_pixel);
+
+    /* failing again shows the decoder didn't read on from where it broke */
+    rc.Height = height;
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, width, width * height, buffer);
+    ok(FAILED(hr), "CopyPixels succeeded\n");
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, width, width * height, buffer);
+    ok(FAILED(hr), "CopyPixels succeeded\n");
+
+    rc.Height = 16;
+    if (!interlace)
+        check_gray_rect(frame, &rc, buffer, noise_pixel);
+    else
+    {
+        hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, width, width * rc.Height, buffer);
+        ok(FAILED(hr), "CopyPixels succeeded\n");
+    }
+
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+    HeapFree(GetProcessHeap(), 0, buffer);
+}
+
 START_TEST(pngformat)
 {
     HRESULT hr;
@@ -591,6 +881,9 @@ START_TEST(pngformat)
 
     test_color_contexts();
     test_png_palette();
+    test_png_large_image();
+    test_png_corrupt_image(FALSE);
+    test_png_corrupt_image(TRUE);
 
     IWICImagingFactory_Release(factory);
     CoUninitialize();
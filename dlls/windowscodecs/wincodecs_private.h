@@ -105,6 +105,10 @@ extern HRESULT copy_pixels(UINT bpp, const BYTE *srcbuffer,
     UINT srcwidth, UINT srcheight, INT srcstride,
     const WICRect *rc, UINT dststride, UINT dstbuffersize, BYTE *dstbuffer) DECLSPEC_HIDDEN;
 
+/* Streaming decoders keep at most this many bytes of decoded rows, and decode
+ * the image again when an earlier row is requested. */
+#define DECODER_ROW_CACHE_SIZE (4 * 1024 * 1024)
+
 extern HRESULT configure_write_source(IWICBitmapFrameEncode *iface,
     IWICBitmapSource *source, const WICRect *prc,
     const WICPixelFormatGUID *format,
@@ -35,6 +35,7 @@ WINE_DEFAULT_DEBUG_CHANNEL(d3d);
 #define WINED3D_BUFFER_DISCARD      0x08    /* A DISCARD lock has occurred since the last preload. */
 #define WINED3D_BUFFER_SYNC         0x10    /* There has been at least one synchronized map since the last preload. */
 #define WINED3D_BUFFER_APPLESYNC    0x20    /* Using sync as in GL_APPLE_flush_buffer_range. */
+#define WINED3D_BUFFER_STREAM       0x40    /* Allocate the buffer object from the device's stream allocator. */
 
 #define VB_MAXDECLCHANGES     100     /* After that number of decl changes we stop converting */
 #define VB_RESETDECLCHANGE    1000    /* Reset the decl changecount after that number of draws */
@@ -104,11 +105,370 @@ static void buffer_bind(struct wined3d_buffer *buffer, struct wined3d_context *c
     GL_EXTCALL(glBindBuffer(buffer->buffer_type_hint, buffer->buffer_object));
 }
 
+struct wined3d_stream_batch
+{
+    struct list entry;
+    struct wined3d_event_query *query;
+    struct wined3d_stream_block_list blocks;
+};
+
+static BOOL stream_block_list_add(struct wined3d_stream_block_list *list, const struct wined3d_stream_block *block)
+{
+    if (list->count == list->size)
+    {
+        SIZE_T new_size = max(list->size * 2, 16);
+        struct wined3d_stream_block *new;
+
+        if (!list->blocks)
+            new = HeapAlloc(GetProcessHeap(), 0, new_size * sizeof(*new));
+        else
+            new = HeapReAlloc(GetProcessHeap(), 0, list->blocks, new_size * sizeof(*new));
+        if (!new)
+            return FALSE;
+
+        list->blocks = new;
+        list->size = new_size;
+    }
+
+    list->blocks[list->count++] = *block;
+    return TRUE;
+}
+
+static void stream_block_list_cleanup(struct wined3d_stream_block_list *list)
+{
+    HeapFree(GetProcessHeap(), 0, list->blocks);
+    memset(list, 0, sizeof(*list));
+}
+
+static void stream_allocator_free_blocks(struct wined3d_stream_allocator *allocator,
+        const struct wined3d_stream_block_list *list)
+{
+    const struct wined3d_stream_block *block;
+    SIZE_T i;
+
+    for (i = 0; i < list->count; ++i)
+    {
+        block = &list->blocks[i];
+        if (!stream_block_list_add(&allocator->free[block->size_class], block))
+            ERR("Failed to add stream block to the free list, leaking it.\n");
+    }
+}
+
+static void stream_allocator_free_batch(struct wined3d_stream_allocator *allocator, struct wined3d_stream_batch *batch)
+{
+    stream_allocator_free_blocks(allocator, &batch->blocks);
+    list_remove(&batch->entry);
+    wined3d_event_query_destroy(batch->query);
+    stream_block_list_cleanup(&batch->blocks);
+    HeapFree(GetProcessHeap(), 0, batch);
+}
+
+/* The blocks are retired by the ops that last use them, so the fence has to
+ * be issued by the thread executing the ops, after the GL commands of those
+ * ops. A fence issued in another context wouldn't wait for them. */
+void wined3d_stream_allocator_fence(struct wined3d_device *device)
+{
+    struct wined3d_stream_allocator *allocator = &device->stream_allocator;
+    struct wined3d_stream_batch *batch;
+
+    if (!allocator->retired.count || !wined3d_cs_is_executing_thread(device->cs))
+        return;
+
+    if (!(batch = HeapAlloc(GetProcessHeap(), 0, sizeof(*batch))))
+    {
+        ERR("Failed to allocate stream batch memory.\n");
+        return;
+    }
+    if (!(batch->query = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*batch->query))))
+    {
+        ERR("Failed to allocate event query memory.\n");
+        HeapFree(GetProcessHeap(), 0, batch);
+        return;
+    }
+
+    wined3d_event_query_issue(batch->query, device);
+    batch->blocks = allocator->retired;
+    memset(&allocator->retired, 0, sizeof(allocator->retired));
+    allocator->retired_size = 0;
+    list_add_tail(&allocator->batches, &batch->entry);
+}
+
+/* Called on the thread executing the ops. Once the GPU is idle, all retired
+ * and fenced blocks can be reused. */
+static void stream_allocator_sync_cb(void *object)
+{
+    struct wined3d_device *device = object;
+    struct wined3d_stream_allocator *allocator = &device->stream_allocator;
+    struct wined3d_stream_batch *batch, *next;
+    struct wined3d_context *context;
+
+    context = context_acquire(device, NULL);
+    context->gl_info->gl_ops.gl.p_glFinish();
+    context_release(context);
+
+    LIST_FOR_EACH_ENTRY_SAFE(batch, next, &allocator->batches, struct wined3d_stream_batch, entry)
+    {
+        stream_allocator_free_batch(allocator, batch);
+    }
+    stream_allocator_free_blocks(allocator, &allocator->retired);
+    allocator->retired.count = 0;
+    allocator->retired_size = 0;
+}
+
+/* Waits for the queued ops and the GPU commands they submitted. */
+static void stream_allocator_sync(struct wined3d_device *device)
+{
+    struct wined3d_cs *cs = device->cs;
+
+    wined3d_cs_emit_callback(cs, stream_allocator_sync_cb, device);
+    wined3d_cs_finish(cs);
+}
+
+/* Moves blocks the GPU is done with to the free lists. If "wait" is set,
+ * waits for the oldest batch. */
+static void stream_allocator_reclaim(struct wined3d_device *device, BOOL wait)
+{
+    struct wined3d_stream_allocator *allocator = &device->stream_allocator;
+    struct wined3d_stream_batch *batch, *next;
+    enum wined3d_event_query_result ret;
+
+    LIST_FOR_EACH_ENTRY_SAFE(batch, next, &allocator->batches, struct wined3d_stream_batch, entry)
+    {
+        if (wait)
+            ret = wined3d_event_query_finish(batch->query, device);
+        else
+            ret = wined3d_event_query_test(batch->query, device);
+
+        if (ret == WINED3D_EVENT_QUERY_WAITING)
+            break;
+
+        /* If the fence can't be checked, keep the batch around and try
+         * again later, unless the caller needs the blocks now. */
+        if (ret != WINED3D_EVENT_QUERY_OK)
+        {
+            WARN("Failed to check stream batch %p, ret %#x.\n", batch, ret);
+            if (wait)
+                stream_allocator_sync(device);
+            break;
+        }
+
+        stream_allocator_free_batch(allocator, batch);
+
+        if (wait)
+            break;
+    }
+}
+
+/* Context activation is done by the caller. */
+static struct wined3d_stream_chunk *stream_allocator_create_chunk(struct wined3d_context *context)
+{
+    static const GLbitfield map_flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT
+            | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    struct wined3d_stream_chunk *chunk;
+
+    if (!(chunk = HeapAlloc(GetProcessHeap(), 0, sizeof(*chunk))))
+        return NULL;
+
+    GL_EXTCALL(glGenBuffers(1, &chunk->buffer_object));
+    GL_EXTCALL(glBindBuffer(GL_ARRAY_BUFFER, chunk->buffer_object));
+    GL_EXTCALL(glBufferStorage(GL_ARRAY_BUFFER, WINED3D_STREAM_CHUNK_SIZE, NULL,
+            map_flags | GL_DYNAMIC_STORAGE_BIT));
+    chunk->ptr = GL_EXTCALL(glMapBufferRange(GL_ARRAY_BUFFER, 0, WINED3D_STREAM_CHUNK_SIZE, map_flags));
+    checkGLcall("create stream chunk");
+
+    if (!chunk->ptr)
+    {
+        ERR("Failed to map stream chunk.\n");
+        GL_EXTCALL(glDeleteBuffers(1, &chunk->buffer_object));
+        HeapFree(GetProcessHeap(), 0, chunk);
+        return NULL;
+    }
+
+    TRACE("Created stream chunk %p, buffer object %u, memory %p.\n", chunk, chunk->buffer_object, chunk->ptr);
+
+    return chunk;
+}
+
+/* Context activation is done by the caller. */
+static BOOL stream_allocator_alloc(struct wined3d_device *device, struct wined3d_context *context,
+        unsigned int size, struct wined3d_stream_block *block)
+{
+    struct wined3d_stream_allocator *allocator = &device->stream_allocator;
+    struct wined3d_stream_block_list *free_list;
+    struct wined3d_stream_chunk *chunk;
+    unsigned int size_class = 0;
+    unsigned int block_size;
+    BOOL polled = FALSE;
+
+    while ((1u << (WINED3D_STREAM_MIN_BLOCK_SHIFT + size_class)) < size)
+        ++size_class;
+    if (size_class >= WINED3D_STREAM_BLOCK_CLASSES)
+        return FALSE;
+    block_size = 1u << (WINED3D_STREAM_MIN_BLOCK_SHIFT + size_class);
+    free_list = &allocator->free[size_class];
+
+    for (;;)
+    {
+        if (free_list->count)
+        {
+            *block = free_list->blocks[--free_list->count];
+            return TRUE;
+        }
+
+        if (!polled && !list_empty(&allocator->batches))
+        {
+            stream_allocator_reclaim(device, FALSE);
+            polled = TRUE;
+            continue;
+        }
+
+        /* All block sizes are multiples of the smallest one, so this keeps
+         * blocks aligned. */
+        if (allocator->chunk_count && allocator->chunk_offset + block_size <= WINED3D_STREAM_CHUNK_SIZE)
+        {
+            block->chunk = allocator->chunks[allocator->chunk_count - 1];
+            block->offset = allocator->chunk_offset;
+            block->size_class = size_class;
+            allocator->chunk_offset += block_size;
+            return TRUE;
+        }
+
+        if (allocator->chunk_count < WINED3D_STREAM_MAX_CHUNKS
+                && (chunk = stream_allocator_create_chunk(context)))
+        {
+            allocator->chunks[allocator->chunk_count++] = chunk;
+            allocator->chunk_offset = 0;
+            continue;
+        }
+
+        /* Out of memory, wait for the GPU to release some blocks. */
+        if (list_empty(&allocator->batches))
+            wined3d_stream_allocator_fence(device);
+        if (!list_empty(&allocator->batches))
+            stream_allocator_reclaim(device, TRUE);
+        else if (allocator->retired.count)
+            stream_allocator_sync(device);
+        else
+            return FALSE;
+    }
+}
+
+static void stream_allocator_retire(struct wined3d_device *device, const struct wined3d_stream_block *block)
+{
+    struct wined3d_stream_allocator *allocator = &device->stream_allocator;
+
+    if (!stream_block_list_add(&allocator->retired, block))
+    {
+        ERR("Failed to retire stream block, leaking it.\n");
+        return;
+    }
+
+    /* Applications that rarely present shouldn't be able to hold on to
+     * arbitrary amounts of retired blocks. Blocks retired by the worker
+     * thread are fenced after the batch of ops that retires them. */
+    allocator->retired_size += 1u << (WINED3D_STREAM_MIN_BLOCK_SHIFT + block->size_class);
+    if (allocator->retired_size >= WINED3D_STREAM_CHUNK_SIZE && !device->cs->thread)
+        wined3d_stream_allocator_fence(device);
+}
+
+/* Context activation is done by the caller. */
+void wined3d_stream_allocator_cleanup(struct wined3d_device *device, const struct wined3d_gl_info *gl_info)
+{
+    struct wined3d_stream_allocator *allocator = &device->stream_allocator;
+    struct wined3d_stream_batch *batch, *next;
+    unsigned int i;
+
+    LIST_FOR_EACH_ENTRY_SAFE(batch, next, &allocator->batches, struct wined3d_stream_batch, entry)
+    {
+        list_remove(&batch->entry);
+        wined3d_event_query_destroy(batch->query);
+        stream_block_list_cleanup(&batch->blocks);
+        HeapFree(GetProcessHeap(), 0, batch);
+    }
+
+    stream_block_list_cleanup(&allocator->retired);
+    allocator->retired_size = 0;
+    for (i = 0; i < WINED3D_STREAM_BLOCK_CLASSES; ++i)
+        stream_block_list_cleanup(&allocator->free[i]);
+
+    for (i = 0; i < allocator->chunk_count; ++i)
+    {
+        GL_EXTCALL(glDeleteBuffers(1, &allocator->chunks[i]->buffer_object));
+        HeapFree(GetProcessHeap(), 0, allocator->chunks[i]);
+    }
+    checkGLcall("delete stream chunks");
+    allocator->chunk_count = 0;
+    allocator->chunk_offset = 0;
+}
+
+/* Called on the thread executing the ops. */
+void buffer_stream_set_block(struct wined3d_buffer *buffer, const struct wined3d_stream_block *block)
+{
+    struct wined3d_device *device = buffer->resource.device;
+
+    if (buffer->stream_block.chunk)
+        stream_allocator_retire(device, &buffer->stream_block);
+    buffer->stream_block = *block;
+    buffer->buffer_object = block->chunk->buffer_object;
+    buffer->map_ptr = block->chunk->ptr + block->offset;
+
+    if (buffer->resource.bind_count)
+    {
+        device_invalidate_state(device, STATE_STREAMSRC);
+        device_invalidate_state(device, STATE_INDEXBUFFER);
+    }
+}
+
+/* Replaces the block of a stream allocated buffer, instead of waiting for
+ * the GPU to finish using it. The buffer switches to the new block in
+ * command stream order, the application can write to it right away. */
+static void buffer_stream_rename(struct wined3d_buffer *buffer, BOOL preserve)
+{
+    struct wined3d_device *device = buffer->resource.device;
+    struct wined3d_stream_block block;
+    struct wined3d_context *context;
+    BOOL ret;
+
+    context = context_acquire(device, NULL);
+    ret = stream_allocator_alloc(device, context, buffer->resource.size, &block);
+    context_release(context);
+
+    if (!ret)
+    {
+        /* wined3d_buffer_map() didn't wait for the buffer. */
+        WARN("Failed to allocate a stream block, synchronizing.\n");
+        stream_allocator_sync(device);
+        return;
+    }
+
+    /* Only the application writes to stream allocated buffers, so the
+     * current contents are in the map block. The GPU can't be using the
+     * new block yet. */
+    if (preserve)
+        memcpy(block.chunk->ptr + block.offset, buffer->map_block.chunk->ptr + buffer->map_block.offset,
+                buffer->resource.size);
+    buffer->map_block = block;
+    buffer->flags |= WINED3D_BUFFER_DISCARD;
+
+    wined3d_cs_emit_rename_buffer(device->cs, buffer, &block);
+}
+
 /* Context activation is done by the caller */
 static void delete_gl_buffer(struct wined3d_buffer *This, const struct wined3d_gl_info *gl_info)
 {
     if(!This->buffer_object) return;
 
+    if (This->stream_block.chunk)
+    {
+        stream_allocator_retire(This->resource.device, &This->stream_block);
+        memset(&This->stream_block, 0, sizeof(This->stream_block));
+        memset(&This->map_block, 0, sizeof(This->map_block));
+        This->buffer_object = 0;
+        This->map_ptr = NULL;
+        return;
+    }
+
     GL_EXTCALL(glDeleteBuffers(1, &This->buffer_object));
     checkGLcall("glDeleteBuffers");
     This->buffer_object = 0;
@@ -131,6 +491,26 @@ static void buffer_create_buffer_object(struct wined3d_buffer *This, struct wine
     TRACE("Creating an OpenGL vertex buffer object for wined3d_buffer %p with usage %s.\n",
             This, debug_d3dusage(This->resource.usage));
 
+    if (This->flags & WINED3D_BUFFER_STREAM)
+    {
+        struct wined3d_stream_block block;
+
+        if (stream_allocator_alloc(This->resource.device, context, This->resource.size, &block))
+        {
+            buffer_stream_set_block(This, &block);
+            This->map_block = block;
+            This->flags |= WINED3D_BUFFER_DISCARD;
+            TRACE("Using stream block %p+%#x.\n", This->stream_block.chunk, This->stream_block.offset);
+            if (This->resource.heap_memory)
+                memcpy(This->map_ptr, This->resource.heap_memory, This->resource.size);
+            wined3d_resource_free_sysmem(&This->resource);
+            return;
+        }
+
+        WARN("Failed to allocate a stream block, using a separate buffer object.\n");
+        This->flags &= ~WINED3D_BUFFER_STREAM;
+    }
+
     /* Make sure that the gl error is cleared. Do not use checkGLcall
     * here because checkGLcall just prints a fixme and continues. However,
     * if an error during VBO creation occurs we can fall back to non-vbo operation
@@ -451,6 +831,90 @@ static inline void fixup_transformed_pos(float *p)
     }
 }
 
+/* A converted attribute, at "offset" bytes into each vertex. */
+struct wined3d_buffer_conversion
+{
+    unsigned int offset;
+    enum wined3d_buffer_conversion_type type;
+};
+
+/* Collapses the per-byte conversion map into a list of converted attributes,
+ * so that conversion doesn't need to walk the map for every vertex. */
+static unsigned int buffer_get_conversions(const struct wined3d_buffer *buffer,
+        struct wined3d_buffer_conversion *conversions, unsigned int max_count)
+{
+    unsigned int i, size, count = 0;
+
+    for (i = 0; i < buffer->stride; i += size)
+    {
+        switch (buffer->conversion_map[i])
+        {
+            case CONV_NONE:
+                size = 4;
+                continue;
+
+            case CONV_D3DCOLOR:
+                size = sizeof(DWORD);
+                break;
+
+            case CONV_POSITIONT:
+                size = 4 * sizeof(float);
+                break;
+
+            default:
+                FIXME("Unimplemented conversion %d in shifted conversion\n", buffer->conversion_map[i]);
+                size = 1;
+                continue;
+        }
+
+        if (i + size > buffer->stride)
+        {
+            FIXME("Converted attribute at offset %u crosses the vertex boundary.\n", i);
+            break;
+        }
+        if (count == max_count)
+        {
+            FIXME("Too many converted attributes.\n");
+            break;
+        }
+        conversions[count].offset = i;
+        conversions[count].type = buffer->conversion_map[i];
+        ++count;
+    }
+
+    return count;
+}
+
+static void buffer_convert_attribute(BYTE *data, unsigned int stride, unsigned int count,
+        const struct wined3d_buffer_conversion *conversion)
+{
+    BYTE *ptr = data + conversion->offset;
+    unsigned int i;
+
+    switch (conversion->type)
+    {
+        case CONV_D3DCOLOR:
+            for (i = 0; i < count; ++i, ptr += stride)
+                fixup_d3dcolor((DWORD *)ptr);
+            break;
+
+        case CONV_POSITIONT:
+            for (i = 0; i < count; ++i, ptr += stride)
+                fixup_transformed_pos((float *)ptr);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static int buffer_map_range_compare(const void *a, const void *b)
+{
+    const struct wined3d_map_range *r1 = a, *r2 = b;
+
+    return r1->offset < r2->offset ? -1 : r1->offset > r2->offset;
+}
+
 /* Context activation is done by the caller. */
 void buffer_get_memory(struct wined3d_buffer *buffer, struct wined3d_context *context,
         struct wined3d_bo_address *data)
@@ -464,7 +928,7 @@ void buffer_get_memory(struct wined3d_buffer *buffer, struct wined3d_context *co
             if (buffer->buffer_object)
             {
                 data->buffer_object = buffer->buffer_object;
-                data->addr = NULL;
+                data->addr = (BYTE *)(ULONG_PTR)buffer->stream_block.offset;
                 return;
             }
         }
@@ -472,7 +936,7 @@ void buffer_get_memory(struct wined3d_buffer *buffer, struct wined3d_context *co
     }
     else
     {
-        data->addr = NULL;
+        data->addr = (BYTE *)(ULONG_PTR)buffer->stream_block.offset;
     }
 }
 
@@ -493,6 +957,9 @@ BYTE *buffer_get_sysmem(struct wined3d_buffer *buffer, struct wined3d_context *c
     /* Heap_memory exists if the buffer is double buffered or has no buffer object at all. */
     if (buffer->resource.heap_memory)
         return buffer->resource.heap_memory;
+    /* Stream allocated buffers are always mapped. */
+    if (buffer->stream_block.chunk)
+        return buffer->map_ptr;
 
     if (!wined3d_resource_allocate_sysmem(&buffer->resource))
         ERR("Failed to allocate system memory.\n");
@@ -518,8 +985,15 @@ static void buffer_unload(struct wined3d_resource *resource)
 
         context = context_acquire(device, NULL);
 
+        if (buffer->stream_block.chunk)
+        {
+            if (wined3d_resource_allocate_sysmem(&buffer->resource))
+                memcpy(buffer->resource.heap_memory, buffer->map_ptr, buffer->resource.size);
+            else
+                ERR("Failed to allocate system memory.\n");
+        }
         /* Download the buffer, but don't permanently enable double buffering */
-        if (!(buffer->flags & WINED3D_BUFFER_DOUBLEBUFFER))
+        else if (!(buffer->flags & WINED3D_BUFFER_DOUBLEBUFFER))
         {
             buffer_get_sysmem(buffer, context);
             buffer->flags &= ~WINED3D_BUFFER_DOUBLEBUFFER;
@@ -540,28 +1014,36 @@ static void buffer_unload(struct wined3d_resource *resource)
     resource_unload(resource);
 }
 
+static void wined3d_buffer_destroy_object(void *object)
+{
+    struct wined3d_buffer *buffer = object;
+    struct wined3d_context *context;
+
+    if (buffer->buffer_object)
+    {
+        context = context_acquire(buffer->resource.device, NULL);
+        delete_gl_buffer(buffer, context->gl_info);
+        context_release(context);
+
+        HeapFree(GetProcessHeap(), 0, buffer->conversion_map);
+    }
+
+    resource_destroy(&buffer->resource);
+    HeapFree(GetProcessHeap(), 0, buffer->maps);
+    HeapFree(GetProcessHeap(), 0, buffer);
+}
+
 ULONG CDECL wined3d_buffer_decref(struct wined3d_buffer *buffer)
 {
     ULONG refcount = InterlockedDecrement(&buffer->resource.ref);
-    struct wined3d_context *context;
 
     TRACE("%p decreasing refcount to %u.\n", buffer, refcount);
 
     if (!refcount)
     {
-        if (buffer->buffer_object)
-        {
-            context = context_acquire(buffer->resource.device, NULL);
-            delete_gl_buffer(buffer, context->gl_info);
-            context_release(context);
-
-            HeapFree(GetProcessHeap(), 0, buffer->conversion_map);
-        }
-
-        resource_cleanup(&buffer->resource);
         buffer->resource.parent_ops->wined3d_object_destroyed(buffer->resource.parent);
-        HeapFree(GetProcessHeap(), 0, buffer->maps);
-        HeapFree(GetProcessHeap(), 0, buffer);
+        resource_detach(&buffer->resource);
+        wined3d_cs_emit_callback(buffer->resource.device->cs, wined3d_buffer_destroy_object, buffer);
     }
 
     return refcount;
@@ -718,11 +1200,12 @@ void buffer_internal_preload(struct wined3d_buffer *buffer, struct wined3d_conte
         const struct wined3d_state *state)
 {
     DWORD flags = buffer->flags & (WINED3D_BUFFER_SYNC | WINED3D_BUFFER_DISCARD);
+    struct wined3d_buffer_conversion conversions[WINED3D_FFP_ATTRIBS_COUNT];
     struct wined3d_device *device = buffer->resource.device;
     UINT start, end, len, vertices;
     const struct wined3d_gl_info *gl_info;
+    unsigned int i, j, count;
     BOOL decl_changed = FALSE;
-    unsigned int i, j;
     BYTE *data;
 
     TRACE("buffer %p.\n", buffer);
@@ -871,48 +1354,68 @@ void buffer_internal_preload(struct wined3d_buffer *buffer, struct wined3d_conte
         buffer_get_sysmem(buffer, context);
     }
 
-    /* Now for each vertex in the buffer that needs conversion */
+    count = buffer_get_conversions(buffer, conversions, ARRAY_SIZE(conversions));
+
+    /* Only whole vertices can be converted, so extend the dirty ranges to
+     * vertex boundaries, and merge them so that vertices covered by several
+     * ranges are converted only once. */
     vertices = buffer->resource.size / buffer->stride;
+    for (i = 0; i < buffer->modified_areas; ++i)
+    {
+        start = buffer->maps[i].offset - buffer->maps[i].offset % buffer->stride;
+        end = buffer->maps[i].offset + buffer->maps[i].size;
+        if (end < vertices * buffer->stride && end % buffer->stride)
+            end += buffer->stride - end % buffer->stride;
+        buffer->maps[i].offset = start;
+        buffer->maps[i].size = end - start;
+    }
+    if (buffer->modified_areas > 1)
+    {
+        qsort(buffer->maps, buffer->modified_areas, sizeof(*buffer->maps), buffer_map_range_compare);
+        for (i = 1, j = 0; i < buffer->modified_areas; ++i)
+        {
+            if (buffer->maps[i].offset <= buffer->maps[j].offset + buffer->maps[j].size)
+            {
+                end = max(buffer->maps[j].offset + buffer->maps[j].size,
+                        buffer->maps[i].offset + buffer->maps[i].size);
+                buffer->maps[j].size = end - buffer->maps[j].offset;
+            }
+            else
+            {
+                buffer->maps[++j] = buffer->maps[i];
+            }
+        }
+        buffer->modified_areas = j + 1;
+    }
 
-    data = HeapAlloc(GetProcessHeap(), 0, buffer->resource.size);
+    for (i = 0, len = 0; i < buffer->modified_areas; ++i)
+        len = max(len, buffer->maps[i].size);
+    if (!(data = HeapAlloc(GetProcessHeap(), 0, len)))
+    {
+        ERR("Failed to allocate conversion buffer.\n");
+        return;
+    }
+
+    GL_EXTCALL(glBindBuffer(buffer->buffer_type_hint, buffer->buffer_object));
+    checkGLcall("glBindBuffer");
 
-    while(buffer->modified_areas)
+    while (buffer->modified_areas)
     {
         buffer->modified_areas--;
         start = buffer->maps[buffer->modified_areas].offset;
         len = buffer->maps[buffer->modified_areas].size;
-        end = start + len;
+        end = min(start + len, vertices * buffer->stride);
 
-        memcpy(data + start, (BYTE *)buffer->resource.heap_memory + start, end - start);
-        for (i = start / buffer->stride; i < min((end / buffer->stride) + 1, vertices); ++i)
+        memcpy(data, (BYTE *)buffer->resource.heap_memory + start, len);
+        if (end > start)
         {
-            for (j = 0; j < buffer->stride; ++j)
-            {
-                switch (buffer->conversion_map[j])
-                {
-                    case CONV_NONE:
-                        /* Done already */
-                        j += 3;
-                        break;
-                    case CONV_D3DCOLOR:
-                        fixup_d3dcolor((DWORD *) (data + i * buffer->stride + j));
-                        j += 3;
-                        break;
-
-                    case CONV_POSITIONT:
-                        fixup_transformed_pos((float *) (data + i * buffer->stride + j));
-                        j += 15;
-                        break;
-                    default:
-                        FIXME("Unimplemented conversion %d in shifted conversion\n", buffer->conversion_map[j]);
-                }
-            }
+            for (i = 0; i < count; ++i)
+                buffer_convert_attribute(data, buffer->stride, (end - start) / buffer->stride, &conversions[i]);
         }
 
-        GL_EXTCALL(glBindBuffer(buffer->buffer_type_hint, buffer->buffer_object));
-        checkGLcall("glBindBuffer");
-        GL_EXTCALL(glBufferSubData(buffer->buffer_type_hint, start, len, data + start));
+        GL_EXTCALL(glBufferSubData(buffer->buffer_type_hint, start, len, data));
         checkGLcall("glBufferSubData");
+        device->converted_vertex_bytes += len;
     }
 
     HeapFree(GetProcessHeap(), 0, data);
@@ -921,6 +1424,9 @@ void buffer_internal_preload(struct wined3d_buffer *buffer, struct wined3d_conte
 void CDECL wined3d_buffer_preload(struct wined3d_buffer *buffer)
 {
     struct wined3d_context *context;
+
+    wined3d_resource_wait_idle(&buffer->resource);
+
     context = context_acquire(buffer->resource.device, NULL);
     buffer_internal_preload(buffer, context, NULL);
     context_release(context);
@@ -935,12 +1441,26 @@ struct wined3d_resource * CDECL wined3d_buffer_get_resource(struct wined3d_buffe
 
 HRESULT CDECL wined3d_buffer_map(struct wined3d_buffer *buffer, UINT offset, UINT size, BYTE **data, DWORD flags)
 {
+    BOOL rename;
     LONG count;
     BYTE *base;
 
     TRACE("buffer %p, offset %u, size %u, data %p, flags %#x\n", buffer, offset, size, data, flags);
 
     flags = wined3d_resource_sanitize_map_flags(&buffer->resource, flags);
+    /* Stream allocated buffers get a new block if the GPU may still be using
+     * the current one. Renaming happens in command stream order, so there's
+     * nothing to wait for. */
+    rename = buffer->stream_block.chunk && !buffer->resource.map_count
+            && !(buffer->flags & WINED3D_BUFFER_DISCARD)
+            && !(flags & (WINED3D_MAP_READONLY | WINED3D_MAP_NOOVERWRITE));
+    /* Otherwise only wait for the command stream to finish with this buffer.
+     * With WINED3D_MAP_NOOVERWRITE the application promises not to touch
+     * data in use, but GL doesn't allow drawing from a buffer object that is
+     * mapped without persistence, so those still have to wait. */
+    if (!rename && (!(flags & WINED3D_MAP_NOOVERWRITE) || (buffer->buffer_object && !buffer->stream_block.chunk
+            && !(buffer->flags & WINED3D_BUFFER_DOUBLEBUFFER))))
+        wined3d_resource_wait_idle(&buffer->resource);
     /* Filter redundant WINED3D_MAP_DISCARD maps. The 3DMark2001 multitexture
      * fill rate test seems to depend on this. When we map a buffer with
      * GL_MAP_INVALIDATE_BUFFER_BIT, the driver is free to discard the
@@ -951,7 +1471,13 @@ HRESULT CDECL wined3d_buffer_map(struct wined3d_buffer *buffer, UINT offset, UIN
         flags &= ~WINED3D_MAP_DISCARD;
     count = ++buffer->resource.map_count;
 
-    if (buffer->buffer_object)
+    if (buffer->stream_block.chunk)
+    {
+        /* Stream allocated buffers are persistently mapped. */
+        if (rename)
+            buffer_stream_rename(buffer, !(flags & WINED3D_MAP_DISCARD));
+    }
+    else if (buffer->buffer_object)
     {
         /* DISCARD invalidates the entire buffer, regardless of the specified
          * offset and size. Some applications also depend on the entire buffer
@@ -1029,7 +1555,10 @@ HRESULT CDECL wined3d_buffer_map(struct wined3d_buffer *buffer, UINT offset, UIN
             buffer->flags |= WINED3D_BUFFER_SYNC;
     }
 
-    base = buffer->map_ptr ? buffer->map_ptr : buffer->resource.heap_memory;
+    if (buffer->stream_block.chunk)
+        base = buffer->map_block.chunk->ptr + buffer->map_block.offset;
+    else
+        base = buffer->map_ptr ? buffer->map_ptr : buffer->resource.heap_memory;
     *data = base + offset;
 
     TRACE("Returning memory at %p (base %p, offset %u).\n", *data, base, offset);
@@ -1061,6 +1590,10 @@ void CDECL wined3d_buffer_unmap(struct wined3d_buffer *buffer)
         return;
     }
 
+    /* The mapping is coherent and stays in place. */
+    if (buffer->stream_block.chunk)
+        return;
+
     if (!(buffer->flags & WINED3D_BUFFER_DOUBLEBUFFER) && buffer->buffer_object)
     {
         struct wined3d_device *device = buffer->resource.device;
@@ -1101,7 +1634,11 @@ void CDECL wined3d_buffer_unmap(struct wined3d_buffer *buffer)
     }
     else if (buffer->flags & WINED3D_BUFFER_HASDESC)
     {
-        wined3d_buffer_preload(buffer);
+        struct wined3d_context *context;
+
+        context = context_acquire(buffer->resource.device, NULL);
+        buffer_internal_preload(buffer, context, NULL);
+        context_release(context);
     }
 }
 
@@ -1124,11 +1661,13 @@ HRESULT wined3d_buffer_copy(struct wined3d_buffer *dst_buffer, unsigned int dst_
     buffer_get_memory(src_buffer, context, &src_bo_address);
 
     dst_buffer_mem = dst_buffer->resource.heap_memory;
-    src_buffer_mem = src_buffer->resource.heap_memory;
+    src_buffer_mem = src_buffer->stream_block.chunk ? src_buffer->map_ptr : src_buffer->resource.heap_memory;
 
-    if (!dst_buffer_mem && !src_buffer_mem)
+    /* Writing to the current block of a stream allocated buffer would race
+     * with the GPU, go through wined3d_buffer_map() instead. */
+    if ((!dst_buffer_mem && !src_buffer_mem) || dst_buffer->stream_block.chunk)
     {
-        if (gl_info->supported[ARB_COPY_BUFFER])
+        if (gl_info->supported[ARB_COPY_BUFFER] && !dst_buffer->stream_block.chunk)
         {
             GL_EXTCALL(glBindBuffer(GL_COPY_READ_BUFFER, src_bo_address.buffer_object));
             GL_EXTCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, dst_bo_address.buffer_object));
@@ -1329,6 +1868,15 @@ static HRESULT buffer_init(struct wined3d_buffer *buffer, struct wined3d_device
         buffer->flags |= WINED3D_BUFFER_USE_BO;
     }
 
+    if ((buffer->flags & WINED3D_BUFFER_USE_BO) && (buffer->resource.usage & WINED3DUSAGE_DYNAMIC)
+            && !(buffer->flags & WINED3D_BUFFER_DOUBLEBUFFER)
+            && gl_info->supported[ARB_BUFFER_STORAGE] && gl_info->supported[ARB_SYNC]
+            && size <= 1u << WINED3D_STREAM_MAX_BLOCK_SHIFT)
+    {
+        TRACE("Using the stream allocator.\n");
+        buffer->flags |= WINED3D_BUFFER_STREAM;
+    }
+
     if (!(buffer->maps = HeapAlloc(GetProcessHeap(), 0, sizeof(*buffer->maps))))
     {
         ERR("Out of memory.\n");
@@ -645,7 +645,12 @@ static void context_apply_fbo_state(struct wined3d_context *context, GLenum targ
         struct wined3d_surface **render_targets, struct wined3d_surface *depth_stencil,
         DWORD color_location, DWORD ds_location)
 {
+    struct wined3d_frame_stats *stats = context->swapchain->device->cs->frame_stats;
     struct fbo_entry *entry, *entry2;
+    ULONGLONG start = 0;
+
+    if (stats)
+        start = wined3d_frame_stats_time();
 
     LIST_FOR_EACH_ENTRY_SAFE(entry, entry2, &context->fbo_destroy_list, struct fbo_entry, entry)
     {
@@ -669,6 +674,12 @@ static void context_apply_fbo_state(struct wined3d_context *context, GLenum targ
                 color_location, ds_location);
         context_apply_fbo_entry(context, target, context->current_fbo);
     }
+
+    if (stats)
+    {
+        stats->fbo_time += wined3d_frame_stats_time() - start;
+        ++stats->fbo_count;
+    }
 }
 
 /* Context activation is done by the caller. */
@@ -1345,6 +1356,12 @@ void context_release(struct wined3d_context *context)
 
     if (!--context->level)
     {
+        struct wined3d_cs *cs = context->swapchain->device->cs;
+
+        /* The command stream thread draws with its own context; make sure
+         * it sees what the application thread did with this one. */
+        if (cs->thread && GetCurrentThreadId() != cs->thread_id)
+            context->gl_info->gl_ops.gl.p_glFlush();
         if (context_restore_pixel_format(context))
             context->needs_set = 1;
         if (context->restore_ctx)
@@ -1409,6 +1426,266 @@ void context_invalidate_state(struct wined3d_context *context, DWORD state)
     context->isStateDirty[idx] |= (1u << shift);
 }
 
+/* Returns TRUE if the GL call can be skipped. */
+static BOOL context_gl_cache_filter(struct wined3d_context *context, DWORD flag, BOOL equal)
+{
+    struct wined3d_frame_stats *stats = context->swapchain->device->cs->frame_stats;
+    BOOL filter = (context->gl_cache.valid & flag) == flag && equal;
+
+    if (stats)
+    {
+        if (filter)
+            ++stats->gl_state_filtered;
+        else
+            ++stats->gl_state_issued;
+    }
+    context->gl_cache.valid |= flag;
+
+    return filter;
+}
+
+void context_invalidate_gl_cache(struct wined3d_context *context, DWORD mask)
+{
+    context->gl_cache.valid &= ~mask;
+}
+
+static int context_gl_cache_cap_idx(GLenum cap)
+{
+    switch (cap)
+    {
+        case GL_BLEND:          return 0;
+        case GL_CULL_FACE:      return 1;
+        case GL_DEPTH_TEST:     return 2;
+        case GL_SCISSOR_TEST:   return 3;
+        case GL_STENCIL_TEST:   return 4;
+        default:                return -1;
+    }
+}
+
+/* Context activation is done by the caller. */
+void context_gl_enable(struct wined3d_context *context, GLenum cap, BOOL enable)
+{
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    int idx = context_gl_cache_cap_idx(cap);
+
+    if (idx >= 0)
+    {
+        DWORD bit = 1u << idx;
+
+        if (context_gl_cache_filter(context, WINED3D_GL_CACHE_CAP(idx), !(context->gl_cache.caps & bit) == !enable))
+            return;
+        if (enable)
+            context->gl_cache.caps |= bit;
+        else
+            context->gl_cache.caps &= ~bit;
+    }
+
+    if (enable)
+        gl_info->gl_ops.gl.p_glEnable(cap);
+    else
+        gl_info->gl_ops.gl.p_glDisable(cap);
+    checkGLcall("glEnable / glDisable");
+}
+
+/* Context activation is done by the caller. "index" is -1 to set the mask
+ * for all draw buffers. */
+void context_gl_color_mask(struct wined3d_context *context, int index, DWORD mask)
+{
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    DWORD flag, masks;
+    unsigned int i;
+
+    mask &= 0xf;
+    if (index < 0)
+    {
+        flag = masks = 0;
+        for (i = 0; i < WINED3D_GL_CACHE_COLOR_MASKS; ++i)
+        {
+            flag |= WINED3D_GL_CACHE_COLOR_MASK(i);
+            masks |= mask << (i * 4);
+        }
+    }
+    else if (index < WINED3D_GL_CACHE_COLOR_MASKS)
+    {
+        flag = WINED3D_GL_CACHE_COLOR_MASK(index);
+        masks = (context->gl_cache.color_masks & ~(0xfu << (index * 4))) | (mask << (index * 4));
+    }
+    else
+    {
+        flag = 0;
+        masks = context->gl_cache.color_masks;
+    }
+
+    if (flag && context_gl_cache_filter(context, flag, context->gl_cache.color_masks == masks))
+        return;
+    context->gl_cache.color_masks = masks;
+
+    if (index < 0)
+    {
+        gl_info->gl_ops.gl.p_glColorMask(mask & WINED3DCOLORWRITEENABLE_RED ? GL_TRUE : GL_FALSE,
+                mask & WINED3DCOLORWRITEENABLE_GREEN ? GL_TRUE : GL_FALSE,
+                mask & WINED3DCOLORWRITEENABLE_BLUE ? GL_TRUE : GL_FALSE,
+                mask & WINED3DCOLORWRITEENABLE_ALPHA ? GL_TRUE : GL_FALSE);
+        checkGLcall("glColorMask");
+    }
+    else
+    {
+        GL_EXTCALL(glColorMaski(index,
+                mask & WINED3DCOLORWRITEENABLE_RED ? GL_TRUE : GL_FALSE,
+                mask & WINED3DCOLORWRITEENABLE_GREEN ? GL_TRUE : GL_FALSE,
+                mask & WINED3DCOLORWRITEENABLE_BLUE ? GL_TRUE : GL_FALSE,
+                mask & WINED3DCOLORWRITEENABLE_ALPHA ? GL_TRUE : GL_FALSE));
+        checkGLcall("glColorMaski");
+    }
+}
+
+/* Context activation is done by the caller. glBlendFuncSeparate() is only
+ * used if the alpha factors differ from the color factors. */
+void context_gl_blend_func(struct wined3d_context *context, GLenum src, GLenum dst,
+        GLenum src_alpha, GLenum dst_alpha)
+{
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    GLenum *cache = context->gl_cache.blend_func;
+
+    if (context_gl_cache_filter(context, WINED3D_GL_CACHE_BLEND_FUNC, cache[0] == src && cache[1] == dst
+            && cache[2] == src_alpha && cache[3] == dst_alpha))
+        return;
+    cache[0] = src;
+    cache[1] = dst;
+    cache[2] = src_alpha;
+    cache[3] = dst_alpha;
+
+    if (src_alpha == src && dst_alpha == dst)
+    {
+        gl_info->gl_ops.gl.p_glBlendFunc(src, dst);
+        checkGLcall("glBlendFunc");
+    }
+    else
+    {
+        GL_EXTCALL(glBlendFuncSeparate(src, dst, src_alpha, dst_alpha));
+        checkGLcall("glBlendFuncSeparate");
+    }
+}
+
+/* Context activation is done by the caller. */
+void context_gl_blend_equation(struct wined3d_context *context, GLenum equation, GLenum equation_alpha)
+{
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    GLenum *cache = context->gl_cache.blend_equation;
+
+    if (context_gl_cache_filter(context, WINED3D_GL_CACHE_BLEND_EQUATION,
+            cache[0] == equation && cache[1] == equation_alpha))
+        return;
+    cache[0] = equation;
+    cache[1] = equation_alpha;
+
+    if (equation_alpha == equation)
+    {
+        GL_EXTCALL(glBlendEquation(equation));
+        checkGLcall("glBlendEquation");
+    }
+    else
+    {
+        GL_EXTCALL(glBlendEquationSeparate(equation, equation_alpha));
+        checkGLcall("glBlendEquationSeparate");
+    }
+}
+
+/* Context activation is done by the caller. */
+void context_gl_depth_func(struct wined3d_context *context, GLenum func)
+{
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+
+    if (context_gl_cache_filter(context, WINED3D_GL_CACHE_DEPTH_FUNC, context->gl_cache.depth_func == func))
+        return;
+    context->gl_cache.depth_func = func;
+
+    gl_info->gl_ops.gl.p_glDepthFunc(func);
+    checkGLcall("glDepthFunc");
+}
+
+/* Context activation is done by the caller. */
+void context_gl_depth_mask(struct wined3d_context *context, GLboolean mask)
+{
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+
+    mask = mask ? GL_TRUE : GL_FALSE;
+    if (context_gl_cache_filter(context, WINED3D_GL_CACHE_DEPTH_MASK, context->gl_cache.depth_mask == mask))
+        return;
+    context->gl_cache.depth_mask = mask;
+
+    gl_info->gl_ops.gl.p_glDepthMask(mask);
+    checkGLcall("glDepthMask");
+}
+
+static BOOL context_gl_stencil_face_equal(const struct wined3d_gl_stencil_face *face, GLenum func,
+        GLint ref, GLuint mask, GLenum stencil_fail, GLenum depth_fail, GLenum depth_pass)
+{
+    return face->func == func && face->ref == ref && face->mask == mask
+            && face->ops[0] == stencil_fail && face->ops[1] == depth_fail && face->ops[2] == depth_pass;
+}
+
+/* Context activation is done by the caller. "face" is GL_FRONT, GL_BACK or
+ * GL_FRONT_AND_BACK; the separate versions require GL 2.0. This doesn't deal
+ * with GL_EXT_stencil_two_side or GL_ATI_separate_stencil, users of those
+ * have to invalidate the stencil state in the cache. */
+void context_gl_stencil(struct wined3d_context *context, GLenum face, GLenum func, GLint ref, GLuint mask,
+        GLenum stencil_fail, GLenum depth_fail, GLenum depth_pass)
+{
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    struct wined3d_gl_stencil_face *cache;
+    unsigned int i, first, last;
+    BOOL equal = TRUE;
+    DWORD flag = 0;
+
+    first = face == GL_BACK ? 1 : 0;
+    last = face == GL_FRONT ? 0 : 1;
+    for (i = first; i <= last; ++i)
+    {
+        flag |= i ? WINED3D_GL_CACHE_STENCIL_BACK : WINED3D_GL_CACHE_STENCIL_FRONT;
+        equal = equal && context_gl_stencil_face_equal(&context->gl_cache.stencil[i],
+                func, ref, mask, stencil_fail, depth_fail, depth_pass);
+    }
+
+    if (context_gl_cache_filter(context, flag, equal))
+        return;
+    for (i = first; i <= last; ++i)
+    {
+        cache = &context->gl_cache.stencil[i];
+        cache->func = func;
+        cache->ref = ref;
+        cache->mask = mask;
+        cache->ops[0] = stencil_fail;
+        cache->ops[1] = depth_fail;
+        cache->ops[2] = depth_pass;
+    }
+
+    if (face == GL_FRONT_AND_BACK)
+    {
+        gl_info->gl_ops.gl.p_glStencilFunc(func, ref, mask);
+        gl_info->gl_ops.gl.p_glStencilOp(stencil_fail, depth_fail, depth_pass);
+    }
+    else
+    {
+        GL_EXTCALL(glStencilFuncSeparate(face, func, ref, mask));
+        GL_EXTCALL(glStencilOpSeparate(face, stencil_fail, depth_fail, depth_pass));
+    }
+    checkGLcall("set stencil state");
+}
+
+/* Context activation is done by the caller. */
+void context_gl_stencil_mask(struct wined3d_context *context, GLuint mask)
+{
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+
+    if (context_gl_cache_filter(context, WINED3D_GL_CACHE_STENCIL_MASK, context->gl_cache.stencil_mask == mask))
+        return;
+    context->gl_cache.stencil_mask = mask;
+
+    gl_info->gl_ops.gl.p_glStencilMask(mask);
+    checkGLcall("glStencilMask");
+}
+
 /* This function takes care of wined3d pixel format selection. */
 static int context_choose_pixel_format(const struct wined3d_device *device, HDC hdc,
         const struct wined3d_format *color_format, const struct wined3d_format *ds_format,
@@ -2197,23 +2474,18 @@ static void SetupForBlit(const struct wined3d_device *device, struct wined3d_con
     gl_info->gl_ops.gl.p_glDisable(GL_LIGHTING);
     checkGLcall("glDisable GL_LIGHTING");
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_LIGHTING));
-    gl_info->gl_ops.gl.p_glDisable(GL_DEPTH_TEST);
-    checkGLcall("glDisable GL_DEPTH_TEST");
+    context_gl_enable(context, GL_DEPTH_TEST, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_ZENABLE));
     glDisableWINE(GL_FOG);
     checkGLcall("glDisable GL_FOG");
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_FOGENABLE));
-    gl_info->gl_ops.gl.p_glDisable(GL_BLEND);
-    checkGLcall("glDisable GL_BLEND");
+    context_gl_enable(context, GL_BLEND, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_ALPHABLENDENABLE));
-    gl_info->gl_ops.gl.p_glDisable(GL_CULL_FACE);
-    checkGLcall("glDisable GL_CULL_FACE");
+    context_gl_enable(context, GL_CULL_FACE, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_CULLMODE));
-    gl_info->gl_ops.gl.p_glDisable(GL_STENCIL_TEST);
-    checkGLcall("glDisable GL_STENCIL_TEST");
+    context_gl_enable(context, GL_STENCIL_TEST, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_STENCILENABLE));
-    gl_info->gl_ops.gl.p_glDisable(GL_SCISSOR_TEST);
-    checkGLcall("glDisable GL_SCISSOR_TEST");
+    context_gl_enable(context, GL_SCISSOR_TEST, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_SCISSORTESTENABLE));
     if (gl_info->supported[ARB_POINT_SPRITE])
     {
@@ -2221,8 +2493,7 @@ static void SetupForBlit(const struct wined3d_device *device, struct wined3d_con
         checkGLcall("glDisable GL_POINT_SPRITE_ARB");
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_POINTSPRITEENABLE));
     }
-    gl_info->gl_ops.gl.p_glColorMask(GL_TRUE, GL_TRUE,GL_TRUE,GL_TRUE);
-    checkGLcall("glColorMask");
+    context_gl_color_mask(context, -1, 0xf);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_COLORWRITEENABLE));
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_COLORWRITEENABLE1));
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_COLORWRITEENABLE2));
@@ -2638,8 +2909,8 @@ BOOL context_apply_clear_state(struct wined3d_context *context, const struct win
     /* Blending and clearing should be orthogonal, but tests on the nvidia
      * driver show that disabling blending when clearing improves the clearing
      * performance incredibly. */
-    gl_info->gl_ops.gl.p_glDisable(GL_BLEND);
-    gl_info->gl_ops.gl.p_glEnable(GL_SCISSOR_TEST);
+    context_gl_enable(context, GL_BLEND, FALSE);
+    context_gl_enable(context, GL_SCISSOR_TEST, TRUE);
     if (rt_count && gl_info->supported[ARB_FRAMEBUFFER_SRGB])
     {
         if (needs_srgb_write(context, state, fb))
@@ -3351,7 +3622,9 @@ BOOL context_apply_draw_state(struct wined3d_context *context,
         const struct wined3d_device *device, const struct wined3d_state *state)
 {
     const struct StateEntry *state_table = context->state_table;
+    struct wined3d_frame_stats *stats = device->cs->frame_stats;
     const struct wined3d_fb_state *fb = state->fb;
+    ULONGLONG start = 0;
     unsigned int i;
     WORD map;
 
@@ -3395,6 +3668,9 @@ BOOL context_apply_draw_state(struct wined3d_context *context,
             buffer_get_sysmem(state->index_buffer, context);
     }
 
+    if (stats)
+        start = wined3d_frame_stats_time();
+
     for (i = 0; i < context->numDirtyEntries; ++i)
     {
         DWORD rep = context->dirtyArray[i];
@@ -3416,6 +3692,12 @@ BOOL context_apply_draw_state(struct wined3d_context *context,
         context->constant_update_mask = 0;
     }
 
+    if (stats)
+    {
+        stats->state_time += wined3d_frame_stats_time() - start;
+        stats->state_count += context->numDirtyEntries;
+    }
+
     if (context->update_shader_resource_bindings)
     {
         context_bind_shader_resources(context, state);
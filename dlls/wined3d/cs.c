@@ -18,11 +18,18 @@
 
 #include "config.h"
 #include "wine/port.h"
+
+#include <stdio.h>
+
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 
 #define WINED3D_INITIAL_CS_SIZE 4096
+#define WINED3D_CS_QUEUE_SIZE 0x100000
+#define WINED3D_CS_BATCH_SIZE 32
+#define WINED3D_CS_QUERY_POLL_INTERVAL 1
 
 enum wined3d_cs_op
 {
@@ -51,7 +58,13 @@ enum wined3d_cs_op
     WINED3D_CS_OP_SET_CLIP_PLANE,
     WINED3D_CS_OP_SET_COLOR_KEY,
     WINED3D_CS_OP_SET_MATERIAL,
+    WINED3D_CS_OP_SET_LIGHT,
+    WINED3D_CS_OP_SET_LIGHT_ENABLE,
+    WINED3D_CS_OP_PUSH_CONSTANTS,
     WINED3D_CS_OP_RESET_STATE,
+    WINED3D_CS_OP_QUERY_ISSUE,
+    WINED3D_CS_OP_RENAME_BUFFER,
+    WINED3D_CS_OP_CALLBACK,
 };
 
 struct wined3d_cs_present
@@ -82,6 +95,8 @@ struct wined3d_cs_draw
     UINT index_count;
     UINT start_instance;
     UINT instance_count;
+    GLenum primitive_type;
+    INT base_vertex_idx;
     BOOL indexed;
 };
 
@@ -246,11 +261,111 @@ struct wined3d_cs_set_material
     struct wined3d_material material;
 };
 
+struct wined3d_cs_set_light
+{
+    enum wined3d_cs_op opcode;
+    struct wined3d_light_info light;
+};
+
+struct wined3d_cs_set_light_enable
+{
+    enum wined3d_cs_op opcode;
+    UINT idx;
+    BOOL enable;
+};
+
+struct wined3d_cs_push_constants
+{
+    enum wined3d_cs_op opcode;
+    enum wined3d_push_constants type;
+    unsigned int start_idx;
+    unsigned int count;
+    BYTE constants[1];
+};
+
 struct wined3d_cs_reset_state
 {
     enum wined3d_cs_op opcode;
 };
 
+struct wined3d_cs_query_issue
+{
+    enum wined3d_cs_op opcode;
+    struct wined3d_query *query;
+    DWORD flags;
+};
+
+struct wined3d_cs_rename_buffer
+{
+    enum wined3d_cs_op opcode;
+    struct wined3d_buffer *buffer;
+    struct wined3d_stream_block block;
+};
+
+struct wined3d_cs_callback
+{
+    enum wined3d_cs_op opcode;
+    void (*callback)(void *object);
+    void *object;
+};
+
+/* Records that the op currently being built uses the resource. */
+static void wined3d_cs_use_resource(struct wined3d_cs *cs, struct wined3d_resource *resource)
+{
+    resource->access_op = cs->submitted_ops + 1;
+}
+
+static void wined3d_cs_use_fb_resources(struct wined3d_cs *cs, const struct wined3d_fb_state *fb)
+{
+    const struct wined3d_gl_info *gl_info = &cs->device->adapter->gl_info;
+    unsigned int i;
+
+    for (i = 0; i < gl_info->limits.buffers; ++i)
+    {
+        if (fb->render_targets[i])
+            wined3d_cs_use_resource(cs, fb->render_targets[i]->resource);
+    }
+    if (fb->depth_stencil)
+        wined3d_cs_use_resource(cs, fb->depth_stencil->resource);
+}
+
+static void wined3d_cs_use_state_resources(struct wined3d_cs *cs, const struct wined3d_state *state)
+{
+    unsigned int i, j;
+
+    for (i = 0; i < ARRAY_SIZE(state->streams); ++i)
+    {
+        if (state->streams[i].buffer)
+            wined3d_cs_use_resource(cs, &state->streams[i].buffer->resource);
+    }
+    for (i = 0; i < ARRAY_SIZE(state->stream_output); ++i)
+    {
+        if (state->stream_output[i].buffer)
+            wined3d_cs_use_resource(cs, &state->stream_output[i].buffer->resource);
+    }
+    if (state->index_buffer)
+        wined3d_cs_use_resource(cs, &state->index_buffer->resource);
+    for (i = 0; i < ARRAY_SIZE(state->textures); ++i)
+    {
+        if (state->textures[i])
+            wined3d_cs_use_resource(cs, &state->textures[i]->resource);
+    }
+    for (i = 0; i < WINED3D_SHADER_TYPE_COUNT; ++i)
+    {
+        for (j = 0; j < MAX_CONSTANT_BUFFERS; ++j)
+        {
+            if (state->cb[i][j])
+                wined3d_cs_use_resource(cs, &state->cb[i][j]->resource);
+        }
+        for (j = 0; j < MAX_SHADER_RESOURCE_VIEWS; ++j)
+        {
+            if (state->shader_resource_view[i][j])
+                wined3d_cs_use_resource(cs, state->shader_resource_view[i][j]->resource);
+        }
+    }
+    wined3d_cs_use_fb_resources(cs, state->fb);
+}
+
 static void wined3d_cs_exec_present(struct wined3d_cs *cs, const void *data)
 {
     const struct wined3d_cs_present *op = data;
@@ -260,12 +375,21 @@ static void wined3d_cs_exec_present(struct wined3d_cs *cs, const void *data)
     wined3d_swapchain_set_window(swapchain, op->dst_window_override);
 
     swapchain->swapchain_ops->swapchain_present(swapchain, &op->src_rect, &op->dst_rect, op->flags);
+    wined3d_stream_allocator_fence(cs->device);
+
+    if (cs->device->converted_vertex_bytes)
+    {
+        TRACE_(d3d_perf)("Converted %u bytes of vertex data this frame.\n", cs->device->converted_vertex_bytes);
+        cs->device->converted_vertex_bytes = 0;
+    }
 }
 
 void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *swapchain,
         const RECT *src_rect, const RECT *dst_rect, HWND dst_window_override, DWORD flags)
 {
     struct wined3d_cs_present *op;
+    unsigned int i;
+    ULONG64 prev;
 
     op = cs->ops->require_space(cs, sizeof(*op));
     op->opcode = WINED3D_CS_OP_PRESENT;
@@ -275,7 +399,19 @@ void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *sw
     op->dst_rect = *dst_rect;
     op->flags = flags;
 
+    wined3d_cs_use_resource(cs, &swapchain->front_buffer->resource);
+    for (i = 0; i < swapchain->desc.backbuffer_count; ++i)
+        wined3d_cs_use_resource(cs, &swapchain->back_buffers[i]->resource);
+
+    prev = cs->present_op;
+    cs->present_op = cs->submitted_ops + 1;
+
     cs->ops->submit(cs);
+
+    /* Don't let the application get more than a frame ahead of the command
+     * stream. */
+    if (prev)
+        cs->ops->finish_op(cs, prev);
 }
 
 static void wined3d_cs_exec_clear(struct wined3d_cs *cs, const void *data)
@@ -285,9 +421,9 @@ static void wined3d_cs_exec_clear(struct wined3d_cs *cs, const void *data)
     RECT draw_rect;
 
     device = cs->device;
-    wined3d_get_draw_rect(&device->state, &draw_rect);
+    wined3d_get_draw_rect(&cs->state, &draw_rect);
     device_clear_render_targets(device, device->adapter->gl_info.limits.buffers,
-            &device->fb, op->rect_count, op->rects, &draw_rect, op->flags,
+            &cs->fb, op->rect_count, op->rects, &draw_rect, op->flags,
             &op->color, op->depth, op->stencil);
 }
 
@@ -305,19 +441,44 @@ void wined3d_cs_emit_clear(struct wined3d_cs *cs, DWORD rect_count, const RECT *
     op->rect_count = rect_count;
     memcpy(op->rects, rects, sizeof(*rects) * rect_count);
 
+    wined3d_cs_use_fb_resources(cs, &cs->device->fb);
+
     cs->ops->submit(cs);
 }
 
 static void wined3d_cs_exec_draw(struct wined3d_cs *cs, const void *data)
 {
+    const struct wined3d_gl_info *gl_info = &cs->device->adapter->gl_info;
+    struct wined3d_state *state = &cs->state;
     const struct wined3d_cs_draw *op = data;
+    INT load_base_vertex_idx;
+    GLenum prev;
+
+    prev = state->gl_primitive_type;
+    state->gl_primitive_type = op->primitive_type;
+    if (op->primitive_type != prev && (op->primitive_type == GL_POINTS || prev == GL_POINTS))
+        device_invalidate_state(cs->device, STATE_POINT_ENABLE);
+
+    /* Without ARB_draw_elements_base_vertex the base vertex index has to be
+     * applied to the stream offsets instead. */
+    if (op->indexed && !gl_info->supported[ARB_DRAW_ELEMENTS_BASE_VERTEX])
+        load_base_vertex_idx = op->base_vertex_idx;
+    else
+        load_base_vertex_idx = 0;
+
+    state->base_vertex_index = op->base_vertex_idx;
+    if (state->load_base_vertex_index != load_base_vertex_idx)
+    {
+        state->load_base_vertex_index = load_base_vertex_idx;
+        device_invalidate_state(cs->device, STATE_BASEVERTEXINDEX);
+    }
 
-    draw_primitive(cs->device, &cs->device->state, op->start_idx, op->index_count,
+    draw_primitive(cs->device, state, op->start_idx, op->index_count,
             op->start_instance, op->instance_count, op->indexed);
 }
 
-void wined3d_cs_emit_draw(struct wined3d_cs *cs, UINT start_idx, UINT index_count,
-        UINT start_instance, UINT instance_count, BOOL indexed)
+void wined3d_cs_emit_draw(struct wined3d_cs *cs, GLenum primitive_type, INT base_vertex_idx, UINT start_idx,
+        UINT index_count, UINT start_instance, UINT instance_count, BOOL indexed)
 {
     struct wined3d_cs_draw *op;
 
@@ -327,8 +488,12 @@ void wined3d_cs_emit_draw(struct wined3d_cs *cs, UINT start_idx, UINT index_coun
     op->index_count = index_count;
     op->start_instance = start_instance;
     op->instance_count = instance_count;
+    op->primitive_type = primitive_type;
+    op->base_vertex_idx = base_vertex_idx;
     op->indexed = indexed;
 
+    wined3d_cs_use_state_resources(cs, &cs->device->state);
+
     cs->ops->submit(cs);
 }
 
@@ -999,6 +1164,170 @@ void wined3d_cs_emit_set_material(struct wined3d_cs *cs, const struct wined3d_ma
     cs->ops->submit(cs);
 }
 
+static struct wined3d_light_info *wined3d_cs_find_light(struct wined3d_cs *cs, UINT idx)
+{
+    struct wined3d_light_info *light_info;
+
+    LIST_FOR_EACH_ENTRY(light_info, &cs->state.light_map[LIGHTMAP_HASHFUNC(idx)], struct wined3d_light_info, entry)
+    {
+        if (light_info->OriginalIndex == idx)
+            return light_info;
+    }
+
+    return NULL;
+}
+
+static void wined3d_cs_exec_set_light(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_set_light *op = data;
+    struct wined3d_light_info *light_info;
+    UINT light_idx = op->light.OriginalIndex;
+
+    if (!(light_info = wined3d_cs_find_light(cs, light_idx)))
+    {
+        TRACE("Adding new light.\n");
+        if (!(light_info = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*light_info))))
+        {
+            ERR("Failed to allocate light info.\n");
+            return;
+        }
+
+        list_add_head(&cs->state.light_map[LIGHTMAP_HASHFUNC(light_idx)], &light_info->entry);
+        light_info->glIndex = -1;
+        light_info->OriginalIndex = light_idx;
+    }
+
+    if (light_info->glIndex != -1)
+    {
+        if (light_info->OriginalParms.type != op->light.OriginalParms.type)
+            device_invalidate_state(cs->device, STATE_LIGHT_TYPE);
+        device_invalidate_state(cs->device, STATE_ACTIVELIGHT(light_info->glIndex));
+    }
+
+    light_info->OriginalParms = op->light.OriginalParms;
+    light_info->position = op->light.position;
+    light_info->direction = op->light.direction;
+    light_info->exponent = op->light.exponent;
+    light_info->cutoff = op->light.cutoff;
+}
+
+void wined3d_cs_emit_set_light(struct wined3d_cs *cs, const struct wined3d_light_info *light)
+{
+    struct wined3d_cs_set_light *op;
+
+    op = cs->ops->require_space(cs, sizeof(*op));
+    op->opcode = WINED3D_CS_OP_SET_LIGHT;
+    op->light = *light;
+
+    cs->ops->submit(cs);
+}
+
+static void wined3d_cs_exec_set_light_enable(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_set_light_enable *op = data;
+    struct wined3d_device *device = cs->device;
+    struct wined3d_light_info *light_info;
+    unsigned int i;
+
+    if (!(light_info = wined3d_cs_find_light(cs, op->idx)))
+    {
+        ERR("Light doesn't exist.\n");
+        return;
+    }
+
+    light_info->enabled = op->enable;
+    if (!op->enable)
+    {
+        if (light_info->glIndex == -1)
+            return;
+
+        device_invalidate_state(device, STATE_LIGHT_TYPE);
+        device_invalidate_state(device, STATE_ACTIVELIGHT(light_info->glIndex));
+        cs->state.lights[light_info->glIndex] = NULL;
+        light_info->glIndex = -1;
+        return;
+    }
+
+    if (light_info->glIndex != -1)
+        return;
+
+    for (i = 0; i < device->adapter->gl_info.limits.lights; ++i)
+    {
+        if (!cs->state.lights[i])
+        {
+            cs->state.lights[i] = light_info;
+            light_info->glIndex = i;
+            device_invalidate_state(device, STATE_LIGHT_TYPE);
+            device_invalidate_state(device, STATE_ACTIVELIGHT(i));
+            return;
+        }
+    }
+
+    WARN("Too many concurrently active lights.\n");
+}
+
+void wined3d_cs_emit_set_light_enable(struct wined3d_cs *cs, UINT idx, BOOL enable)
+{
+    struct wined3d_cs_set_light_enable *op;
+
+    op = cs->ops->require_space(cs, sizeof(*op));
+    op->opcode = WINED3D_CS_OP_SET_LIGHT_ENABLE;
+    op->idx = idx;
+    op->enable = enable;
+
+    cs->ops->submit(cs);
+}
+
+static const struct
+{
+    size_t offset;
+    size_t size;
+    DWORD mask;
+}
+wined3d_cs_push_constant_info[] =
+{
+    /* WINED3D_PUSH_CONSTANTS_VS_F */
+    {FIELD_OFFSET(struct wined3d_state, vs_consts_f), sizeof(struct wined3d_vec4),  WINED3D_SHADER_CONST_VS_F},
+    /* WINED3D_PUSH_CONSTANTS_PS_F */
+    {FIELD_OFFSET(struct wined3d_state, ps_consts_f), sizeof(struct wined3d_vec4),  WINED3D_SHADER_CONST_PS_F},
+    /* WINED3D_PUSH_CONSTANTS_VS_I */
+    {FIELD_OFFSET(struct wined3d_state, vs_consts_i), sizeof(struct wined3d_ivec4), WINED3D_SHADER_CONST_VS_I},
+    /* WINED3D_PUSH_CONSTANTS_PS_I */
+    {FIELD_OFFSET(struct wined3d_state, ps_consts_i), sizeof(struct wined3d_ivec4), WINED3D_SHADER_CONST_PS_I},
+    /* WINED3D_PUSH_CONSTANTS_VS_B */
+    {FIELD_OFFSET(struct wined3d_state, vs_consts_b), sizeof(BOOL),                 WINED3D_SHADER_CONST_VS_B},
+    /* WINED3D_PUSH_CONSTANTS_PS_B */
+    {FIELD_OFFSET(struct wined3d_state, ps_consts_b), sizeof(BOOL),                 WINED3D_SHADER_CONST_PS_B},
+};
+
+static void wined3d_cs_update_constants(struct wined3d_cs *cs, enum wined3d_push_constants p,
+        unsigned int start_idx, unsigned int count, const void *constants)
+{
+    struct wined3d_device *device = cs->device;
+    unsigned int context_count;
+    unsigned int i;
+    size_t offset;
+
+    if (p == WINED3D_PUSH_CONSTANTS_VS_F)
+        device->shader_backend->shader_update_float_vertex_constants(device, start_idx, count);
+    else if (p == WINED3D_PUSH_CONSTANTS_PS_F)
+        device->shader_backend->shader_update_float_pixel_constants(device, start_idx, count);
+
+    offset = wined3d_cs_push_constant_info[p].offset + start_idx * wined3d_cs_push_constant_info[p].size;
+    memcpy((BYTE *)&cs->state + offset, constants, count * wined3d_cs_push_constant_info[p].size);
+    for (i = 0, context_count = device->context_count; i < context_count; ++i)
+    {
+        device->contexts[i]->constant_update_mask |= wined3d_cs_push_constant_info[p].mask;
+    }
+}
+
+static void wined3d_cs_exec_push_constants(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_push_constants *op = data;
+
+    wined3d_cs_update_constants(cs, op->type, op->start_idx, op->count, op->constants);
+}
+
 static void wined3d_cs_exec_reset_state(struct wined3d_cs *cs, const void *data)
 {
     struct wined3d_adapter *adapter = cs->device->adapter;
@@ -1019,6 +1348,105 @@ void wined3d_cs_emit_reset_state(struct wined3d_cs *cs)
     cs->ops->submit(cs);
 }
 
+static void wined3d_cs_exec_query_issue(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_query_issue *op = data;
+    struct wined3d_query *query = op->query;
+    BOOL poll;
+
+    poll = query->query_ops->query_issue(query, op->flags);
+
+    if (!(op->flags & WINED3DISSUE_END))
+        return;
+
+    ++query->counter_executed;
+    if (poll)
+    {
+        if (list_empty(&query->poll_list_entry))
+            list_add_tail(&cs->query_poll_list, &query->poll_list_entry);
+        return;
+    }
+
+    list_remove(&query->poll_list_entry);
+    list_init(&query->poll_list_entry);
+    InterlockedExchange(&query->counter_retrieved, query->counter_executed);
+}
+
+void wined3d_cs_emit_query_issue(struct wined3d_cs *cs, struct wined3d_query *query, DWORD flags)
+{
+    struct wined3d_cs_query_issue *op;
+
+    op = cs->ops->require_space(cs, sizeof(*op));
+    op->opcode = WINED3D_CS_OP_QUERY_ISSUE;
+    op->query = query;
+    op->flags = flags;
+
+    cs->ops->submit(cs);
+}
+
+static void wined3d_cs_exec_rename_buffer(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_rename_buffer *op = data;
+
+    buffer_stream_set_block(op->buffer, &op->block);
+}
+
+/* Switches a stream allocated buffer to a new block once the ops queued
+ * before, which may still draw from the old one, have been executed. */
+void wined3d_cs_emit_rename_buffer(struct wined3d_cs *cs, struct wined3d_buffer *buffer,
+        const struct wined3d_stream_block *block)
+{
+    struct wined3d_cs_rename_buffer *op;
+
+    op = cs->ops->require_space(cs, sizeof(*op));
+    op->opcode = WINED3D_CS_OP_RENAME_BUFFER;
+    op->buffer = buffer;
+    op->block = *block;
+    wined3d_cs_use_resource(cs, &buffer->resource);
+
+    cs->ops->submit(cs);
+}
+
+static void wined3d_cs_exec_callback(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_callback *op = data;
+
+    op->callback(op->object);
+}
+
+/* Calls "callback" on the thread executing the ops, once the ops queued
+ * before have been executed. E.g. to destroy objects they may still use. */
+void wined3d_cs_emit_callback(struct wined3d_cs *cs, void (*callback)(void *object), void *object)
+{
+    struct wined3d_cs_callback *op;
+
+    /* Called from within an op, e.g. when the onscreen depth/stencil buffer
+     * is released during a clear. Everything queued before has been
+     * executed. */
+    if (GetCurrentThreadId() == cs->thread_id)
+    {
+        callback(object);
+        return;
+    }
+
+    op = cs->ops->require_space(cs, sizeof(*op));
+    op->opcode = WINED3D_CS_OP_CALLBACK;
+    op->callback = callback;
+    op->object = object;
+
+    cs->ops->submit(cs);
+}
+
+static void wined3d_cs_poll_queries(struct wined3d_cs *cs)
+{
+    struct wined3d_query *query, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE(query, next, &cs->query_poll_list, struct wined3d_query, poll_list_entry)
+    {
+        wined3d_query_poll(query);
+    }
+}
+
 static void (* const wined3d_cs_op_handlers[])(struct wined3d_cs *cs, const void *data) =
 {
     /* WINED3D_CS_OP_PRESENT                    */ wined3d_cs_exec_present,
@@ -1046,9 +1474,116 @@ static void (* const wined3d_cs_op_handlers[])(struct wined3d_cs *cs, const void
     /* WINED3D_CS_OP_SET_CLIP_PLANE             */ wined3d_cs_exec_set_clip_plane,
     /* WINED3D_CS_OP_SET_COLOR_KEY              */ wined3d_cs_exec_set_color_key,
     /* WINED3D_CS_OP_SET_MATERIAL               */ wined3d_cs_exec_set_material,
+    /* WINED3D_CS_OP_SET_LIGHT                  */ wined3d_cs_exec_set_light,
+    /* WINED3D_CS_OP_SET_LIGHT_ENABLE           */ wined3d_cs_exec_set_light_enable,
+    /* WINED3D_CS_OP_PUSH_CONSTANTS             */ wined3d_cs_exec_push_constants,
     /* WINED3D_CS_OP_RESET_STATE                */ wined3d_cs_exec_reset_state,
+    /* WINED3D_CS_OP_QUERY_ISSUE                */ wined3d_cs_exec_query_issue,
+    /* WINED3D_CS_OP_RENAME_BUFFER              */ wined3d_cs_exec_rename_buffer,
+    /* WINED3D_CS_OP_CALLBACK                   */ wined3d_cs_exec_callback,
 };
 
+C_ASSERT(WINED3D_CS_OP_CALLBACK < WINED3D_FRAME_STATS_MAX_OPS);
+
+static void wined3d_cs_init_frame_stats(struct wined3d_cs *cs)
+{
+    static LONG device_count;
+    struct wined3d_frame_stats *view;
+    LARGE_INTEGER frequency;
+    HANDLE file, mapping;
+    char path[MAX_PATH];
+
+    /* Each device gets its own file, so that devices in the same or in
+     * different processes don't truncate each other's statistics. */
+    if (snprintf(path, sizeof(path), "%s.%04x.%u", wined3d_settings.frame_stats_path,
+            GetCurrentProcessId(), InterlockedIncrement(&device_count)) >= sizeof(path))
+    {
+        WARN("Frame statistics path %s is too long.\n", debugstr_a(wined3d_settings.frame_stats_path));
+        return;
+    }
+
+    file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE,
+            FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        WARN("Failed to create frame statistics file %s, error %#x.\n", debugstr_a(path), GetLastError());
+        return;
+    }
+    TRACE("Writing frame statistics to %s.\n", debugstr_a(path));
+
+    mapping = CreateFileMappingW(file, NULL, PAGE_READWRITE, 0, sizeof(*view), NULL);
+    CloseHandle(file);
+    if (!mapping)
+    {
+        WARN("Failed to create frame statistics mapping, error %#x.\n", GetLastError());
+        return;
+    }
+
+    view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, sizeof(*view));
+    CloseHandle(mapping);
+    if (!view)
+    {
+        WARN("Failed to map frame statistics, error %#x.\n", GetLastError());
+        return;
+    }
+
+    if (!(cs->frame_stats = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*cs->frame_stats))))
+    {
+        UnmapViewOfFile(view);
+        return;
+    }
+
+    QueryPerformanceFrequency(&frequency);
+    memset(view, 0, sizeof(*view));
+    view->magic = WINED3D_FRAME_STATS_MAGIC;
+    view->version = WINED3D_FRAME_STATS_VERSION;
+    view->op_count = WINED3D_CS_OP_CALLBACK + 1;
+    view->frequency = frequency.QuadPart;
+    cs->frame_stats_view = view;
+    cs->frame_start = wined3d_frame_stats_time();
+}
+
+static void wined3d_cs_publish_frame_stats(struct wined3d_cs *cs, ULONGLONG now)
+{
+    struct wined3d_frame_stats *stats = cs->frame_stats;
+    struct wined3d_frame_stats *view = cs->frame_stats_view;
+    LONG sequence = view->sequence;
+
+    stats->frame_time = now - cs->frame_start;
+    cs->frame_start = now;
+
+    InterlockedExchange(&view->sequence, sequence + 1);
+    memcpy(&view->frame, &stats->frame, sizeof(*stats) - FIELD_OFFSET(struct wined3d_frame_stats, frame));
+    InterlockedExchange(&view->sequence, sequence + 2);
+
+    memset(&stats->frame_time, 0, sizeof(*stats) - FIELD_OFFSET(struct wined3d_frame_stats, frame_time));
+    ++stats->frame;
+}
+
+static void wined3d_cs_execute_op(struct wined3d_cs *cs, const void *data)
+{
+    enum wined3d_cs_op opcode = *(const enum wined3d_cs_op *)data;
+    struct wined3d_frame_stats *stats;
+    ULONGLONG start, end;
+
+    if (!(stats = cs->frame_stats))
+    {
+        wined3d_cs_op_handlers[opcode](cs, data);
+        return;
+    }
+
+    start = wined3d_frame_stats_time();
+    wined3d_cs_op_handlers[opcode](cs, data);
+    end = wined3d_frame_stats_time();
+
+    ++stats->ops[opcode].count;
+    stats->ops[opcode].time += end - start;
+    stats->cs_time += end - start;
+
+    if (opcode == WINED3D_CS_OP_PRESENT)
+        wined3d_cs_publish_frame_stats(cs, end);
+}
+
 static void *wined3d_cs_st_require_space(struct wined3d_cs *cs, size_t size)
 {
     if (size > cs->data_size)
@@ -1068,61 +1603,354 @@ static void *wined3d_cs_st_require_space(struct wined3d_cs *cs, size_t size)
 
 static void wined3d_cs_st_submit(struct wined3d_cs *cs)
 {
-    enum wined3d_cs_op opcode = *(const enum wined3d_cs_op *)cs->data;
-
-    wined3d_cs_op_handlers[opcode](cs, cs->data);
+    wined3d_cs_execute_op(cs, cs->data);
 }
 
 static void wined3d_cs_st_push_constants(struct wined3d_cs *cs, enum wined3d_push_constants p,
         unsigned int start_idx, unsigned int count, const void *constants)
 {
-    struct wined3d_device *device = cs->device;
-    unsigned int context_count;
-    unsigned int i;
-    size_t offset;
+    wined3d_cs_update_constants(cs, p, start_idx, count, constants);
+}
+
+static void wined3d_cs_st_finish(struct wined3d_cs *cs)
+{
+}
+
+static void wined3d_cs_st_finish_op(struct wined3d_cs *cs, ULONG64 op)
+{
+}
+
+static const struct wined3d_cs_ops wined3d_cs_st_ops =
+{
+    wined3d_cs_st_require_space,
+    wined3d_cs_st_submit,
+    wined3d_cs_st_push_constants,
+    wined3d_cs_st_finish,
+    wined3d_cs_st_finish_op,
+};
+
+struct wined3d_cs_packet
+{
+    size_t size;
+    /* Ops that don't fit in the queue are allocated separately. */
+    void *external_data;
+    BYTE data[1];
+};
+
+/* The queue is only ever written with the wined3d mutex held, and only the
+ * worker thread executes it, also with the mutex held. The worker polls
+ * queue_head without holding it, so that it can go to sleep while the queue
+ * is empty. A packet with size 0 marks the end of the usable space before the
+ * queue wraps around. */
+static BOOL wined3d_cs_mt_execute_next(struct wined3d_cs *cs)
+{
+    const struct wined3d_cs_packet *packet;
+    LONG tail = cs->queue_tail;
+
+    if (tail == cs->queue_head)
+        return FALSE;
 
-    static const struct
+    packet = (const struct wined3d_cs_packet *)&cs->queue[tail];
+    if (!packet->size)
     {
-        size_t offset;
-        size_t size;
-        DWORD mask;
+        tail = 0;
+        packet = (const struct wined3d_cs_packet *)cs->queue;
     }
-    push_constant_info[] =
+
+    if (packet->external_data)
+    {
+        wined3d_cs_execute_op(cs, packet->external_data);
+        HeapFree(GetProcessHeap(), 0, packet->external_data);
+    }
+    else
     {
-        /* WINED3D_PUSH_CONSTANTS_VS_F */
-        {FIELD_OFFSET(struct wined3d_state, vs_consts_f), sizeof(struct wined3d_vec4),  WINED3D_SHADER_CONST_VS_F},
-        /* WINED3D_PUSH_CONSTANTS_PS_F */
-        {FIELD_OFFSET(struct wined3d_state, ps_consts_f), sizeof(struct wined3d_vec4),  WINED3D_SHADER_CONST_PS_F},
-        /* WINED3D_PUSH_CONSTANTS_VS_I */
-        {FIELD_OFFSET(struct wined3d_state, vs_consts_i), sizeof(struct wined3d_ivec4), WINED3D_SHADER_CONST_VS_I},
-        /* WINED3D_PUSH_CONSTANTS_PS_I */
-        {FIELD_OFFSET(struct wined3d_state, ps_consts_i), sizeof(struct wined3d_ivec4), WINED3D_SHADER_CONST_PS_I},
-        /* WINED3D_PUSH_CONSTANTS_VS_B */
-        {FIELD_OFFSET(struct wined3d_state, vs_consts_b), sizeof(BOOL),                 WINED3D_SHADER_CONST_VS_B},
-        /* WINED3D_PUSH_CONSTANTS_PS_B */
-        {FIELD_OFFSET(struct wined3d_state, ps_consts_b), sizeof(BOOL),                 WINED3D_SHADER_CONST_PS_B},
-    };
+        wined3d_cs_execute_op(cs, packet->data);
+    }
 
-    if (p == WINED3D_PUSH_CONSTANTS_VS_F)
-        device->shader_backend->shader_update_float_vertex_constants(device, start_idx, count);
-    else if (p == WINED3D_PUSH_CONSTANTS_PS_F)
-        device->shader_backend->shader_update_float_pixel_constants(device, start_idx, count);
+    tail += packet->size;
+    if (tail == WINED3D_CS_QUEUE_SIZE)
+        tail = 0;
+    InterlockedExchange(&cs->queue_tail, tail);
+    /* Only the worker thread writes executed_ops, but 64-bit accesses
+     * aren't atomic on every architecture. */
+    InterlockedCompareExchange64(&cs->executed_ops, cs->executed_ops + 1, cs->executed_ops);
 
-    offset = push_constant_info[p].offset + start_idx * push_constant_info[p].size;
-    memcpy((BYTE *)&cs->state + offset, constants, count * push_constant_info[p].size);
-    for (i = 0, context_count = device->context_count; i < context_count; ++i)
+    if (cs->wait_count)
     {
-        device->contexts[i]->constant_update_mask |= push_constant_info[p].mask;
+        EnterCriticalSection(&cs->wait_cs);
+        WakeAllConditionVariable(&cs->progress);
+        LeaveCriticalSection(&cs->wait_cs);
     }
+
+    return TRUE;
 }
 
-static const struct wined3d_cs_ops wined3d_cs_st_ops =
+static ULONG64 wined3d_cs_mt_get_executed_ops(struct wined3d_cs *cs)
 {
-    wined3d_cs_st_require_space,
-    wined3d_cs_st_submit,
-    wined3d_cs_st_push_constants,
+    return InterlockedCompareExchange64(&cs->executed_ops, 0, 0);
+}
+
+static BOOL wined3d_cs_mt_op_executed(struct wined3d_cs *cs, ULONG64 op)
+{
+    return wined3d_cs_mt_get_executed_ops(cs) >= op;
+}
+
+/* Waits for the worker thread to execute "op". The worker needs the wined3d
+ * mutex to execute ops, so the calling thread releases it while waiting. */
+static void wined3d_cs_mt_finish_op(struct wined3d_cs *cs, ULONG64 op)
+{
+    unsigned int count;
+
+    /* Called from within an op, e.g. through a blit during present. */
+    if (GetCurrentThreadId() == cs->thread_id)
+        return;
+
+    if (wined3d_cs_mt_op_executed(cs, op))
+        return;
+
+    TRACE("Waiting for op %s, executed %s.\n", wine_dbgstr_longlong(op),
+            wine_dbgstr_longlong(wined3d_cs_mt_get_executed_ops(cs)));
+
+    count = wined3d_mutex_suspend();
+    EnterCriticalSection(&cs->wait_cs);
+    InterlockedIncrement(&cs->wait_count);
+    while (!wined3d_cs_mt_op_executed(cs, op))
+        SleepConditionVariableCS(&cs->progress, &cs->wait_cs, INFINITE);
+    InterlockedDecrement(&cs->wait_count);
+    LeaveCriticalSection(&cs->wait_cs);
+    wined3d_mutex_resume(count);
+}
+
+static void wined3d_cs_mt_finish(struct wined3d_cs *cs)
+{
+    wined3d_cs_mt_finish_op(cs, cs->submitted_ops);
+}
+
+static size_t wined3d_cs_mt_get_free_space(const struct wined3d_cs *cs)
+{
+    size_t used = (cs->queue_head - cs->queue_tail) & (WINED3D_CS_QUEUE_SIZE - 1);
+
+    /* Keep a gap so that a full queue can't look empty. */
+    return WINED3D_CS_QUEUE_SIZE - used - sizeof(size_t);
+}
+
+/* Returns the number of bytes needed to put a packet of "packet_size" bytes
+ * at the current queue head, including the space skipped when wrapping. */
+static size_t wined3d_cs_mt_get_needed_space(const struct wined3d_cs *cs, size_t packet_size)
+{
+    size_t remaining = WINED3D_CS_QUEUE_SIZE - cs->queue_head;
+
+    return remaining < packet_size ? remaining + packet_size : packet_size;
+}
+
+/* Waits for the worker thread to free enough of the queue for a packet of
+ * "packet_size" bytes. This happens before anything is written to the queue,
+ * and the caller re-reads the queue head afterwards: other threads may queue
+ * ops while the mutex is released, but nothing they queued is overwritten. */
+static void wined3d_cs_mt_wait_space(struct wined3d_cs *cs, size_t packet_size)
+{
+    unsigned int count;
+
+    TRACE("Queue is full, waiting for %lu bytes.\n", (unsigned long)packet_size);
+
+    count = wined3d_mutex_suspend();
+    EnterCriticalSection(&cs->wait_cs);
+    InterlockedIncrement(&cs->wait_count);
+    while (wined3d_cs_mt_get_free_space(cs) < wined3d_cs_mt_get_needed_space(cs, packet_size))
+        SleepConditionVariableCS(&cs->progress, &cs->wait_cs, INFINITE);
+    InterlockedDecrement(&cs->wait_count);
+    LeaveCriticalSection(&cs->wait_cs);
+    wined3d_mutex_resume(count);
+}
+
+static void *wined3d_cs_mt_require_space(struct wined3d_cs *cs, size_t size)
+{
+    struct wined3d_cs_packet *packet;
+    void *external_data = NULL;
+    size_t packet_size;
+    LONG head;
+
+    /* Released again in wined3d_cs_mt_submit(). */
+    wined3d_mutex_lock();
+
+    packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[size]);
+    if (packet_size > WINED3D_CS_QUEUE_SIZE / 2)
+    {
+        TRACE("Allocating %lu byte op outside the queue.\n", (unsigned long)size);
+        if (!(external_data = HeapAlloc(GetProcessHeap(), 0, size)))
+        {
+            ERR("Failed to allocate op memory.\n");
+            wined3d_mutex_unlock();
+            return NULL;
+        }
+        packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[0]);
+    }
+    packet_size = (packet_size + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1);
+
+    /* Packets are at most half the queue, so an empty queue always has room. */
+    while (wined3d_cs_mt_get_free_space(cs) < wined3d_cs_mt_get_needed_space(cs, packet_size))
+        wined3d_cs_mt_wait_space(cs, packet_size);
+
+    /* From here on the mutex is held until wined3d_cs_mt_submit(). */
+    head = cs->queue_head;
+    if (WINED3D_CS_QUEUE_SIZE - head < packet_size)
+    {
+        ((struct wined3d_cs_packet *)&cs->queue[head])->size = 0;
+        head = 0;
+    }
+
+    packet = (struct wined3d_cs_packet *)&cs->queue[head];
+    packet->size = packet_size;
+    packet->external_data = external_data;
+    cs->pending_head = head + packet_size;
+    if (cs->pending_head == WINED3D_CS_QUEUE_SIZE)
+        cs->pending_head = 0;
+
+    return external_data ? external_data : packet->data;
+}
+
+static void wined3d_cs_mt_submit(struct wined3d_cs *cs)
+{
+    ++cs->submitted_ops;
+    InterlockedExchange(&cs->queue_head, cs->pending_head);
+    if (InterlockedCompareExchange(&cs->waiting, FALSE, TRUE))
+        SetEvent(cs->event);
+
+    wined3d_mutex_unlock();
+}
+
+static void wined3d_cs_mt_push_constants(struct wined3d_cs *cs, enum wined3d_push_constants p,
+        unsigned int start_idx, unsigned int count, const void *constants)
+{
+    struct wined3d_cs_push_constants *op;
+    size_t size;
+
+    size = count * wined3d_cs_push_constant_info[p].size;
+    op = cs->ops->require_space(cs, FIELD_OFFSET(struct wined3d_cs_push_constants, constants[size]));
+    op->opcode = WINED3D_CS_OP_PUSH_CONSTANTS;
+    op->type = p;
+    op->start_idx = start_idx;
+    op->count = count;
+    memcpy(op->constants, constants, size);
+
+    cs->ops->submit(cs);
+}
+
+static const struct wined3d_cs_ops wined3d_cs_mt_ops =
+{
+    wined3d_cs_mt_require_space,
+    wined3d_cs_mt_submit,
+    wined3d_cs_mt_push_constants,
+    wined3d_cs_mt_finish,
+    wined3d_cs_mt_finish_op,
 };
 
+static void wined3d_cs_release(struct wined3d_cs *cs)
+{
+    if (InterlockedDecrement(&cs->refcount))
+        return;
+
+    if (cs->event)
+        CloseHandle(cs->event);
+    DeleteCriticalSection(&cs->wait_cs);
+    HeapFree(GetProcessHeap(), 0, cs->queue);
+    HeapFree(GetProcessHeap(), 0, cs);
+}
+
+static DWORD WINAPI wined3d_cs_run(void *ctx)
+{
+    struct wined3d_context *context;
+    struct wined3d_cs *cs = ctx;
+    HMODULE wined3d_module;
+    unsigned int count;
+    BOOL poll;
+
+    TRACE("Started.\n");
+
+    wined3d_module = cs->wined3d_module;
+    for (;;)
+    {
+        if (cs->queue_head == cs->queue_tail)
+        {
+            if (cs->exit)
+                break;
+
+            wined3d_mutex_lock();
+            wined3d_cs_poll_queries(cs);
+            /* Don't keep the context current while idle, the application
+             * thread may want to destroy it. Queries still have to be polled
+             * though. */
+            if (!(poll = !list_empty(&cs->query_poll_list)) && context_get_current())
+                context_set_current(NULL);
+            wined3d_mutex_unlock();
+
+            InterlockedExchange(&cs->waiting, TRUE);
+            if (cs->queue_head == cs->queue_tail && !cs->exit)
+                WaitForSingleObject(cs->event, poll ? WINED3D_CS_QUERY_POLL_INTERVAL : INFINITE);
+            InterlockedExchange(&cs->waiting, FALSE);
+            continue;
+        }
+
+        wined3d_mutex_lock();
+        for (count = 0; count < WINED3D_CS_BATCH_SIZE && wined3d_cs_mt_execute_next(cs); ++count);
+        if (cs->device->stream_allocator.retired_size >= WINED3D_STREAM_CHUNK_SIZE)
+            wined3d_stream_allocator_fence(cs->device);
+        /* Anything the application thread does with its own context after
+         * we release the mutex has to see the results of these ops. */
+        if (count && (context = context_get_current()) && !context->destroyed)
+            context->gl_info->gl_ops.gl.p_glFlush();
+        wined3d_cs_poll_queries(cs);
+        wined3d_mutex_unlock();
+    }
+
+    if (context_get_current())
+        context_set_current(NULL);
+    wined3d_cs_release(cs);
+
+    TRACE("Stopped.\n");
+    FreeLibraryAndExitThread(wined3d_module, 0);
+}
+
+static BOOL wined3d_cs_start_thread(struct wined3d_cs *cs)
+{
+    if (!(cs->queue = HeapAlloc(GetProcessHeap(), 0, WINED3D_CS_QUEUE_SIZE)))
+        return FALSE;
+
+    if (!(cs->event = CreateEventW(NULL, FALSE, FALSE, NULL)))
+    {
+        ERR("Failed to create command stream event.\n");
+        goto fail;
+    }
+
+    if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+            (const WCHAR *)wined3d_cs_run, &cs->wined3d_module))
+    {
+        ERR("Failed to get wined3d module handle.\n");
+        goto fail;
+    }
+
+    /* One reference for the device, one for the thread. */
+    cs->refcount = 2;
+    if (!(cs->thread = CreateThread(NULL, 0, wined3d_cs_run, cs, 0, &cs->thread_id)))
+    {
+        ERR("Failed to create command stream thread.\n");
+        FreeLibrary(cs->wined3d_module);
+        cs->refcount = 1;
+        goto fail;
+    }
+
+    cs->ops = &wined3d_cs_mt_ops;
+    return TRUE;
+
+fail:
+    if (cs->event)
+        CloseHandle(cs->event);
+    cs->event = NULL;
+    HeapFree(GetProcessHeap(), 0, cs->queue);
+    cs->queue = NULL;
+    return FALSE;
+}
+
 struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
 {
     const struct wined3d_gl_info *gl_info = &device->adapter->gl_info;
@@ -1142,23 +1970,57 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
 
     cs->ops = &wined3d_cs_st_ops;
     cs->device = device;
+    cs->refcount = 1;
+    list_init(&cs->query_poll_list);
+    InitializeCriticalSection(&cs->wait_cs);
+    InitializeConditionVariable(&cs->progress);
 
     cs->data_size = WINED3D_INITIAL_CS_SIZE;
     if (!(cs->data = HeapAlloc(GetProcessHeap(), 0, cs->data_size)))
     {
         state_cleanup(&cs->state);
+        DeleteCriticalSection(&cs->wait_cs);
         HeapFree(GetProcessHeap(), 0, cs->fb.render_targets);
         HeapFree(GetProcessHeap(), 0, cs);
         return NULL;
     }
 
+    if (wined3d_settings.frame_stats_path)
+        wined3d_cs_init_frame_stats(cs);
+
+    if (wined3d_settings.cs_multithreaded)
+    {
+        if (wined3d_cs_start_thread(cs))
+            TRACE("Using the multi-threaded command stream.\n");
+        else
+            WARN("Failed to start the command stream thread, using the single-threaded command stream.\n");
+    }
+
     return cs;
 }
 
 void wined3d_cs_destroy(struct wined3d_cs *cs)
 {
+    if (cs->thread)
+    {
+        /* The thread may be waiting for the wined3d mutex, which the caller
+         * is likely to hold, so don't wait for it to exit. It drops its own
+         * reference to the command stream when it does. */
+        cs->ops->finish(cs);
+        InterlockedExchange(&cs->exit, TRUE);
+        SetEvent(cs->event);
+        CloseHandle(cs->thread);
+    }
+
+    if (cs->frame_stats)
+    {
+        UnmapViewOfFile(cs->frame_stats_view);
+        HeapFree(GetProcessHeap(), 0, cs->frame_stats);
+        cs->frame_stats = NULL;
+    }
+
     state_cleanup(&cs->state);
     HeapFree(GetProcessHeap(), 0, cs->fb.render_targets);
     HeapFree(GetProcessHeap(), 0, cs->data);
-    HeapFree(GetProcessHeap(), 0, cs);
+    wined3d_cs_release(cs);
 }
@@ -294,7 +294,8 @@ void device_clear_render_targets(struct wined3d_device *device, UINT rt_count, c
     struct wined3d_surface *target = rt_count ? wined3d_rendertarget_view_get_surface(fb->render_targets[0]) : NULL;
     struct wined3d_rendertarget_view *dsv = fb->depth_stencil;
     struct wined3d_surface *depth_stencil = dsv ? wined3d_rendertarget_view_get_surface(dsv) : NULL;
-    const struct wined3d_state *state = &device->state;
+    /* This runs on the command stream thread, device->state may be ahead. */
+    const struct wined3d_state *state = &device->cs->state;
     const struct wined3d_gl_info *gl_info;
     UINT drawable_width, drawable_height;
     struct wined3d_color corrected_color;
@@ -379,7 +380,7 @@ void device_clear_render_targets(struct wined3d_device *device, UINT rt_count, c
             gl_info->gl_ops.gl.p_glDisable(GL_STENCIL_TEST_TWO_SIDE_EXT);
             context_invalidate_state(context, STATE_RENDER(WINED3D_RS_TWOSIDEDSTENCILMODE));
         }
-        gl_info->gl_ops.gl.p_glStencilMask(~0U);
+        context_gl_stencil_mask(context, ~0u);
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_STENCILWRITEMASK));
         gl_info->gl_ops.gl.p_glClearStencil(stencil);
         checkGLcall("glClearStencil");
@@ -392,7 +393,7 @@ void device_clear_render_targets(struct wined3d_device *device, UINT rt_count, c
 
         surface_modify_ds_location(depth_stencil, location, ds_rect.right, ds_rect.bottom);
 
-        gl_info->gl_ops.gl.p_glDepthMask(GL_TRUE);
+        context_gl_depth_mask(context, GL_TRUE);
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_ZWRITEENABLE));
         gl_info->gl_ops.gl.p_glClearDepth(depth);
         checkGLcall("glClearDepth");
@@ -444,7 +445,7 @@ void device_clear_render_targets(struct wined3d_device *device, UINT rt_count, c
             color = &corrected_color;
         }
 
-        gl_info->gl_ops.gl.p_glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        context_gl_color_mask(context, -1, 0xf);
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_COLORWRITEENABLE));
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_COLORWRITEENABLE1));
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_COLORWRITEENABLE2));
@@ -543,8 +544,6 @@ ULONG CDECL wined3d_device_decref(struct wined3d_device *device)
     {
         UINT i;
 
-        wined3d_cs_destroy(device->cs);
-
         if (device->recording && wined3d_stateblock_decref(device->recording))
             FIXME("Something's still holding the recording stateblock.\n");
         device->recording = NULL;
@@ -578,6 +577,10 @@ ULONG CDECL wined3d_device_decref(struct wined3d_device *device)
 
         wine_rb_destroy(&device->samplers, device_leftover_sampler, NULL);
 
+        /* Destroyed last, releasing the objects above may need to execute
+         * queued ops. */
+        wined3d_cs_destroy(device->cs);
+
         wined3d_decref(device->wined3d);
         device->wined3d = NULL;
         HeapFree(GetProcessHeap(), 0, device);
@@ -1154,6 +1157,8 @@ HRESULT CDECL wined3d_device_uninit_3d(struct wined3d_device *device)
 
     TRACE("device %p.\n", device);
 
+    wined3d_cs_finish(device->cs);
+
     if (!device->d3d_initialized)
         return WINED3DERR_INVALIDCALL;
 
@@ -1167,6 +1172,8 @@ HRESULT CDECL wined3d_device_uninit_3d(struct wined3d_device *device)
         wined3d_texture_decref(device->logo_texture);
     if (device->cursor_texture)
         wined3d_texture_decref(device->cursor_texture);
+    /* Destroy them before the GL objects they may depend on. */
+    wined3d_cs_finish(device->cs);
 
     state_unbind_resources(&device->state);
 
@@ -1193,6 +1200,7 @@ HRESULT CDECL wined3d_device_uninit_3d(struct wined3d_device *device)
     device->shader_backend->shader_free_private(device);
     destroy_dummy_textures(device, gl_info);
     destroy_default_samplers(device);
+    wined3d_stream_allocator_cleanup(device, gl_info);
 
     /* Release the context again as soon as possible. In particular,
      * releasing the render target views below may release the last reference
@@ -1613,14 +1621,6 @@ HRESULT CDECL wined3d_device_set_light(struct wined3d_device *device,
             light->direction.x, light->direction.y, light->direction.z,
             light->range, light->falloff, light->theta, light->phi);
 
-    /* Update the live definitions if the light is currently assigned a glIndex. */
-    if (object->glIndex != -1 && !device->recording)
-    {
-        if (object->OriginalParms.type != light->type)
-            device_invalidate_state(device, STATE_LIGHT_TYPE);
-        device_invalidate_state(device, STATE_ACTIVELIGHT(object->glIndex));
-    }
-
     /* Save away the information. */
     object->OriginalParms = *light;
 
@@ -1700,6 +1700,9 @@ HRESULT CDECL wined3d_device_set_light(struct wined3d_device *device,
             FIXME("Unrecognized light type %#x.\n", light->type);
     }
 
+    if (!device->recording)
+        wined3d_cs_emit_set_light(device->cs, object);
+
     return WINED3D_OK;
 }
 
@@ -1768,16 +1771,13 @@ HRESULT CDECL wined3d_device_set_light_enable(struct wined3d_device *device, UIN
         }
     }
 
+    if (!device->recording)
+        wined3d_cs_emit_set_light_enable(device->cs, light_idx, enable);
+
     if (!enable)
     {
         if (light_info->glIndex != -1)
         {
-            if (!device->recording)
-            {
-                device_invalidate_state(device, STATE_LIGHT_TYPE);
-                device_invalidate_state(device, STATE_ACTIVELIGHT(light_info->glIndex));
-            }
-
             device->update_state->lights[light_info->glIndex] = NULL;
             light_info->glIndex = -1;
         }
@@ -1819,13 +1819,6 @@ HRESULT CDECL wined3d_device_set_light_enable(struct wined3d_device *device, UIN
                 WARN("Too many concurrently active lights\n");
                 return WINED3D_OK;
             }
-
-            /* i == light_info->glIndex */
-            if (!device->recording)
-            {
-                device_invalidate_state(device, STATE_LIGHT_TYPE);
-                device_invalidate_state(device, STATE_ACTIVELIGHT(i));
-            }
         }
     }
 
@@ -3126,6 +3119,14 @@ HRESULT CDECL wined3d_device_process_vertices(struct wined3d_device *device,
             device, src_start_idx, dst_idx, vertex_count,
             dst_buffer, declaration, flags, dst_fvf);
 
+    /* The source vertices are read from the current stream sources. */
+    for (i = 0; i < MAX_STREAMS; ++i)
+    {
+        if (state->streams[i].buffer)
+            wined3d_resource_wait_idle(&state->streams[i].buffer->resource);
+    }
+    wined3d_resource_wait_idle(&dst_buffer->resource);
+
     if (declaration)
         FIXME("Output vertex declaration not implemented yet.\n");
 
@@ -3154,8 +3155,8 @@ HRESULT CDECL wined3d_device_process_vertices(struct wined3d_device *device,
         e = &stream_info.elements[i];
         buffer = state->streams[e->stream_idx].buffer;
         e->data.buffer_object = 0;
-        e->data.addr += (ULONG_PTR)buffer_get_sysmem(buffer, context);
-        if (buffer->buffer_object)
+        e->data.addr += (ULONG_PTR)buffer_get_sysmem(buffer, context) - buffer->stream_block.offset;
+        if (buffer->buffer_object && !buffer->stream_block.chunk)
         {
             GL_EXTCALL(glDeleteBuffers(1, &buffer->buffer_object));
             buffer->buffer_object = 0;
@@ -3469,17 +3470,11 @@ struct wined3d_query * CDECL wined3d_device_get_predication(struct wined3d_devic
 void CDECL wined3d_device_set_primitive_type(struct wined3d_device *device,
         enum wined3d_primitive_type primitive_type)
 {
-    GLenum gl_primitive_type, prev;
-
     TRACE("device %p, primitive_type %s\n", device, debug_d3dprimitivetype(primitive_type));
 
-    gl_primitive_type = gl_primitive_type_from_d3d(primitive_type);
-    prev = device->update_state->gl_primitive_type;
-    device->update_state->gl_primitive_type = gl_primitive_type;
+    device->update_state->gl_primitive_type = gl_primitive_type_from_d3d(primitive_type);
     if (device->recording)
         device->recording->changed.primitive_type = TRUE;
-    else if (gl_primitive_type != prev && (gl_primitive_type == GL_POINTS || prev == GL_POINTS))
-        device_invalidate_state(device, STATE_POINT_ENABLE);
 }
 
 void CDECL wined3d_device_get_primitive_type(const struct wined3d_device *device,
@@ -3496,13 +3491,8 @@ HRESULT CDECL wined3d_device_draw_primitive(struct wined3d_device *device, UINT
 {
     TRACE("device %p, start_vertex %u, vertex_count %u.\n", device, start_vertex, vertex_count);
 
-    if (device->state.load_base_vertex_index)
-    {
-        device->state.load_base_vertex_index = 0;
-        device_invalidate_state(device, STATE_BASEVERTEXINDEX);
-    }
-
-    wined3d_cs_emit_draw(device->cs, start_vertex, vertex_count, 0, 0, FALSE);
+    wined3d_cs_emit_draw(device->cs, device->state.gl_primitive_type,
+            device->state.base_vertex_index, start_vertex, vertex_count, 0, 0, FALSE);
 
     return WINED3D_OK;
 }
@@ -3513,13 +3503,12 @@ void CDECL wined3d_device_draw_primitive_instanced(struct wined3d_device *device
     TRACE("device %p, start_vertex %u, vertex_count %u, start_instance %u, instance_count %u.\n",
             device, start_vertex, vertex_count, start_instance, instance_count);
 
-    wined3d_cs_emit_draw(device->cs, start_vertex, vertex_count, start_instance, instance_count, FALSE);
+    wined3d_cs_emit_draw(device->cs, device->state.gl_primitive_type, device->state.base_vertex_index,
+            start_vertex, vertex_count, start_instance, instance_count, FALSE);
 }
 
 HRESULT CDECL wined3d_device_draw_indexed_primitive(struct wined3d_device *device, UINT start_idx, UINT index_count)
 {
-    const struct wined3d_gl_info *gl_info = &device->adapter->gl_info;
-
     TRACE("device %p, start_idx %u, index_count %u.\n", device, start_idx, index_count);
 
     if (!device->state.index_buffer)
@@ -3532,14 +3521,8 @@ HRESULT CDECL wined3d_device_draw_indexed_primitive(struct wined3d_device *devic
         return WINED3DERR_INVALIDCALL;
     }
 
-    if (!gl_info->supported[ARB_DRAW_ELEMENTS_BASE_VERTEX] &&
-            device->state.load_base_vertex_index != device->state.base_vertex_index)
-    {
-        device->state.load_base_vertex_index = device->state.base_vertex_index;
-        device_invalidate_state(device, STATE_BASEVERTEXINDEX);
-    }
-
-    wined3d_cs_emit_draw(device->cs, start_idx, index_count, 0, 0, TRUE);
+    wined3d_cs_emit_draw(device->cs, device->state.gl_primitive_type,
+            device->state.base_vertex_index, start_idx, index_count, 0, 0, TRUE);
 
     return WINED3D_OK;
 }
@@ -3550,7 +3533,8 @@ void CDECL wined3d_device_draw_indexed_primitive_instanced(struct wined3d_device
     TRACE("device %p, start_idx %u, index_count %u, start_instance %u, instance_count %u.\n",
             device, start_idx, index_count, start_instance, instance_count);
 
-    wined3d_cs_emit_draw(device->cs, start_idx, index_count, start_instance, instance_count, TRUE);
+    wined3d_cs_emit_draw(device->cs, device->state.gl_primitive_type, device->state.base_vertex_index,
+            start_idx, index_count, start_instance, instance_count, TRUE);
 }
 
 static HRESULT wined3d_device_update_texture_3d(struct wined3d_device *device,
@@ -3624,6 +3608,9 @@ HRESULT CDECL wined3d_device_update_texture(struct wined3d_device *device,
         return WINED3DERR_INVALIDCALL;
     }
 
+    wined3d_resource_wait_idle(&src_texture->resource);
+    wined3d_resource_wait_idle(&dst_texture->resource);
+
     if (src_texture->resource.pool != WINED3D_POOL_SYSTEM_MEM)
     {
         WARN("Source texture not in WINED3D_POOL_SYSTEM_MEM, returning WINED3DERR_INVALIDCALL.\n");
@@ -3858,6 +3845,9 @@ void CDECL wined3d_device_copy_resource(struct wined3d_device *device,
 
     TRACE("device %p, dst_resource %p, src_resource %p.\n", device, dst_resource, src_resource);
 
+    wined3d_resource_wait_idle(src_resource);
+    wined3d_resource_wait_idle(dst_resource);
+
     if (src_resource == dst_resource)
     {
         WARN("Source and destination are the same resource.\n");
@@ -3950,6 +3940,9 @@ HRESULT CDECL wined3d_device_copy_sub_resource_region(struct wined3d_device *dev
             device, dst_resource, dst_sub_resource_idx, dst_x, dst_y, dst_z,
             src_resource, src_sub_resource_idx, debug_box(src_box));
 
+    wined3d_resource_wait_idle(src_resource);
+    wined3d_resource_wait_idle(dst_resource);
+
     if (src_box && (src_box->left >= src_box->right
             || src_box->top >= src_box->bottom
             || src_box->front >= src_box->back))
@@ -4068,6 +4061,8 @@ void CDECL wined3d_device_update_sub_resource(struct wined3d_device *device, str
     TRACE("device %p, resource %p, sub_resource_idx %u, box %s, data %p, row_pitch %u, depth_pitch %u.\n",
             device, resource, sub_resource_idx, debug_box(box), data, row_pitch, depth_pitch);
 
+    wined3d_resource_wait_idle(resource);
+
     if (resource->type == WINED3D_RTYPE_BUFFER)
     {
         struct wined3d_buffer *buffer = buffer_from_resource(resource);
@@ -4165,6 +4160,8 @@ HRESULT CDECL wined3d_device_clear_rendertarget_view(struct wined3d_device *devi
     if (!flags)
         return WINED3D_OK;
 
+    wined3d_resource_wait_idle(view->resource);
+
     resource = view->resource;
     if (resource->type != WINED3D_RTYPE_TEXTURE_2D)
     {
@@ -4357,6 +4354,8 @@ HRESULT CDECL wined3d_device_set_cursor_properties(struct wined3d_device *device
     TRACE("device %p, x_hotspot %u, y_hotspot %u, texture %p, sub_resource_idx %u.\n",
             device, x_hotspot, y_hotspot, texture, sub_resource_idx);
 
+    wined3d_resource_wait_idle(&texture->resource);
+
     if (sub_resource_idx >= texture->level_count * texture->layer_count
             || texture->resource.type != WINED3D_RTYPE_TEXTURE_2D)
         return WINED3DERR_INVALIDCALL;
@@ -4517,6 +4516,8 @@ void CDECL wined3d_device_evict_managed_resources(struct wined3d_device *device)
 
     TRACE("device %p.\n", device);
 
+    wined3d_cs_finish(device->cs);
+
     LIST_FOR_EACH_ENTRY_SAFE(resource, cursor, &device->resources, struct wined3d_resource, resource_list_entry)
     {
         TRACE("Checking resource %p for eviction.\n", resource);
@@ -4563,6 +4564,7 @@ static void delete_opengl_contexts(struct wined3d_device *device, struct wined3d
     device->shader_backend->shader_free_private(device);
     destroy_dummy_textures(device, gl_info);
     destroy_default_samplers(device);
+    wined3d_stream_allocator_cleanup(device, gl_info);
 
     context_release(context);
 
@@ -4639,6 +4641,8 @@ HRESULT CDECL wined3d_device_reset(struct wined3d_device *device,
     TRACE("device %p, swapchain_desc %p, mode %p, callback %p, reset_state %#x.\n",
             device, swapchain_desc, mode, callback, reset_state);
 
+    wined3d_cs_finish(device->cs);
+
     if (!(swapchain = wined3d_device_get_swapchain(device, 0)))
     {
         ERR("Failed to get the first implicit swapchain.\n");
@@ -5004,8 +5008,6 @@ void device_resource_released(struct wined3d_device *device, struct wined3d_reso
 
     TRACE("device %p, resource %p, type %s.\n", device, resource, debug_d3dresourcetype(type));
 
-    context_resource_released(device, resource, type);
-
     for (i = 0; i < device->adapter->gl_info.limits.buffers; ++i)
     {
         if ((rtv = device->fb.render_targets[i]) && rtv->resource == resource)
@@ -5115,6 +5117,7 @@ HRESULT device_init(struct wined3d_device *device, struct wined3d *wined3d,
     device->device_parent = device_parent;
     list_init(&device->resources);
     list_init(&device->shaders);
+    list_init(&device->stream_allocator.batches);
     device->surface_alignment = surface_alignment;
 
     /* Save the creation parameters. */
@@ -134,7 +134,10 @@ static void draw_primitive_arrays(struct wined3d_context *context, const struct
             element = &si->elements[element_idx];
             ptr = element->data.addr + element->stride * i;
             if (element->data.buffer_object)
-                ptr += (ULONG_PTR)buffer_get_sysmem(state->streams[element->stream_idx].buffer, context);
+            {
+                struct wined3d_buffer *buffer = state->streams[element->stream_idx].buffer;
+                ptr += (ULONG_PTR)buffer_get_sysmem(buffer, context) - buffer->stream_block.offset;
+            }
             ops->generic[element->format->emit_idx](element_idx, ptr);
         }
 
@@ -401,7 +404,8 @@ static void remove_vbos(struct wined3d_context *context,
         {
             struct wined3d_buffer *vb = state->streams[e->stream_idx].buffer;
             e->data.buffer_object = 0;
-            e->data.addr = (BYTE *)((ULONG_PTR)e->data.addr + (ULONG_PTR)buffer_get_sysmem(vb, context));
+            e->data.addr = (BYTE *)((ULONG_PTR)e->data.addr + (ULONG_PTR)buffer_get_sysmem(vb, context)
+                    - vb->stream_block.offset);
         }
     }
 }
@@ -522,12 +526,12 @@ void draw_primitive(struct wined3d_device *device, const struct wined3d_state *s
         struct wined3d_buffer *index_buffer = state->index_buffer;
         if (!index_buffer->buffer_object || !stream_info->all_vbo)
         {
-            idx_data = index_buffer->resource.heap_memory;
+            idx_data = buffer_get_sysmem(index_buffer, context);
         }
         else
         {
             ib_query = index_buffer->query;
-            idx_data = NULL;
+            idx_data = (const BYTE *)(ULONG_PTR)index_buffer->stream_block.offset;
         }
         idx_data = (const BYTE *)idx_data + state->index_offset;
 
@@ -566,6 +570,10 @@ void draw_primitive(struct wined3d_device *device, const struct wined3d_state *s
 
         if (emulation)
         {
+            /* Immediate mode can't source indices from a buffer object. */
+            if (indexed && state->index_buffer->buffer_object && stream_info->all_vbo)
+                idx_data = buffer_get_sysmem(state->index_buffer, context) + state->index_offset;
+
             si_emulated = context->stream_info;
             remove_vbos(context, state, &si_emulated);
             stream_info = &si_emulated;
@@ -42,6 +42,7 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d_shader);
 WINE_DECLARE_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 WINE_DECLARE_DEBUG_CHANNEL(winediag);
 
 #define WINED3D_GLSL_SAMPLE_PROJECTED   0x01
@@ -93,6 +94,34 @@ struct constant_heap
 };
 
 /* GLSL shader private data */
+#define WINED3D_GLSL_BINARY_CACHE_MAGIC     0x42534c47 /* "GLSB" */
+#define WINED3D_GLSL_BINARY_CACHE_VERSION   1
+
+struct glsl_binary_cache_key
+{
+    UINT64 key;
+    UINT64 check;
+};
+
+struct glsl_binary_cache_header
+{
+    DWORD magic;
+    DWORD version;
+    struct glsl_binary_cache_key key;
+    GLenum format;
+    DWORD size;
+};
+
+/* State that affects linking, but isn't part of the GLSL source. */
+struct glsl_program_link_params
+{
+    DWORD attribs_map;
+    DWORD explicit_attrib_location;
+    DWORD gs_input_type;
+    DWORD gs_output_type;
+    DWORD gs_vertices_out;
+};
+
 struct shader_glsl_priv {
     struct wined3d_string_buffer shader_buffer;
     struct wined3d_string_buffer_list string_buffers;
@@ -110,6 +139,14 @@ struct shader_glsl_priv {
     struct wine_rb_tree ffp_fragment_shaders;
     BOOL ffp_proj_control;
     BOOL legacy_lighting;
+
+    BOOL binary_cache;
+    BOOL binary_cache_initialized;
+    struct glsl_binary_cache_key driver_key;
+    unsigned int binary_cache_hits;
+    unsigned int binary_cache_misses;
+    unsigned int binary_cache_stores;
+    unsigned int binary_cache_rejects;
 };
 
 struct glsl_vs_program
@@ -7534,6 +7571,273 @@ static void shader_glsl_init_uniform_block_bindings(const struct wined3d_gl_info
     string_buffer_release(&priv->string_buffers, name);
 }
 
+static void glsl_binary_cache_key_update(struct glsl_binary_cache_key *key, const void *data, size_t size)
+{
+    const BYTE *ptr = data;
+    size_t i;
+
+    /* 64-bit FNV-1a for the file name, and a separate multiplicative hash
+     * stored in the file header to catch collisions. */
+    for (i = 0; i < size; ++i)
+    {
+        key->key = (key->key ^ ptr[i]) * 0x100000001b3ull;
+        key->check = key->check * 31 + ptr[i];
+    }
+}
+
+static BOOL glsl_binary_cache_get_path(const struct glsl_binary_cache_key *key, char *path, size_t size)
+{
+    int len;
+
+    len = snprintf(path, size, "%s\\%08x%08x.bin", wined3d_settings.shader_cache_path,
+            (unsigned int)(key->key >> 32), (unsigned int)key->key);
+    return len > 0 && len < size;
+}
+
+static void glsl_binary_cache_create_directory(const char *path)
+{
+    char buffer[MAX_PATH];
+    size_t len, i;
+
+    if ((len = strlen(path)) >= sizeof(buffer))
+        return;
+    memcpy(buffer, path, len + 1);
+
+    for (i = 1; i < len; ++i)
+    {
+        if (buffer[i] != '\\' && buffer[i] != '/')
+            continue;
+        /* Skip the root of a drive, e.g. "C:\". */
+        if (buffer[i - 1] == ':')
+            continue;
+        buffer[i] = 0;
+        CreateDirectoryA(buffer, NULL);
+        buffer[i] = '\\';
+    }
+    CreateDirectoryA(buffer, NULL);
+}
+
+/* Context activation is done by the caller. */
+static BOOL shader_glsl_init_binary_cache(const struct wined3d_gl_info *gl_info, struct shader_glsl_priv *priv)
+{
+    static const GLenum strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    const char *str;
+    unsigned int i;
+    GLint count;
+
+    priv->binary_cache_initialized = TRUE;
+
+    gl_info->gl_ops.gl.p_glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+    checkGLcall("glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS)");
+    if (!count)
+    {
+        WARN("No program binary formats supported, disabling the binary cache.\n");
+        return priv->binary_cache = FALSE;
+    }
+
+    /* Binaries are only valid for the driver that created them. */
+    priv->driver_key.key = 0xcbf29ce484222325ull;
+    priv->driver_key.check = 0;
+    for (i = 0; i < sizeof(strings) / sizeof(*strings); ++i)
+    {
+        if ((str = (const char *)gl_info->gl_ops.gl.p_glGetString(strings[i])))
+            glsl_binary_cache_key_update(&priv->driver_key, str, strlen(str) + 1);
+    }
+
+    glsl_binary_cache_create_directory(wined3d_settings.shader_cache_path);
+
+    return TRUE;
+}
+
+/* Context activation is done by the caller. */
+static BOOL shader_glsl_get_binary_cache_key(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv, const GLuint *shader_ids, unsigned int shader_count,
+        const struct glsl_program_link_params *params, struct glsl_binary_cache_key *key)
+{
+    char *source = NULL;
+    GLint source_size = 0, length;
+    unsigned int i;
+
+    *key = priv->driver_key;
+    glsl_binary_cache_key_update(key, params, sizeof(*params));
+
+    /* The generated source already reflects the shader bytecode and the
+     * compile arguments it was generated with. */
+    for (i = 0; i < shader_count; ++i)
+    {
+        if (!shader_ids[i])
+        {
+            glsl_binary_cache_key_update(key, &shader_ids[i], sizeof(shader_ids[i]));
+            continue;
+        }
+
+        GL_EXTCALL(glGetShaderiv(shader_ids[i], GL_SHADER_SOURCE_LENGTH, &length));
+        if (length > source_size)
+        {
+            HeapFree(GetProcessHeap(), 0, source);
+            if (!(source = HeapAlloc(GetProcessHeap(), 0, length)))
+            {
+                ERR("Failed to allocate %d bytes for shader source.\n", length);
+                return FALSE;
+            }
+            source_size = length;
+        }
+        if (length)
+        {
+            GL_EXTCALL(glGetShaderSource(shader_ids[i], length, &length, source));
+            glsl_binary_cache_key_update(key, source, length);
+        }
+        glsl_binary_cache_key_update(key, &length, sizeof(length));
+    }
+    checkGLcall("get shader source");
+
+    HeapFree(GetProcessHeap(), 0, source);
+
+    return TRUE;
+}
+
+/* Context activation is done by the caller. */
+static BOOL shader_glsl_load_program_binary(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv, GLuint program_id, const struct glsl_binary_cache_key *key)
+{
+    struct glsl_binary_cache_header header;
+    char path[MAX_PATH];
+    DWORD read, size;
+    void *data;
+    HANDLE file;
+    GLint status;
+
+    if (!glsl_binary_cache_get_path(key, path, sizeof(path)))
+        return FALSE;
+
+    if ((file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        ++priv->binary_cache_misses;
+        return FALSE;
+    }
+
+    size = GetFileSize(file, NULL);
+    if (!ReadFile(file, &header, sizeof(header), &read, NULL) || read != sizeof(header)
+            || header.magic != WINED3D_GLSL_BINARY_CACHE_MAGIC
+            || header.version != WINED3D_GLSL_BINARY_CACHE_VERSION
+            || header.key.key != key->key || header.key.check != key->check
+            || !header.size || header.size != size - sizeof(header))
+    {
+        WARN("Ignoring invalid program binary %s.\n", debugstr_a(path));
+        CloseHandle(file);
+        ++priv->binary_cache_misses;
+        return FALSE;
+    }
+
+    if (!(data = HeapAlloc(GetProcessHeap(), 0, header.size)))
+    {
+        ERR("Failed to allocate %u bytes for program binary.\n", header.size);
+        CloseHandle(file);
+        return FALSE;
+    }
+
+    if (!ReadFile(file, data, header.size, &read, NULL) || read != header.size)
+    {
+        WARN("Failed to read program binary %s.\n", debugstr_a(path));
+        HeapFree(GetProcessHeap(), 0, data);
+        CloseHandle(file);
+        ++priv->binary_cache_misses;
+        return FALSE;
+    }
+    CloseHandle(file);
+
+    GL_EXTCALL(glProgramBinary(program_id, header.format, data, header.size));
+    HeapFree(GetProcessHeap(), 0, data);
+    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    checkGLcall("glProgramBinary");
+
+    if (!status)
+    {
+        /* Typically because of a driver update. The program will be linked
+         * normally and the stale binary replaced. */
+        TRACE("Driver rejected program binary %s.\n", debugstr_a(path));
+        ++priv->binary_cache_rejects;
+        return FALSE;
+    }
+
+    TRACE("Loaded program %u from %s.\n", program_id, debugstr_a(path));
+    ++priv->binary_cache_hits;
+
+    return TRUE;
+}
+
+/* Context activation is done by the caller. */
+static void shader_glsl_store_program_binary(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv, GLuint program_id, const struct glsl_binary_cache_key *key)
+{
+    struct glsl_binary_cache_header header;
+    char path[MAX_PATH], tmp_path[MAX_PATH];
+    GLint status, length;
+    DWORD written;
+    GLenum format;
+    HANDLE file;
+    void *data;
+    BOOL ret;
+
+    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    if (!status)
+        return;
+    GL_EXTCALL(glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length));
+    checkGLcall("glGetProgramiv");
+    if (length <= 0)
+        return;
+
+    if (!glsl_binary_cache_get_path(key, path, sizeof(path)))
+        return;
+
+    if (!(data = HeapAlloc(GetProcessHeap(), 0, length)))
+    {
+        ERR("Failed to allocate %d bytes for program binary.\n", length);
+        return;
+    }
+
+    GL_EXTCALL(glGetProgramBinary(program_id, length, &length, &format, data));
+    checkGLcall("glGetProgramBinary");
+
+    /* Write to a temporary file first, so that other processes never see a
+     * partially written binary. */
+    if (!GetTempFileNameA(wined3d_settings.shader_cache_path, "glb", 0, tmp_path))
+    {
+        WARN("Failed to create temporary file in %s.\n", debugstr_a(wined3d_settings.shader_cache_path));
+        HeapFree(GetProcessHeap(), 0, data);
+        return;
+    }
+
+    if ((file = CreateFileA(tmp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        DeleteFileA(tmp_path);
+        HeapFree(GetProcessHeap(), 0, data);
+        return;
+    }
+
+    header.magic = WINED3D_GLSL_BINARY_CACHE_MAGIC;
+    header.version = WINED3D_GLSL_BINARY_CACHE_VERSION;
+    header.key = *key;
+    header.format = format;
+    header.size = length;
+
+    ret = WriteFile(file, &header, sizeof(header), &written, NULL) && written == sizeof(header)
+            && WriteFile(file, data, length, &written, NULL) && written == length;
+    CloseHandle(file);
+    HeapFree(GetProcessHeap(), 0, data);
+
+    if (!ret || !MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING))
+    {
+        WARN("Failed to store program binary %s.\n", debugstr_a(path));
+        DeleteFileA(tmp_path);
+        return;
+    }
+
+    TRACE("Stored program %u to %s.\n", program_id, debugstr_a(path));
+    ++priv->binary_cache_stores;
+}
+
 /* Context activation is done by the caller. */
 static void set_glsl_shader_program(const struct wined3d_context *context, const struct wined3d_state *state,
         struct shader_glsl_priv *priv, struct glsl_context_data *ctx_data)
@@ -7554,6 +7858,9 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
     struct list *ps_list, *vs_list;
     WORD attribs_map;
     struct wined3d_string_buffer *tmp_name;
+    struct glsl_program_link_params link_params;
+    struct glsl_binary_cache_key binary_key;
+    BOOL use_binary_cache;
 
     if (!(context->shader_update_mask & (1u << WINED3D_SHADER_TYPE_VERTEX)) && ctx_data->glsl_program)
     {
@@ -7698,6 +8005,10 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
         attribs_map = (1u << WINED3D_FFP_ATTRIBS_COUNT) - 1;
     }
 
+    memset(&link_params, 0, sizeof(link_params));
+    link_params.attribs_map = attribs_map;
+    link_params.explicit_attrib_location = shader_glsl_use_explicit_attrib_location(gl_info);
+
     if (!shader_glsl_use_explicit_attrib_location(gl_info))
     {
         /* Bind vertex attributes to a corresponding index number to match
@@ -7748,6 +8059,10 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
             GL_EXTCALL(glProgramParameteriARB(program_id, GL_GEOMETRY_VERTICES_OUT_ARB,
                     gshader->u.gs.vertices_out));
             checkGLcall("glProgramParameteriARB");
+
+            link_params.gs_input_type = gshader->u.gs.input_type;
+            link_params.gs_output_type = gshader->u.gs.output_type;
+            link_params.gs_vertices_out = gshader->u.gs.vertices_out;
         }
 
         list_add_head(&gshader->linked_programs, &entry->gs.shader_entry);
@@ -7763,10 +8078,28 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
         list_add_head(ps_list, &entry->ps.shader_entry);
     }
 
-    /* Link the program */
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    use_binary_cache = priv->binary_cache
+            && (priv->binary_cache_initialized || shader_glsl_init_binary_cache(gl_info, priv));
+    if (use_binary_cache)
+    {
+        GLuint shader_ids[] = {vs_id, reorder_shader_id, gs_id, ps_id};
+
+        use_binary_cache = shader_glsl_get_binary_cache_key(gl_info, priv, shader_ids,
+                sizeof(shader_ids) / sizeof(*shader_ids), &link_params, &binary_key);
+        if (use_binary_cache)
+            GL_EXTCALL(glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    }
+
+    if (!use_binary_cache || !shader_glsl_load_program_binary(gl_info, priv, program_id, &binary_key))
+    {
+        /* Link the program */
+        TRACE("Linking GLSL shader program %u.\n", program_id);
+        GL_EXTCALL(glLinkProgram(program_id));
+        shader_glsl_validate_link(gl_info, program_id);
+
+        if (use_binary_cache)
+            shader_glsl_store_program_binary(gl_info, priv, program_id, &binary_key);
+    }
 
     shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
             vshader ? vshader->limits->constant_float : 0);
@@ -8077,6 +8410,9 @@ static void shader_glsl_select(void *shader_priv, struct wined3d_context *contex
         GL_EXTCALL(glUseProgram(program_id));
         checkGLcall("glUseProgram");
 
+        if (context->swapchain->device->cs->frame_stats)
+            ++context->swapchain->device->cs->frame_stats->program_switches;
+
         if (program_id)
             context->constant_update_mask |= ctx_data->glsl_program->constant_update_mask;
     }
@@ -8396,6 +8732,7 @@ static HRESULT shader_glsl_alloc(struct wined3d_device *device, const struct win
     fragment_pipe->get_caps(gl_info, &fragment_caps);
     priv->ffp_proj_control = fragment_caps.wined3d_caps & WINED3D_FRAGMENT_CAP_PROJ_CONTROL;
     priv->legacy_lighting = device->wined3d->flags & WINED3D_LEGACY_FFP_LIGHTING;
+    priv->binary_cache = wined3d_settings.shader_cache_path && gl_info->supported[ARB_GET_PROGRAM_BINARY];
 
     device->vertex_priv = vertex_priv;
     device->fragment_priv = fragment_priv;
@@ -8433,6 +8770,11 @@ static void shader_glsl_free(struct wined3d_device *device)
         }
     }
 
+    if (priv->binary_cache && priv->binary_cache_initialized)
+        TRACE_(d3d_perf)("Program binary cache: %u hits, %u misses, %u rejected, %u stored.\n",
+                priv->binary_cache_hits, priv->binary_cache_misses,
+                priv->binary_cache_rejects, priv->binary_cache_stores);
+
     wine_rb_destroy(&priv->program_lookup, NULL, NULL);
     constant_heap_free(&priv->pconst_heap);
     constant_heap_free(&priv->vconst_heap);
@@ -93,6 +93,8 @@ HRESULT CDECL wined3d_palette_set_entries(struct wined3d_palette *palette,
             palette, flags, start, count, entries);
     TRACE("Palette flags: %#x.\n", palette->flags);
 
+    wined3d_cs_finish(palette->device->cs);
+
     if (palette->flags & WINED3D_PALETTE_8BIT_ENTRIES)
     {
         const BYTE *entry = (const BYTE *)entries;
@@ -36,7 +36,7 @@ void wined3d_event_query_destroy(struct wined3d_event_query *query)
     HeapFree(GetProcessHeap(), 0, query);
 }
 
-static enum wined3d_event_query_result wined3d_event_query_test(const struct wined3d_event_query *query,
+enum wined3d_event_query_result wined3d_event_query_test(const struct wined3d_event_query *query,
         const struct wined3d_device *device)
 {
     struct wined3d_context *context;
@@ -233,42 +233,49 @@ ULONG CDECL wined3d_query_incref(struct wined3d_query *query)
     return refcount;
 }
 
-ULONG CDECL wined3d_query_decref(struct wined3d_query *query)
+static void wined3d_query_destroy_object(void *object)
 {
-    ULONG refcount = InterlockedDecrement(&query->ref);
+    struct wined3d_query *query = object;
 
-    TRACE("%p decreasing refcount to %u.\n", query, refcount);
+    list_remove(&query->poll_list_entry);
 
-    if (!refcount)
+    /* Queries are specific to the GL context that created them. Not
+     * deleting the query will obviously leak it, but that's still better
+     * than potentially deleting a different query with the same id in this
+     * context, and (still) leaking the actual query. */
+    if (query->type == WINED3D_QUERY_TYPE_EVENT)
     {
-        /* Queries are specific to the GL context that created them. Not
-         * deleting the query will obviously leak it, but that's still better
-         * than potentially deleting a different query with the same id in this
-         * context, and (still) leaking the actual query. */
-        if (query->type == WINED3D_QUERY_TYPE_EVENT)
-        {
-            struct wined3d_event_query *event_query = query->extendedData;
-            if (event_query) wined3d_event_query_destroy(event_query);
-        }
-        else if (query->type == WINED3D_QUERY_TYPE_OCCLUSION)
-        {
-            struct wined3d_occlusion_query *oq = query->extendedData;
-
-            if (oq->context) context_free_occlusion_query(oq);
-            HeapFree(GetProcessHeap(), 0, query->extendedData);
-        }
-        else if (query->type == WINED3D_QUERY_TYPE_TIMESTAMP)
-        {
-            struct wined3d_timestamp_query *tq = query->extendedData;
+        struct wined3d_event_query *event_query = query->extendedData;
+        if (event_query) wined3d_event_query_destroy(event_query);
+    }
+    else if (query->type == WINED3D_QUERY_TYPE_OCCLUSION)
+    {
+        struct wined3d_occlusion_query *oq = query->extendedData;
 
-            if (tq->context)
-                context_free_timestamp_query(tq);
-            HeapFree(GetProcessHeap(), 0, query->extendedData);
-        }
+        if (oq->context) context_free_occlusion_query(oq);
+        HeapFree(GetProcessHeap(), 0, query->extendedData);
+    }
+    else if (query->type == WINED3D_QUERY_TYPE_TIMESTAMP)
+    {
+        struct wined3d_timestamp_query *tq = query->extendedData;
 
-        HeapFree(GetProcessHeap(), 0, query);
+        if (tq->context)
+            context_free_timestamp_query(tq);
+        HeapFree(GetProcessHeap(), 0, query->extendedData);
     }
 
+    HeapFree(GetProcessHeap(), 0, query);
+}
+
+ULONG CDECL wined3d_query_decref(struct wined3d_query *query)
+{
+    ULONG refcount = InterlockedDecrement(&query->ref);
+
+    TRACE("%p decreasing refcount to %u.\n", query, refcount);
+
+    if (!refcount)
+        wined3d_cs_emit_callback(query->device->cs, wined3d_query_destroy_object, query);
+
     return refcount;
 }
 
@@ -292,7 +299,44 @@ HRESULT CDECL wined3d_query_issue(struct wined3d_query *query, DWORD flags)
 {
     TRACE("query %p, flags %#x.\n", query, flags);
 
-    return query->query_ops->query_issue(query, flags);
+    if (flags & WINED3DISSUE_END)
+        ++query->counter_main;
+
+    wined3d_cs_emit_query_issue(query->device->cs, query, flags);
+
+    if (flags & WINED3DISSUE_END)
+        query->state = QUERY_SIGNALLED;
+    else if (flags & WINED3DISSUE_BEGIN)
+        query->state = QUERY_BUILDING;
+
+    return WINED3D_OK;
+}
+
+/* Called by the command stream. */
+BOOL wined3d_query_poll(struct wined3d_query *query)
+{
+    if (!query->query_ops->query_poll(query))
+        return FALSE;
+
+    list_remove(&query->poll_list_entry);
+    list_init(&query->poll_list_entry);
+    InterlockedExchange(&query->counter_retrieved, query->counter_executed);
+
+    return TRUE;
+}
+
+/* Returns whether the result of the last WINED3DISSUE_END has been
+ * retrieved. The multi-threaded command stream polls queries on its own
+ * thread, so this never waits for it. */
+static BOOL wined3d_query_result_available(struct wined3d_query *query)
+{
+    if (query->counter_retrieved == query->counter_main)
+        return TRUE;
+
+    if (!query->device->cs->thread)
+        return wined3d_query_poll(query);
+
+    return FALSE;
 }
 
 static void fill_query_data(void *out, unsigned int out_size, const void *result, unsigned int result_size)
@@ -304,18 +348,10 @@ static HRESULT wined3d_occlusion_query_ops_get_data(struct wined3d_query *query,
         void *data, DWORD size, DWORD flags)
 {
     struct wined3d_occlusion_query *oq = query->extendedData;
-    struct wined3d_device *device = query->device;
-    const struct wined3d_gl_info *gl_info = &device->adapter->gl_info;
-    struct wined3d_context *context;
-    GLuint available;
-    GLuint samples;
-    HRESULT res;
+    DWORD samples;
 
     TRACE("query %p, data %p, size %#x, flags %#x.\n", query, data, size, flags);
 
-    if (!oq->context)
-        query->state = QUERY_CREATED;
-
     if (query->state == QUERY_CREATED)
     {
         /* D3D allows GetData on a new query, OpenGL doesn't. So just invent the data ourselves */
@@ -332,20 +368,34 @@ static HRESULT wined3d_occlusion_query_ops_get_data(struct wined3d_query *query,
         return S_FALSE;
     }
 
-    if (!gl_info->supported[ARB_OCCLUSION_QUERY])
+    if (!wined3d_query_result_available(query))
     {
-        WARN("%p Occlusion queries not supported. Returning 1.\n", query);
-        samples = 1;
-        fill_query_data(data, size, &samples, sizeof(samples));
-        return S_OK;
+        TRACE("Result not available yet, returning S_FALSE.\n");
+        return S_FALSE;
     }
 
+    TRACE("Returning %u samples.\n", oq->samples);
+    fill_query_data(data, size, &oq->samples, sizeof(oq->samples));
+
+    return S_OK;
+}
+
+static BOOL wined3d_occlusion_query_ops_poll(struct wined3d_query *query)
+{
+    struct wined3d_occlusion_query *oq = query->extendedData;
+    struct wined3d_device *device = query->device;
+    const struct wined3d_gl_info *gl_info = &device->adapter->gl_info;
+    struct wined3d_context *context;
+    GLuint available;
+    GLuint samples;
+
+    TRACE("query %p.\n", query);
+
     if (oq->context->tid != GetCurrentThreadId())
     {
         FIXME("%p Wrong thread, returning 1.\n", query);
-        samples = 1;
-        fill_query_data(data, size, &samples, sizeof(samples));
-        return S_OK;
+        oq->samples = 1;
+        return TRUE;
     }
 
     context = context_acquire(device, context_get_rt_surface(oq->context));
@@ -356,69 +406,55 @@ static HRESULT wined3d_occlusion_query_ops_get_data(struct wined3d_query *query,
 
     if (available)
     {
-        if (size)
-        {
-            GL_EXTCALL(glGetQueryObjectuiv(oq->id, GL_QUERY_RESULT, &samples));
-            checkGLcall("glGetQueryObjectuiv(GL_QUERY_RESULT)");
-            TRACE("Returning %d samples.\n", samples);
-            fill_query_data(data, size, &samples, sizeof(samples));
-        }
-        res = S_OK;
-    }
-    else
-    {
-        res = S_FALSE;
+        GL_EXTCALL(glGetQueryObjectuiv(oq->id, GL_QUERY_RESULT, &samples));
+        checkGLcall("glGetQueryObjectuiv(GL_QUERY_RESULT)");
+        oq->samples = samples;
     }
 
     context_release(context);
 
-    return res;
+    return available;
 }
 
 static HRESULT wined3d_event_query_ops_get_data(struct wined3d_query *query,
         void *data, DWORD size, DWORD flags)
 {
-    struct wined3d_event_query *event_query = query->extendedData;
     BOOL signaled;
-    enum wined3d_event_query_result ret;
 
     TRACE("query %p, data %p, size %#x, flags %#x.\n", query, data, size, flags);
 
     if (!data || !size) return S_OK;
-    if (!event_query)
-    {
-        WARN("Event query not supported by GL, reporting GPU idle.\n");
-        signaled = TRUE;
-        fill_query_data(data, size, &signaled, sizeof(signaled));
-        return S_OK;
-    }
 
-    ret = wined3d_event_query_test(event_query, query->device);
-    switch(ret)
+    signaled = wined3d_query_result_available(query);
+    fill_query_data(data, size, &signaled, sizeof(signaled));
+
+    return S_OK;
+}
+
+static BOOL wined3d_event_query_ops_poll(struct wined3d_query *query)
+{
+    struct wined3d_event_query *event_query = query->extendedData;
+
+    TRACE("query %p.\n", query);
+
+    switch (wined3d_event_query_test(event_query, query->device))
     {
         case WINED3D_EVENT_QUERY_OK:
         case WINED3D_EVENT_QUERY_NOT_STARTED:
-            signaled = TRUE;
-            fill_query_data(data, size, &signaled, sizeof(signaled));
-            break;
+            return TRUE;
 
         case WINED3D_EVENT_QUERY_WAITING:
-            signaled = FALSE;
-            fill_query_data(data, size, &signaled, sizeof(signaled));
-            break;
+            return FALSE;
 
         case WINED3D_EVENT_QUERY_WRONG_THREAD:
             FIXME("(%p) Wrong thread, reporting GPU idle.\n", query);
-            signaled = TRUE;
-            fill_query_data(data, size, &signaled, sizeof(signaled));
-            break;
+            return TRUE;
 
         case WINED3D_EVENT_QUERY_ERROR:
-            ERR("The GL event query failed, returning D3DERR_INVALIDCALL\n");
-            return WINED3DERR_INVALIDCALL;
+        default:
+            ERR("The GL event query failed, reporting GPU idle.\n");
+            return TRUE;
     }
-
-    return S_OK;
 }
 
 void * CDECL wined3d_query_get_parent(const struct wined3d_query *query)
@@ -435,19 +471,19 @@ enum wined3d_query_type CDECL wined3d_query_get_type(const struct wined3d_query
     return query->type;
 }
 
-static HRESULT wined3d_event_query_ops_issue(struct wined3d_query *query, DWORD flags)
+static BOOL wined3d_event_query_ops_issue(struct wined3d_query *query, DWORD flags)
 {
     TRACE("query %p, flags %#x.\n", query, flags);
 
-    TRACE("(%p) : flags %#x, type D3DQUERY_EVENT\n", query, flags);
     if (flags & WINED3DISSUE_END)
     {
         struct wined3d_event_query *event_query = query->extendedData;
 
         /* Faked event query support */
-        if (!event_query) return WINED3D_OK;
+        if (!event_query) return FALSE;
 
         wined3d_event_query_issue(event_query, query->device);
+        return TRUE;
     }
     else if (flags & WINED3DISSUE_BEGIN)
     {
@@ -455,112 +491,103 @@ static HRESULT wined3d_event_query_ops_issue(struct wined3d_query *query, DWORD
         ERR("Event query issued with START flag - what to do?\n");
     }
 
-    if (flags & WINED3DISSUE_BEGIN)
-        query->state = QUERY_BUILDING;
-    else
-        query->state = QUERY_SIGNALLED;
-
-    return WINED3D_OK;
+    return FALSE;
 }
 
-static HRESULT wined3d_occlusion_query_ops_issue(struct wined3d_query *query, DWORD flags)
+static BOOL wined3d_occlusion_query_ops_issue(struct wined3d_query *query, DWORD flags)
 {
+    struct wined3d_occlusion_query *oq = query->extendedData;
     struct wined3d_device *device = query->device;
     const struct wined3d_gl_info *gl_info = &device->adapter->gl_info;
+    struct wined3d_context *context;
 
     TRACE("query %p, flags %#x.\n", query, flags);
 
-    if (gl_info->supported[ARB_OCCLUSION_QUERY])
+    if (!gl_info->supported[ARB_OCCLUSION_QUERY])
     {
-        struct wined3d_occlusion_query *oq = query->extendedData;
-        struct wined3d_context *context;
+        FIXME("%p Occlusion queries not supported.\n", query);
+        oq->samples = 1;
+        return FALSE;
+    }
 
-        /* This is allowed according to msdn and our tests. Reset the query and restart */
-        if (flags & WINED3DISSUE_BEGIN)
+    /* This is allowed according to msdn and our tests. Reset the query and restart */
+    if (flags & WINED3DISSUE_BEGIN)
+    {
+        if (oq->started)
         {
-            if (query->state == QUERY_BUILDING)
+            if (oq->context->tid != GetCurrentThreadId())
             {
-                if (oq->context->tid != GetCurrentThreadId())
-                {
-                    FIXME("Wrong thread, can't restart query.\n");
-
-                    context_free_occlusion_query(oq);
-                    context = context_acquire(query->device, NULL);
-                    context_alloc_occlusion_query(context, oq);
-                }
-                else
-                {
-                    context = context_acquire(device, context_get_rt_surface(oq->context));
-
-                    GL_EXTCALL(glEndQuery(GL_SAMPLES_PASSED));
-                    checkGLcall("glEndQuery()");
-                }
+                FIXME("Wrong thread, can't restart query.\n");
+
+                context_free_occlusion_query(oq);
+                context = context_acquire(device, NULL);
+                context_alloc_occlusion_query(context, oq);
             }
             else
             {
-                if (oq->context) context_free_occlusion_query(oq);
-                context = context_acquire(query->device, NULL);
-                context_alloc_occlusion_query(context, oq);
+                context = context_acquire(device, context_get_rt_surface(oq->context));
+
+                GL_EXTCALL(glEndQuery(GL_SAMPLES_PASSED));
+                checkGLcall("glEndQuery()");
             }
+        }
+        else
+        {
+            if (oq->context) context_free_occlusion_query(oq);
+            context = context_acquire(device, NULL);
+            context_alloc_occlusion_query(context, oq);
+        }
 
-            GL_EXTCALL(glBeginQuery(GL_SAMPLES_PASSED, oq->id));
-            checkGLcall("glBeginQuery()");
+        GL_EXTCALL(glBeginQuery(GL_SAMPLES_PASSED, oq->id));
+        checkGLcall("glBeginQuery()");
 
-            context_release(context);
-        }
-        if (flags & WINED3DISSUE_END)
+        context_release(context);
+        oq->started = TRUE;
+    }
+    if (flags & WINED3DISSUE_END)
+    {
+        /* Msdn says _END on a non-building occlusion query returns an error, but
+         * our tests show that it returns OK. But OpenGL doesn't like it, so avoid
+         * generating an error
+         */
+        if (oq->started)
         {
-            /* Msdn says _END on a non-building occlusion query returns an error, but
-             * our tests show that it returns OK. But OpenGL doesn't like it, so avoid
-             * generating an error
-             */
-            if (query->state == QUERY_BUILDING)
+            if (oq->context->tid != GetCurrentThreadId())
             {
-                if (oq->context->tid != GetCurrentThreadId())
-                {
-                    FIXME("Wrong thread, can't end query.\n");
-                }
-                else
-                {
-                    context = context_acquire(device, context_get_rt_surface(oq->context));
-
-                    GL_EXTCALL(glEndQuery(GL_SAMPLES_PASSED));
-                    checkGLcall("glEndQuery()");
-
-                    context_release(context);
-                }
+                FIXME("Wrong thread, can't end query.\n");
             }
+            else
+            {
+                context = context_acquire(device, context_get_rt_surface(oq->context));
+
+                GL_EXTCALL(glEndQuery(GL_SAMPLES_PASSED));
+                checkGLcall("glEndQuery()");
+
+                context_release(context);
+            }
+            oq->started = FALSE;
         }
-    }
-    else
-    {
-        FIXME("%p Occlusion queries not supported.\n", query);
-    }
 
-    if (flags & WINED3DISSUE_BEGIN)
-        query->state = QUERY_BUILDING;
-    else
-        query->state = QUERY_SIGNALLED;
+        /* The query was never started, there's nothing to poll. */
+        if (!oq->context)
+        {
+            oq->samples = 0;
+            return FALSE;
+        }
+        return TRUE;
+    }
 
-    return WINED3D_OK; /* can be WINED3DERR_INVALIDCALL.    */
+    return FALSE;
 }
 
 static HRESULT wined3d_timestamp_query_ops_get_data(struct wined3d_query *query,
         void *data, DWORD size, DWORD flags)
 {
     struct wined3d_timestamp_query *tq = query->extendedData;
-    struct wined3d_device *device = query->device;
-    const struct wined3d_gl_info *gl_info = &device->adapter->gl_info;
-    struct wined3d_context *context;
-    GLuint available;
-    GLuint64 timestamp;
-    HRESULT res;
+    UINT64 timestamp;
 
     TRACE("query %p, data %p, size %#x, flags %#x.\n", query, data, size, flags);
 
-    if (!tq->context)
-        query->state = QUERY_CREATED;
-
     if (query->state == QUERY_CREATED)
     {
         /* D3D allows GetData on a new query, OpenGL doesn't. So just invent the data ourselves. */
@@ -570,12 +597,34 @@ static HRESULT wined3d_timestamp_query_ops_get_data(struct wined3d_query *query,
         return S_OK;
     }
 
+    if (!wined3d_query_result_available(query))
+    {
+        TRACE("Result not available yet, returning S_FALSE.\n");
+        return S_FALSE;
+    }
+
+    TRACE("Returning timestamp %s.\n", wine_dbgstr_longlong(tq->timestamp));
+    fill_query_data(data, size, &tq->timestamp, sizeof(tq->timestamp));
+
+    return S_OK;
+}
+
+static BOOL wined3d_timestamp_query_ops_poll(struct wined3d_query *query)
+{
+    struct wined3d_timestamp_query *tq = query->extendedData;
+    struct wined3d_device *device = query->device;
+    const struct wined3d_gl_info *gl_info = &device->adapter->gl_info;
+    struct wined3d_context *context;
+    GLuint64 timestamp;
+    GLuint available;
+
+    TRACE("query %p.\n", query);
+
     if (tq->context->tid != GetCurrentThreadId())
     {
         FIXME("%p Wrong thread, returning 1.\n", query);
-        timestamp = 1;
-        fill_query_data(data, size, &timestamp, sizeof(timestamp));
-        return S_OK;
+        tq->timestamp = 1;
+        return TRUE;
     }
 
     context = context_acquire(device, context_get_rt_surface(tq->context));
@@ -586,61 +635,48 @@ static HRESULT wined3d_timestamp_query_ops_get_data(struct wined3d_query *query,
 
     if (available)
     {
-        if (size)
-        {
-            GL_EXTCALL(glGetQueryObjectui64v(tq->id, GL_QUERY_RESULT, &timestamp));
-            checkGLcall("glGetQueryObjectui64v(GL_QUERY_RESULT)");
-            TRACE("Returning timestamp %s.\n", wine_dbgstr_longlong(timestamp));
-            fill_query_data(data, size, &timestamp, sizeof(timestamp));
-        }
-        res = S_OK;
-    }
-    else
-    {
-        res = S_FALSE;
+        GL_EXTCALL(glGetQueryObjectui64v(tq->id, GL_QUERY_RESULT, &timestamp));
+        checkGLcall("glGetQueryObjectui64v(GL_QUERY_RESULT)");
+        tq->timestamp = timestamp;
     }
 
     context_release(context);
 
-    return res;
+    return available;
 }
 
-static HRESULT wined3d_timestamp_query_ops_issue(struct wined3d_query *query, DWORD flags)
+static BOOL wined3d_timestamp_query_ops_issue(struct wined3d_query *query, DWORD flags)
 {
+    struct wined3d_timestamp_query *tq = query->extendedData;
     struct wined3d_device *device = query->device;
     const struct wined3d_gl_info *gl_info = &device->adapter->gl_info;
+    struct wined3d_context *context;
 
     TRACE("query %p, flags %#x.\n", query, flags);
 
-    if (gl_info->supported[ARB_TIMER_QUERY])
-    {
-        struct wined3d_timestamp_query *tq = query->extendedData;
-        struct wined3d_context *context;
-
-        if (flags & WINED3DISSUE_BEGIN)
-        {
-            WARN("Ignoring WINED3DISSUE_BEGIN with a TIMESTAMP query.\n");
-        }
-        if (flags & WINED3DISSUE_END)
-        {
-            if (tq->context)
-                context_free_timestamp_query(tq);
-            context = context_acquire(query->device, NULL);
-            context_alloc_timestamp_query(context, tq);
-            GL_EXTCALL(glQueryCounter(tq->id, GL_TIMESTAMP));
-            checkGLcall("glQueryCounter()");
-            context_release(context);
-        }
-    }
-    else
+    if (!gl_info->supported[ARB_TIMER_QUERY])
     {
         ERR("Timestamp queries not supported.\n");
+        return FALSE;
     }
 
+    if (flags & WINED3DISSUE_BEGIN)
+    {
+        WARN("Ignoring WINED3DISSUE_BEGIN with a TIMESTAMP query.\n");
+    }
     if (flags & WINED3DISSUE_END)
-        query->state = QUERY_SIGNALLED;
+    {
+        if (tq->context)
+            context_free_timestamp_query(tq);
+        context = context_acquire(device, NULL);
+        context_alloc_timestamp_query(context, tq);
+        GL_EXTCALL(glQueryCounter(tq->id, GL_TIMESTAMP));
+        checkGLcall("glQueryCounter()");
+        context_release(context);
+        return TRUE;
+    }
 
-    return WINED3D_OK;
+    return FALSE;
 }
 
 static HRESULT wined3d_timestamp_disjoint_query_ops_get_data(struct wined3d_query *query,
@@ -669,40 +705,46 @@ static HRESULT wined3d_timestamp_disjoint_query_ops_get_data(struct wined3d_quer
     return S_OK;
 }
 
-static HRESULT wined3d_timestamp_disjoint_query_ops_issue(struct wined3d_query *query, DWORD flags)
+static BOOL wined3d_timestamp_disjoint_query_ops_issue(struct wined3d_query *query, DWORD flags)
 {
     TRACE("query %p, flags %#x.\n", query, flags);
 
-    if (flags & WINED3DISSUE_BEGIN)
-        query->state = QUERY_BUILDING;
-    if (flags & WINED3DISSUE_END)
-        query->state = QUERY_SIGNALLED;
+    return FALSE;
+}
 
-    return WINED3D_OK;
+static BOOL wined3d_timestamp_disjoint_query_ops_poll(struct wined3d_query *query)
+{
+    TRACE("query %p.\n", query);
+
+    return TRUE;
 }
 
 static const struct wined3d_query_ops event_query_ops =
 {
     wined3d_event_query_ops_get_data,
     wined3d_event_query_ops_issue,
+    wined3d_event_query_ops_poll,
 };
 
 static const struct wined3d_query_ops occlusion_query_ops =
 {
     wined3d_occlusion_query_ops_get_data,
     wined3d_occlusion_query_ops_issue,
+    wined3d_occlusion_query_ops_poll,
 };
 
 static const struct wined3d_query_ops timestamp_query_ops =
 {
     wined3d_timestamp_query_ops_get_data,
     wined3d_timestamp_query_ops_issue,
+    wined3d_timestamp_query_ops_poll,
 };
 
 static const struct wined3d_query_ops timestamp_disjoint_query_ops =
 {
     wined3d_timestamp_disjoint_query_ops_get_data,
     wined3d_timestamp_disjoint_query_ops_issue,
+    wined3d_timestamp_disjoint_query_ops_poll,
 };
 
 static HRESULT query_init(struct wined3d_query *query, struct wined3d_device *device,
@@ -723,13 +765,12 @@ static HRESULT query_init(struct wined3d_query *query, struct wined3d_device *de
             }
             query->query_ops = &occlusion_query_ops;
             query->data_size = sizeof(DWORD);
-            query->extendedData = HeapAlloc(GetProcessHeap(), 0, sizeof(struct wined3d_occlusion_query));
+            query->extendedData = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(struct wined3d_occlusion_query));
             if (!query->extendedData)
             {
                 ERR("Failed to allocate occlusion query extended data.\n");
                 return E_OUTOFMEMORY;
             }
-            ((struct wined3d_occlusion_query *)query->extendedData)->context = NULL;
             break;
 
         case WINED3D_QUERY_TYPE_EVENT:
@@ -761,13 +802,12 @@ static HRESULT query_init(struct wined3d_query *query, struct wined3d_device *de
             }
             query->query_ops = &timestamp_query_ops;
             query->data_size = sizeof(UINT64);
-            query->extendedData = HeapAlloc(GetProcessHeap(), 0, sizeof(struct wined3d_timestamp_query));
+            query->extendedData = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(struct wined3d_timestamp_query));
             if (!query->extendedData)
             {
                 ERR("Failed to allocate timestamp query extended data.\n");
                 return E_OUTOFMEMORY;
             }
-            ((struct wined3d_timestamp_query *)query->extendedData)->context = NULL;
             break;
 
         case WINED3D_QUERY_TYPE_TIMESTAMP_DISJOINT:
@@ -802,6 +842,7 @@ static HRESULT query_init(struct wined3d_query *query, struct wined3d_device *de
     query->state = QUERY_CREATED;
     query->device = device;
     query->ref = 1;
+    list_init(&query->poll_list_entry);
 
     return WINED3D_OK;
 }
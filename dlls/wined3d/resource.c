@@ -198,6 +198,7 @@ HRESULT resource_init(struct wined3d_resource *resource, struct wined3d_device *
     resource->depth = depth;
     resource->size = size;
     resource->priority = 0;
+    resource->access_op = 0;
     resource->parent = parent;
     resource->parent_ops = parent_ops;
     resource->resource_ops = resource_ops;
@@ -233,11 +234,14 @@ HRESULT resource_init(struct wined3d_resource *resource, struct wined3d_device *
     return WINED3D_OK;
 }
 
-void resource_cleanup(struct wined3d_resource *resource)
+/* Removes the resource from the device. This happens on the application
+ * thread as soon as the resource is released; ops that are still queued may
+ * use the resource until resource_destroy() is called. */
+void resource_detach(struct wined3d_resource *resource)
 {
     const struct wined3d *d3d = resource->device->wined3d;
 
-    TRACE("Cleaning up resource %p.\n", resource);
+    TRACE("Detaching resource %p.\n", resource);
 
     if (resource->pool == WINED3D_POOL_DEFAULT && d3d->flags & WINED3D_VIDMEM_ACCOUNTING)
     {
@@ -245,9 +249,24 @@ void resource_cleanup(struct wined3d_resource *resource)
         adapter_adjust_memory(resource->device->adapter, (INT64)0 - resource->size);
     }
 
+    device_resource_released(resource->device, resource);
+}
+
+/* Frees the memory of the resource, along with its GL objects. */
+void resource_destroy(struct wined3d_resource *resource)
+{
+    TRACE("Destroying resource %p.\n", resource);
+
     wined3d_resource_free_sysmem(resource);
+    context_resource_released(resource->device, resource, resource->type);
+}
 
-    device_resource_released(resource->device, resource);
+void resource_cleanup(struct wined3d_resource *resource)
+{
+    TRACE("Cleaning up resource %p.\n", resource);
+
+    resource_detach(resource);
+    resource_destroy(resource);
 }
 
 void resource_unload(struct wined3d_resource *resource)
@@ -102,7 +102,6 @@ static void state_lighting(struct wined3d_context *context, const struct wined3d
 static void state_zenable(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
 {
     enum wined3d_depth_buffer_type zenable = state->render_states[WINED3D_RS_ZENABLE];
-    const struct wined3d_gl_info *gl_info = context->gl_info;
 
     /* No z test without depth stencil buffers */
     if (!state->fb->depth_stencil)
@@ -114,16 +113,13 @@ static void state_zenable(struct wined3d_context *context, const struct wined3d_
     switch (zenable)
     {
         case WINED3D_ZB_FALSE:
-            gl_info->gl_ops.gl.p_glDisable(GL_DEPTH_TEST);
-            checkGLcall("glDisable GL_DEPTH_TEST");
+            context_gl_enable(context, GL_DEPTH_TEST, FALSE);
             break;
         case WINED3D_ZB_TRUE:
-            gl_info->gl_ops.gl.p_glEnable(GL_DEPTH_TEST);
-            checkGLcall("glEnable GL_DEPTH_TEST");
+            context_gl_enable(context, GL_DEPTH_TEST, TRUE);
             break;
         case WINED3D_ZB_USEW:
-            gl_info->gl_ops.gl.p_glEnable(GL_DEPTH_TEST);
-            checkGLcall("glEnable GL_DEPTH_TEST");
+            context_gl_enable(context, GL_DEPTH_TEST, TRUE);
             FIXME("W buffer is not well handled\n");
             break;
         default:
@@ -144,18 +140,15 @@ static void state_cullmode(struct wined3d_context *context, const struct wined3d
     switch (state->render_states[WINED3D_RS_CULLMODE])
     {
         case WINED3D_CULL_NONE:
-            gl_info->gl_ops.gl.p_glDisable(GL_CULL_FACE);
-            checkGLcall("glDisable GL_CULL_FACE");
+            context_gl_enable(context, GL_CULL_FACE, FALSE);
             break;
         case WINED3D_CULL_CW:
-            gl_info->gl_ops.gl.p_glEnable(GL_CULL_FACE);
-            checkGLcall("glEnable GL_CULL_FACE");
+            context_gl_enable(context, GL_CULL_FACE, TRUE);
             gl_info->gl_ops.gl.p_glCullFace(GL_FRONT);
             checkGLcall("glCullFace(GL_FRONT)");
             break;
         case WINED3D_CULL_CCW:
-            gl_info->gl_ops.gl.p_glEnable(GL_CULL_FACE);
-            checkGLcall("glEnable GL_CULL_FACE");
+            context_gl_enable(context, GL_CULL_FACE, TRUE);
             gl_info->gl_ops.gl.p_glCullFace(GL_BACK);
             checkGLcall("glCullFace(GL_BACK)");
             break;
@@ -206,18 +199,7 @@ static void state_ditherenable(struct wined3d_context *context, const struct win
 
 static void state_zwritenable(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
 {
-    const struct wined3d_gl_info *gl_info = context->gl_info;
-
-    if (state->render_states[WINED3D_RS_ZWRITEENABLE])
-    {
-        gl_info->gl_ops.gl.p_glDepthMask(1);
-        checkGLcall("glDepthMask(1)");
-    }
-    else
-    {
-        gl_info->gl_ops.gl.p_glDepthMask(0);
-        checkGLcall("glDepthMask(0)");
-    }
+    context_gl_depth_mask(context, state->render_states[WINED3D_RS_ZWRITEENABLE] ? GL_TRUE : GL_FALSE);
 }
 
 GLenum wined3d_gl_compare_func(enum wined3d_cmp_func f)
@@ -249,12 +231,10 @@ GLenum wined3d_gl_compare_func(enum wined3d_cmp_func f)
 static void state_zfunc(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
 {
     GLenum depth_func = wined3d_gl_compare_func(state->render_states[WINED3D_RS_ZFUNC]);
-    const struct wined3d_gl_info *gl_info = context->gl_info;
 
     if (!depth_func) return;
 
-    gl_info->gl_ops.gl.p_glDepthFunc(depth_func);
-    checkGLcall("glDepthFunc");
+    context_gl_depth_func(context, depth_func);
 }
 
 static void state_ambient(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
@@ -311,16 +291,9 @@ static void state_blendop(struct wined3d_context *context, const struct wined3d_
     blend_equation_alpha = gl_blend_op(gl_info, state->render_states[WINED3D_RS_BLENDOPALPHA]);
     TRACE("blend_equation %#x, blend_equation_alpha %#x.\n", blend_equation, blend_equation_alpha);
 
-    if (state->render_states[WINED3D_RS_SEPARATEALPHABLENDENABLE])
-    {
-        GL_EXTCALL(glBlendEquationSeparate(blend_equation, blend_equation_alpha));
-        checkGLcall("glBlendEquationSeparate");
-    }
-    else
-    {
-        GL_EXTCALL(glBlendEquation(blend_equation));
-        checkGLcall("glBlendEquation");
-    }
+    if (!state->render_states[WINED3D_RS_SEPARATEALPHABLENDENABLE])
+        blend_equation_alpha = blend_equation;
+    context_gl_blend_equation(context, blend_equation, blend_equation_alpha);
 }
 
 static GLenum gl_blend_factor(enum wined3d_blend factor, const struct wined3d_format *dst_format)
@@ -375,7 +348,7 @@ static void state_blend(struct wined3d_context *context, const struct wined3d_st
 
     if (!state->fb->render_targets[0])
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_BLEND);
+        context_gl_enable(context, GL_BLEND, FALSE);
         return;
     }
 
@@ -393,20 +366,17 @@ static void state_blend(struct wined3d_context *context, const struct wined3d_st
          * The d3d9 visual test confirms the behavior. */
         if (context->render_offscreen && !(rt_fmt_flags & WINED3DFMT_FLAG_POSTPIXELSHADER_BLENDING))
         {
-            gl_info->gl_ops.gl.p_glDisable(GL_BLEND);
-            checkGLcall("glDisable GL_BLEND");
+            context_gl_enable(context, GL_BLEND, FALSE);
             return;
         }
         else
         {
-            gl_info->gl_ops.gl.p_glEnable(GL_BLEND);
-            checkGLcall("glEnable GL_BLEND");
+            context_gl_enable(context, GL_BLEND, TRUE);
         }
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_BLEND);
-        checkGLcall("glDisable GL_BLEND");
+        context_gl_enable(context, GL_BLEND, FALSE);
         /* Nothing more to do - get out */
         return;
     };
@@ -482,14 +452,12 @@ static void state_blend(struct wined3d_context *context, const struct wined3d_st
             dstBlendAlpha = gl_blend_factor(state->render_states[WINED3D_RS_DESTBLENDALPHA], rt_format);
         }
 
-        GL_EXTCALL(glBlendFuncSeparate(srcBlend, dstBlend, srcBlendAlpha, dstBlendAlpha));
-        checkGLcall("glBlendFuncSeparate");
+        context_gl_blend_func(context, srcBlend, dstBlend, srcBlendAlpha, dstBlendAlpha);
     }
     else
     {
         TRACE("glBlendFunc src=%x, dst=%x\n", srcBlend, dstBlend);
-        gl_info->gl_ops.gl.p_glBlendFunc(srcBlend, dstBlend);
-        checkGLcall("glBlendFunc");
+        context_gl_blend_func(context, srcBlend, dstBlend, srcBlend, dstBlend);
     }
 
     /* Colorkey fixup for stage 0 alphaop depends on
@@ -816,8 +784,7 @@ static void state_stencil(struct wined3d_context *context, const struct wined3d_
     /* No stencil test without a stencil buffer. */
     if (!state->fb->depth_stencil)
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_STENCIL_TEST);
-        checkGLcall("glDisable GL_STENCIL_TEST");
+        context_gl_enable(context, GL_STENCIL_TEST, FALSE);
         return;
     }
 
@@ -845,16 +812,12 @@ static void state_stencil(struct wined3d_context *context, const struct wined3d_
 
     if (twosided_enable && onesided_enable)
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_STENCIL_TEST);
-        checkGLcall("glEnable GL_STENCIL_TEST");
+        context_gl_enable(context, GL_STENCIL_TEST, TRUE);
 
         if (gl_info->supported[WINED3D_GL_VERSION_2_0])
         {
-            GL_EXTCALL(glStencilFuncSeparate(GL_FRONT, func, ref, mask));
-            GL_EXTCALL(glStencilOpSeparate(GL_FRONT, stencilFail, depthFail, stencilPass));
-            GL_EXTCALL(glStencilFuncSeparate(GL_BACK, func_ccw, ref, mask));
-            GL_EXTCALL(glStencilOpSeparate(GL_BACK, stencilFail_ccw, depthFail_ccw, stencilPass_ccw));
-            checkGLcall("setting two sided stencil state");
+            context_gl_stencil(context, GL_FRONT, func, ref, mask, stencilFail, depthFail, stencilPass);
+            context_gl_stencil(context, GL_BACK, func_ccw, ref, mask, stencilFail_ccw, depthFail_ccw, stencilPass_ccw);
         }
         else if (gl_info->supported[EXT_STENCIL_TWO_SIDE])
         {
@@ -868,6 +831,7 @@ static void state_stencil(struct wined3d_context *context, const struct wined3d_
                     func_ccw, ref, mask, stencilFail_ccw, depthFail_ccw, stencilPass_ccw);
             renderstate_stencil_twosided(context, GL_FRONT,
                     func, ref, mask, stencilFail, depthFail, stencilPass);
+            context_invalidate_gl_cache(context, WINED3D_GL_CACHE_STENCIL_FRONT | WINED3D_GL_CACHE_STENCIL_BACK);
         }
         else if (gl_info->supported[ATI_SEPARATE_STENCIL])
         {
@@ -877,6 +841,7 @@ static void state_stencil(struct wined3d_context *context, const struct wined3d_
             checkGLcall("glStencilOpSeparateATI(GL_FRONT, ...)");
             GL_EXTCALL(glStencilOpSeparateATI(GL_BACK, stencilFail_ccw, depthFail_ccw, stencilPass_ccw));
             checkGLcall("glStencilOpSeparateATI(GL_BACK, ...)");
+            context_invalidate_gl_cache(context, WINED3D_GL_CACHE_STENCIL_FRONT | WINED3D_GL_CACHE_STENCIL_BACK);
         }
         else
         {
@@ -894,17 +859,12 @@ static void state_stencil(struct wined3d_context *context, const struct wined3d_
         /* This code disables the ATI extension as well, since the standard stencil functions are equal
          * to calling the ATI functions with GL_FRONT_AND_BACK as face parameter
          */
-        gl_info->gl_ops.gl.p_glEnable(GL_STENCIL_TEST);
-        checkGLcall("glEnable GL_STENCIL_TEST");
-        gl_info->gl_ops.gl.p_glStencilFunc(func, ref, mask);
-        checkGLcall("glStencilFunc(...)");
-        gl_info->gl_ops.gl.p_glStencilOp(stencilFail, depthFail, stencilPass);
-        checkGLcall("glStencilOp(...)");
+        context_gl_enable(context, GL_STENCIL_TEST, TRUE);
+        context_gl_stencil(context, GL_FRONT_AND_BACK, func, ref, mask, stencilFail, depthFail, stencilPass);
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_STENCIL_TEST);
-        checkGLcall("glDisable GL_STENCIL_TEST");
+        context_gl_enable(context, GL_STENCIL_TEST, FALSE);
     }
 }
 
@@ -920,15 +880,14 @@ static void state_stencilwrite2s(struct wined3d_context *context, const struct w
     GL_EXTCALL(glActiveStencilFaceEXT(GL_FRONT));
     checkGLcall("glActiveStencilFaceEXT(GL_FRONT)");
     gl_info->gl_ops.gl.p_glStencilMask(mask);
+    context_invalidate_gl_cache(context, WINED3D_GL_CACHE_STENCIL_MASK);
 }
 
 static void state_stencilwrite(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
 {
     DWORD mask = state->fb->depth_stencil ? state->render_states[WINED3D_RS_STENCILWRITEMASK] : 0;
-    const struct wined3d_gl_info *gl_info = context->gl_info;
 
-    gl_info->gl_ops.gl.p_glStencilMask(mask);
-    checkGLcall("glStencilMask");
+    context_gl_stencil_mask(context, mask);
 }
 
 static void state_fog_vertexpart(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
@@ -1463,18 +1422,13 @@ static void state_colorwrite(struct wined3d_context *context, const struct wined
     DWORD mask1 = state->render_states[WINED3D_RS_COLORWRITEENABLE1];
     DWORD mask2 = state->render_states[WINED3D_RS_COLORWRITEENABLE2];
     DWORD mask3 = state->render_states[WINED3D_RS_COLORWRITEENABLE3];
-    const struct wined3d_gl_info *gl_info = context->gl_info;
 
     TRACE("Color mask: r(%d) g(%d) b(%d) a(%d)\n",
             mask0 & WINED3DCOLORWRITEENABLE_RED ? 1 : 0,
             mask0 & WINED3DCOLORWRITEENABLE_GREEN ? 1 : 0,
             mask0 & WINED3DCOLORWRITEENABLE_BLUE ? 1 : 0,
             mask0 & WINED3DCOLORWRITEENABLE_ALPHA ? 1 : 0);
-    gl_info->gl_ops.gl.p_glColorMask(mask0 & WINED3DCOLORWRITEENABLE_RED ? GL_TRUE : GL_FALSE,
-            mask0 & WINED3DCOLORWRITEENABLE_GREEN ? GL_TRUE : GL_FALSE,
-            mask0 & WINED3DCOLORWRITEENABLE_BLUE ? GL_TRUE : GL_FALSE,
-            mask0 & WINED3DCOLORWRITEENABLE_ALPHA ? GL_TRUE : GL_FALSE);
-    checkGLcall("glColorMask(...)");
+    context_gl_color_mask(context, -1, mask0);
 
     if (!((mask1 == mask0 && mask2 == mask0 && mask3 == mask0)
         || (mask1 == 0xf && mask2 == 0xf && mask3 == 0xf)))
@@ -1485,34 +1439,24 @@ static void state_colorwrite(struct wined3d_context *context, const struct wined
     }
 }
 
-static void set_color_mask(const struct wined3d_gl_info *gl_info, UINT index, DWORD mask)
-{
-    GL_EXTCALL(glColorMaski(index,
-            mask & WINED3DCOLORWRITEENABLE_RED ? GL_TRUE : GL_FALSE,
-            mask & WINED3DCOLORWRITEENABLE_GREEN ? GL_TRUE : GL_FALSE,
-            mask & WINED3DCOLORWRITEENABLE_BLUE ? GL_TRUE : GL_FALSE,
-            mask & WINED3DCOLORWRITEENABLE_ALPHA ? GL_TRUE : GL_FALSE));
-    checkGLcall("glColorMaski");
-}
-
 static void state_colorwrite0(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
 {
-    set_color_mask(context->gl_info, 0, state->render_states[WINED3D_RS_COLORWRITEENABLE]);
+    context_gl_color_mask(context, 0, state->render_states[WINED3D_RS_COLORWRITEENABLE]);
 }
 
 static void state_colorwrite1(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
 {
-    set_color_mask(context->gl_info, 1, state->render_states[WINED3D_RS_COLORWRITEENABLE1]);
+    context_gl_color_mask(context, 1, state->render_states[WINED3D_RS_COLORWRITEENABLE1]);
 }
 
 static void state_colorwrite2(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
 {
-    set_color_mask(context->gl_info, 2, state->render_states[WINED3D_RS_COLORWRITEENABLE2]);
+    context_gl_color_mask(context, 2, state->render_states[WINED3D_RS_COLORWRITEENABLE2]);
 }
 
 static void state_colorwrite3(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
 {
-    set_color_mask(context->gl_info, 3, state->render_states[WINED3D_RS_COLORWRITEENABLE3]);
+    context_gl_color_mask(context, 3, state->render_states[WINED3D_RS_COLORWRITEENABLE3]);
 }
 
 static void state_localviewer(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
@@ -1626,17 +1570,13 @@ static void state_msaa(struct wined3d_context *context, const struct wined3d_sta
 
 static void state_scissor(struct wined3d_context *context, const struct wined3d_state *state, DWORD state_id)
 {
-    const struct wined3d_gl_info *gl_info = context->gl_info;
-
     if (state->render_states[WINED3D_RS_SCISSORTESTENABLE])
     {
-        gl_info->gl_ops.gl.p_glEnable(GL_SCISSOR_TEST);
-        checkGLcall("glEnable(GL_SCISSOR_TEST)");
+        context_gl_enable(context, GL_SCISSOR_TEST, TRUE);
     }
     else
     {
-        gl_info->gl_ops.gl.p_glDisable(GL_SCISSOR_TEST);
-        checkGLcall("glDisable(GL_SCISSOR_TEST)");
+        context_gl_enable(context, GL_SCISSOR_TEST, FALSE);
     }
 }
 
@@ -4046,7 +3986,7 @@ static void load_numbered_arrays(struct wined3d_context *context,
              * figure out the system memory address. */
             const BYTE *ptr = element->data.addr;
             if (element->data.buffer_object)
-                ptr += (ULONG_PTR)buffer_get_sysmem(stream->buffer, context);
+                ptr += (ULONG_PTR)buffer_get_sysmem(stream->buffer, context) - stream->buffer->stream_block.offset;
 
             if (context->numbered_array_mask & (1u << i))
                 unload_numbered_array(context, i);
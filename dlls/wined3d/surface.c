@@ -30,6 +30,10 @@
 #include "wine/port.h"
 #include "wined3d_private.h"
 
+#ifdef WINED3D_SSE2
+#include <emmintrin.h>
+#endif
+
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
 WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 
@@ -468,7 +472,7 @@ static void surface_depth_blt_fbo(const struct wined3d_device *device,
 
     if (gl_mask & GL_DEPTH_BUFFER_BIT)
     {
-        gl_info->gl_ops.gl.p_glDepthMask(GL_TRUE);
+        context_gl_depth_mask(context, GL_TRUE);
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_ZWRITEENABLE));
     }
     if (gl_mask & GL_STENCIL_BUFFER_BIT)
@@ -478,11 +482,11 @@ static void surface_depth_blt_fbo(const struct wined3d_device *device,
             gl_info->gl_ops.gl.p_glDisable(GL_STENCIL_TEST_TWO_SIDE_EXT);
             context_invalidate_state(context, STATE_RENDER(WINED3D_RS_TWOSIDEDSTENCILMODE));
         }
-        gl_info->gl_ops.gl.p_glStencilMask(~0U);
+        context_gl_stencil_mask(context, ~0u);
         context_invalidate_state(context, STATE_RENDER(WINED3D_RS_STENCILWRITEMASK));
     }
 
-    gl_info->gl_ops.gl.p_glDisable(GL_SCISSOR_TEST);
+    context_gl_enable(context, GL_SCISSOR_TEST, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_SCISSORTESTENABLE));
 
     gl_info->fbo_ops.glBlitFramebuffer(src_rect->left, src_rect->top, src_rect->right, src_rect->bottom,
@@ -606,13 +610,13 @@ static void surface_blt_fbo(const struct wined3d_device *device,
     context_check_fbo_status(context, GL_DRAW_FRAMEBUFFER);
     context_invalidate_state(context, STATE_FRAMEBUFFER);
 
-    gl_info->gl_ops.gl.p_glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    context_gl_color_mask(context, -1, 0xf);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_COLORWRITEENABLE));
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_COLORWRITEENABLE1));
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_COLORWRITEENABLE2));
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_COLORWRITEENABLE3));
 
-    gl_info->gl_ops.gl.p_glDisable(GL_SCISSOR_TEST);
+    context_gl_enable(context, GL_SCISSOR_TEST, FALSE);
     context_invalidate_state(context, STATE_RENDER(WINED3D_RS_SCISSORTESTENABLE));
 
     gl_info->fbo_ops.glBlitFramebuffer(src_rect.left, src_rect.top, src_rect.right, src_rect.bottom,
@@ -1336,6 +1340,163 @@ static inline unsigned short float_32_to_16(const float *in)
     return ret;
 }
 
+#ifdef WINED3D_SSE2
+/* Handles the common case of values that are representable as normalized
+ * half floats, in groups of eight. Groups containing anything else (denormals,
+ * overflow, NaN, or values where rounding carries into the exponent) go
+ * through float_32_to_16(), so the results are identical. */
+static unsigned int WINED3D_SSE2_FUNC convert_r32_float_r16_float_row_sse2(const float *src,
+        unsigned short *dst, unsigned int w)
+{
+    const __m128i abs_mask = _mm_set1_epi32(0x7fffffff);
+    const __m128i exp_min = _mm_set1_epi32((113 << 23) - 1);
+    const __m128i exp_max = _mm_set1_epi32(143 << 23);
+    const __m128i exp_bias = _mm_set1_epi32(112 << 23);
+    const __m128i carry_mask = _mm_set1_epi32(0x007ff000);
+    const __m128i round_bit = _mm_set1_epi32(1);
+    const __m128i sign_mask = _mm_set1_epi32(0x8000);
+    const __m128i pack_bias = _mm_set1_epi16((short)0x8000);
+    __m128i in, a, zero, ok, half[2];
+    unsigned int x, i;
+
+    for (x = 0; x + 8 <= w; x += 8)
+    {
+        for (i = 0; i < 2; ++i)
+        {
+            in = _mm_loadu_si128((const __m128i *)(src + x + 4 * i));
+            a = _mm_and_si128(in, abs_mask);
+            zero = _mm_cmpeq_epi32(a, _mm_setzero_si128());
+            ok = _mm_and_si128(_mm_cmpgt_epi32(a, exp_min), _mm_cmplt_epi32(a, exp_max));
+            ok = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(a, carry_mask), carry_mask), ok);
+            if (_mm_movemask_epi8(_mm_or_si128(ok, zero)) != 0xffff)
+                break;
+
+            half[i] = _mm_add_epi32(_mm_srli_epi32(_mm_sub_epi32(a, exp_bias), 13),
+                    _mm_and_si128(_mm_srli_epi32(a, 12), round_bit));
+            /* float_32_to_16() drops the sign of -0.0f. */
+            half[i] = _mm_andnot_si128(zero, _mm_or_si128(half[i],
+                    _mm_and_si128(_mm_srli_epi32(in, 16), sign_mask)));
+            /* Bias into signed range so that packs doesn't saturate. */
+            half[i] = _mm_sub_epi32(half[i], sign_mask);
+        }
+
+        if (i < 2)
+        {
+            for (i = 0; i < 8; ++i)
+                dst[x + i] = float_32_to_16(src + x + i);
+            continue;
+        }
+
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_add_epi16(_mm_packs_epi32(half[0], half[1]), pack_bias));
+    }
+
+    return x;
+}
+
+/* x * 527 + 23 >> 6 and x * 259 + 33 >> 6 match the 5 and 6 bit expansion
+ * tables used by convert_r5g6b5_x8r8g8b8() exactly. */
+static unsigned int WINED3D_SSE2_FUNC convert_r5g6b5_x8r8g8b8_row_sse2(const WORD *src,
+        DWORD *dst, unsigned int w)
+{
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    const __m128i mask6 = _mm_set1_epi16(0x3f);
+    const __m128i mul5 = _mm_set1_epi16(527);
+    const __m128i mul6 = _mm_set1_epi16(259);
+    const __m128i add5 = _mm_set1_epi16(23);
+    const __m128i add6 = _mm_set1_epi16(33);
+    const __m128i alpha = _mm_set1_epi16((short)0xff00);
+    __m128i p, r, g, b, lo, hi;
+    unsigned int x;
+
+    for (x = 0; x + 8 <= w; x += 8)
+    {
+        p = _mm_loadu_si128((const __m128i *)(src + x));
+        r = _mm_srli_epi16(p, 11);
+        g = _mm_and_si128(_mm_srli_epi16(p, 5), mask6);
+        b = _mm_and_si128(p, mask5);
+
+        r = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(r, mul5), add5), 6);
+        g = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(g, mul6), add6), 6);
+        b = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(b, mul5), add5), 6);
+
+        lo = _mm_or_si128(_mm_slli_epi16(g, 8), b);
+        hi = _mm_or_si128(r, alpha);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_unpacklo_epi16(lo, hi));
+        _mm_storeu_si128((__m128i *)(dst + x + 4), _mm_unpackhi_epi16(lo, hi));
+    }
+
+    return x;
+}
+
+static unsigned int WINED3D_SSE2_FUNC convert_a8r8g8b8_x8r8g8b8_row_sse2(const DWORD *src,
+        DWORD *dst, unsigned int w)
+{
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+    unsigned int x;
+
+    for (x = 0; x + 4 <= w; x += 4)
+    {
+        _mm_storeu_si128((__m128i *)(dst + x),
+                _mm_or_si128(_mm_loadu_si128((const __m128i *)(src + x)), alpha));
+    }
+
+    return x;
+}
+
+/* Same formulas as convert_yuy2_x8r8g8b8(), eight pixels at a time. Each
+ * 32-bit lane holds one pixel while computing; the luma term is evaluated as
+ * [Y, 1] . [298, -4640], which folds in both the -16 offset and the +128
+ * rounding constant, and the chroma terms as [U - 128, V - 128] dot the
+ * respective coefficients. */
+static unsigned int WINED3D_SSE2_FUNC convert_yuy2_x8r8g8b8_row_sse2(const BYTE *src,
+        DWORD *dst, unsigned int w)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i y_mask = _mm_set1_epi32(0x0000ffff);
+    const __m128i y_one = _mm_set1_epi32(0x00010000);
+    const __m128i y_coeff = _mm_unpacklo_epi16(_mm_set1_epi16(298), _mm_set1_epi16(-4640));
+    const __m128i r_coeff = _mm_unpacklo_epi16(_mm_set1_epi16(0), _mm_set1_epi16(409));
+    const __m128i g_coeff = _mm_unpacklo_epi16(_mm_set1_epi16(-100), _mm_set1_epi16(-208));
+    const __m128i b_coeff = _mm_unpacklo_epi16(_mm_set1_epi16(516), _mm_set1_epi16(0));
+    const __m128i uv_bias = _mm_set1_epi16(128);
+    const __m128i alpha = _mm_set1_epi8((char)0xff);
+    __m128i in, v, c, uv, r[2], g[2], b[2], bg, ra;
+    unsigned int x, i;
+
+    for (x = 0; x + 8 <= w; x += 8)
+    {
+        in = _mm_loadu_si128((const __m128i *)(src + 2 * x));
+        for (i = 0; i < 2; ++i)
+        {
+            /* Y0 U0 Y1 V0 Y2 U1 Y3 V1 */
+            v = i ? _mm_unpackhi_epi8(in, zero) : _mm_unpacklo_epi8(in, zero);
+            c = _mm_madd_epi16(_mm_or_si128(_mm_and_si128(v, y_mask), y_one), y_coeff);
+            uv = _mm_srli_epi32(v, 16);
+            uv = _mm_sub_epi16(_mm_packs_epi32(uv, uv), uv_bias);
+            uv = _mm_unpacklo_epi32(uv, uv);
+
+            r[i] = _mm_srai_epi32(_mm_add_epi32(c, _mm_madd_epi16(uv, r_coeff)), 8);
+            g[i] = _mm_srai_epi32(_mm_add_epi32(c, _mm_madd_epi16(uv, g_coeff)), 8);
+            b[i] = _mm_srai_epi32(_mm_add_epi32(c, _mm_madd_epi16(uv, b_coeff)), 8);
+        }
+
+        r[0] = _mm_packs_epi32(r[0], r[1]);
+        g[0] = _mm_packs_epi32(g[0], g[1]);
+        b[0] = _mm_packs_epi32(b[0], b[1]);
+        r[0] = _mm_packus_epi16(r[0], r[0]);
+        g[0] = _mm_packus_epi16(g[0], g[0]);
+        b[0] = _mm_packus_epi16(b[0], b[0]);
+
+        bg = _mm_unpacklo_epi8(b[0], g[0]);
+        ra = _mm_unpacklo_epi8(r[0], alpha);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i *)(dst + x + 4), _mm_unpackhi_epi16(bg, ra));
+    }
+
+    return x;
+}
+#endif
+
 static void convert_r32_float_r16_float(const BYTE *src, BYTE *dst,
         DWORD pitch_in, DWORD pitch_out, unsigned int w, unsigned int h)
 {
@@ -1349,7 +1510,12 @@ static void convert_r32_float_r16_float(const BYTE *src, BYTE *dst,
     {
         src_f = (const float *)(src + y * pitch_in);
         dst_s = (unsigned short *) (dst + y * pitch_out);
-        for (x = 0; x < w; ++x)
+        x = 0;
+#ifdef WINED3D_SSE2
+        if (wined3d_use_sse2)
+            x = convert_r32_float_r16_float_row_sse2(src_f, dst_s, w);
+#endif
+        for (; x < w; ++x)
         {
             dst_s[x] = float_32_to_16(src_f + x);
         }
@@ -1385,7 +1551,12 @@ static void convert_r5g6b5_x8r8g8b8(const BYTE *src, BYTE *dst,
     {
         const WORD *src_line = (const WORD *)(src + y * pitch_in);
         DWORD *dst_line = (DWORD *)(dst + y * pitch_out);
-        for (x = 0; x < w; ++x)
+        x = 0;
+#ifdef WINED3D_SSE2
+        if (wined3d_use_sse2)
+            x = convert_r5g6b5_x8r8g8b8_row_sse2(src_line, dst_line, w);
+#endif
+        for (; x < w; ++x)
         {
             WORD pixel = src_line[x];
             dst_line[x] = 0xff000000u
@@ -1410,7 +1581,12 @@ static void convert_a8r8g8b8_x8r8g8b8(const BYTE *src, BYTE *dst,
         const DWORD *src_line = (const DWORD *)(src + y * pitch_in);
         DWORD *dst_line = (DWORD *)(dst + y * pitch_out);
 
-        for (x = 0; x < w; ++x)
+        x = 0;
+#ifdef WINED3D_SSE2
+        if (wined3d_use_sse2)
+            x = convert_a8r8g8b8_x8r8g8b8_row_sse2(src_line, dst_line, w);
+#endif
+        for (; x < w; ++x)
         {
             dst_line[x] = 0xff000000 | (src_line[x] & 0xffffff);
         }
@@ -1434,7 +1610,15 @@ static void convert_yuy2_x8r8g8b8(const BYTE *src, BYTE *dst,
     {
         const BYTE *src_line = src + y * pitch_in;
         DWORD *dst_line = (DWORD *)(dst + y * pitch_out);
-        for (x = 0; x < w; ++x)
+        x = 0;
+#ifdef WINED3D_SSE2
+        if (wined3d_use_sse2)
+        {
+            x = convert_yuy2_x8r8g8b8_row_sse2(src_line, dst_line, w);
+            src_line += 2 * x;
+        }
+#endif
+        for (; x < w; ++x)
         {
             /* YUV to RGB conversion formulas from http://en.wikipedia.org/wiki/YUV:
              *     C = Y - 16; D = U - 128; E = V - 128;
@@ -2385,7 +2569,7 @@ static HRESULT surface_blt_special(struct wined3d_surface *dst_surface, const RE
 {
     struct wined3d_texture *dst_texture = dst_surface->container;
     struct wined3d_device *device = dst_texture->resource.device;
-    const struct wined3d_surface *rt = wined3d_rendertarget_view_get_surface(device->fb.render_targets[0]);
+    const struct wined3d_surface *rt = wined3d_rendertarget_view_get_surface(device->cs->fb.render_targets[0]);
     struct wined3d_swapchain *src_swapchain, *dst_swapchain;
     struct wined3d_texture *src_texture;
 
@@ -2574,6 +2758,7 @@ static void surface_depth_blt(const struct wined3d_surface *surface, struct wine
     gl_info->gl_ops.gl.p_glBindTexture(info.bind_target, old_binding);
 
     gl_info->gl_ops.gl.p_glPopAttrib();
+    context_invalidate_gl_cache(context, ~0u);
 
     device->shader_backend->shader_deselect_depth_blt(device->shader_priv, gl_info);
 }
@@ -468,7 +468,27 @@ static void wined3d_texture_unload_gl_texture(struct wined3d_texture *texture)
     resource_unload(&texture->resource);
 }
 
-static void wined3d_texture_cleanup(struct wined3d_texture *texture)
+static void wined3d_texture_sub_resources_destroyed(struct wined3d_texture *texture)
+{
+    unsigned int sub_count = texture->level_count * texture->layer_count;
+    struct wined3d_texture_sub_resource *sub_resource;
+    unsigned int i;
+
+    for (i = 0; i < sub_count; ++i)
+    {
+        sub_resource = &texture->sub_resources[i];
+        if (!sub_resource->parent_ops)
+            continue;
+
+        TRACE("sub-resource %u, parent %p.\n", i, sub_resource->parent);
+
+        sub_resource->parent_ops->wined3d_object_destroyed(sub_resource->parent);
+        sub_resource->parent_ops = NULL;
+    }
+}
+
+/* Destroys the GL objects and the memory of the texture. */
+static void wined3d_texture_destroy_resources(struct wined3d_texture *texture)
 {
     unsigned int sub_count = texture->level_count * texture->layer_count;
     struct wined3d_device *device = texture->resource.device;
@@ -501,7 +521,20 @@ static void wined3d_texture_cleanup(struct wined3d_texture *texture)
 
     texture->texture_ops->texture_cleanup_sub_resources(texture);
     wined3d_texture_unload_gl_texture(texture);
-    resource_cleanup(&texture->resource);
+    resource_destroy(&texture->resource);
+}
+
+static void wined3d_texture_cleanup(struct wined3d_texture *texture)
+{
+    wined3d_texture_sub_resources_destroyed(texture);
+    resource_detach(&texture->resource);
+    wined3d_texture_destroy_resources(texture);
+}
+
+static void wined3d_texture_destroy_object(void *object)
+{
+    wined3d_texture_destroy_resources(object);
+    HeapFree(GetProcessHeap(), 0, object);
 }
 
 void wined3d_texture_set_swapchain(struct wined3d_texture *texture, struct wined3d_swapchain *swapchain)
@@ -809,9 +842,10 @@ ULONG CDECL wined3d_texture_decref(struct wined3d_texture *texture)
 
     if (!refcount)
     {
-        wined3d_texture_cleanup(texture);
+        wined3d_texture_sub_resources_destroyed(texture);
         texture->resource.parent_ops->wined3d_object_destroyed(texture->resource.parent);
-        HeapFree(GetProcessHeap(), 0, texture);
+        resource_detach(&texture->resource);
+        wined3d_cs_emit_callback(texture->resource.device->cs, wined3d_texture_destroy_object, texture);
     }
 
     return refcount;
@@ -889,6 +923,9 @@ void wined3d_texture_load(struct wined3d_texture *texture,
 void CDECL wined3d_texture_preload(struct wined3d_texture *texture)
 {
     struct wined3d_context *context;
+
+    wined3d_resource_wait_idle(&texture->resource);
+
     context = context_acquire(texture->resource.device, NULL);
     wined3d_texture_load(texture, context, texture->flags & WINED3D_TEXTURE_IS_SRGB);
     context_release(context);
@@ -941,6 +978,8 @@ DWORD CDECL wined3d_texture_set_lod(struct wined3d_texture *texture, DWORD lod)
 
     TRACE("texture %p, lod %u.\n", texture, lod);
 
+    wined3d_resource_wait_idle(&texture->resource);
+
     /* The d3d9:texture test shows that SetLOD is ignored on non-managed
      * textures. The call always returns 0, and GetLOD always returns 0. */
     if (texture->resource.pool != WINED3D_POOL_MANAGED)
@@ -1039,6 +1078,8 @@ HRESULT CDECL wined3d_texture_update_desc(struct wined3d_texture *texture, UINT
             "mem %p, pitch %u.\n",
             texture, width, height, debug_d3dformat(format_id), multisample_type, multisample_quality, mem, pitch);
 
+    wined3d_resource_wait_idle(&texture->resource);
+
     if (!resource_size)
         return WINED3DERR_INVALIDCALL;
 
@@ -1349,6 +1390,8 @@ HRESULT CDECL wined3d_texture_add_dirty_region(struct wined3d_texture *texture,
 
     TRACE("texture %p, layer %u, dirty_region %s.\n", texture, layer, debug_box(dirty_region));
 
+    wined3d_resource_wait_idle(&texture->resource);
+
     if (layer >= texture->layer_count)
     {
         WARN("Invalid layer %u specified.\n", layer);
@@ -1518,8 +1561,6 @@ static void texture2d_cleanup_sub_resources(struct wined3d_texture *texture)
             list_remove(&overlay->overlay_entry);
             overlay->overlay_dest = NULL;
         }
-
-        sub_resource->parent_ops->wined3d_object_destroyed(sub_resource->parent);
     }
     if (context)
         context_release(context);
@@ -1648,6 +1689,8 @@ static HRESULT texture_resource_sub_resource_map(struct wined3d_resource *resour
             return WINED3DERR_INVALIDCALL;
     }
 
+    wined3d_resource_wait_idle(resource);
+
     if (!(resource->access_flags & WINED3D_RESOURCE_ACCESS_CPU))
     {
         WARN("Trying to map unmappable texture.\n");
@@ -2106,21 +2149,6 @@ static void texture3d_prepare_texture(struct wined3d_texture *texture, struct wi
 
 static void texture3d_cleanup_sub_resources(struct wined3d_texture *texture)
 {
-    unsigned int sub_count = texture->level_count * texture->layer_count;
-    struct wined3d_texture_sub_resource *sub_resource;
-    struct wined3d_volume *volume;
-    unsigned int i;
-
-    for (i = 0; i < sub_count; ++i)
-    {
-        sub_resource = &texture->sub_resources[i];
-        if ((volume = sub_resource->u.volume))
-        {
-            TRACE("volume %p.\n", volume);
-
-            sub_resource->parent_ops->wined3d_object_destroyed(sub_resource->parent);
-        }
-    }
     HeapFree(GetProcessHeap(), 0, texture->sub_resources[0].u.volume);
 }
 
@@ -2308,6 +2336,10 @@ HRESULT CDECL wined3d_texture_blt(struct wined3d_texture *dst_texture, unsigned
             dst_texture, dst_sub_resource_idx, wine_dbgstr_rect(dst_rect), src_texture,
             src_sub_resource_idx, wine_dbgstr_rect(src_rect), flags, fx, debug_d3dtexturefiltertype(filter));
 
+    wined3d_resource_wait_idle(&dst_texture->resource);
+    if (src_texture)
+        wined3d_resource_wait_idle(&src_texture->resource);
+
     if (!(dst_resource = wined3d_texture_get_sub_resource(dst_texture, dst_sub_resource_idx))
             || dst_texture->resource.type != WINED3D_RTYPE_TEXTURE_2D)
         return WINED3DERR_INVALIDCALL;
@@ -2393,6 +2425,10 @@ HRESULT CDECL wined3d_texture_update_overlay(struct wined3d_texture *texture, un
             texture, sub_resource_idx, wine_dbgstr_rect(src_rect), dst_texture,
             dst_sub_resource_idx, wine_dbgstr_rect(dst_rect), flags);
 
+    wined3d_resource_wait_idle(&texture->resource);
+    if (dst_texture)
+        wined3d_resource_wait_idle(&dst_texture->resource);
+
     if (!(texture->resource.usage & WINED3DUSAGE_OVERLAY) || texture->resource.type != WINED3D_RTYPE_TEXTURE_2D
             || !(sub_resource = wined3d_texture_get_sub_resource(texture, sub_resource_idx)))
     {
@@ -2611,6 +2647,8 @@ HRESULT CDECL wined3d_texture_get_dc(struct wined3d_texture *texture, unsigned i
 
     TRACE("texture %p, sub_resource_idx %u, dc %p.\n", texture, sub_resource_idx, dc);
 
+    wined3d_resource_wait_idle(&texture->resource);
+
     if (!(sub_resource = wined3d_texture_get_sub_resource(texture, sub_resource_idx)))
         return WINED3DERR_INVALIDCALL;
 
@@ -2657,6 +2695,8 @@ HRESULT CDECL wined3d_texture_release_dc(struct wined3d_texture *texture, unsign
 
     TRACE("texture %p, sub_resource_idx %u, dc %p.\n", texture, sub_resource_idx, dc);
 
+    wined3d_resource_wait_idle(&texture->resource);
+
     if (!(sub_resource = wined3d_texture_get_sub_resource(texture, sub_resource_idx)))
         return WINED3DERR_INVALIDCALL;
 
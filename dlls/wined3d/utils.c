@@ -31,6 +31,10 @@
 
 #include "wined3d_private.h"
 
+#ifdef WINED3D_SSE2
+#include <emmintrin.h>
+#endif
+
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
 
 #define WINED3D_FORMAT_FOURCC_BASE (WINED3DFMT_BC7_UNORM_SRGB + 1)
@@ -781,6 +785,37 @@ static BOOL color_in_range(const struct wined3d_color_key *color_key, DWORD colo
             && color <= color_key->color_space_high_value;
 }
 
+#ifdef WINED3D_SSE2
+/* Converts 32 bpp pixels four at a time. Pixels inside the color key range
+ * get their alpha cleared; the others get alpha set to 0xff if "set_alpha"
+ * is TRUE, and are copied unmodified otherwise. */
+static unsigned int WINED3D_SSE2_FUNC convert_color_key_row_sse2(const DWORD *src, DWORD *dst,
+        unsigned int width, const struct wined3d_color_key *color_key, BOOL set_alpha)
+{
+    /* SSE2 only has signed compares, so flip the sign bits. */
+    const __m128i sign = _mm_set1_epi32(0x80000000);
+    const __m128i low = _mm_set1_epi32(color_key->color_space_low_value ^ 0x80000000);
+    const __m128i high = _mm_set1_epi32(color_key->color_space_high_value ^ 0x80000000);
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+    __m128i c, outside;
+    unsigned int x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        c = _mm_loadu_si128((const __m128i *)(src + x));
+        outside = _mm_xor_si128(c, sign);
+        outside = _mm_or_si128(_mm_cmpgt_epi32(low, outside), _mm_cmpgt_epi32(outside, high));
+        if (set_alpha)
+            c = _mm_or_si128(_mm_andnot_si128(alpha, c), _mm_and_si128(outside, alpha));
+        else
+            c = _mm_andnot_si128(_mm_andnot_si128(outside, alpha), c);
+        _mm_storeu_si128((__m128i *)(dst + x), c);
+    }
+
+    return x;
+}
+#endif
+
 static void convert_p8_uint_b8g8r8a8_unorm(const BYTE *src, unsigned int src_pitch,
         BYTE *dst, unsigned int dst_pitch, unsigned int width, unsigned int height,
         const struct wined3d_palette *palette, const struct wined3d_color_key *color_key)
@@ -896,7 +931,12 @@ static void convert_b8g8r8x8_unorm_b8g8r8a8_unorm_color_key(const BYTE *src, uns
     {
         src_row = (DWORD *)&src[src_pitch * y];
         dst_row = (DWORD *)&dst[dst_pitch * y];
-        for (x = 0; x < width; ++x)
+        x = 0;
+#ifdef WINED3D_SSE2
+        if (wined3d_use_sse2)
+            x = convert_color_key_row_sse2(src_row, dst_row, width, color_key, TRUE);
+#endif
+        for (; x < width; ++x)
         {
             DWORD src_color = src_row[x];
             if (color_in_range(color_key, src_color))
@@ -919,7 +959,12 @@ static void convert_b8g8r8a8_unorm_b8g8r8a8_unorm_color_key(const BYTE *src, uns
     {
         src_row = (DWORD *)&src[src_pitch * y];
         dst_row = (DWORD *)&dst[dst_pitch * y];
-        for (x = 0; x < width; ++x)
+        x = 0;
+#ifdef WINED3D_SSE2
+        if (wined3d_use_sse2)
+            x = convert_color_key_row_sse2(src_row, dst_row, width, color_key, FALSE);
+#endif
+        for (; x < width; ++x)
         {
             DWORD src_color = src_row[x];
             if (color_in_range(color_key, src_color))
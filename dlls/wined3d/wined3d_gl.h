@@ -44,6 +44,7 @@ enum wined3d_gl_extension
     APPLE_YCBCR_422,
     /* ARB */
     ARB_BLEND_FUNC_EXTENDED,
+    ARB_BUFFER_STORAGE,
     ARB_COLOR_BUFFER_FLOAT,
     ARB_COPY_BUFFER,
     ARB_DEBUG_OUTPUT,
@@ -59,6 +60,7 @@ enum wined3d_gl_extension
     ARB_FRAMEBUFFER_OBJECT,
     ARB_FRAMEBUFFER_SRGB,
     ARB_GEOMETRY_SHADER4,
+    ARB_GET_PROGRAM_BINARY,
     ARB_HALF_FLOAT_PIXEL,
     ARB_HALF_FLOAT_VERTEX,
     ARB_INSTANCED_ARRAYS,
@@ -90,8 +90,15 @@ struct wined3d_settings wined3d_settings =
     ~0U,            /* No GS shader model limit by default. */
     ~0U,            /* No PS shader model limit by default. */
     FALSE,          /* 3D support enabled by default. */
+    FALSE,          /* Single-threaded command stream by default. */
+    NULL,           /* No on-disk shader cache by default. */
+    NULL,           /* No frame statistics by default. */
 };
 
+#ifdef WINED3D_SSE2
+BOOL wined3d_use_sse2;
+#endif
+
 struct wined3d * CDECL wined3d_create(DWORD flags)
 {
     struct wined3d *object;
@@ -155,6 +162,11 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
     }
     context_set_tls_idx(wined3d_context_tls_idx);
 
+#ifdef WINED3D_SSE2
+    wined3d_use_sse2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+    TRACE("SSE2 conversion paths %s.\n", wined3d_use_sse2 ? "enabled" : "disabled");
+#endif
+
     /* We need our own window class for a fake window which we use to retrieve GL capabilities */
     /* We might need CS_OWNDC in the future if we notice strange things on Windows.
      * Various articles/posts about OpenGL problems on Windows recommend this. */
@@ -331,6 +343,30 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
             TRACE("Disabling 3D support.\n");
             wined3d_settings.no_3d = TRUE;
         }
+        if (!get_config_key(hkey, appkey, "CSMT", buffer, size)
+                && !strcmp(buffer, "enabled"))
+        {
+            TRACE("Enabling the multi-threaded command stream.\n");
+            wined3d_settings.cs_multithreaded = TRUE;
+        }
+        if (!get_config_key(hkey, appkey, "ShaderCachePath", buffer, size) && *buffer)
+        {
+            size_t len = strlen(buffer) + 1;
+
+            TRACE("Using shader cache path %s.\n", debugstr_a(buffer));
+            wined3d_settings.shader_cache_path = HeapAlloc(GetProcessHeap(), 0, len);
+            if (!wined3d_settings.shader_cache_path) ERR("Failed to allocate shader cache path memory.\n");
+            else memcpy(wined3d_settings.shader_cache_path, buffer, len);
+        }
+        if (!get_config_key(hkey, appkey, "FrameStatsPath", buffer, size) && *buffer)
+        {
+            size_t len = strlen(buffer) + 1;
+
+            TRACE("Using frame statistics path %s.\n", debugstr_a(buffer));
+            wined3d_settings.frame_stats_path = HeapAlloc(GetProcessHeap(), 0, len);
+            if (!wined3d_settings.frame_stats_path) ERR("Failed to allocate frame statistics path memory.\n");
+            else memcpy(wined3d_settings.frame_stats_path, buffer, len);
+        }
     }
 
     if (appkey) RegCloseKey( appkey );
@@ -363,6 +399,8 @@ static BOOL wined3d_dll_destroy(HINSTANCE hInstDLL)
     HeapFree(GetProcessHeap(), 0, wndproc_table.entries);
 
     HeapFree(GetProcessHeap(), 0, wined3d_settings.logo);
+    HeapFree(GetProcessHeap(), 0, wined3d_settings.shader_cache_path);
+    HeapFree(GetProcessHeap(), 0, wined3d_settings.frame_stats_path);
     UnregisterClassA(WINED3D_OPENGL_WINDOW_CLASS_NAME, hInstDLL);
 
     DeleteCriticalSection(&wined3d_wndproc_cs);
@@ -380,6 +418,29 @@ void WINAPI wined3d_mutex_unlock(void)
     LeaveCriticalSection(&wined3d_cs);
 }
 
+/* Releases the wined3d mutex completely, so that the command stream thread
+ * can make progress while the calling thread waits for it. Returns the
+ * number of times the calling thread had entered it. */
+unsigned int wined3d_mutex_suspend(void)
+{
+    unsigned int count, i;
+
+    if (wined3d_cs.OwningThread != ULongToHandle(GetCurrentThreadId()))
+        return 0;
+
+    count = wined3d_cs.RecursionCount;
+    for (i = 0; i < count; ++i)
+        LeaveCriticalSection(&wined3d_cs);
+
+    return count;
+}
+
+void wined3d_mutex_resume(unsigned int count)
+{
+    while (count--)
+        EnterCriticalSection(&wined3d_cs);
+}
+
 static void wined3d_wndproc_mutex_lock(void)
 {
     EnterCriticalSection(&wined3d_wndproc_cs);
@@ -309,10 +309,24 @@ struct wined3d_settings
     unsigned int max_sm_gs;
     unsigned int max_sm_ps;
     BOOL no_3d;
+    BOOL cs_multithreaded;
+    char *shader_cache_path;
+    char *frame_stats_path;
 };
 
 extern struct wined3d_settings wined3d_settings DECLSPEC_HIDDEN;
 
+unsigned int wined3d_mutex_suspend(void) DECLSPEC_HIDDEN;
+void wined3d_mutex_resume(unsigned int count) DECLSPEC_HIDDEN;
+
+/* SSE2 format conversion paths. On i386 these need per-function target
+ * attributes, since the rest of the module isn't built with -msse2. */
+#ifdef __WINE_TARGET
+#define WINED3D_SSE2
+#define WINED3D_SSE2_FUNC __WINE_TARGET("sse2")
+extern BOOL wined3d_use_sse2 DECLSPEC_HIDDEN;
+#endif
+
 enum wined3d_shader_resource_type
 {
     WINED3D_SHADER_RESOURCE_NONE,
@@ -1317,6 +1331,8 @@ struct wined3d_occlusion_query
     struct list entry;
     GLuint id;
     struct wined3d_context *context;
+    BOOL started;
+    DWORD samples;
 };
 
 union wined3d_gl_query_object
@@ -1344,6 +1360,8 @@ enum wined3d_event_query_result
 void wined3d_event_query_destroy(struct wined3d_event_query *query) DECLSPEC_HIDDEN;
 enum wined3d_event_query_result wined3d_event_query_finish(const struct wined3d_event_query *query,
         const struct wined3d_device *device) DECLSPEC_HIDDEN;
+enum wined3d_event_query_result wined3d_event_query_test(const struct wined3d_event_query *query,
+        const struct wined3d_device *device) DECLSPEC_HIDDEN;
 void wined3d_event_query_issue(struct wined3d_event_query *query, const struct wined3d_device *device) DECLSPEC_HIDDEN;
 BOOL wined3d_event_query_supported(const struct wined3d_gl_info *gl_info) DECLSPEC_HIDDEN;
 
@@ -1352,11 +1370,48 @@ struct wined3d_timestamp_query
     struct list entry;
     GLuint id;
     struct wined3d_context *context;
+    UINT64 timestamp;
 };
 
 void context_alloc_timestamp_query(struct wined3d_context *context, struct wined3d_timestamp_query *query) DECLSPEC_HIDDEN;
 void context_free_timestamp_query(struct wined3d_timestamp_query *query) DECLSPEC_HIDDEN;
 
+#define WINED3D_GL_CACHE_BLEND_FUNC      0x00000001
+#define WINED3D_GL_CACHE_BLEND_EQUATION  0x00000002
+#define WINED3D_GL_CACHE_DEPTH_FUNC      0x00000004
+#define WINED3D_GL_CACHE_DEPTH_MASK      0x00000008
+#define WINED3D_GL_CACHE_STENCIL_FRONT   0x00000010
+#define WINED3D_GL_CACHE_STENCIL_BACK    0x00000020
+#define WINED3D_GL_CACHE_STENCIL_MASK    0x00000040
+#define WINED3D_GL_CACHE_CAP(i)          (0x00000100u << (i))
+#define WINED3D_GL_CACHE_COLOR_MASK(i)   (0x00010000u << (i))
+#define WINED3D_GL_CACHE_COLOR_MASKS     4
+
+struct wined3d_gl_stencil_face
+{
+    GLenum func;
+    GLint ref;
+    GLuint mask;
+    GLenum ops[3];
+};
+
+/* Shadow copy of the GL state set through the context_gl_*() functions,
+ * used to skip calls that wouldn't change anything. Only the state flagged
+ * in "valid" is known. Code that changes this state without going through
+ * those functions has to call context_invalidate_gl_cache() afterwards. */
+struct wined3d_gl_cache
+{
+    DWORD valid;
+    DWORD caps;
+    DWORD color_masks;
+    GLenum blend_func[4];
+    GLenum blend_equation[2];
+    GLenum depth_func;
+    GLboolean depth_mask;
+    GLuint stencil_mask;
+    struct wined3d_gl_stencil_face stencil[2];
+};
+
 struct wined3d_context
 {
     const struct wined3d_gl_info *gl_info;
@@ -1476,6 +1531,8 @@ struct wined3d_context
     GLfloat                 fog_coord_value;
     GLfloat                 color[4], fogstart, fogend, fogcolor[4];
     GLuint                  dummy_arbfp_prog;
+
+    struct wined3d_gl_cache gl_cache;
 };
 
 struct wined3d_fb_state
@@ -1641,8 +1698,20 @@ void context_free_occlusion_query(struct wined3d_occlusion_query *query) DECLSPE
 struct wined3d_context *context_get_current(void) DECLSPEC_HIDDEN;
 GLenum context_get_offscreen_gl_buffer(const struct wined3d_context *context) DECLSPEC_HIDDEN;
 DWORD context_get_tls_idx(void) DECLSPEC_HIDDEN;
+void context_gl_blend_equation(struct wined3d_context *context,
+        GLenum equation, GLenum equation_alpha) DECLSPEC_HIDDEN;
+void context_gl_blend_func(struct wined3d_context *context, GLenum src, GLenum dst,
+        GLenum src_alpha, GLenum dst_alpha) DECLSPEC_HIDDEN;
+void context_gl_color_mask(struct wined3d_context *context, int index, DWORD mask) DECLSPEC_HIDDEN;
+void context_gl_depth_func(struct wined3d_context *context, GLenum func) DECLSPEC_HIDDEN;
+void context_gl_depth_mask(struct wined3d_context *context, GLboolean mask) DECLSPEC_HIDDEN;
+void context_gl_enable(struct wined3d_context *context, GLenum cap, BOOL enable) DECLSPEC_HIDDEN;
 void context_gl_resource_released(struct wined3d_device *device,
         GLuint name, BOOL rb_namespace) DECLSPEC_HIDDEN;
+void context_gl_stencil(struct wined3d_context *context, GLenum face, GLenum func, GLint ref, GLuint mask,
+        GLenum stencil_fail, GLenum depth_fail, GLenum depth_pass) DECLSPEC_HIDDEN;
+void context_gl_stencil_mask(struct wined3d_context *context, GLuint mask) DECLSPEC_HIDDEN;
+void context_invalidate_gl_cache(struct wined3d_context *context, DWORD mask) DECLSPEC_HIDDEN;
 void context_invalidate_state(struct wined3d_context *context, DWORD state_id) DECLSPEC_HIDDEN;
 void context_release(struct wined3d_context *context) DECLSPEC_HIDDEN;
 void context_resource_released(const struct wined3d_device *device,
@@ -2294,6 +2363,51 @@ struct wined3d_state
  * wined3d_device_create() ignores it. */
 #define WINED3DCREATE_MULTITHREADED 0x00000004
 
+#define WINED3D_STREAM_CHUNK_SIZE       0x400000
+#define WINED3D_STREAM_MAX_CHUNKS       16
+#define WINED3D_STREAM_MIN_BLOCK_SHIFT  8
+#define WINED3D_STREAM_MAX_BLOCK_SHIFT  20
+#define WINED3D_STREAM_BLOCK_CLASSES    (WINED3D_STREAM_MAX_BLOCK_SHIFT - WINED3D_STREAM_MIN_BLOCK_SHIFT + 1)
+
+struct wined3d_stream_chunk
+{
+    GLuint buffer_object;
+    BYTE *ptr;
+};
+
+struct wined3d_stream_block
+{
+    struct wined3d_stream_chunk *chunk;
+    unsigned int offset;
+    unsigned int size_class;
+};
+
+struct wined3d_stream_block_list
+{
+    struct wined3d_stream_block *blocks;
+    SIZE_T count;
+    SIZE_T size;
+};
+
+/* Sub-allocates dynamic buffers from persistently mapped buffer objects.
+ * Blocks released during a frame are fenced at the end of the frame, and
+ * only reused once the GPU is done with them. */
+struct wined3d_stream_allocator
+{
+    struct wined3d_stream_chunk *chunks[WINED3D_STREAM_MAX_CHUNKS];
+    unsigned int chunk_count;
+    unsigned int chunk_offset;
+
+    struct wined3d_stream_block_list free[WINED3D_STREAM_BLOCK_CLASSES];
+    struct wined3d_stream_block_list retired;
+    unsigned int retired_size;
+    struct list batches;
+};
+
+void wined3d_stream_allocator_cleanup(struct wined3d_device *device,
+        const struct wined3d_gl_info *gl_info) DECLSPEC_HIDDEN;
+void wined3d_stream_allocator_fence(struct wined3d_device *device) DECLSPEC_HIDDEN;
+
 struct wined3d_device
 {
     LONG ref;
@@ -2379,6 +2493,10 @@ struct wined3d_device
     /* Command stream */
     struct wined3d_cs *cs;
 
+    struct wined3d_stream_allocator stream_allocator;
+    /* Bytes of vertex data converted since the last present. */
+    unsigned int converted_vertex_bytes;
+
     /* Context management */
     struct wined3d_context **contexts;
     UINT context_count;
@@ -2444,6 +2562,8 @@ struct wined3d_resource
     DWORD priority;
     void *heap_memory;
     struct list resource_list_entry;
+    /* The last command stream op that uses the resource. */
+    ULONG64 access_op;
 
     void *parent;
     const struct wined3d_parent_ops *parent_ops;
@@ -2461,6 +2581,8 @@ static inline ULONG wined3d_resource_decref(struct wined3d_resource *resource)
 }
 
 void resource_cleanup(struct wined3d_resource *resource) DECLSPEC_HIDDEN;
+void resource_destroy(struct wined3d_resource *resource) DECLSPEC_HIDDEN;
+void resource_detach(struct wined3d_resource *resource) DECLSPEC_HIDDEN;
 HRESULT resource_init(struct wined3d_resource *resource, struct wined3d_device *device,
         enum wined3d_resource_type type, const struct wined3d_format *format,
         enum wined3d_multisample_type multisample_type, UINT multisample_quality,
@@ -2901,28 +3023,108 @@ struct wined3d_cs_ops
     void (*submit)(struct wined3d_cs *cs);
     void (*push_constants)(struct wined3d_cs *cs, enum wined3d_push_constants p,
             unsigned int start_idx, unsigned int count, const void *constants);
+    void (*finish)(struct wined3d_cs *cs);
+    void (*finish_op)(struct wined3d_cs *cs, ULONG64 op);
+};
+
+#define WINED3D_FRAME_STATS_MAGIC   0x53463357 /* "W3FS" */
+#define WINED3D_FRAME_STATS_VERSION 2
+#define WINED3D_FRAME_STATS_MAX_OPS 32
+
+/* CPU side statistics for a single frame. When the FrameStatsPath setting is
+ * set, the statistics of the last completed frame are published at present
+ * time through a shared mapping of the file "<FrameStatsPath>.<pid>.<n>",
+ * where "pid" is the hexadecimal process id and "n" numbers the devices
+ * created by the process. "sequence" is odd while the mapping is being
+ * updated; readers should retry if it is odd, or changes while they read.
+ * Times are in units of "frequency" ticks per second. */
+struct wined3d_frame_stats
+{
+    DWORD magic;
+    DWORD version;
+    LONG volatile sequence;
+    DWORD op_count;
+    ULONGLONG frequency;
+
+    ULONGLONG frame;
+    ULONGLONG frame_time;       /* Time between the last two presents. */
+    ULONGLONG cs_time;          /* Time spent executing command stream ops. */
+    ULONGLONG state_time;       /* Time spent applying dirty states. */
+    ULONGLONG fbo_time;         /* Time spent in FBO setup. */
+    DWORD state_count;
+    DWORD fbo_count;
+    DWORD program_switches;
+    DWORD gl_state_issued;      /* GL state changes passed to GL. */
+    DWORD gl_state_filtered;    /* Redundant GL state changes skipped. */
+    DWORD padding;
+    struct
+    {
+        DWORD count;
+        DWORD padding;
+        ULONGLONG time;
+    } ops[WINED3D_FRAME_STATS_MAX_OPS];
 };
 
+static inline ULONGLONG wined3d_frame_stats_time(void)
+{
+    LARGE_INTEGER counter;
+
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+}
+
 struct wined3d_cs
 {
     const struct wined3d_cs_ops *ops;
     struct wined3d_device *device;
     struct wined3d_fb_state fb;
     struct wined3d_state state;
+    struct list query_poll_list;
+    LONG refcount;
 
     size_t data_size;
     void *data;
+
+    /* Multi-threaded command stream. */
+    BYTE *queue;
+    LONG volatile queue_head;
+    LONG volatile queue_tail;
+    LONG pending_head;
+    /* Op counters, 64-bit so that they never wrap. */
+    ULONG64 submitted_ops;
+    LONG64 volatile executed_ops;
+    ULONG64 present_op;
+    HANDLE thread;
+    DWORD thread_id;
+    HANDLE event;
+    HMODULE wined3d_module;
+    LONG volatile waiting;
+    LONG volatile exit;
+    /* Used by the application thread to wait for ops to be executed. */
+    CRITICAL_SECTION wait_cs;
+    CONDITION_VARIABLE progress;
+    LONG volatile wait_count;
+
+    /* NULL unless frame statistics are enabled. */
+    struct wined3d_frame_stats *frame_stats;
+    struct wined3d_frame_stats *frame_stats_view;
+    ULONGLONG frame_start;
 };
 
 struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device) DECLSPEC_HIDDEN;
 void wined3d_cs_destroy(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
 
+void wined3d_cs_emit_callback(struct wined3d_cs *cs,
+        void (*callback)(void *object), void *object) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_clear(struct wined3d_cs *cs, DWORD rect_count, const RECT *rects,
         DWORD flags, const struct wined3d_color *color, float depth, DWORD stencil) DECLSPEC_HIDDEN;
-void wined3d_cs_emit_draw(struct wined3d_cs *cs, UINT start_idx, UINT index_count,
-        UINT start_instance, UINT instance_count, BOOL indexed) DECLSPEC_HIDDEN;
+void wined3d_cs_emit_draw(struct wined3d_cs *cs, GLenum primitive_type, INT base_vertex_idx, UINT start_idx,
+        UINT index_count, UINT start_instance, UINT instance_count, BOOL indexed) DECLSPEC_HIDDEN;
+void wined3d_cs_emit_rename_buffer(struct wined3d_cs *cs, struct wined3d_buffer *buffer,
+        const struct wined3d_stream_block *block) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *swapchain,
         const RECT *src_rect, const RECT *dst_rect, HWND dst_window_override, DWORD flags) DECLSPEC_HIDDEN;
+void wined3d_cs_emit_query_issue(struct wined3d_cs *cs, struct wined3d_query *query, DWORD flags) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_reset_state(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_set_clip_plane(struct wined3d_cs *cs, UINT plane_idx,
         const struct wined3d_vec4 *plane) DECLSPEC_HIDDEN;
@@ -2934,6 +3136,8 @@ void wined3d_cs_emit_set_depth_stencil_view(struct wined3d_cs *cs,
         struct wined3d_rendertarget_view *view) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_set_index_buffer(struct wined3d_cs *cs, struct wined3d_buffer *buffer,
         enum wined3d_format_id format_id, unsigned int offset) DECLSPEC_HIDDEN;
+void wined3d_cs_emit_set_light(struct wined3d_cs *cs, const struct wined3d_light_info *light) DECLSPEC_HIDDEN;
+void wined3d_cs_emit_set_light_enable(struct wined3d_cs *cs, UINT idx, BOOL enable) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_set_material(struct wined3d_cs *cs, const struct wined3d_material *material) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_set_predication(struct wined3d_cs *cs,
         struct wined3d_query *predicate, BOOL value) DECLSPEC_HIDDEN;
@@ -2971,6 +3175,28 @@ static inline void wined3d_cs_push_constants(struct wined3d_cs *cs, enum wined3d
     cs->ops->push_constants(cs, p, start_idx, count, constants);
 }
 
+/* Waits for all queued ops to be executed before the caller touches
+ * resources or objects they may still refer to. */
+static inline void wined3d_cs_finish(struct wined3d_cs *cs)
+{
+    cs->ops->finish(cs);
+}
+
+/* Whether the calling thread executes the ops, and submits their GL
+ * commands. */
+static inline BOOL wined3d_cs_is_executing_thread(const struct wined3d_cs *cs)
+{
+    return !cs->thread || GetCurrentThreadId() == cs->thread_id;
+}
+
+/* Waits for the queued ops that use the resource to be executed. */
+static inline void wined3d_resource_wait_idle(const struct wined3d_resource *resource)
+{
+    struct wined3d_cs *cs = resource->device->cs;
+
+    cs->ops->finish_op(cs, resource->access_op);
+}
+
 /* Direct3D terminology with little modifications. We do not have an issued state
  * because only the driver knows about it, but we have a created state because d3d
  * allows GetData on a created issue, but opengl doesn't
@@ -2984,7 +3210,12 @@ enum query_state {
 struct wined3d_query_ops
 {
     HRESULT (*query_get_data)(struct wined3d_query *query, void *data, DWORD data_size, DWORD flags);
-    HRESULT (*query_issue)(struct wined3d_query *query, DWORD flags);
+    /* Executed by the command stream. Returns TRUE if the result has to be
+     * polled for. */
+    BOOL (*query_issue)(struct wined3d_query *query, DWORD flags);
+    /* Executed by the command stream. Returns TRUE once the result is
+     * available. */
+    BOOL (*query_poll)(struct wined3d_query *query);
 };
 
 struct wined3d_query
@@ -2998,8 +3229,17 @@ struct wined3d_query
     enum wined3d_query_type type;
     DWORD data_size;
     void                     *extendedData;
+
+    /* The result is available when counter_retrieved reaches counter_main,
+     * which counts the WINED3DISSUE_END issues. */
+    LONG volatile counter_main;
+    LONG volatile counter_retrieved;
+    LONG counter_executed;
+    struct list poll_list_entry;
 };
 
+BOOL wined3d_query_poll(struct wined3d_query *query) DECLSPEC_HIDDEN;
+
 /* TODO: Add tests and support for FLOAT16_4 POSITIONT, D3DCOLOR position, other
  * fixed function semantics as D3DCOLOR or FLOAT16 */
 enum wined3d_buffer_conversion_type
@@ -3037,6 +3277,13 @@ struct wined3d_buffer
     UINT stride;                                            /* 0 if no conversion */
     UINT conversion_stride;                                 /* 0 if no shifted conversion */
     enum wined3d_buffer_conversion_type *conversion_map;    /* NULL if no conversion */
+
+    /* The buffer's data is at stream_block.offset in buffer_object if
+     * stream_block.chunk is set. */
+    struct wined3d_stream_block stream_block;
+    /* The block wined3d_buffer_map() returns. It's ahead of stream_block
+     * while the op switching the buffer to a renamed block is queued. */
+    struct wined3d_stream_block map_block;
 };
 
 static inline struct wined3d_buffer *buffer_from_resource(struct wined3d_resource *resource)
@@ -3050,6 +3297,8 @@ BYTE *buffer_get_sysmem(struct wined3d_buffer *buffer, struct wined3d_context *c
 void buffer_internal_preload(struct wined3d_buffer *buffer, struct wined3d_context *context,
         const struct wined3d_state *state) DECLSPEC_HIDDEN;
 void buffer_mark_used(struct wined3d_buffer *buffer) DECLSPEC_HIDDEN;
+void buffer_stream_set_block(struct wined3d_buffer *buffer,
+        const struct wined3d_stream_block *block) DECLSPEC_HIDDEN;
 HRESULT wined3d_buffer_copy(struct wined3d_buffer *dst_buffer, unsigned int dst_offset,
         struct wined3d_buffer *src_buffer, unsigned int src_offset, unsigned int size) DECLSPEC_HIDDEN;
 HRESULT wined3d_buffer_upload_data(struct wined3d_buffer *buffer,
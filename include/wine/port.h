@@ -108,6 +108,16 @@ struct statvfs
  * Macro definitions
  */
 
+/* Attribute for functions that use instruction set extensions the rest of
+ * the module isn't built for. Windows code only keeps the stack 4-byte
+ * aligned on i386, which isn't enough for spilling vector registers, so
+ * such functions realign it on entry there. */
+#if defined(__x86_64__) && defined(__GNUC__)
+# define __WINE_TARGET(isa) __attribute__((target(isa)))
+#elif defined(__i386__) && defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+# define __WINE_TARGET(isa) __attribute__((target(isa), force_align_arg_pointer))
+#endif
+
 #ifdef HAVE_DLFCN_H
 #include <dlfcn.h>
 #else
@@ -1377,14 +1377,18 @@ struct create_file_request
     int          create;
     unsigned int options;
     unsigned int attrs;
+    int          want_fd;
     /* VARARG(objattr,object_attributes); */
     /* VARARG(filename,string); */
+    char __pad_36[4];
 };
 struct create_file_reply
 {
     struct reply_header __header;
     obj_handle_t handle;
-    char __pad_12[4];
+    int          type;
+    unsigned int access;
+    unsigned int options;
 };
 
 
@@ -1452,6 +1456,7 @@ struct get_handle_fd_reply
     unsigned int access;
     unsigned int options;
 };
+
 enum server_fd_type
 {
     FD_TYPE_INVALID,
@@ -1466,6 +1471,26 @@ enum server_fd_type
     FD_TYPE_NB_TYPES
 };
 
+struct handle_fd_info
+{
+    obj_handle_t handle;
+    int          type;
+    unsigned int access;
+    unsigned int options;
+};
+
+
+struct get_handle_fds_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_handle_fds_reply
+{
+    struct reply_header __header;
+    /* VARARG(fds,handle_fd_infos); */
+};
+
 
 
 struct get_directory_cache_entry_request
@@ -5386,6 +5411,34 @@ struct terminate_job_reply
 };
 
 
+struct request_stat
+{
+    unsigned int    req;
+    unsigned int    calls;
+    timeout_t       total_time;
+    timeout_t       max_time;
+    mem_size_t      bytes_in;
+    mem_size_t      bytes_out;
+};
+
+
+struct get_request_stats_request
+{
+    struct request_header __header;
+    obj_handle_t    process;
+};
+struct get_request_stats_reply
+{
+    struct reply_header __header;
+    unsigned int    calls;
+    unsigned int    count;
+    timeout_t       total_time;
+    mem_size_t      bytes_in;
+    mem_size_t      bytes_out;
+    /* VARARG(stats,request_stats); */
+};
+
+
 enum request
 {
     REQ_new_process,
@@ -5433,6 +5486,7 @@ enum request
     REQ_alloc_file_handle,
     REQ_get_handle_unix_name,
     REQ_get_handle_fd,
+    REQ_get_handle_fds,
     REQ_get_directory_cache_entry,
     REQ_flush,
     REQ_lock_file,
@@ -5661,6 +5715,7 @@ enum request
     REQ_set_job_limits,
     REQ_set_job_completion_port,
     REQ_terminate_job,
+    REQ_get_request_stats,
     REQ_NB_REQUESTS
 };
 
@@ -5713,6 +5768,7 @@ union generic_request
     struct alloc_file_handle_request alloc_file_handle_request;
     struct get_handle_unix_name_request get_handle_unix_name_request;
     struct get_handle_fd_request get_handle_fd_request;
+    struct get_handle_fds_request get_handle_fds_request;
     struct get_directory_cache_entry_request get_directory_cache_entry_request;
     struct flush_request flush_request;
     struct lock_file_request lock_file_request;
@@ -5941,6 +5997,7 @@ union generic_request
     struct set_job_limits_request set_job_limits_request;
     struct set_job_completion_port_request set_job_completion_port_request;
     struct terminate_job_request terminate_job_request;
+    struct get_request_stats_request get_request_stats_request;
 };
 union generic_reply
 {
@@ -5991,6 +6048,7 @@ union generic_reply
     struct alloc_file_handle_reply alloc_file_handle_reply;
     struct get_handle_unix_name_reply get_handle_unix_name_reply;
     struct get_handle_fd_reply get_handle_fd_reply;
+    struct get_handle_fds_reply get_handle_fds_reply;
     struct get_directory_cache_entry_reply get_directory_cache_entry_reply;
     struct flush_reply flush_reply;
     struct lock_file_reply lock_file_reply;
@@ -6219,8 +6277,9 @@ union generic_reply
     struct set_job_limits_reply set_job_limits_reply;
     struct set_job_completion_port_reply set_job_completion_port_reply;
     struct terminate_job_reply terminate_job_reply;
+    struct get_request_stats_reply get_request_stats_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 504
+#define SERVER_PROTOCOL_VERSION 507
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
@@ -53,6 +53,7 @@ static void async_destroy( struct object *obj );
 static const struct object_ops async_ops =
 {
     sizeof(struct async),      /* size */
+    "async",                   /* name */
     async_dump,                /* dump */
     no_get_type,               /* get_type */
     add_queue,                 /* add_queue */
@@ -88,6 +89,7 @@ static void async_queue_destroy( struct object *obj );
 static const struct object_ops async_queue_ops =
 {
     sizeof(struct async_queue),      /* size */
+    "async_queue",                   /* name */
     async_queue_dump,                /* dump */
     no_get_type,                     /* get_type */
     no_add_queue,                    /* add_queue */
@@ -75,6 +75,7 @@ static void atom_table_destroy( struct object *obj );
 static const struct object_ops atom_table_ops =
 {
     sizeof(struct atom_table),    /* size */
+    "atom_table",                 /* name */
     atom_table_dump,              /* dump */
     no_get_type,                  /* get_type */
     no_add_queue,                 /* add_queue */
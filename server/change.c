@@ -93,6 +93,7 @@ struct inotify_event {
 #define IN_CREATE        0x00000100
 #define IN_DELETE        0x00000200
 #define IN_DELETE_SELF   0x00000400
+#define IN_Q_OVERFLOW    0x00004000
 
 #define IN_ISDIR         0x40000000
 
@@ -127,6 +128,9 @@ struct change_record {
     struct filesystem_event event;
 };
 
+/* maximum size of the pending change records of a directory before they are discarded */
+#define MAX_CHANGE_RECORDS_SIZE  (256 * 1024)
+
 struct dir
 {
     struct object  obj;      /* object header */
@@ -139,6 +143,8 @@ struct dir
     int            want_data; /* return change data */
     int            subtree;  /* do we want to watch subdirectories? */
     struct list    change_records;   /* data for the change */
+    data_size_t    records_size;     /* total size of the pending change records */
+    int            overflow; /* change records have been discarded */
     struct list    in_entry; /* entry in the inode dirs list */
     struct inode  *inode;    /* inode of the associated directory */
     struct process *client_process;  /* client process that has a cache for this directory */
@@ -157,6 +163,7 @@ static void dir_destroy( struct object *obj );
 static const struct object_ops dir_ops =
 {
     sizeof(struct dir),       /* size */
+    "dir",                    /* name */
     dir_dump,                 /* dump */
     dir_get_type,             /* get_type */
     add_queue,                /* add_queue */
@@ -357,8 +364,8 @@ void do_change_notify( int unix_fd )
     }
 }
 
-/* SIGIO callback, called synchronously with the poll loop */
-void sigio_callback(void)
+/* wake up the waiters of all the directories that have been notified */
+static void wake_up_notified_dirs(void)
 {
     struct dir *dir;
 
@@ -369,6 +376,12 @@ void sigio_callback(void)
     }
 }
 
+/* SIGIO callback, called synchronously with the poll loop */
+void sigio_callback(void)
+{
+    wake_up_notified_dirs();
+}
+
 static struct fd *dir_get_fd( struct object *obj )
 {
     struct dir *dir = (struct dir *)obj;
@@ -468,6 +481,16 @@ static struct change_record *get_first_change_record( struct dir *dir )
     return LIST_ENTRY( ptr, struct change_record, entry );
 }
 
+/* discard all the pending change records, the client will have to rescan the directory */
+static void discard_change_records( struct dir *dir )
+{
+    struct change_record *record;
+
+    while ((record = get_first_change_record( dir ))) free( record );
+    dir->records_size = 0;
+    dir->overflow = 1;
+}
+
 static int dir_close_handle( struct object *obj, struct process *process, obj_handle_t handle )
 {
     struct dir *dir = (struct dir *)obj;
@@ -533,6 +556,7 @@ struct inode {
     dev_t dev;               /* device number */
     ino_t ino;               /* device's inode number */
     int wd;                  /* inotify's watch descriptor */
+    unsigned int mask;       /* inotify event mask of the watch */
     char *name;              /* basename name of the inode */
 };
 
@@ -540,6 +564,7 @@ static struct list inode_hash[ HASH_SIZE ];
 static struct list wd_hash[ HASH_SIZE ];
 
 static int inotify_add_dir( char *path, unsigned int filter );
+static int map_flags( unsigned int filter );
 
 static struct inode *inode_from_wd( int wd )
 {
@@ -582,6 +607,7 @@ static struct inode *create_inode( dev_t dev, ino_t ino )
         inode->ino = ino;
         inode->dev = dev;
         inode->wd = -1;
+        inode->mask = 0;
         inode->parent = NULL;
         inode->name = NULL;
         list_add_tail( get_hash_list( dev, ino ), &inode->ino_entry );
@@ -599,11 +625,12 @@ static struct inode *get_inode( dev_t dev, ino_t ino )
     return create_inode( dev, ino );
 }
 
-static void inode_set_wd( struct inode *inode, int wd )
+static void inode_set_wd( struct inode *inode, int wd, unsigned int mask )
 {
     if (inode->wd != -1)
         list_remove( &inode->wd_entry );
     inode->wd = wd;
+    inode->mask = mask;
     list_add_tail( &wd_hash[ wd % HASH_SIZE ], &inode->wd_entry );
 }
 
@@ -714,12 +741,31 @@ static void inotify_do_change_notify( struct dir *dir, unsigned int action,
                                       unsigned int cookie, const char *relpath )
 {
     struct change_record *record;
+    struct list *tail;
 
     assert( dir->obj.ops == &dir_ops );
 
-    if (dir->want_data)
+    if (dir->want_data && !dir->overflow)
     {
         size_t len = strlen(relpath);
+        data_size_t size = (offsetof(struct filesystem_event, name[len]) + sizeof(int)-1)
+                           / sizeof(int) * sizeof(int);
+
+        /* coalesce repeated modifications of the same file */
+        if (action == FILE_ACTION_MODIFIED && (tail = list_tail( &dir->change_records )))
+        {
+            record = LIST_ENTRY( tail, struct change_record, entry );
+            if (record->event.action == action && record->event.len == len &&
+                !memcmp( record->event.name, relpath, len ))
+                goto done;
+        }
+
+        if (dir->records_size + size > MAX_CHANGE_RECORDS_SIZE)
+        {
+            discard_change_records( dir );
+            goto done;
+        }
+
         record = malloc( offsetof(struct change_record, event.name[len]) );
         if (!record)
             return;
@@ -730,9 +776,25 @@ static void inotify_do_change_notify( struct dir *dir, unsigned int action,
         record->event.len = len;
 
         list_add_tail( &dir->change_records, &record->entry );
+        dir->records_size += size;
     }
 
-    fd_async_wake_up( dir->fd, ASYNC_TYPE_WAIT, STATUS_ALERTED );
+done:
+    /* waiters are woken up once the whole batch of events has been processed */
+    dir->notified = 1;
+}
+
+/* the inotify event queue overflowed, all watching directories have to be rescanned */
+static void inotify_overflow(void)
+{
+    struct dir *dir;
+
+    LIST_FOR_EACH_ENTRY( dir, &change_list, struct dir, entry )
+    {
+        if (!dir->inode) continue;
+        if (dir->want_data) discard_change_records( dir );
+        dir->notified = 1;
+    }
 }
 
 static unsigned int filter_from_event( struct inotify_event *ie )
@@ -837,7 +899,7 @@ static void inode_check_dir( struct inode *parent, const char *name )
 
     wd = inotify_add_dir( path, filter );
     if (wd != -1)
-        inode_set_wd( inode, wd );
+        inode_set_wd( inode, wd, map_flags( filter ) );
     else
         free_inode( inode );
 
@@ -935,7 +997,7 @@ static void inotify_notify_all( struct inotify_event *ie )
 static void inotify_poll_event( struct fd *fd, int event )
 {
     int r, ofs, unix_fd;
-    char buffer[0x1000];
+    char buffer[0x10000];
     struct inotify_event *ie;
 
     unix_fd = get_unix_fd( fd );
@@ -949,12 +1011,15 @@ static void inotify_poll_event( struct fd *fd, int event )
     for( ofs = 0; ofs < r - offsetof(struct inotify_event, name); )
     {
         ie = (struct inotify_event*) &buffer[ofs];
-        if (!ie->len)
-            break;
         ofs += offsetof( struct inotify_event, name[ie->len] );
         if (ofs > r) break;
-        inotify_notify_all( ie );
+        if (ie->mask & IN_Q_OVERFLOW)
+            inotify_overflow();
+        else if (ie->len)
+            inotify_notify_all( ie );
     }
+
+    wake_up_notified_dirs();
 }
 
 static inline struct fd *create_inotify_fd( void )
@@ -1048,11 +1113,15 @@ static int inotify_adjust_changes( struct dir *dir )
 
     filter = filter_from_inode( inode, 0 );
 
+    /* the inode is already watched with the right mask, no need to update it */
+    if (inode->wd != -1 && inode->mask == map_flags( filter ))
+        return 1;
+
     sprintf( path, "/proc/self/fd/%u", unix_fd );
     wd = inotify_add_dir( path, filter );
     if (wd == -1) return 0;
 
-    inode_set_wd( inode, wd );
+    inode_set_wd( inode, wd, map_flags( filter ) );
 
     return 1;
 }
@@ -1151,7 +1220,7 @@ static int dir_add_to_existing_notify( struct dir *dir )
 
     wd = inotify_add_dir( link, filter );
     if (wd != -1)
-        inode_set_wd( inode, wd );
+        inode_set_wd( inode, wd, map_flags( filter ) );
 
     return 1;
 }
@@ -1189,6 +1258,8 @@ struct object *create_dir_obj( struct fd *fd, unsigned int access, mode_t mode )
         return NULL;
 
     list_init( &dir->change_records );
+    dir->records_size = 0;
+    dir->overflow = 0;
     dir->filter = 0;
     dir->notified = 0;
     dir->want_data = 0;
@@ -1260,8 +1331,8 @@ DECL_HANDLER(read_directory_changes)
         dir->want_data = req->want_data;
     }
 
-    /* if there's already a change in the queue, send it */
-    if (!list_empty( &dir->change_records ))
+    /* if there's already a change in the queue, or records were lost, send it */
+    if (!list_empty( &dir->change_records ) || dir->overflow)
         fd_async_wake_up( dir->fd, ASYNC_TYPE_WAIT, STATUS_ALERTED );
 
     /* setup the real notification */
@@ -1289,6 +1360,15 @@ DECL_HANDLER(read_change)
 
     list_init( &events );
     list_move_tail( &events, &dir->change_records );
+    dir->records_size = 0;
+    if (dir->overflow)
+    {
+        /* records have been lost, let the client rescan the directory */
+        dir->overflow = 0;
+        release_object( dir );
+        set_error( STATUS_NOTIFY_ENUM_DIR );
+        return;
+    }
     release_object( dir );
 
     if (list_empty( &events ))
@@ -53,6 +53,7 @@ static void clipboard_dump( struct object *obj, int verbose );
 static const struct object_ops clipboard_ops =
 {
     sizeof(struct clipboard),     /* size */
+    "clipboard",                  /* name */
     clipboard_dump,               /* dump */
     no_get_type,                  /* get_type */
     no_add_queue,                 /* add_queue */
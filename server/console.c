@@ -72,6 +72,7 @@ static struct fd *console_input_get_fd( struct object *obj );
 static const struct object_ops console_input_ops =
 {
     sizeof(struct console_input),     /* size */
+    "console_input",                  /* name */
     console_input_dump,               /* dump */
     no_get_type,                      /* get_type */
     no_add_queue,                     /* add_queue */
@@ -106,6 +107,7 @@ struct console_input_events
 static const struct object_ops console_input_events_ops =
 {
     sizeof(struct console_input_events), /* size */
+    "console_input_events",              /* name */
     console_input_events_dump,        /* dump */
     no_get_type,                      /* get_type */
     add_queue,                        /* add_queue */
@@ -160,6 +162,7 @@ static struct fd *screen_buffer_get_fd( struct object *obj );
 static const struct object_ops screen_buffer_ops =
 {
     sizeof(struct screen_buffer),     /* size */
+    "screen_buffer",                  /* name */
     screen_buffer_dump,               /* dump */
     no_get_type,                      /* get_type */
     no_add_queue,                     /* add_queue */
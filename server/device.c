@@ -66,6 +66,7 @@ static void irp_call_destroy( struct object *obj );
 static const struct object_ops irp_call_ops =
 {
     sizeof(struct irp_call),          /* size */
+    "irp_call",                       /* name */
     irp_call_dump,                    /* dump */
     no_get_type,                      /* get_type */
     add_queue,                        /* add_queue */
@@ -102,6 +103,7 @@ static void device_manager_destroy( struct object *obj );
 static const struct object_ops device_manager_ops =
 {
     sizeof(struct device_manager),    /* size */
+    "device_manager",                 /* name */
     device_manager_dump,              /* dump */
     no_get_type,                      /* get_type */
     add_queue,                        /* add_queue */
@@ -143,6 +145,7 @@ static struct object *device_open_file( struct object *obj, unsigned int access,
 static const struct object_ops device_ops =
 {
     sizeof(struct device),            /* size */
+    "device",                         /* name */
     device_dump,                      /* dump */
     device_get_type,                  /* get_type */
     no_add_queue,                     /* add_queue */
@@ -191,6 +194,7 @@ static obj_handle_t device_file_ioctl( struct fd *fd, ioctl_code_t code, const a
 static const struct object_ops device_file_ops =
 {
     sizeof(struct device_file),       /* size */
+    "device_file",                    /* name */
     device_file_dump,                 /* dump */
     no_get_type,                      /* get_type */
     add_queue,                        /* add_queue */
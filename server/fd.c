@@ -202,6 +202,7 @@ static void fd_destroy( struct object *obj );
 static const struct object_ops fd_ops =
 {
     sizeof(struct fd),        /* size */
+    "fd",                     /* name */
     fd_dump,                  /* dump */
     no_get_type,              /* get_type */
     no_add_queue,             /* add_queue */
@@ -241,6 +242,7 @@ static void device_destroy( struct object *obj );
 static const struct object_ops device_ops =
 {
     sizeof(struct device),    /* size */
+    "unix_device",            /* name */
     device_dump,              /* dump */
     no_get_type,              /* get_type */
     no_add_queue,             /* add_queue */
@@ -279,6 +281,7 @@ static void inode_destroy( struct object *obj );
 static const struct object_ops inode_ops =
 {
     sizeof(struct inode),     /* size */
+    "inode",                  /* name */
     inode_dump,               /* dump */
     no_get_type,              /* get_type */
     no_add_queue,             /* add_queue */
@@ -319,6 +322,7 @@ static int file_lock_signaled( struct object *obj, struct wait_queue_entry *entr
 static const struct object_ops file_lock_ops =
 {
     sizeof(struct file_lock),   /* size */
+    "file_lock",                /* name */
     file_lock_dump,             /* dump */
     no_get_type,                /* get_type */
     add_queue,                  /* add_queue */
@@ -365,6 +369,7 @@ struct timeout_user
 };
 
 static struct list timeout_list = LIST_INIT(timeout_list);   /* sorted timeouts list */
+DECLARE_MEM_POOL( timeout_pool, struct timeout_user );
 timeout_t current_time;
 
 static inline void set_current_time(void)
@@ -381,7 +386,7 @@ struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, vo
     struct timeout_user *user;
     struct list *ptr;
 
-    if (!(user = mem_alloc( sizeof(*user) ))) return NULL;
+    if (!(user = pool_alloc( &timeout_pool ))) return NULL;
     user->when     = (when > 0) ? when : current_time - when;
     user->callback = func;
     user->private  = private;
@@ -401,7 +406,7 @@ struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, vo
 void remove_timeout_user( struct timeout_user *user )
 {
     list_remove( &user->entry );
-    free( user );
+    pool_free( &timeout_pool, user );
 }
 
 /* return a text description of a timeout for debugging purposes */
@@ -872,7 +877,7 @@ static int get_next_timeout(void)
             struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
             list_remove( &timeout->entry );
             timeout->callback( timeout->private );
-            free( timeout );
+            pool_free( &timeout_pool, timeout );
         }
 
         if ((ptr = list_head( &timeout_list )) != NULL)
@@ -2453,6 +2458,25 @@ DECL_HANDLER(get_handle_fd)
     }
 }
 
+/* send the unix fd of a newly created handle along with the reply, if it can be cached */
+int send_handle_fd( struct process *process, struct object *obj, obj_handle_t handle,
+                    unsigned int *access, unsigned int *options )
+{
+    struct fd *fd;
+    int type = FD_TYPE_INVALID;
+
+    if (!(fd = get_obj_fd( obj ))) return FD_TYPE_INVALID;
+    if (fd->cacheable && fd->unix_fd != -1)
+    {
+        type = fd->fd_ops->get_fd_type( fd );
+        *options = fd->options;
+        *access = get_handle_access( process, handle );
+        if (send_client_fd( process, fd->unix_fd, handle ) == -1) type = FD_TYPE_INVALID;
+    }
+    release_object( fd );
+    return type;
+}
+
 /* perform a read on a file object */
 DECL_HANDLER(read)
 {
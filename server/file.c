@@ -80,6 +80,7 @@ static enum server_fd_type file_get_fd_type( struct fd *fd );
 static const struct object_ops file_ops =
 {
     sizeof(struct file),          /* size */
+    "file",                       /* name */
     file_dump,                    /* dump */
     file_get_type,                /* get_type */
     add_queue,                    /* add_queue */
@@ -729,6 +730,9 @@ DECL_HANDLER(create_file)
                              req->create, req->options, req->attrs, sd )))
     {
         reply->handle = alloc_handle( current->process, file, req->access, objattr->attributes );
+        if (reply->handle && req->want_fd)
+            reply->type = send_handle_fd( current->process, file, reply->handle,
+                                          &reply->access, &reply->options );
         release_object( file );
     }
     if (root_fd) release_object( root_fd );
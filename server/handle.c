@@ -34,6 +34,7 @@
 #include "winternl.h"
 
 #include "handle.h"
+#include "file.h"
 #include "process.h"
 #include "thread.h"
 #include "security.h"
@@ -118,6 +119,7 @@ static void handle_table_destroy( struct object *obj );
 static const struct object_ops handle_table_ops =
 {
     sizeof(struct handle_table),     /* size */
+    "handle_table",                  /* name */
     handle_table_dump,               /* dump */
     no_get_type,                     /* get_type */
     no_add_queue,                    /* add_queue */
@@ -768,6 +770,33 @@ DECL_HANDLER(get_security_object)
     release_object( obj );
 }
 
+/* send the fds of the handles that the client can cache, usually inherited at process start */
+DECL_HANDLER(get_handle_fds)
+{
+    struct handle_table *table = current->process->handles;
+    data_size_t max_infos = get_reply_max_size() / sizeof(struct handle_fd_info);
+    struct handle_fd_info *infos;
+    struct handle_entry *entry;
+    unsigned int count = 0;
+    int i;
+
+    if (!table || !max_infos) return;
+    if (!(infos = mem_alloc( max_infos * sizeof(*infos) ))) return;
+
+    for (i = 0, entry = table->entries; i <= table->last && count < max_infos; i++, entry++)
+    {
+        if (!entry->ptr || entry->ptr->ops->get_fd == no_get_fd) continue;
+        infos[count].handle = index_to_handle(i);
+        infos[count].type = send_handle_fd( current->process, entry->ptr, infos[count].handle,
+                                            &infos[count].access, &infos[count].options );
+        if (infos[count].type != FD_TYPE_INVALID) count++;
+    }
+    /* objects without a usable fd are simply left out */
+    clear_error();
+
+    set_reply_data_ptr( infos, count * sizeof(*infos) );
+}
+
 struct enum_handle_info
 {
     unsigned int count;
@@ -74,6 +74,7 @@ static void mailslot_destroy( struct object * );
 static const struct object_ops mailslot_ops =
 {
     sizeof(struct mailslot),   /* size */
+    "mailslot",                /* name */
     mailslot_dump,             /* dump */
     no_get_type,               /* get_type */
     add_queue,                 /* add_queue */
@@ -129,6 +130,7 @@ static void mail_writer_destroy( struct object *obj);
 static const struct object_ops mail_writer_ops =
 {
     sizeof(struct mail_writer), /* size */
+    "mail_writer",              /* name */
     mail_writer_dump,           /* dump */
     no_get_type,                /* get_type */
     no_add_queue,               /* add_queue */
@@ -185,6 +187,7 @@ static enum server_fd_type mailslot_device_get_fd_type( struct fd *fd );
 static const struct object_ops mailslot_device_ops =
 {
     sizeof(struct mailslot_device), /* size */
+    "mailslot_device",              /* name */
     mailslot_device_dump,           /* dump */
     mailslot_device_get_type,       /* get_type */
     no_add_queue,                   /* add_queue */
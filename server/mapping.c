@@ -79,6 +79,7 @@ static enum server_fd_type mapping_get_fd_type( struct fd *fd );
 static const struct object_ops mapping_ops =
 {
     sizeof(struct mapping),      /* size */
+    "mapping",                   /* name */
     mapping_dump,                /* dump */
     mapping_get_type,            /* get_type */
     no_add_queue,                /* add_queue */
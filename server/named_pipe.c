@@ -120,6 +120,7 @@ static void named_pipe_destroy( struct object *obj );
 static const struct object_ops named_pipe_ops =
 {
     sizeof(struct named_pipe),    /* size */
+    "named_pipe",                 /* name */
     named_pipe_dump,              /* dump */
     no_get_type,                  /* get_type */
     no_add_queue,                 /* add_queue */
@@ -151,6 +152,7 @@ static obj_handle_t pipe_server_ioctl( struct fd *fd, ioctl_code_t code, const a
 static const struct object_ops pipe_server_ops =
 {
     sizeof(struct pipe_server),   /* size */
+    "pipe_server",                /* name */
     pipe_server_dump,             /* dump */
     no_get_type,                  /* get_type */
     add_queue,                    /* add_queue */
@@ -195,6 +197,7 @@ static enum server_fd_type pipe_client_get_fd_type( struct fd *fd );
 static const struct object_ops pipe_client_ops =
 {
     sizeof(struct pipe_client),   /* size */
+    "pipe_client",                /* name */
     pipe_client_dump,             /* dump */
     no_get_type,                  /* get_type */
     add_queue,                    /* add_queue */
@@ -243,6 +246,7 @@ static obj_handle_t named_pipe_device_ioctl( struct fd *fd, ioctl_code_t code,
 static const struct object_ops named_pipe_device_ops =
 {
     sizeof(struct named_pipe_device), /* size */
+    "named_pipe_device",              /* name */
     named_pipe_device_dump,           /* dump */
     named_pipe_device_get_type,       /* get_type */
     no_add_queue,                     /* add_queue */
@@ -111,6 +111,126 @@ void *memdup( const void *data, size_t len )
 }
 
 
+/*****************************************************************/
+/* memory pools */
+
+#define POOL_ALIGN       16    /* alignment of the pool blocks */
+#define POOL_CHUNK_SIZE  4096  /* minimum size of the chunks allocated for a pool */
+
+static struct list pool_list = LIST_INIT(pool_list);
+
+/* allocate a block from a memory pool */
+void *pool_alloc( struct mem_pool *pool )
+{
+    size_t size = (pool->size + POOL_ALIGN - 1) & ~(POOL_ALIGN - 1);
+    void *ptr;
+
+    if (!pool->free_list)
+    {
+        unsigned int i, count = max( POOL_CHUNK_SIZE / size, 16 );
+        char *chunk;
+
+        /* chunks are never freed, blocks are recycled through the free list */
+        if (!(chunk = malloc( count * size )))
+        {
+            set_error( STATUS_NO_MEMORY );
+            return NULL;
+        }
+        for (i = 0; i < count; i++)
+        {
+            *(void **)(chunk + i * size) = pool->free_list;
+            pool->free_list = chunk + i * size;
+        }
+        if (!pool->chunks++) list_add_tail( &pool_list, &pool->entry );
+    }
+    ptr = pool->free_list;
+    pool->free_list = *(void **)ptr;
+    if (++pool->count > pool->peak) pool->peak = pool->count;
+    memset( ptr, 0x55, pool->size );
+    return ptr;
+}
+
+/* return a block to its memory pool */
+void pool_free( struct mem_pool *pool, void *ptr )
+{
+    if (!ptr) return;
+    assert( pool->count );
+#ifdef DEBUG_OBJECTS
+    memset( ptr, 0xaa, pool->size );
+#endif
+    *(void **)ptr = pool->free_list;
+    pool->free_list = ptr;
+    pool->count--;
+}
+
+
+/*****************************************************************/
+/* object statistics */
+
+#define OBJECT_STATS_SIZE 256  /* must be larger than the number of object types */
+
+struct object_stats
+{
+    const struct object_ops *ops;     /* object type */
+    unsigned int             count;   /* number of live objects */
+    unsigned int             peak;    /* maximum number of live objects */
+    unsigned int             total;   /* total number of objects allocated */
+    struct object           *sample;  /* a live object of this type, for dumping */
+};
+
+static struct object_stats object_stats[OBJECT_STATS_SIZE];
+
+/* find the statistics entry of an object type, creating it if needed */
+static struct object_stats *get_object_stats( const struct object_ops *ops )
+{
+    unsigned int i, hash = ((unsigned long)ops / sizeof(void *)) % OBJECT_STATS_SIZE;
+
+    for (i = 0; i < OBJECT_STATS_SIZE; i++)
+    {
+        struct object_stats *stats = &object_stats[(hash + i) % OBJECT_STATS_SIZE];
+        if (stats->ops == ops) return stats;
+        if (stats->ops) continue;
+        stats->ops = ops;
+        return stats;
+    }
+    return NULL;
+}
+
+/* dump the object and memory pool statistics to stderr */
+void dump_object_stats(void)
+{
+    struct mem_pool *pool;
+    unsigned long total = 0;
+    unsigned int i;
+
+    fprintf( stderr, "%-18s %6s %8s %8s %10s %12s  %s\n",
+             "object type", "size", "count", "peak", "allocated", "bytes", "sample" );
+    for (i = 0; i < OBJECT_STATS_SIZE; i++)
+    {
+        const struct object_stats *stats = &object_stats[i];
+
+        if (!stats->ops) continue;
+        fprintf( stderr, "%-18s %6lu %8u %8u %10u %12lu  ", stats->ops->name,
+                 (unsigned long)stats->ops->size, stats->count, stats->peak, stats->total,
+                 (unsigned long)(stats->count * stats->ops->size) );
+        if (stats->sample) stats->ops->dump( stats->sample, 0 );
+        else fputc( '\n', stderr );
+        total += stats->count * stats->ops->size;
+    }
+    fprintf( stderr, "total object bytes: %lu\n", total );
+
+    fprintf( stderr, "%-26s %6s %8s %8s %12s\n", "pool", "size", "count", "peak", "bytes" );
+    LIST_FOR_EACH_ENTRY( pool, &pool_list, struct mem_pool, entry )
+    {
+        size_t size = (pool->size + POOL_ALIGN - 1) & ~(POOL_ALIGN - 1);
+        unsigned int count = max( POOL_CHUNK_SIZE / size, 16 );
+
+        fprintf( stderr, "%-26s %6lu %8u %8u %12lu\n", pool->name, (unsigned long)pool->size,
+                 pool->count, pool->peak, (unsigned long)(pool->chunks * count * size) );
+    }
+}
+
+
 /*****************************************************************/
 
 static int get_name_hash( const struct namespace *namespace, const WCHAR *name, data_size_t len )
@@ -186,6 +306,14 @@ void *alloc_object( const struct object_ops *ops )
     struct object *obj = mem_alloc( ops->size );
     if (obj)
     {
+        struct object_stats *stats = get_object_stats( ops );
+
+        if (stats)
+        {
+            if (++stats->count > stats->peak) stats->peak = stats->count;
+            stats->total++;
+            stats->sample = obj;
+        }
         obj->refcount     = 1;
         obj->handle_count = 0;
         obj->ops          = ops;
@@ -203,6 +331,13 @@ void *alloc_object( const struct object_ops *ops )
 /* free an object once it has been destroyed */
 void free_object( struct object *obj )
 {
+    struct object_stats *stats = get_object_stats( obj->ops );
+
+    if (stats)
+    {
+        stats->count--;
+        if (stats->sample == obj) stats->sample = NULL;
+    }
     free( obj->sd );
 #ifdef DEBUG_OBJECTS
     list_remove( &obj->obj_list );
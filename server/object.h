@@ -58,6 +58,8 @@ struct object_ops
 {
     /* size of this object type */
     size_t size;
+    /* name of the object type (for statistics) */
+    const char *name;
     /* dump the object (for debugging) */
     void (*dump)(struct object *,int);
     /* return the object type */
@@ -124,8 +126,25 @@ struct wait_queue_entry
     struct thread_wait *wait;
 };
 
+/* pool of fixed-size memory blocks, allocated in chunks */
+struct mem_pool
+{
+    const char   *name;       /* name of the pool, for statistics */
+    size_t        size;       /* size of the blocks */
+    void         *free_list;  /* list of free blocks */
+    unsigned int  count;      /* number of blocks currently in use */
+    unsigned int  peak;       /* maximum number of blocks in use at the same time */
+    unsigned int  chunks;     /* number of chunks allocated */
+    struct list   entry;      /* entry in the global list of pools */
+};
+
+#define DECLARE_MEM_POOL(var,type) \
+    static struct mem_pool var = { #type, sizeof(type), NULL, 0, 0, 0, { NULL, NULL } }
+
 extern void *mem_alloc( size_t size );  /* malloc wrapper */
 extern void *memdup( const void *data, size_t len );
+extern void *pool_alloc( struct mem_pool *pool );
+extern void pool_free( struct mem_pool *pool, void *ptr );
 extern void *alloc_object( const struct object_ops *ops );
 extern void namespace_add( struct namespace *namespace, struct object_name *ptr );
 extern const WCHAR *get_object_name( struct object *obj, data_size_t *len );
@@ -165,6 +184,7 @@ extern struct object *no_open_file( struct object *obj, unsigned int access, uns
                                     unsigned int options );
 extern int no_close_handle( struct object *obj, struct process *process, obj_handle_t handle );
 extern void no_destroy( struct object *obj );
+extern void dump_object_stats(void);
 #ifdef DEBUG_OBJECTS
 extern void dump_objects(void);
 extern void close_objects(void);
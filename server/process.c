@@ -69,6 +69,7 @@ static void terminate_process( struct process *process, struct thread *skip, int
 static const struct object_ops process_ops =
 {
     sizeof(struct process),      /* size */
+    "process",                   /* name */
     process_dump,                /* dump */
     no_get_type,                 /* get_type */
     add_queue,                   /* add_queue */
@@ -119,6 +120,7 @@ static void startup_info_destroy( struct object *obj );
 static const struct object_ops startup_info_ops =
 {
     sizeof(struct startup_info),   /* size */
+    "startup_info",                /* name */
     startup_info_dump,             /* dump */
     no_get_type,                   /* get_type */
     add_queue,                     /* add_queue */
@@ -162,6 +164,7 @@ struct job
 static const struct object_ops job_ops =
 {
     sizeof(struct job),            /* size */
+    "job",                         /* name */
     job_dump,                      /* dump */
     job_get_type,                  /* get_type */
     add_queue,                     /* add_queue */
@@ -533,6 +536,7 @@ struct thread *create_process( int fd, struct thread *parent_thread, int inherit
     process->trace_data      = 0;
     process->rawinput_mouse  = NULL;
     process->rawinput_kbd    = NULL;
+    memset( &process->req_stats, 0, sizeof(process->req_stats) );
     list_init( &process->thread_list );
     list_init( &process->locks );
     list_init( &process->classes );
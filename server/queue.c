@@ -86,6 +86,9 @@ struct message
     struct message_result *result;    /* result in sender queue */
 };
 
+DECLARE_MEM_POOL( message_pool, struct message );
+DECLARE_MEM_POOL( message_result_pool, struct message_result );
+
 struct timer
 {
     struct list     entry;     /* entry in timer list */
@@ -166,6 +169,7 @@ static void timer_callback( void *private );
 static const struct object_ops msg_queue_ops =
 {
     sizeof(struct msg_queue),  /* size */
+    "msg_queue",               /* name */
     msg_queue_dump,            /* dump */
     no_get_type,               /* get_type */
     msg_queue_add_queue,       /* add_queue */
@@ -201,6 +205,7 @@ static const struct fd_ops msg_queue_fd_ops =
 static const struct object_ops thread_input_ops =
 {
     sizeof(struct thread_input),  /* size */
+    "thread_input",               /* name */
     thread_input_dump,            /* dump */
     no_get_type,                  /* get_type */
     no_add_queue,                 /* add_queue */
@@ -345,10 +350,10 @@ static void set_cursor_pos( struct desktop *desktop, int x, int y )
     struct hardware_msg_data *msg_data;
     struct message *msg;
 
-    if (!(msg = mem_alloc( sizeof(*msg) ))) return;
+    if (!(msg = pool_alloc( &message_pool ))) return;
     if (!(msg_data = mem_alloc( sizeof(*msg_data) )))
     {
-        free( msg );
+        pool_free( &message_pool, msg );
         return;
     }
     memset( msg_data, 0, sizeof(*msg_data) );
@@ -544,7 +549,7 @@ static void free_result( struct message_result *result )
     if (result->callback_msg) free_message( result->callback_msg );
     if (result->hardware_msg) free_message( result->hardware_msg );
     if (result->desktop) release_object( result->desktop );
-    free( result );
+    pool_free( &message_result_pool, result );
 }
 
 /* remove the result from the sender list it is on */
@@ -612,7 +617,7 @@ static void free_message( struct message *msg )
         store_message_result( result, 0, STATUS_ACCESS_DENIED /*FIXME*/ );
     }
     free( msg->data );
-    free( msg );
+    pool_free( &message_pool, msg );
 }
 
 /* remove (and free) a message from a message list */
@@ -661,7 +666,7 @@ static struct message_result *alloc_message_result( struct msg_queue *send_queue
                                                     struct msg_queue *recv_queue,
                                                     struct message *msg, timeout_t timeout )
 {
-    struct message_result *result = mem_alloc( sizeof(*result) );
+    struct message_result *result = pool_alloc( &message_result_pool );
     if (result)
     {
         result->msg          = msg;
@@ -677,11 +682,11 @@ static struct message_result *alloc_message_result( struct msg_queue *send_queue
 
         if (msg->type == MSG_CALLBACK)
         {
-            struct message *callback_msg = mem_alloc( sizeof(*callback_msg) );
+            struct message *callback_msg = pool_alloc( &message_pool );
 
             if (!callback_msg)
             {
-                free( result );
+                pool_free( &message_result_pool, result );
                 return NULL;
             }
             callback_msg->type      = MSG_CALLBACK_RESULT;
@@ -743,7 +748,7 @@ static void receive_message( struct msg_queue *queue, struct message *msg,
         result->recv_next  = queue->recv_result;
         queue->recv_result = result;
     }
-    free( msg );
+    pool_free( &message_pool, msg );
     if (list_empty( &queue->msg_list[SEND_MESSAGE] )) clear_queue_bits( queue, QS_SENDMESSAGE );
 }
 
@@ -1550,7 +1555,7 @@ static int send_hook_ll_message( struct desktop *desktop, struct message *hardwa
     if (!(queue = hook_thread->queue)) return 0;
     if (is_queue_hung( queue )) return 0;
 
-    if (!(msg = mem_alloc( sizeof(*msg) ))) return 0;
+    if (!(msg = pool_alloc( &message_pool ))) return 0;
 
     msg->type      = MSG_HOOK_LL;
     msg->win       = 0;
@@ -1639,10 +1644,10 @@ static int queue_mouse_message( struct desktop *desktop, user_handle_t win, cons
 
     if ((device = current->process->rawinput_mouse))
     {
-        if (!(msg = mem_alloc( sizeof(*msg) ))) return 0;
+        if (!(msg = pool_alloc( &message_pool ))) return 0;
         if (!(msg_data = mem_alloc( sizeof(*msg_data) )))
         {
-            free( msg );
+            pool_free( &message_pool, msg );
             return 0;
         }
 
@@ -1672,10 +1677,10 @@ static int queue_mouse_message( struct desktop *desktop, user_handle_t win, cons
         if (!(flags & (1 << i))) continue;
         flags &= ~(1 << i);
 
-        if (!(msg = mem_alloc( sizeof(*msg) ))) return 0;
+        if (!(msg = pool_alloc( &message_pool ))) return 0;
         if (!(msg_data = mem_alloc( sizeof(*msg_data) )))
         {
-            free( msg );
+            pool_free( &message_pool, msg );
             return 0;
         }
         memset( msg_data, 0, sizeof(*msg_data) );
@@ -1785,10 +1790,10 @@ static int queue_keyboard_message( struct desktop *desktop, user_handle_t win, c
 
     if ((device = current->process->rawinput_kbd))
     {
-        if (!(msg = mem_alloc( sizeof(*msg) ))) return 0;
+        if (!(msg = pool_alloc( &message_pool ))) return 0;
         if (!(msg_data = mem_alloc( sizeof(*msg_data) )))
         {
-            free( msg );
+            pool_free( &message_pool, msg );
             return 0;
         }
 
@@ -1812,10 +1817,10 @@ static int queue_keyboard_message( struct desktop *desktop, user_handle_t win, c
         queue_hardware_message( desktop, msg, 0 );
     }
 
-    if (!(msg = mem_alloc( sizeof(*msg) ))) return 0;
+    if (!(msg = pool_alloc( &message_pool ))) return 0;
     if (!(msg_data = mem_alloc( sizeof(*msg_data) )))
     {
-        free( msg );
+        pool_free( &message_pool, msg );
         return 0;
     }
     memset( msg_data, 0, sizeof(*msg_data) );
@@ -1861,10 +1866,10 @@ static void queue_custom_hardware_message( struct desktop *desktop, user_handle_
     struct hardware_msg_data *msg_data;
     struct message *msg;
 
-    if (!(msg = mem_alloc( sizeof(*msg) ))) return;
+    if (!(msg = pool_alloc( &message_pool ))) return;
     if (!(msg_data = mem_alloc( sizeof(*msg_data) )))
     {
-        free( msg );
+        pool_free( &message_pool, msg );
         return;
     }
     memset( msg_data, 0, sizeof(*msg_data) );
@@ -2088,7 +2093,7 @@ void post_message( user_handle_t win, unsigned int message, lparam_t wparam, lpa
 
     if (!thread) return;
 
-    if (thread->queue && (msg = mem_alloc( sizeof(*msg) )))
+    if (thread->queue && (msg = pool_alloc( &message_pool )))
     {
         msg->type      = MSG_POSTED;
         msg->win       = get_user_full_handle( win );
@@ -2121,7 +2126,7 @@ void post_win_event( struct thread *thread, unsigned int event,
 {
     struct message *msg;
 
-    if (thread->queue && (msg = mem_alloc( sizeof(*msg) )))
+    if (thread->queue && (msg = pool_alloc( &message_pool )))
     {
         struct winevent_msg_data *data;
 
@@ -2150,7 +2155,7 @@ void post_win_event( struct thread *thread, unsigned int event,
             set_queue_bits( thread->queue, QS_SENDMESSAGE );
         }
         else
-            free( msg );
+            pool_free( &message_pool, msg );
     }
 }
 
@@ -2278,7 +2283,7 @@ DECL_HANDLER(send_message)
         return;
     }
 
-    if ((msg = mem_alloc( sizeof(*msg) )))
+    if ((msg = pool_alloc( &message_pool )))
     {
         msg->type      = req->type;
         msg->win       = get_user_full_handle( req->win );
@@ -2293,7 +2298,7 @@ DECL_HANDLER(send_message)
 
         if (msg->data_size && !(msg->data = memdup( get_req_data(), msg->data_size )))
         {
-            free( msg );
+            pool_free( &message_pool, msg );
             release_object( thread );
             return;
         }
@@ -2328,7 +2333,7 @@ DECL_HANDLER(send_message)
         case MSG_HOOK_LL:  /* generated internally */
         default:
             set_error( STATUS_INVALID_PARAMETER );
-            free( msg );
+            pool_free( &message_pool, msg );
             break;
         }
     }
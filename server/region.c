@@ -91,6 +91,7 @@ struct region
 
 
 #define RGN_DEFAULT_RECTS 2
+#define RGN_SHRINK_RECTS  32  /* don't bother shrinking rectangle arrays below this size */
 
 #define EXTENTCHECK(r1, r2) \
     ((r1)->right > (r2)->left && \
@@ -105,6 +106,68 @@ typedef int (*non_overlap_func_t)( struct region *reg, const rectangle_t *r,
 
 static const rectangle_t empty_rect;  /* all-zero rectangle for empty regions */
 
+/* spare rectangle array kept around to avoid an allocation on every region operation */
+static rectangle_t *spare_rects;
+static int spare_size;
+
+/* get a rectangle array with at least the specified size, reusing the spare one if possible */
+static rectangle_t *alloc_rects( int *size )
+{
+    rectangle_t *rects;
+
+    if (spare_rects && spare_size >= *size)
+    {
+        rects = spare_rects;
+        *size = spare_size;
+        spare_rects = NULL;
+        spare_size = 0;
+        return rects;
+    }
+    return mem_alloc( *size * sizeof(*rects) );
+}
+
+/* release a rectangle array, keeping the largest one as the spare array */
+static void free_rects( rectangle_t *rects, int size )
+{
+    if (size > spare_size)
+    {
+        free( spare_rects );
+        spare_rects = rects;
+        spare_size = size;
+    }
+    else free( rects );
+}
+
+/* make sure a region has room for the specified number of rectangles, discarding its contents */
+static int reserve_rects( struct region *region, int count )
+{
+    rectangle_t *rects;
+
+    if (region->size >= count) return 1;
+    if (!(rects = alloc_rects( &count ))) return 0;
+    free_rects( region->rects, region->size );
+    region->rects = rects;
+    region->size = count;
+    return 1;
+}
+
+/* set an empty region */
+static inline void set_region_empty( struct region *region )
+{
+    region->num_rects = 0;
+    region->extents.left = 0;
+    region->extents.top = 0;
+    region->extents.right = 0;
+    region->extents.bottom = 0;
+}
+
+/* check if a rectangle entirely contains another one */
+static inline int rect_contains( const rectangle_t *outer, const rectangle_t *inner )
+{
+    return (outer->left <= inner->left && outer->top <= inner->top &&
+            outer->right >= inner->right && outer->bottom >= inner->bottom);
+}
+
 /* add a rectangle to a region */
 static inline rectangle_t *add_rect( struct region *reg )
 {
@@ -220,10 +283,10 @@ static int region_op( struct region *newReg, const struct region *reg1, const st
     const rectangle_t *r2End = r2 + reg2->num_rects;
 
     rectangle_t *new_rects, *old_rects = newReg->rects;
-    int new_size, ret = 0;
+    int new_size, old_size = newReg->size, ret = 0;
 
     new_size = max( reg1->num_rects, reg2->num_rects ) * 2;
-    if (!(new_rects = mem_alloc( new_size * sizeof(*newReg->rects) ))) return 0;
+    if (!(new_rects = alloc_rects( &new_size ))) return 0;
 
     newReg->size = new_size;
     newReg->rects = new_rects;
@@ -321,7 +384,7 @@ static int region_op( struct region *newReg, const struct region *reg1, const st
 
     if (newReg->num_rects != curBand) coalesce_region(newReg, prevBand, curBand);
 
-    if ((newReg->num_rects < (newReg->size / 2)) && (newReg->size > 2))
+    if ((newReg->num_rects < (newReg->size / 2)) && (newReg->size > RGN_SHRINK_RECTS))
     {
         new_size = max( newReg->num_rects, RGN_DEFAULT_RECTS );
         if ((new_rects = realloc( newReg->rects, sizeof(*newReg->rects) * new_size )))
@@ -332,7 +395,7 @@ static int region_op( struct region *newReg, const struct region *reg1, const st
     }
     ret = 1;
 done:
-    free( old_rects );
+    free_rects( old_rects, old_size );
     return ret;
 }
 
@@ -561,6 +624,104 @@ static int union_overlapping( struct region *pReg,
 }
 
 
+/* clip a region to a rectangle; dst can be the source region */
+static struct region *clip_region_to_rect( struct region *dst, const struct region *src,
+                                           const rectangle_t *clip )
+{
+    const rectangle_t *ptr, *end, *band_end, *rect;
+    rectangle_t clip_rect = *clip;  /* clip may point into dst */
+    int prev_band = 0, cur_band;
+
+    rect = &clip_rect;
+
+    if (dst != src && !reserve_rects( dst, src->num_rects )) return NULL;
+
+    /* we never produce more rectangles than we consume, so this works in place too */
+    ptr = src->rects;
+    end = src->rects + src->num_rects;
+    dst->num_rects = 0;
+    while (ptr < end)
+    {
+        rectangle_t band = *ptr;
+
+        for (band_end = ptr; band_end < end && band_end->top == band.top; band_end++) ;
+
+        if (band.bottom <= rect->top)
+        {
+            ptr = band_end;
+            continue;
+        }
+        if (band.top >= rect->bottom) break;
+        band.top = max( band.top, rect->top );
+        band.bottom = min( band.bottom, rect->bottom );
+
+        cur_band = dst->num_rects;
+        for ( ; ptr < band_end; ptr++)
+        {
+            rectangle_t *out;
+
+            if (ptr->right <= rect->left) continue;
+            if (ptr->left >= rect->right) break;
+            out = &dst->rects[dst->num_rects++];
+            out->left   = max( ptr->left, rect->left );
+            out->right  = min( ptr->right, rect->right );
+            out->top    = band.top;
+            out->bottom = band.bottom;
+        }
+        ptr = band_end;
+        if (dst->num_rects != cur_band && cur_band)
+            prev_band = coalesce_region( dst, prev_band, cur_band );
+    }
+    set_region_extents( dst );
+    return dst;
+}
+
+/* subtract a rectangle from another one, storing the result in dst */
+static struct region *subtract_rects( struct region *dst, const rectangle_t *r1, const rectangle_t *r2 )
+{
+    rectangle_t src = *r1, *out;
+    int top = max( src.top, r2->top ), bottom = min( src.bottom, r2->bottom );
+
+    if (!reserve_rects( dst, 4 )) return NULL;
+    out = dst->rects;
+
+    if (src.top < top)  /* band above r2 */
+    {
+        out->left = src.left;
+        out->right = src.right;
+        out->top = src.top;
+        out->bottom = top;
+        out++;
+    }
+    if (src.left < r2->left)  /* left part of the middle band */
+    {
+        out->left = src.left;
+        out->right = r2->left;
+        out->top = top;
+        out->bottom = bottom;
+        out++;
+    }
+    if (src.right > r2->right)  /* right part of the middle band */
+    {
+        out->left = r2->right;
+        out->right = src.right;
+        out->top = top;
+        out->bottom = bottom;
+        out++;
+    }
+    if (src.bottom > bottom)  /* band below r2 */
+    {
+        out->left = src.left;
+        out->right = src.right;
+        out->top = bottom;
+        out->bottom = src.bottom;
+        out++;
+    }
+    dst->num_rects = out - dst->rects;
+    set_region_extents( dst );
+    return dst;
+}
+
 /* create an empty region */
 struct region *create_empty_region(void)
 {
@@ -763,13 +924,20 @@ struct region *intersect_region( struct region *dst, const struct region *src1,
 {
     if (!src1->num_rects || !src2->num_rects || !EXTENTCHECK(&src1->extents, &src2->extents))
     {
-        dst->num_rects = 0;
-        dst->extents.left = 0;
-        dst->extents.top = 0;
-        dst->extents.right = 0;
-        dst->extents.bottom = 0;
+        set_region_empty( dst );
         return dst;
     }
+    /* fast paths when one of the regions is a single rectangle */
+    if (src1->num_rects == 1)
+    {
+        if (rect_contains( &src1->extents, &src2->extents )) return copy_region( dst, src2 );
+        return clip_region_to_rect( dst, src2, &src1->extents );
+    }
+    if (src2->num_rects == 1)
+    {
+        if (rect_contains( &src2->extents, &src1->extents )) return copy_region( dst, src1 );
+        return clip_region_to_rect( dst, src1, &src2->extents );
+    }
     if (!region_op( dst, src1, src2, intersect_overlapping, NULL, NULL )) return NULL;
     set_region_extents( dst );
     return dst;
@@ -782,6 +950,17 @@ struct region *subtract_region( struct region *dst, const struct region *src1,
     if (!src1->num_rects || !src2->num_rects || !EXTENTCHECK(&src1->extents, &src2->extents))
         return copy_region( dst, src1 );
 
+    /* fast paths when subtracting a single rectangle */
+    if (src2->num_rects == 1)
+    {
+        if (rect_contains( &src2->extents, &src1->extents ))
+        {
+            set_region_empty( dst );
+            return dst;
+        }
+        if (src1->num_rects == 1) return subtract_rects( dst, &src1->extents, &src2->extents );
+    }
+
     if (!region_op( dst, src1, src2, subtract_overlapping,
                     subtract_non_overlapping, NULL )) return NULL;
     set_region_extents( dst );
@@ -92,6 +92,7 @@ static void master_socket_poll_event( struct fd *fd, int event );
 static const struct object_ops master_socket_ops =
 {
     sizeof(struct master_socket),  /* size */
+    "master_socket",               /* name */
     master_socket_dump,            /* dump */
     no_get_type,                   /* get_type */
     no_add_queue,                  /* add_queue */
@@ -133,6 +134,9 @@ int config_dir_fd = -1;    /* file descriptor for the config dir */
 static struct master_socket *master_socket;  /* the master socket object */
 static struct timeout_user *master_timeout;
 
+/* per-request statistics, the last entry holds the server-wide totals */
+static struct request_stat req_stats[REQ_NB_REQUESTS + 1];
+
 /* complain about a protocol error and terminate the client connection */
 void fatal_protocol_error( struct thread *thread, const char *err, ... )
 {
@@ -287,11 +291,47 @@ static void send_reply( union generic_reply *reply )
         fatal_protocol_error( current, "reply write: %s\n", strerror( errno ));
 }
 
+/* get a monotonic time stamp for request accounting, in 100ns units */
+static inline timeout_t get_request_time(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+    struct timespec ts;
+
+    if (!clock_gettime( CLOCK_MONOTONIC, &ts ))
+        return (timeout_t)ts.tv_sec * TICKS_PER_SEC + ts.tv_nsec / 100;
+#endif
+    {
+        struct timeval now;
+        gettimeofday( &now, NULL );
+        return (timeout_t)now.tv_sec * TICKS_PER_SEC + now.tv_usec * 10;
+    }
+}
+
+/* account for a completed request */
+static inline void update_request_stat( struct request_stat *stat, timeout_t elapsed,
+                                        data_size_t in, data_size_t out )
+{
+    stat->calls++;
+    stat->total_time += elapsed;
+    if (elapsed > stat->max_time) stat->max_time = elapsed;
+    stat->bytes_in += in;
+    stat->bytes_out += out;
+}
+
+/* print the server-wide request statistics to stderr */
+void print_request_stats(void)
+{
+    dump_request_stats( req_stats );
+}
+
 /* call a request handler */
 static void call_req_handler( struct thread *thread )
 {
     union generic_reply reply;
     enum request req = thread->req.request_header.req;
+    struct process *process = thread->process;
+    data_size_t reply_size = 0;
+    timeout_t start = get_request_time();
 
     current = thread;
     current->reply_size = 0;
@@ -311,6 +351,7 @@ static void call_req_handler( struct thread *thread )
         {
             reply.reply_header.error = current->error;
             reply.reply_header.reply_size = current->reply_size;
+            reply_size = current->reply_size;
             if (debug_level) trace_reply( req, &reply );
             send_reply( &reply );
         }
@@ -321,6 +362,17 @@ static void call_req_handler( struct thread *thread )
         }
     }
     current = NULL;
+
+    if (req < REQ_NB_REQUESTS)
+    {
+        timeout_t elapsed = get_request_time() - start;
+        data_size_t in = sizeof(thread->req) + thread->req.request_header.request_size;
+        data_size_t out = sizeof(reply) + reply_size;
+
+        update_request_stat( &req_stats[req], elapsed, in, out );
+        update_request_stat( &req_stats[REQ_NB_REQUESTS], elapsed, in, out );
+        update_request_stat( &process->req_stats, elapsed, in, out );
+    }
 }
 
 /* read a request from a thread */
@@ -898,3 +950,45 @@ void close_master_socket( timeout_t timeout )
 
     master_timeout = add_timeout_user( timeout, close_socket_timeout, NULL );
 }
+
+/* retrieve the request statistics */
+DECL_HANDLER(get_request_stats)
+{
+    const struct request_stat *total = &req_stats[REQ_NB_REQUESTS];
+    struct request_stat *stat;
+    unsigned int i, count = 0;
+
+    if (req->process)
+    {
+        struct process *process = get_process_from_handle( req->process, PROCESS_QUERY_INFORMATION );
+
+        if (!process) return;
+        reply->calls      = process->req_stats.calls;
+        reply->total_time = process->req_stats.total_time;
+        reply->bytes_in   = process->req_stats.bytes_in;
+        reply->bytes_out  = process->req_stats.bytes_out;
+        release_object( process );
+        return;
+    }
+
+    reply->calls      = total->calls;
+    reply->total_time = total->total_time;
+    reply->bytes_in   = total->bytes_in;
+    reply->bytes_out  = total->bytes_out;
+
+    for (i = 0; i < REQ_NB_REQUESTS; i++) if (req_stats[i].calls) count++;
+    reply->count = count;
+
+    if (get_reply_max_size() < count * sizeof(*stat))
+        set_error( STATUS_BUFFER_TOO_SMALL );
+    else if ((stat = set_reply_data_size( count * sizeof(*stat) )))
+    {
+        for (i = 0; i < REQ_NB_REQUESTS; i++)
+        {
+            if (!req_stats[i].calls) continue;
+            *stat = req_stats[i];
+            stat->req = i;
+            stat++;
+        }
+    }
+}
@@ -64,6 +64,8 @@ extern int server_dir_fd, config_dir_fd;
 
 extern void trace_request(void);
 extern void trace_reply( enum request req, const union generic_reply *reply );
+extern void dump_request_stats( const struct request_stat *stats );
+extern void print_request_stats(void);
 
 /* get the request vararg data */
 static inline const void *get_req_data(void)
@@ -157,6 +159,7 @@ DECL_HANDLER(open_file_object);
 DECL_HANDLER(alloc_file_handle);
 DECL_HANDLER(get_handle_unix_name);
 DECL_HANDLER(get_handle_fd);
+DECL_HANDLER(get_handle_fds);
 DECL_HANDLER(get_directory_cache_entry);
 DECL_HANDLER(flush);
 DECL_HANDLER(lock_file);
@@ -385,6 +388,7 @@ DECL_HANDLER(process_in_job);
 DECL_HANDLER(set_job_limits);
 DECL_HANDLER(set_job_completion_port);
 DECL_HANDLER(terminate_job);
+DECL_HANDLER(get_request_stats);
 
 #ifdef WANT_REQUEST_HANDLERS
 
@@ -436,6 +440,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_alloc_file_handle,
     (req_handler)req_get_handle_unix_name,
     (req_handler)req_get_handle_fd,
+    (req_handler)req_get_handle_fds,
     (req_handler)req_get_directory_cache_entry,
     (req_handler)req_flush,
     (req_handler)req_lock_file,
@@ -664,6 +669,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_set_job_limits,
     (req_handler)req_set_job_completion_port,
     (req_handler)req_terminate_job,
+    (req_handler)req_get_request_stats,
 };
 
 C_ASSERT( sizeof(affinity_t) == 8 );
@@ -957,9 +963,13 @@ C_ASSERT( FIELD_OFFSET(struct create_file_request, sharing) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, create) == 20 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, options) == 24 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, attrs) == 28 );
-C_ASSERT( sizeof(struct create_file_request) == 32 );
+C_ASSERT( FIELD_OFFSET(struct create_file_request, want_fd) == 32 );
+C_ASSERT( sizeof(struct create_file_request) == 40 );
 C_ASSERT( FIELD_OFFSET(struct create_file_reply, handle) == 8 );
-C_ASSERT( sizeof(struct create_file_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct create_file_reply, type) == 12 );
+C_ASSERT( FIELD_OFFSET(struct create_file_reply, access) == 16 );
+C_ASSERT( FIELD_OFFSET(struct create_file_reply, options) == 20 );
+C_ASSERT( sizeof(struct create_file_reply) == 24 );
 C_ASSERT( FIELD_OFFSET(struct open_file_object_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct open_file_object_request, attributes) == 16 );
 C_ASSERT( FIELD_OFFSET(struct open_file_object_request, rootdir) == 20 );
@@ -985,6 +995,8 @@ C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, cacheable) == 12 );
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, access) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, options) == 20 );
 C_ASSERT( sizeof(struct get_handle_fd_reply) == 24 );
+C_ASSERT( sizeof(struct get_handle_fds_request) == 16 );
+C_ASSERT( sizeof(struct get_handle_fds_reply) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_directory_cache_entry_request, handle) == 12 );
 C_ASSERT( sizeof(struct get_directory_cache_entry_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_directory_cache_entry_reply, entry) == 8 );
@@ -2306,6 +2318,14 @@ C_ASSERT( sizeof(struct set_job_completion_port_request) == 32 );
 C_ASSERT( FIELD_OFFSET(struct terminate_job_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct terminate_job_request, status) == 16 );
 C_ASSERT( sizeof(struct terminate_job_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_request_stats_request, process) == 12 );
+C_ASSERT( sizeof(struct get_request_stats_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_request_stats_reply, calls) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_request_stats_reply, count) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_request_stats_reply, total_time) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_request_stats_reply, bytes_in) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_request_stats_reply, bytes_out) == 32 );
+C_ASSERT( sizeof(struct get_request_stats_reply) == 40 );
 
 #endif  /* WANT_REQUEST_HANDLERS */
 
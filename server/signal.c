@@ -62,6 +62,7 @@ static void handler_destroy( struct object *obj );
 static const struct object_ops handler_ops =
 {
     sizeof(struct handler),   /* size */
+    "handler",                /* name */
     handler_dump,             /* dump */
     no_get_type,              /* get_type */
     no_add_queue,             /* add_queue */
@@ -100,6 +101,7 @@ static struct handler *handler_sigterm;
 static struct handler *handler_sigint;
 static struct handler *handler_sigchld;
 static struct handler *handler_sigio;
+static struct handler *handler_sigusr1;
 
 static int watchdog;
 
@@ -195,6 +197,13 @@ static void sigint_callback(void)
     shutdown_master_socket();
 }
 
+/* SIGUSR1 callback */
+static void sigusr1_callback(void)
+{
+    print_request_stats();
+    dump_object_stats();
+}
+
 /* SIGHUP handler */
 static void do_sighup( int signum )
 {
@@ -213,6 +222,12 @@ static void do_sigint( int signum )
     do_signal( handler_sigint );
 }
 
+/* SIGUSR1 handler */
+static void do_sigusr1( int signum )
+{
+    do_signal( handler_sigusr1 );
+}
+
 /* SIGALRM handler */
 static void do_sigalrm( int signum )
 {
@@ -279,6 +294,7 @@ void init_signals(void)
     if (!(handler_sigint  = create_handler( sigint_callback ))) goto error;
     if (!(handler_sigchld = create_handler( sigchld_callback ))) goto error;
     if (!(handler_sigio   = create_handler( sigio_callback ))) goto error;
+    if (!(handler_sigusr1 = create_handler( sigusr1_callback ))) goto error;
 
     sigemptyset( &blocked_sigset );
     sigaddset( &blocked_sigset, SIGCHLD );
@@ -288,6 +304,7 @@ void init_signals(void)
     sigaddset( &blocked_sigset, SIGIO );
     sigaddset( &blocked_sigset, SIGQUIT );
     sigaddset( &blocked_sigset, SIGTERM );
+    sigaddset( &blocked_sigset, SIGUSR1 );
 #ifdef SIG_PTHREAD_CANCEL
     sigaddset( &blocked_sigset, SIG_PTHREAD_CANCEL );
 #endif
@@ -305,6 +322,8 @@ void init_signals(void)
     sigaction( SIGINT, &action, NULL );
     action.sa_handler = do_sigalrm;
     sigaction( SIGALRM, &action, NULL );
+    action.sa_handler = do_sigusr1;
+    sigaction( SIGUSR1, &action, NULL );
     action.sa_handler = do_sigterm;
     sigaction( SIGQUIT, &action, NULL );
     sigaction( SIGTERM, &action, NULL );
@@ -56,6 +56,7 @@ static void snapshot_destroy( struct object *obj );
 static const struct object_ops snapshot_ops =
 {
     sizeof(struct snapshot),      /* size */
+    "snapshot",                   /* name */
     snapshot_dump,                /* dump */
     no_get_type,                  /* get_type */
     no_add_queue,                 /* add_queue */
@@ -141,6 +141,7 @@ static void sock_set_error(void);
 static const struct object_ops sock_ops =
 {
     sizeof(struct sock),          /* size */
+    "sock",                       /* name */
     sock_dump,                    /* dump */
     no_get_type,                  /* get_type */
     add_queue,                    /* add_queue */
@@ -985,6 +986,7 @@ struct ifchange
 static const struct object_ops ifchange_ops =
 {
     sizeof(struct ifchange), /* size */
+    "ifchange",              /* name */
     ifchange_dump,           /* dump */
     no_get_type,             /* get_type */
     add_queue,               /* add_queue */
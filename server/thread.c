@@ -76,6 +76,7 @@ struct thread_wait
     int                     count;      /* count of objects */
     int                     flags;
     int                     abandoned;
+    int                     pooled;     /* allocated from the wait pool? */
     enum select_op          select;
     client_ptr_t            key;        /* wait key for keyed events */
     client_ptr_t            cookie;     /* magic cookie to return to client */
@@ -84,6 +85,9 @@ struct thread_wait
     struct wait_queue_entry queues[1];
 };
 
+/* waits on at most one object are allocated from a pool */
+DECLARE_MEM_POOL( wait_pool, struct thread_wait );
+
 /* asynchronous procedure calls */
 
 struct thread_apc
@@ -105,6 +109,7 @@ static void clear_apc_queue( struct list *queue );
 static const struct object_ops thread_apc_ops =
 {
     sizeof(struct thread_apc),  /* size */
+    "thread_apc",               /* name */
     dump_thread_apc,            /* dump */
     no_get_type,                /* get_type */
     add_queue,                  /* add_queue */
@@ -136,6 +141,7 @@ static void destroy_thread( struct object *obj );
 static const struct object_ops thread_ops =
 {
     sizeof(struct thread),      /* size */
+    "thread",                   /* name */
     dump_thread,                /* dump */
     no_get_type,                /* get_type */
     add_queue,                  /* add_queue */
@@ -595,7 +601,8 @@ static void end_wait( struct thread *thread )
     for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
         entry->obj->ops->remove_queue( entry->obj, entry );
     if (wait->user) remove_timeout_user( wait->user );
-    free( wait );
+    if (wait->pooled) pool_free( &wait_pool, wait );
+    else free( wait );
 }
 
 /* build the thread wait structure */
@@ -606,7 +613,16 @@ static int wait_on( const select_op_t *select_op, unsigned int count, struct obj
     struct wait_queue_entry *entry;
     unsigned int i;
 
-    if (!(wait = mem_alloc( FIELD_OFFSET(struct thread_wait, queues[count]) ))) return 0;
+    if (count <= 1)
+    {
+        if (!(wait = pool_alloc( &wait_pool ))) return 0;
+        wait->pooled = 1;
+    }
+    else
+    {
+        if (!(wait = mem_alloc( FIELD_OFFSET(struct thread_wait, queues[count]) ))) return 0;
+        wait->pooled = 0;
+    }
     wait->next    = current->wait;
     wait->thread  = current;
     wait->count   = count;
@@ -146,6 +146,7 @@ static void token_destroy( struct object *obj );
 static const struct object_ops token_ops =
 {
     sizeof(struct token),      /* size */
+    "token",                   /* name */
     token_dump,                /* dump */
     no_get_type,               /* get_type */
     no_add_queue,              /* add_queue */
@@ -1149,6 +1149,23 @@ static void dump_varargs_rawinput_devices(const char *prefix, data_size_t size )
     fputc( '}', stderr );
 }
 
+static void dump_varargs_handle_fd_infos( const char *prefix, data_size_t size )
+{
+    const struct handle_fd_info *info;
+
+    fprintf( stderr, "%s{", prefix );
+    while (size >= sizeof(*info))
+    {
+        info = cur_data;
+        fprintf( stderr, "{handle=%04x,type=%d,access=%08x,options=%08x}",
+                 info->handle, info->type, info->access, info->options );
+        size -= sizeof(*info);
+        remove_data( sizeof(*info) );
+        if (size) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+}
+
 static void dump_varargs_handle_infos( const char *prefix, data_size_t size )
 {
     const struct handle_info *handle;
@@ -1166,6 +1183,27 @@ static void dump_varargs_handle_infos( const char *prefix, data_size_t size )
     fputc( '}', stderr );
 }
 
+static void dump_varargs_request_stats( const char *prefix, data_size_t size )
+{
+    const struct request_stat *stat;
+
+    fprintf( stderr, "%s{", prefix );
+    while (size >= sizeof(*stat))
+    {
+        stat = cur_data;
+        fprintf( stderr, "{req=%u,calls=%u", stat->req, stat->calls );
+        dump_uint64( ",total_time=", (const unsigned __int64 *)&stat->total_time );
+        dump_uint64( ",max_time=", (const unsigned __int64 *)&stat->max_time );
+        dump_uint64( ",bytes_in=", &stat->bytes_in );
+        dump_uint64( ",bytes_out=", &stat->bytes_out );
+        fputc( '}', stderr );
+        size -= sizeof(*stat);
+        remove_data( sizeof(*stat) );
+        if (size) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+}
+
 typedef void (*dump_func)( const void *req );
 
 /* Everything below this line is generated automatically by tools/make_requests */
@@ -1669,6 +1707,7 @@ static void dump_create_file_request( const struct create_file_request *req )
     fprintf( stderr, ", create=%d", req->create );
     fprintf( stderr, ", options=%08x", req->options );
     fprintf( stderr, ", attrs=%08x", req->attrs );
+    fprintf( stderr, ", want_fd=%d", req->want_fd );
     dump_varargs_object_attributes( ", objattr=", cur_size );
     dump_varargs_string( ", filename=", cur_size );
 }
@@ -1676,6 +1715,9 @@ static void dump_create_file_request( const struct create_file_request *req )
 static void dump_create_file_reply( const struct create_file_reply *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", type=%d", req->type );
+    fprintf( stderr, ", access=%08x", req->access );
+    fprintf( stderr, ", options=%08x", req->options );
 }
 
 static void dump_open_file_object_request( const struct open_file_object_request *req )
@@ -1729,6 +1771,15 @@ static void dump_get_handle_fd_reply( const struct get_handle_fd_reply *req )
     fprintf( stderr, ", options=%08x", req->options );
 }
 
+static void dump_get_handle_fds_request( const struct get_handle_fds_request *req )
+{
+}
+
+static void dump_get_handle_fds_reply( const struct get_handle_fds_reply *req )
+{
+    dump_varargs_handle_fd_infos( " fds=", cur_size );
+}
+
 static void dump_get_directory_cache_entry_request( const struct get_directory_cache_entry_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -4322,6 +4373,21 @@ static void dump_terminate_job_request( const struct terminate_job_request *req
     fprintf( stderr, ", status=%d", req->status );
 }
 
+static void dump_get_request_stats_request( const struct get_request_stats_request *req )
+{
+    fprintf( stderr, " process=%04x", req->process );
+}
+
+static void dump_get_request_stats_reply( const struct get_request_stats_reply *req )
+{
+    fprintf( stderr, " calls=%08x", req->calls );
+    fprintf( stderr, ", count=%08x", req->count );
+    dump_timeout( ", total_time=", &req->total_time );
+    dump_uint64( ", bytes_in=", &req->bytes_in );
+    dump_uint64( ", bytes_out=", &req->bytes_out );
+    dump_varargs_request_stats( ", stats=", cur_size );
+}
+
 static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_new_process_request,
     (dump_func)dump_get_new_process_info_request,
@@ -4368,6 +4434,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_alloc_file_handle_request,
     (dump_func)dump_get_handle_unix_name_request,
     (dump_func)dump_get_handle_fd_request,
+    (dump_func)dump_get_handle_fds_request,
     (dump_func)dump_get_directory_cache_entry_request,
     (dump_func)dump_flush_request,
     (dump_func)dump_lock_file_request,
@@ -4596,6 +4663,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_set_job_limits_request,
     (dump_func)dump_set_job_completion_port_request,
     (dump_func)dump_terminate_job_request,
+    (dump_func)dump_get_request_stats_request,
 };
 
 static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
@@ -4644,6 +4712,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_alloc_file_handle_reply,
     (dump_func)dump_get_handle_unix_name_reply,
     (dump_func)dump_get_handle_fd_reply,
+    (dump_func)dump_get_handle_fds_reply,
     (dump_func)dump_get_directory_cache_entry_reply,
     (dump_func)dump_flush_reply,
     (dump_func)dump_lock_file_reply,
@@ -4872,6 +4941,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     NULL,
     NULL,
+    (dump_func)dump_get_request_stats_reply,
 };
 
 static const char * const req_names[REQ_NB_REQUESTS] = {
@@ -4920,6 +4990,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "alloc_file_handle",
     "get_handle_unix_name",
     "get_handle_fd",
+    "get_handle_fds",
     "get_directory_cache_entry",
     "flush",
     "lock_file",
@@ -5148,6 +5219,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "set_job_limits",
     "set_job_completion_port",
     "terminate_job",
+    "get_request_stats",
 };
 
 static const struct
@@ -5221,6 +5293,7 @@ static const struct
     { "NAME_TOO_LONG",               STATUS_NAME_TOO_LONG },
     { "NETWORK_BUSY",                STATUS_NETWORK_BUSY },
     { "NETWORK_UNREACHABLE",         STATUS_NETWORK_UNREACHABLE },
+    { "NOTIFY_ENUM_DIR",             STATUS_NOTIFY_ENUM_DIR },
     { "NOT_ALL_ASSIGNED",            STATUS_NOT_ALL_ASSIGNED },
     { "NOT_A_DIRECTORY",             STATUS_NOT_A_DIRECTORY },
     { "NOT_FOUND",                   STATUS_NOT_FOUND },
@@ -5321,3 +5394,28 @@ void trace_reply( enum request req, const union generic_reply *reply )
     else fprintf( stderr, "%04x: %d() = %s\n",
                   current->id, req, get_status_name(current->error) );
 }
+
+/* dump the per-request statistics in a human-readable form */
+void dump_request_stats( const struct request_stat *stats )
+{
+    const struct request_stat *total = &stats[REQ_NB_REQUESTS];
+    int i;
+
+    fprintf( stderr, "%-32s %10s %12s %10s %10s %14s %14s\n",
+             "request", "calls", "total (us)", "avg (us)", "max (us)",
+             "bytes in", "bytes out" );
+    for (i = 0; i < REQ_NB_REQUESTS; i++)
+    {
+        if (!stats[i].calls) continue;
+        fprintf( stderr, "%-32s %10u %12lu %10lu %10lu %14lu %14lu\n",
+                 req_names[i], stats[i].calls,
+                 (unsigned long)(stats[i].total_time / 10),
+                 (unsigned long)(stats[i].total_time / 10 / stats[i].calls),
+                 (unsigned long)(stats[i].max_time / 10),
+                 (unsigned long)stats[i].bytes_in, (unsigned long)stats[i].bytes_out );
+    }
+    fprintf( stderr, "%-32s %10u %12lu %10s %10lu %14lu %14lu\n",
+             "total", total->calls, (unsigned long)(total->total_time / 10), "",
+             (unsigned long)(total->max_time / 10),
+             (unsigned long)total->bytes_in, (unsigned long)total->bytes_out );
+}